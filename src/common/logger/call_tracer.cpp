@@ -0,0 +1,319 @@
+#include "pch.h"
+#include "call_tracer.h"
+#include "logger.h"
+#include "logger_settings.h"
+
+#include <Windows.h>
+#include <array>
+#include <condition_variable>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    // Non-localizable
+    const std::wstring traceLogLevel = L"trace";
+
+    constexpr size_t bufferCapacity = 8192; // power of two
+    constexpr auto flushPeriod = std::chrono::seconds(1);
+    // Stop writing instead of filling the disk when tracing is left on
+    constexpr size_t maxTraceFileSize = 256 * 1024 * 1024;
+
+    struct Record
+    {
+        LONGLONG timestamp;
+        const char* functionName;
+        bool enter;
+    };
+
+    // Written only by its thread and read only by the writer thread
+    struct ThreadBuffer
+    {
+        DWORD threadId = GetCurrentThreadId();
+        std::atomic<uint64_t> head = 0;
+        std::atomic<uint64_t> tail = 0;
+        std::atomic<uint64_t> dropped = 0;
+        std::atomic<bool> exited = false;
+        std::array<Record, bufferCapacity> records;
+
+        void push(const Record& record) noexcept
+        {
+            const uint64_t position = head.load(std::memory_order_relaxed);
+            if (position - tail.load(std::memory_order_acquire) >= bufferCapacity)
+            {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+
+            records[position & (bufferCapacity - 1)] = record;
+            head.store(position + 1, std::memory_order_release);
+        }
+    };
+
+    class TraceWriter
+    {
+    public:
+        ~TraceWriter()
+        {
+            // Only reached when the process exits without stopping the tracing, the thread is gone by then
+            if (thread.joinable())
+            {
+                thread.detach();
+            }
+        }
+
+        void start(std::wstring traceFilePath);
+        void stop();
+        void flush();
+        ThreadBuffer* currentThreadBuffer() noexcept;
+
+    private:
+        void run();
+        void writeRecords();
+
+        std::mutex buffersMutex;
+        std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+
+        // Guards the file, held while writing
+        std::mutex fileMutex;
+        std::ofstream file;
+        size_t fileSize = 0;
+        bool firstEvent = true;
+        uint64_t dropped = 0;
+        LARGE_INTEGER frequency{};
+        DWORD processId = GetCurrentProcessId();
+        std::string events;
+
+        std::mutex threadMutex;
+        std::condition_variable stopCondition;
+        bool stopping = false;
+        std::thread thread;
+    };
+
+    TraceWriter traceWriter;
+
+    // Marks the buffer for removal once its thread exits
+    struct ThreadBufferOwner
+    {
+        std::shared_ptr<ThreadBuffer> buffer;
+
+        ~ThreadBufferOwner()
+        {
+            if (buffer)
+            {
+                buffer->exited.store(true, std::memory_order_release);
+            }
+        }
+    };
+
+    thread_local ThreadBufferOwner threadBufferOwner;
+
+    void appendEscaped(std::string& out, const char* str)
+    {
+        for (; *str; str++)
+        {
+            if (*str == '"' || *str == '\\')
+            {
+                out += '\\';
+            }
+            out += *str;
+        }
+    }
+
+    void TraceWriter::start(std::wstring traceFilePath)
+    {
+        stop();
+
+        {
+            std::unique_lock lock(fileMutex);
+            file.open(traceFilePath, std::ios::binary | std::ios::trunc);
+            if (!file.is_open())
+            {
+                return;
+            }
+
+            QueryPerformanceFrequency(&frequency);
+            // The Chrome trace event format accepts an array that isn't closed, so a crash still leaves a readable file
+            file << "[\n";
+            fileSize = 2;
+            firstEvent = true;
+            dropped = 0;
+        }
+
+        {
+            // Skip the exits recorded since tracing stopped
+            std::unique_lock lock(buffersMutex);
+            for (const auto& buffer : buffers)
+            {
+                buffer->tail.store(buffer->head.load(std::memory_order_acquire), std::memory_order_release);
+            }
+        }
+
+        stopping = false;
+        thread = std::thread([this] { run(); });
+    }
+
+    void TraceWriter::stop()
+    {
+        {
+            std::unique_lock lock(threadMutex);
+            stopping = true;
+        }
+        stopCondition.notify_one();
+
+        if (thread.joinable())
+        {
+            thread.join();
+        }
+
+        std::unique_lock lock(fileMutex);
+        if (file.is_open())
+        {
+            writeRecords();
+            file << "\n]\n";
+            file.close();
+
+            if (dropped > 0)
+            {
+                Logger::warn("Call tracing dropped {} records", dropped);
+            }
+        }
+    }
+
+    void TraceWriter::flush()
+    {
+        std::unique_lock lock(fileMutex);
+        if (file.is_open())
+        {
+            writeRecords();
+            file.flush();
+        }
+    }
+
+    ThreadBuffer* TraceWriter::currentThreadBuffer() noexcept
+    {
+        if (!threadBufferOwner.buffer)
+        {
+            try
+            {
+                auto buffer = std::make_shared<ThreadBuffer>();
+
+                std::unique_lock lock(buffersMutex);
+                buffers.push_back(buffer);
+                threadBufferOwner.buffer = std::move(buffer);
+            }
+            catch (...)
+            {
+                return nullptr;
+            }
+        }
+
+        return threadBufferOwner.buffer.get();
+    }
+
+    void TraceWriter::run()
+    {
+        std::unique_lock lock(threadMutex);
+        while (!stopCondition.wait_for(lock, flushPeriod, [this] { return stopping; }))
+        {
+            flush();
+        }
+    }
+
+    // Called with the file mutex held
+    void TraceWriter::writeRecords()
+    {
+        std::vector<std::shared_ptr<ThreadBuffer>> snapshot;
+        {
+            std::unique_lock lock(buffersMutex);
+            snapshot = buffers;
+        }
+
+        events.clear();
+        uint64_t eventCount = 0;
+        for (const auto& buffer : snapshot)
+        {
+            // Read exited before the records, so the records of an exited thread are all written before it's removed
+            const bool exited = buffer->exited.load(std::memory_order_acquire);
+            const uint64_t head = buffer->head.load(std::memory_order_acquire);
+            uint64_t tail = buffer->tail.load(std::memory_order_relaxed);
+
+            for (; tail != head; tail++)
+            {
+                const Record& record = buffer->records[tail & (bufferCapacity - 1)];
+                const double microseconds = record.timestamp * 1'000'000.0 / frequency.QuadPart;
+
+                events += firstEvent ? "" : ",\n";
+                firstEvent = false;
+                events += "{\"name\":\"";
+                appendEscaped(events, record.functionName);
+                events += "\",\"ph\":\"";
+                events += record.enter ? 'B' : 'E';
+                events += "\",\"ts\":";
+                events += std::to_string(microseconds);
+                events += ",\"pid\":";
+                events += std::to_string(processId);
+                events += ",\"tid\":";
+                events += std::to_string(buffer->threadId);
+                events += '}';
+                eventCount++;
+            }
+
+            buffer->tail.store(head, std::memory_order_release);
+            dropped += buffer->dropped.exchange(0, std::memory_order_relaxed);
+
+            if (exited)
+            {
+                std::unique_lock lock(buffersMutex);
+                std::erase(buffers, buffer);
+            }
+        }
+
+        if (fileSize + events.size() > maxTraceFileSize)
+        {
+            dropped += eventCount;
+            return;
+        }
+
+        file.write(events.data(), events.size());
+        fileSize += events.size();
+    }
+}
+
+void CallTracer::init(std::wstring traceFilePath, std::wstring_view logSettingsPath)
+{
+    if (get_log_settings(logSettingsPath).logLevel == traceLogLevel)
+    {
+        start(std::move(traceFilePath));
+    }
+}
+
+void CallTracer::start(std::wstring traceFilePath)
+{
+    traceWriter.start(std::move(traceFilePath));
+    enabled.store(true, std::memory_order_relaxed);
+}
+
+void CallTracer::stop()
+{
+    enabled.store(false, std::memory_order_relaxed);
+    traceWriter.stop();
+}
+
+void CallTracer::flush()
+{
+    traceWriter.flush();
+}
+
+void CallTracer::record(const char* functionName, bool enter) noexcept
+{
+    LARGE_INTEGER timestamp;
+    QueryPerformanceCounter(&timestamp);
+    if (auto buffer = traceWriter.currentThreadBuffer())
+    {
+        buffer->push({ timestamp.QuadPart, functionName, enter });
+    }
+}
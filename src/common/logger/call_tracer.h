@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+
+#define _TRACER_ CallTracer callTracer(__FUNCTION__)
+
+/*
+ * Records entering and exiting the calling function. Records go into a buffer of the calling thread
+ * without locking or formatting, and a background thread writes them to a file in the Chrome trace
+ * event format, which chrome://tracing and https://ui.perfetto.dev open.
+ * While tracing is stopped a traced call only costs a relaxed atomic load.
+ */
+class CallTracer
+{
+public:
+    // functionName must outlive the tracing, it is stored by pointer
+    CallTracer(const char* functionName) noexcept
+    {
+        if (enabled.load(std::memory_order_relaxed))
+        {
+            this->functionName = functionName;
+            record(functionName, true);
+        }
+    }
+
+    ~CallTracer()
+    {
+        if (functionName)
+        {
+            record(functionName, false);
+        }
+    }
+
+    CallTracer(const CallTracer&) = delete;
+    CallTracer& operator=(const CallTracer&) = delete;
+
+    // Start tracing to the file if the log level in the log settings is trace
+    static void init(std::wstring traceFilePath, std::wstring_view logSettingsPath);
+
+    // Start tracing to the file, replacing its contents
+    static void start(std::wstring traceFilePath);
+
+    // Write the remaining records and stop tracing. Call before the module unloads.
+    static void stop();
+
+    // Write the records of all threads
+    static void flush();
+
+private:
+    static void record(const char* functionName, bool enter) noexcept;
+
+    inline static std::atomic<bool> enabled = false;
+
+    const char* functionName = nullptr;
+};
@@ -15,6 +15,7 @@ struct LogSettings
     inline const static std::wstring launcherLogPath = L"LogsModuleInterface\\launcher-log.txt";
     inline const static std::string fancyZonesLoggerName = "fancyzones";
     inline const static std::wstring fancyZonesLogPath = L"fancyzones-log.txt";
+    inline const static std::wstring fancyZonesTracePath = L"fancyzones-trace.json";
     inline const static std::wstring fancyZonesOldLogPath = L"FancyZonesLogs\\"; // needed to clean up old logs
     inline const static std::string shortcutGuideLoggerName = "shortcut-guide";
     inline const static std::wstring shortcutGuideLogPath = L"ShortcutGuideLogs\\shortcut-guide-log.txt";
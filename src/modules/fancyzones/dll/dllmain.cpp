@@ -13,6 +13,7 @@
 #include <lib/FancyZonesData.h>
 #include <lib/FancyZonesWinHookEventIDs.h>
 #include <lib/FancyZonesData.cpp>
+#include <common/logger/call_tracer.h>
 #include <common/logger/logger.h>
 #include <common/utils/logger_helper.h>
 #include <common/utils/resources.h>
@@ -150,6 +151,7 @@ public:
     virtual void destroy() override
     {
         Disable(false);
+        CallTracer::stop();
         delete this;
     }
 
@@ -163,6 +165,10 @@ public:
         std::filesystem::path logFilePath(logFolder);
         logFilePath.append(LogSettings::fancyZonesLogPath);
         Logger::init(LogSettings::fancyZonesLoggerName, logFilePath.wstring(), PTSettingsHelper::get_log_settings_file_location());
+
+        std::filesystem::path traceFilePath(logFolder);
+        traceFilePath.append(LogSettings::fancyZonesTracePath);
+        CallTracer::init(traceFilePath.wstring(), PTSettingsHelper::get_log_settings_file_location());
         
         std::filesystem::path oldLogFolder(appFolder);
         oldLogFolder.append(LogSettings::fancyZonesOldLogPath);
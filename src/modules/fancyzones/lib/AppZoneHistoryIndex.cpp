@@ -0,0 +1,278 @@
+#include "pch.h"
+#include "AppZoneHistoryIndex.h"
+
+namespace
+{
+    constexpr size_t InitialSlots = 16;
+
+    // Finalizer of splitmix64, spreads the interned ids over the table
+    uint64_t Mix(uint64_t value) noexcept
+    {
+        value ^= value >> 30;
+        value *= 0xbf58476d1ce4e5b9ull;
+        value ^= value >> 27;
+        value *= 0x94d049bb133111ebull;
+        value ^= value >> 31;
+        return value;
+    }
+}
+
+uint32_t AppZoneHistoryIndex::InternTable::Find(std::wstring_view str) const noexcept
+{
+    if (m_slots.empty())
+    {
+        return None;
+    }
+
+    return m_slots[Probe(str, std::hash<std::wstring_view>{}(str))];
+}
+
+uint32_t AppZoneHistoryIndex::InternTable::Intern(std::wstring_view str)
+{
+    if ((m_strings.size() + 1) * 2 > m_slots.size())
+    {
+        // Keep the table at most half full
+        std::vector<uint32_t> slots((std::max)(InitialSlots, m_slots.size() * 2), None);
+        m_slots.swap(slots);
+        for (uint32_t id = 0; id < m_strings.size(); id++)
+        {
+            m_slots[Probe(m_strings[id], m_hashes[id])] = id;
+        }
+    }
+
+    const size_t hash = std::hash<std::wstring_view>{}(str);
+    auto& slot = m_slots[Probe(str, hash)];
+    if (slot == None)
+    {
+        slot = static_cast<uint32_t>(m_strings.size());
+        m_strings.emplace_back(str);
+        m_hashes.push_back(hash);
+    }
+
+    return slot;
+}
+
+void AppZoneHistoryIndex::InternTable::Clear() noexcept
+{
+    m_strings.clear();
+    m_hashes.clear();
+    m_slots.clear();
+}
+
+size_t AppZoneHistoryIndex::InternTable::Probe(std::wstring_view str, size_t hash) const noexcept
+{
+    const size_t mask = m_slots.size() - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask)
+    {
+        const uint32_t id = m_slots[i];
+        if (id == None || (m_hashes[id] == hash && m_strings[id] == str))
+        {
+            return i;
+        }
+    }
+}
+
+void AppZoneHistoryIndex::Rebuild(std::unordered_map<std::wstring, History>& appZoneHistoryMap)
+{
+    Clear();
+    for (auto& [processPath, history] : appZoneHistoryMap)
+    {
+        Update(processPath, &history);
+    }
+}
+
+void AppZoneHistoryIndex::Update(const std::wstring& processPath, History* history)
+{
+    const uint32_t appId = history ? m_apps.Intern(processPath) : m_apps.Find(processPath);
+    if (appId == None)
+    {
+        return;
+    }
+
+    if (appId >= m_appDevices.size())
+    {
+        m_appDevices.resize(appId + 1);
+    }
+
+    auto& devices = m_appDevices[appId];
+    for (uint32_t deviceId : devices)
+    {
+        Erase(Key(appId, deviceId));
+    }
+    devices.clear();
+
+    if (!history)
+    {
+        return;
+    }
+
+    for (size_t position = 0; position < history->size(); position++)
+    {
+        const auto& data = (*history)[position];
+        const uint32_t deviceId = m_devices.Intern(data.deviceId);
+        const uint64_t key = Key(appId, deviceId);
+
+        const size_t mask = m_slots.size() - 1;
+        bool found = false;
+        for (size_t i = m_slots.empty() ? 0 : Home(key); !m_slots.empty() && m_slots[i].key != EmptyKey; i = (i + 1) & mask)
+        {
+            if (m_slots[i].key == key)
+            {
+                m_slots[i].duplicated = true;
+                found = true;
+                break;
+            }
+        }
+
+        if (!found)
+        {
+            Insert(Slot{ .key = key, .history = history, .position = static_cast<uint32_t>(position), .zoneSetId = m_zoneSets.Intern(data.zoneSetUuid) });
+            devices.push_back(deviceId);
+        }
+    }
+}
+
+void AppZoneHistoryIndex::Clear() noexcept
+{
+    m_apps.Clear();
+    m_devices.Clear();
+    m_zoneSets.Clear();
+    m_slots.clear();
+    m_count = 0;
+    m_appDevices.clear();
+}
+
+FancyZonesDataTypes::AppZoneHistoryData* AppZoneHistoryIndex::Find(std::wstring_view processPath, std::wstring_view deviceId) const noexcept
+{
+    const Slot* slot = FindSlot(processPath, deviceId);
+    return slot ? &(*slot->history)[slot->position] : nullptr;
+}
+
+FancyZonesDataTypes::AppZoneHistoryData* AppZoneHistoryIndex::Find(std::wstring_view processPath, std::wstring_view deviceId, std::wstring_view zoneSetId) const noexcept
+{
+    const Slot* slot = FindSlot(processPath, deviceId);
+    if (!slot)
+    {
+        return nullptr;
+    }
+
+    if (slot->duplicated)
+    {
+        // Rare, the first entry with the zone set isn't necessarily the indexed one
+        for (size_t position = slot->position; position < slot->history->size(); position++)
+        {
+            auto& data = (*slot->history)[position];
+            if (data.deviceId == deviceId && data.zoneSetUuid == zoneSetId)
+            {
+                return &data;
+            }
+        }
+        return nullptr;
+    }
+
+    if (slot->zoneSetId != m_zoneSets.Find(zoneSetId))
+    {
+        return nullptr;
+    }
+
+    return &(*slot->history)[slot->position];
+}
+
+size_t AppZoneHistoryIndex::Home(uint64_t key) const noexcept
+{
+    return static_cast<size_t>(Mix(key)) & (m_slots.size() - 1);
+}
+
+const AppZoneHistoryIndex::Slot* AppZoneHistoryIndex::FindSlot(std::wstring_view processPath, std::wstring_view deviceId) const noexcept
+{
+    if (m_slots.empty())
+    {
+        return nullptr;
+    }
+
+    const uint32_t appId = m_apps.Find(processPath);
+    const uint32_t device = appId != None ? m_devices.Find(deviceId) : None;
+    if (device == None)
+    {
+        return nullptr;
+    }
+
+    const uint64_t key = Key(appId, device);
+    const size_t mask = m_slots.size() - 1;
+    for (size_t i = Home(key); m_slots[i].key != EmptyKey; i = (i + 1) & mask)
+    {
+        if (m_slots[i].key == key)
+        {
+            return &m_slots[i];
+        }
+    }
+
+    return nullptr;
+}
+
+void AppZoneHistoryIndex::Insert(const Slot& slot)
+{
+    if ((m_count + 1) * 2 > m_slots.size())
+    {
+        Grow();
+    }
+
+    const size_t mask = m_slots.size() - 1;
+    size_t i = Home(slot.key);
+    while (m_slots[i].key != EmptyKey)
+    {
+        i = (i + 1) & mask;
+    }
+
+    m_slots[i] = slot;
+    m_count++;
+}
+
+void AppZoneHistoryIndex::Erase(uint64_t key) noexcept
+{
+    if (m_slots.empty())
+    {
+        return;
+    }
+
+    const size_t mask = m_slots.size() - 1;
+    size_t i = Home(key);
+    while (m_slots[i].key != key)
+    {
+        if (m_slots[i].key == EmptyKey)
+        {
+            return;
+        }
+        i = (i + 1) & mask;
+    }
+
+    // Shift the following entries back instead of leaving a tombstone, so lookups stay short
+    for (size_t j = (i + 1) & mask; m_slots[j].key != EmptyKey; j = (j + 1) & mask)
+    {
+        const size_t home = Home(m_slots[j].key);
+        // Move the entry unless its home lies cyclically in (i, j]
+        const bool between = i <= j ? (i < home && home <= j) : (i < home || home <= j);
+        if (!between)
+        {
+            m_slots[i] = m_slots[j];
+            i = j;
+        }
+    }
+
+    m_slots[i] = Slot{};
+    m_count--;
+}
+
+void AppZoneHistoryIndex::Grow()
+{
+    std::vector<Slot> slots((std::max)(InitialSlots, m_slots.size() * 2));
+    m_slots.swap(slots);
+    m_count = 0;
+    for (const auto& slot : slots)
+    {
+        if (slot.key != EmptyKey)
+        {
+            Insert(slot);
+        }
+    }
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "FancyZonesDataTypes.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Finds the app zone history of an app on a work area without hashing the process path into the history
+ * map and comparing device id strings of every entry. Process paths, device ids and zone set ids are
+ * interned to small integers, and the entries are found in an open addressing table keyed by the
+ * (process path, device id) pair.
+ *
+ * The index points into the history map, so the history of an app has to be indexed again whenever it
+ * changes, and the whole map whenever several apps change.
+ */
+class AppZoneHistoryIndex
+{
+public:
+    using History = std::vector<FancyZonesDataTypes::AppZoneHistoryData>;
+
+    // Index the whole map, replacing the previous index
+    void Rebuild(std::unordered_map<std::wstring, History>& appZoneHistoryMap);
+
+    /**
+     * Index the history of an app again after it changed.
+     *
+     * @param   processPath Path of the app.
+     * @param   history     History of the app in the map, or nullptr if the app was removed from it.
+     */
+    void Update(const std::wstring& processPath, History* history);
+
+    void Clear() noexcept;
+
+    // First history entry of the app on the work area, or nullptr
+    FancyZonesDataTypes::AppZoneHistoryData* Find(std::wstring_view processPath, std::wstring_view deviceId) const noexcept;
+
+    // First history entry of the app on the work area with the zone set, or nullptr
+    FancyZonesDataTypes::AppZoneHistoryData* Find(std::wstring_view processPath, std::wstring_view deviceId, std::wstring_view zoneSetId) const noexcept;
+
+    // Number of indexed (app, work area) pairs
+    size_t Size() const noexcept { return m_count; }
+
+private:
+    static constexpr uint32_t None = UINT32_MAX;
+
+    // Strings by interned id, and an open addressing table from string to id
+    class InternTable
+    {
+    public:
+        uint32_t Find(std::wstring_view str) const noexcept;
+        uint32_t Intern(std::wstring_view str);
+        void Clear() noexcept;
+
+    private:
+        size_t Probe(std::wstring_view str, size_t hash) const noexcept;
+
+        std::vector<std::wstring> m_strings;
+        std::vector<size_t> m_hashes;
+        // Ids of the strings, None for empty slots. The size is a power of two.
+        std::vector<uint32_t> m_slots;
+    };
+
+    struct Slot
+    {
+        uint64_t key = EmptyKey;
+        History* history = nullptr;
+        uint32_t position = 0;
+        uint32_t zoneSetId = None;
+        // The app has more entries for the work area, only the first one is indexed
+        bool duplicated = false;
+    };
+
+    static constexpr uint64_t EmptyKey = UINT64_MAX;
+
+    static uint64_t Key(uint32_t appId, uint32_t deviceId) noexcept { return (static_cast<uint64_t>(appId) << 32) | deviceId; }
+    size_t Home(uint64_t key) const noexcept;
+    const Slot* FindSlot(std::wstring_view processPath, std::wstring_view deviceId) const noexcept;
+    void Insert(const Slot& slot);
+    void Erase(uint64_t key) noexcept;
+    void Grow();
+
+    InternTable m_apps;
+    InternTable m_devices;
+    InternTable m_zoneSets;
+
+    // The size is a power of two, kept at most half full
+    std::vector<Slot> m_slots;
+    size_t m_count = 0;
+
+    // Indexed device ids of each app, to remove them when the app's history changes
+    std::vector<std::vector<uint32_t>> m_appDevices;
+};
@@ -0,0 +1,159 @@
+#include "pch.h"
+
+#include "DebouncedFileWriter.h"
+#include <common/logger/call_tracer.h>
+
+#include <fstream>
+
+#include <common/logger/logger.h>
+
+namespace NonLocalizable
+{
+    const wchar_t TemporaryFileSuffix[] = L".tmp";
+}
+
+DebouncedFileWriter::DebouncedFileWriter(std::chrono::milliseconds delay) :
+    m_delay(delay),
+    m_timer(CreateThreadpoolTimer(TimerCallback, this, nullptr))
+{
+    if (!m_timer)
+    {
+        Logger::error("DebouncedFileWriter: CreateThreadpoolTimer failed, files are written right away");
+    }
+}
+
+DebouncedFileWriter::~DebouncedFileWriter()
+{
+    // Cancels the timer and waits for a running callback
+    m_timer.reset();
+    Flush();
+}
+
+void DebouncedFileWriter::Schedule(std::wstring fileName, Serializer serializer)
+{
+    {
+        std::scoped_lock lock{ m_pendingMutex };
+        m_pendingFileName = std::move(fileName);
+        m_pendingSerializer = std::move(serializer);
+
+        if (m_timer)
+        {
+            if (!m_timerSet)
+            {
+                // Negative due time is relative, in 100 nanosecond intervals
+                ULARGE_INTEGER dueTime{};
+                dueTime.QuadPart = static_cast<ULONGLONG>(-std::chrono::duration_cast<std::chrono::nanoseconds>(m_delay).count() / 100);
+                FILETIME fileTime{ .dwLowDateTime = dueTime.LowPart, .dwHighDateTime = dueTime.HighPart };
+                SetThreadpoolTimer(m_timer.get(), &fileTime, 0, 0);
+                m_timerSet = true;
+            }
+            return;
+        }
+    }
+
+    Flush();
+}
+
+void DebouncedFileWriter::Flush()
+{
+    _TRACER_;
+    std::wstring fileName;
+    Serializer serializer;
+    size_t number = 0;
+    {
+        std::scoped_lock lock{ m_pendingMutex };
+        fileName = std::move(m_pendingFileName);
+        serializer = std::move(m_pendingSerializer);
+        m_pendingSerializer = nullptr;
+        m_timerSet = false;
+        if (serializer)
+        {
+            number = ++m_takenNumber;
+            m_writesInProgress++;
+        }
+    }
+
+    if (serializer)
+    {
+        // The serializer may lock the data it snapshots, and the owner of the data may hold that lock while
+        // calling Cancel, so no lock of the writer is held here
+        std::string contents;
+        bool serialized = false;
+        try
+        {
+            contents = serializer();
+            serialized = true;
+        }
+        catch (...)
+        {
+            Logger::error(L"DebouncedFileWriter: failed to serialize {}", fileName);
+        }
+
+        if (serialized)
+        {
+            std::scoped_lock writeLock{ m_writeMutex };
+            if (number > m_writtenNumber)
+            {
+                m_writtenNumber = number;
+                WriteAtomically(fileName, contents);
+            }
+        }
+
+        std::scoped_lock lock{ m_pendingMutex };
+        m_writesInProgress--;
+    }
+    m_writesDone.notify_all();
+
+    std::unique_lock lock{ m_pendingMutex };
+    m_writesDone.wait(lock, [this] { return m_writesInProgress == 0; });
+}
+
+void DebouncedFileWriter::Cancel()
+{
+    std::scoped_lock writeLock{ m_writeMutex };
+    std::scoped_lock lock{ m_pendingMutex };
+    m_pendingFileName.clear();
+    m_pendingSerializer = nullptr;
+    m_writtenNumber = m_takenNumber;
+}
+
+bool DebouncedFileWriter::HasPending() const
+{
+    std::scoped_lock lock{ m_pendingMutex };
+    return static_cast<bool>(m_pendingSerializer);
+}
+
+void DebouncedFileWriter::SetDelay(std::chrono::milliseconds delay)
+{
+    std::scoped_lock lock{ m_pendingMutex };
+    m_delay = delay;
+}
+
+bool DebouncedFileWriter::WriteAtomically(const std::wstring& fileName, const std::string& contents)
+{
+    const std::wstring temporaryFileName = fileName + NonLocalizable::TemporaryFileSuffix;
+    {
+        std::ofstream file{ temporaryFileName, std::ios::binary | std::ios::trunc };
+        file << contents;
+        file.flush();
+        if (!file.good())
+        {
+            Logger::error(L"DebouncedFileWriter: failed to write {}", temporaryFileName);
+            return false;
+        }
+    }
+
+    if (!MoveFileExW(temporaryFileName.c_str(), fileName.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+    {
+        Logger::error(L"DebouncedFileWriter: failed to replace {}, error {}", fileName, GetLastError());
+        DeleteFileW(temporaryFileName.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+void CALLBACK DebouncedFileWriter::TimerCallback(PTP_CALLBACK_INSTANCE /*instance*/, PVOID context, PTP_TIMER /*timer*/)
+{
+    reinterpret_cast<DebouncedFileWriter*>(context)->Flush();
+}
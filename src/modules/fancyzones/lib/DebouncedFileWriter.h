@@ -0,0 +1,76 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <wil\resource.h>
+
+/**
+ * Writes a file on a thread pool thread some time after the write was requested, so a burst of changes
+ * ends up in a single write. Each request replaces the pending one. The contents are produced on the
+ * thread pool when the write happens, so the serializer takes its snapshot of the data once per write
+ * rather than once per request, and replace the file atomically, so readers never see a partially
+ * written file.
+ */
+class DebouncedFileWriter
+{
+public:
+    // Produces the file contents, called on the thread pool without holding a lock of the writer
+    using Serializer = std::function<std::string()>;
+
+    DebouncedFileWriter(std::chrono::milliseconds delay);
+    // Writes the pending contents
+    ~DebouncedFileWriter();
+
+    DebouncedFileWriter(const DebouncedFileWriter&) = delete;
+    DebouncedFileWriter& operator=(const DebouncedFileWriter&) = delete;
+
+    /**
+     * Request a write, replacing the pending one. The file is written at most the delay after the first
+     * request since the last write.
+     */
+    void Schedule(std::wstring fileName, Serializer serializer);
+
+    /**
+     * Write the pending contents on the calling thread, and wait for writes in progress on the thread pool.
+     * Must not be called while holding a lock the serializer takes.
+     */
+    void Flush();
+
+    // Drop the pending contents and the contents of writes in progress, waiting for a file being replaced
+    void Cancel();
+
+    bool HasPending() const;
+
+    void SetDelay(std::chrono::milliseconds delay);
+
+    /**
+     * Write the contents to a temporary file next to the file, and move it over the file.
+     *
+     * @returns Boolean indicating whether the file was replaced.
+     */
+    static bool WriteAtomically(const std::wstring& fileName, const std::string& contents);
+
+private:
+    static void CALLBACK TimerCallback(PTP_CALLBACK_INSTANCE instance, PVOID context, PTP_TIMER timer);
+
+    std::chrono::milliseconds m_delay;
+
+    // Held while replacing the file. Contents are numbered when they are taken for writing, so contents
+    // taken earlier are dropped if contents taken later, or a cancel, got there first.
+    std::mutex m_writeMutex;
+    size_t m_writtenNumber = 0;
+
+    mutable std::mutex m_pendingMutex;
+    std::condition_variable m_writesDone;
+    std::wstring m_pendingFileName;
+    Serializer m_pendingSerializer;
+    bool m_timerSet = false;
+    size_t m_takenNumber = 0;
+    size_t m_writesInProgress = 0;
+
+    // Declared last so its callbacks are done before the members above are destroyed
+    wil::unique_threadpool_timer m_timer;
+};
@@ -10,6 +10,8 @@
 #include "lib/ZoneWindow.h"
 #include "lib/FancyZonesData.h"
 #include "lib/ZoneSet.h"
+#include "lib/ZoneIndexSetStamp.h"
+#include "lib/ZoneNeighborGraph.h"
 #include "lib/FileWatcher.h"
 #include "lib/WindowMoveHandler.h"
 #include "lib/FancyZonesWinHookEventIDs.h"
@@ -19,7 +21,7 @@
 #include "VirtualDesktopUtils.h"
 #include "MonitorWorkAreaHandler.h"
 #include "util.h"
-#include "CallTracer.h"
+#include <common/logger/call_tracer.h>
 
 #include <lib/SecondaryMouseButtonsHook.h>
 
@@ -249,6 +251,7 @@ private:
     WindowMoveHandler m_windowMoveHandler;
     MonitorWorkAreaHandler m_workAreaHandler;
     FileWatcher m_fileWatcher;
+    ZoneNeighborGraph m_zoneNeighborGraph; // Zones reached by snap hotkeys across monitors
 
     winrt::com_ptr<IFancyZonesSettings> m_settings{};
     GUID m_previousDesktopId{}; // UUID of previously active virtual desktop.
@@ -340,6 +343,8 @@ FancyZones::Destroy() noexcept
     {
         SetEvent(m_terminateVirtualDesktopTrackerEvent.get());
     }
+
+    FancyZonesDataInstance().FlushPendingSaves();
 }
 
 // IFancyZonesCallback
@@ -364,8 +369,8 @@ bool FancyZones::ShouldProcessNewWindow(HWND window) noexcept
     // Avoid processing splash screens, already stamped (zoned) windows, or those windows
     // that belong to excluded applications list.
     if (IsSplashScreen(window) ||
-        (reinterpret_cast<size_t>(::GetProp(window, ZonedWindowProperties::PropertyMultipleZoneID)) != 0) ||
-        !IsCandidateForLastKnownZone(window, m_settings->GetSettings()->excludedAppsArray))
+        ZoneIndexSetStamp::IsStamped(window) ||
+        !IsCandidateForLastKnownZone(window))
     {
         return false;
     }
@@ -939,6 +944,7 @@ void FancyZones::OnDisplayChange(DisplayChangeType changeType, require_write_loc
         }
     }
 
+    m_zoneNeighborGraph.Clear();
     UpdateZoneWindows(lock);
 
     if ((changeType == DisplayChangeType::WorkArea) || (changeType == DisplayChangeType::DisplayChange))
@@ -1038,19 +1044,9 @@ void FancyZones::UpdateZoneWindows(require_write_lock lock) noexcept
 void FancyZones::UpdateWindowsPositions(require_write_lock) noexcept
 {
     auto callback = [](HWND window, LPARAM data) -> BOOL {
-        size_t bitmask = reinterpret_cast<size_t>(::GetProp(window, ZonedWindowProperties::PropertyMultipleZoneID));
-
-        if (bitmask != 0)
+        std::vector<size_t> indexSet = ZoneIndexSetStamp::Get(window);
+        if (!indexSet.empty())
         {
-            std::vector<size_t> indexSet;
-            for (int i = 0; i < std::numeric_limits<size_t>::digits; i++)
-            {
-                if ((1ull << i) & bitmask)
-                {
-                    indexSet.push_back(i);
-                }
-            }
-
             auto strongThis = reinterpret_cast<FancyZones*>(data);
             auto zoneWindow = strongThis->m_workAreaHandler.GetWorkArea(window);
             if (zoneWindow)
@@ -1138,7 +1134,56 @@ bool FancyZones::OnSnapHotkeyBasedOnPosition(HWND window, DWORD vkCode) noexcept
             return true;
         }
 
-        // If that didn't work, extract zones from all other monitors and target one of them
+        // If that didn't work, a window snapped to a single zone moves along the neighbor graph.
+        // The graph measures from the zone the window is snapped to, while the search below measures
+        // from the window rectangle. A snapped window covers its zone, so the two only differ by the
+        // invisible resize borders of the window, or for windows that can't be resized to the zone.
+        std::vector<ZoneNeighborGraph::MonitorLayout> layouts;
+        std::optional<size_t> currentIndex;
+        for (const auto& [monitor, monitorRect] : allMonitors)
+        {
+            if (monitor == current)
+            {
+                currentIndex = layouts.size();
+            }
+
+            auto workArea = m_workAreaHandler.GetWorkArea(m_currentDesktopId, monitor);
+            layouts.push_back({ monitor, monitorRect, workArea ? workArea->ActiveZoneSet() : nullptr });
+        }
+
+        if (currentIndex && layouts[*currentIndex].zoneSet)
+        {
+            const auto indexSet = layouts[*currentIndex].zoneSet->GetZoneIndexSetFromWindow(window);
+            if (indexSet.size() == 1)
+            {
+                // Layout, display and virtual desktop changes all show up as a different zone set or monitor
+                if (!m_zoneNeighborGraph.IsBuiltFrom(layouts))
+                {
+                    m_zoneNeighborGraph.Build(layouts, FancyZonesUtils::GetAllMonitorsCombinedRect<&MONITORINFOEX::rcWork>());
+                }
+
+                // Try the other monitors first, then cycle on all monitors
+                auto target = m_zoneNeighborGraph.Next(*currentIndex, indexSet[0], vkCode, false);
+                if (!target)
+                {
+                    target = m_zoneNeighborGraph.Next(*currentIndex, indexSet[0], vkCode, true);
+                }
+
+                if (target)
+                {
+                    auto zoneWindow = m_workAreaHandler.GetWorkArea(m_currentDesktopId, layouts[target->monitorIndex].monitor);
+                    if (zoneWindow)
+                    {
+                        m_windowMoveHandler.MoveWindowIntoZoneByIndexSet(window, { target->zoneId }, zoneWindow);
+                        return true;
+                    }
+                }
+
+                return false;
+            }
+        }
+
+        // Otherwise, extract zones from all other monitors and target one of them based on the window position
         std::vector<RECT> zoneRects;
         std::vector<std::pair<size_t, winrt::com_ptr<IZoneWindow>>> zoneRectsInfo;
         RECT currentMonitorRect{ .top = 0, .bottom = -1 };
@@ -1310,6 +1355,7 @@ void FancyZones::OnEditorExitEvent(require_write_lock lock) noexcept
 
 void FancyZones::UpdateZoneSets(require_write_lock lock) noexcept
 {
+    m_zoneNeighborGraph.Clear();
     for (auto workArea : m_workAreaHandler.GetAllWorkAreas())
     {
         workArea->UpdateActiveZoneSet();
@@ -1323,7 +1369,7 @@ void FancyZones::UpdateZoneSets(require_write_lock lock) noexcept
 bool FancyZones::ShouldProcessSnapHotkey(DWORD vkCode) noexcept
 {
     auto window = GetForegroundWindow();
-    if (m_settings->GetSettings()->overrideSnapHotkeys && FancyZonesUtils::IsCandidateForZoning(window, m_settings->GetSettings()->excludedAppsArray))
+    if (m_settings->GetSettings()->overrideSnapHotkeys && FancyZonesUtils::IsCandidateForZoning(window))
     {
         HMONITOR monitor = WorkAreaKeyFromWindow(window);
 
@@ -3,8 +3,9 @@
 #include "FancyZonesDataTypes.h"
 #include "JsonHelpers.h"
 #include "ZoneSet.h"
+#include "ZoneIndexSetStamp.h"
 #include "Settings.h"
-#include "CallTracer.h"
+#include <common/logger/call_tracer.h>
 
 #include <common/utils/json.h>
 #include <fancyzones/lib/util.h>
@@ -34,6 +35,9 @@ namespace NonLocalizable
 
 namespace
 {
+    // App zone history changes with every snapped window, changes within this time are written together
+    const std::chrono::milliseconds AppZoneHistorySaveDelay{ 1000 };
+
     std::wstring ExtractVirtualDesktopId(const std::wstring& deviceId)
     {
         // Format: <device-id>_<resolution>_<virtual-desktop-id>
@@ -145,7 +149,8 @@ FancyZonesData& FancyZonesDataInstance()
     return instance;
 }
 
-FancyZonesData::FancyZonesData()
+FancyZonesData::FancyZonesData() :
+    appZoneHistoryWriter(AppZoneHistorySaveDelay)
 {
     std::wstring saveFolderPath = PTSettingsHelper::get_module_save_folder_location(NonLocalizable::FancyZonesStr);
 
@@ -259,6 +264,11 @@ void FancyZonesData::UpdatePrimaryDesktopData(const std::wstring& desktopId)
             }
         }
     }
+
+    if (dirtyFlag)
+    {
+        appZoneHistoryIndex.Rebuild(appZoneHistoryMap);
+    }
     
     std::vector<std::wstring> toReplace{};
     
@@ -320,28 +330,20 @@ bool FancyZonesData::IsAnotherWindowOfApplicationInstanceZoned(HWND window, cons
     auto processPath = get_process_path(window);
     if (!processPath.empty())
     {
-        auto history = appZoneHistoryMap.find(processPath);
-        if (history != std::end(appZoneHistoryMap))
+        if (const auto* data = appZoneHistoryIndex.Find(processPath, deviceId))
         {
-            auto& perDesktopData = history->second;
-            for (auto& data : perDesktopData)
+            DWORD processId = 0;
+            GetWindowThreadProcessId(window, &processId);
+
+            auto processIdIt = data->processIdToHandleMap.find(processId);
+
+            if (processIdIt == std::end(data->processIdToHandleMap))
             {
-                if (data.deviceId == deviceId)
-                {
-                    DWORD processId = 0;
-                    GetWindowThreadProcessId(window, &processId);
-
-                    auto processIdIt = data.processIdToHandleMap.find(processId);
-
-                    if (processIdIt == std::end(data.processIdToHandleMap))
-                    {
-                        return false;
-                    }
-                    else if (processIdIt->second != window && IsWindow(processIdIt->second))
-                    {
-                        return true;
-                    }
-                }
+                return false;
+            }
+            else if (processIdIt->second != window && IsWindow(processIdIt->second))
+            {
+                return true;
             }
         }
     }
@@ -355,20 +357,11 @@ void FancyZonesData::UpdateProcessIdToHandleMap(HWND window, const std::wstring_
     auto processPath = get_process_path(window);
     if (!processPath.empty())
     {
-        auto history = appZoneHistoryMap.find(processPath);
-        if (history != std::end(appZoneHistoryMap))
+        if (auto* data = appZoneHistoryIndex.Find(processPath, deviceId))
         {
-            auto& perDesktopData = history->second;
-            for (auto& data : perDesktopData)
-            {
-                if (data.deviceId == deviceId)
-                {
-                    DWORD processId = 0;
-                    GetWindowThreadProcessId(window, &processId);
-                    data.processIdToHandleMap[processId] = window;
-                    break;
-                }
-            }
+            DWORD processId = 0;
+            GetWindowThreadProcessId(window, &processId);
+            data->processIdToHandleMap[processId] = window;
         }
     }
 }
@@ -379,17 +372,9 @@ std::vector<size_t> FancyZonesData::GetAppLastZoneIndexSet(HWND window, const st
     auto processPath = get_process_path(window);
     if (!processPath.empty())
     {
-        auto history = appZoneHistoryMap.find(processPath);
-        if (history != std::end(appZoneHistoryMap))
+        if (const auto* data = appZoneHistoryIndex.Find(processPath, deviceId, zoneSetId))
         {
-            const auto& perDesktopData = history->second;
-            for (const auto& data : perDesktopData)
-            {
-                if (data.zoneSetUuid == zoneSetId && data.deviceId == deviceId)
-                {
-                    return data.zoneIndexSet;
-                }
-            }
+            return data->zoneIndexSet;
         }
     }
 
@@ -403,46 +388,39 @@ bool FancyZonesData::RemoveAppLastZone(HWND window, const std::wstring_view& dev
     auto processPath = get_process_path(window);
     if (!processPath.empty())
     {
-        auto history = appZoneHistoryMap.find(processPath);
-        if (history != std::end(appZoneHistoryMap))
+        if (auto* data = appZoneHistoryIndex.Find(processPath, deviceId, zoneSetId))
         {
-            auto& perDesktopData = history->second;
-            for (auto data = std::begin(perDesktopData); data != std::end(perDesktopData);)
+            if (!IsAnotherWindowOfApplicationInstanceZoned(window, deviceId))
             {
-                if (data->deviceId == deviceId && data->zoneSetUuid == zoneSetId)
-                {
-                    if (!IsAnotherWindowOfApplicationInstanceZoned(window, deviceId))
-                    {
-                        DWORD processId = 0;
-                        GetWindowThreadProcessId(window, &processId);
-
-                        data->processIdToHandleMap.erase(processId);
-                    }
-
-                    // if there is another instance of same application placed in the same zone don't erase history
-                    size_t windowZoneStamp = reinterpret_cast<size_t>(::GetProp(window, ZonedWindowProperties::PropertyMultipleZoneID));
-                    for (auto placedWindow : data->processIdToHandleMap)
-                    {
-                        size_t placedWindowZoneStamp = reinterpret_cast<size_t>(::GetProp(placedWindow.second, ZonedWindowProperties::PropertyMultipleZoneID));
-                        if (IsWindow(placedWindow.second) && (windowZoneStamp == placedWindowZoneStamp))
-                        {
-                            return false;
-                        }
-                    }
-
-                    data = perDesktopData.erase(data);
-                    if (perDesktopData.empty())
-                    {
-                        appZoneHistoryMap.erase(processPath);
-                    }
-                    SaveAppZoneHistory();
-                    return true;
-                }
-                else
+                DWORD processId = 0;
+                GetWindowThreadProcessId(window, &processId);
+
+                data->processIdToHandleMap.erase(processId);
+            }
+
+            // if there is another instance of same application placed in the same zone don't erase history
+            const auto windowZoneStamp = ZoneIndexSetStamp::Get(window);
+            for (auto placedWindow : data->processIdToHandleMap)
+            {
+                if (IsWindow(placedWindow.second) && (windowZoneStamp == ZoneIndexSetStamp::Get(placedWindow.second)))
                 {
-                    ++data;
+                    return false;
                 }
             }
+
+            auto& perDesktopData = appZoneHistoryMap.at(processPath);
+            perDesktopData.erase(perDesktopData.begin() + (data - perDesktopData.data()));
+            if (perDesktopData.empty())
+            {
+                appZoneHistoryMap.erase(processPath);
+                appZoneHistoryIndex.Update(processPath, nullptr);
+            }
+            else
+            {
+                appZoneHistoryIndex.Update(processPath, &perDesktopData);
+            }
+            ScheduleSaveAppZoneHistory();
+            return true;
         }
     }
 
@@ -468,22 +446,18 @@ bool FancyZonesData::SetAppLastZones(HWND window, const std::wstring& deviceId,
     DWORD processId = 0;
     GetWindowThreadProcessId(window, &processId);
 
-    auto history = appZoneHistoryMap.find(processPath);
-    if (history != std::end(appZoneHistoryMap))
+    if (auto* data = appZoneHistoryIndex.Find(processPath, deviceId))
     {
-        auto& perDesktopData = history->second;
-        for (auto& data : perDesktopData)
+        // application already has history on this work area, update it with new window position
+        data->processIdToHandleMap[processId] = window;
+        data->zoneIndexSet = zoneIndexSet;
+        if (data->zoneSetUuid != zoneSetId)
         {
-            if (data.deviceId == deviceId)
-            {
-                // application already has history on this work area, update it with new window position
-                data.processIdToHandleMap[processId] = window;
-                data.zoneSetUuid = zoneSetId;
-                data.zoneIndexSet = zoneIndexSet;
-                SaveAppZoneHistory();
-                return true;
-            }
+            data->zoneSetUuid = zoneSetId;
+            appZoneHistoryIndex.Update(processPath, &appZoneHistoryMap.at(processPath));
         }
+        ScheduleSaveAppZoneHistory();
+        return true;
     }
 
     std::unordered_map<DWORD, HWND> processIdToHandleMap{};
@@ -503,8 +477,9 @@ bool FancyZonesData::SetAppLastZones(HWND window, const std::wstring& deviceId,
         // new application, create entry in app zone history map
         appZoneHistoryMap[processPath] = std::vector<FancyZonesDataTypes::AppZoneHistoryData>{ data };
     }
+    appZoneHistoryIndex.Update(processPath, &appZoneHistoryMap.at(processPath));
 
-    SaveAppZoneHistory();
+    ScheduleSaveAppZoneHistory();
     return true;
 }
 
@@ -548,6 +523,9 @@ json::JsonObject FancyZonesData::GetPersistFancyZonesJSON()
 
 void FancyZonesData::LoadFancyZonesData()
 {
+    // The file is read back below, so it must not miss changes that are still pending
+    appZoneHistoryWriter.Flush();
+
     if (!std::filesystem::exists(zonesSettingsFileName))
     {
         SaveAppZoneHistoryAndZoneSettings();
@@ -557,6 +535,7 @@ void FancyZonesData::LoadFancyZonesData()
         json::JsonObject fancyZonesDataJSON = GetPersistFancyZonesJSON();
 
         appZoneHistoryMap = JSONHelpers::ParseAppZoneHistory(fancyZonesDataJSON);
+        appZoneHistoryIndex.Rebuild(appZoneHistoryMap);
         deviceInfoMap = JSONHelpers::ParseDeviceInfos(fancyZonesDataJSON);
         customZoneSetsMap = JSONHelpers::ParseCustomZoneSets(fancyZonesDataJSON);
         quickKeysMap = JSONHelpers::ParseQuickKeys(fancyZonesDataJSON);
@@ -580,9 +559,35 @@ void FancyZonesData::SaveAppZoneHistory() const
 {
     _TRACER_;
     std::scoped_lock lock{ dataLock };
+    // The pending contents and the snapshots being written are at most as new as the ones written here
+    appZoneHistoryWriter.Cancel();
     JSONHelpers::SaveAppZoneHistory(appZoneHistoryFileName, appZoneHistoryMap);
 }
 
+void FancyZonesData::ScheduleSaveAppZoneHistory() const
+{
+    // Lock is held by the caller. Only marks the history as changed, a burst of changes is copied once when
+    // the writer runs, and the copy is serialized without the lock while the map keeps changing.
+    appZoneHistoryWriter.Schedule(appZoneHistoryFileName, [this] {
+        JSONHelpers::TAppZoneHistoryMap snapshot;
+        {
+            std::scoped_lock lock{ dataLock };
+            snapshot = appZoneHistoryMap;
+        }
+        return JSONHelpers::SerializeAppZoneHistoryFile(snapshot);
+    });
+}
+
+void FancyZonesData::FlushPendingSaves() const
+{
+    appZoneHistoryWriter.Flush();
+}
+
+void FancyZonesData::SetSaveDelay(std::chrono::milliseconds delay)
+{
+    appZoneHistoryWriter.SetDelay(delay);
+}
+
 void FancyZonesData::SaveFancyZonesEditorParameters(bool spanZonesAcrossMonitors, const std::wstring& virtualDesktopId, const HMONITOR& targetMonitor) const
 {
     JSONHelpers::EditorArgs argsJson; /* json arguments */
@@ -672,4 +677,6 @@ void FancyZonesData::RemoveDesktopAppZoneHistory(const std::wstring& desktopId)
             ++it;
         }
     }
+
+    appZoneHistoryIndex.Rebuild(appZoneHistoryMap);
 }
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "AppZoneHistoryIndex.h"
+#include "DebouncedFileWriter.h"
 #include "JsonHelpers.h"
 
 #include <common/SettingsAPI/settings_helpers.h>
@@ -79,6 +81,10 @@ public:
     void SaveZoneSettings() const;
     void SaveAppZoneHistory() const;
 
+    // Writes app zone history changes that are waiting to be written together
+    void FlushPendingSaves() const;
+    void SetSaveDelay(std::chrono::milliseconds delay);
+
     void SaveFancyZonesEditorParameters(bool spanZonesAcrossMonitors, const std::wstring& virtualDesktopId, const HMONITOR& targetMonitor) const;
 
 private:
@@ -108,6 +114,7 @@ private:
     inline void clear_data()
     {
         appZoneHistoryMap.clear();
+        appZoneHistoryIndex.Clear();
         deviceInfoMap.clear();
         customZoneSetsMap.clear();
     }
@@ -120,9 +127,12 @@ private:
     }
 #endif
     void RemoveDesktopAppZoneHistory(const std::wstring& desktopId);
+    void ScheduleSaveAppZoneHistory() const;
 
     // Maps app path to app's zone history data
     std::unordered_map<std::wstring, std::vector<FancyZonesDataTypes::AppZoneHistoryData>> appZoneHistoryMap{};
+    // Finds entries of appZoneHistoryMap by app path and device ID, updated with every change of the map
+    AppZoneHistoryIndex appZoneHistoryIndex{};
     // Maps device unique ID to device data
     JSONHelpers::TDeviceInfoMap deviceInfoMap{};
     // Maps custom zoneset UUID to it's data
@@ -135,6 +145,7 @@ private:
     std::wstring editorParametersFileName;
 
     mutable std::recursive_mutex dataLock;
+    mutable DebouncedFileWriter appZoneHistoryWriter;
 };
 
 FancyZonesData& FancyZonesDataInstance();
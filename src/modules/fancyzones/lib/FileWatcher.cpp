@@ -1,68 +1,508 @@
 #include "pch.h"
 #include "FileWatcher.h"
 
-std::optional<FILETIME> FileWatcher::MyFileTime()
+#include <algorithm>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+
+#include <common/logger/logger.h>
+
+namespace
 {
-    HANDLE hFile = CreateFileW(m_path.c_str(), FILE_READ_ATTRIBUTES, FILE_SHARE_DELETE | FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, 0, nullptr);
-    std::optional<FILETIME> result;
-    if (hFile != INVALID_HANDLE_VALUE)
+    constexpr ULONG_PTR WakeUpKey = 1;
+    constexpr ULONG_PTR ShutdownKey = 2;
+    constexpr ULONG_PTR DirectoryKey = 3;
+
+    constexpr DWORD NotificationBufferSize = 16 * 1024;
+    constexpr DWORD NotifyFilter = FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE;
+
+    // Folders that don't exist yet are opened again after this time
+    constexpr std::chrono::seconds OpenRetryPeriod{ 5 };
+
+    constexpr uint64_t FnvOffsetBasis = 14695981039346656037ull;
+    constexpr uint64_t FnvPrime = 1099511628211ull;
+
+    uint64_t HashBytes(uint64_t hash, const char* data, size_t size) noexcept
     {
-        FILETIME lastWrite;
-        if (GetFileTime(hFile, nullptr, nullptr, &lastWrite))
+        for (size_t i = 0; i < size; i++)
         {
-            result = lastWrite;
+            hash ^= static_cast<uint8_t>(data[i]);
+            hash *= FnvPrime;
         }
+        return hash;
+    }
 
-        CloseHandle(hFile);
+    std::wstring ToUpper(std::wstring_view str)
+    {
+        std::wstring result{ str };
+        if (!result.empty())
+        {
+            CharUpperBuffW(result.data(), static_cast<DWORD>(result.size()));
+        }
+        return result;
     }
 
-    return result;
-}
+    struct Watch
+    {
+        std::wstring path;
+        // Upper-cased, notifications name files case-insensitively
+        std::wstring folder;
+        std::wstring fileName;
+        std::function<void()> callback;
+        FileChangeFilter filter;
+    };
 
-void FileWatcher::Run()
-{
-    while (1)
+    // Folder with a ReadDirectoryChangesW request in flight
+    struct Directory
+    {
+        OVERLAPPED overlapped{};
+        wil::unique_hfile handle;
+        std::vector<DWORD> buffer = std::vector<DWORD>(NotificationBufferSize / sizeof(DWORD));
+        bool pending = false;
+    };
+
+    class FileWatcherService
+    {
+    public:
+        static FileWatcherService& Instance()
+        {
+            static FileWatcherService instance;
+            return instance;
+        }
+
+        ~FileWatcherService()
+        {
+            // Only reached with watchers left when the process exits, the thread is gone by then
+            if (m_thread.joinable())
+            {
+                m_thread.detach();
+            }
+        }
+
+        size_t Add(const std::wstring& path, std::function<void()> callback, std::chrono::milliseconds debounce);
+        void Remove(size_t id);
+
+    private:
+        using Directories = std::map<std::wstring, std::unique_ptr<Directory>>;
+
+        void Run(HANDLE port);
+        void SyncDirectories(HANDLE port, Directories& directories, std::vector<std::unique_ptr<Directory>>& closing);
+        void OnChanges(const std::wstring& folder, const Directory& directory, DWORD bytes);
+        void CheckDueWatches();
+        DWORD WaitTimeout() const;
+
+        // Guards everything below
+        mutable std::mutex m_mutex;
+        std::unordered_map<size_t, Watch> m_watches;
+        size_t m_nextId = 1;
+        HANDLE m_port = nullptr;
+        std::thread m_thread;
+        FileChangeFilter::Clock::time_point m_nextOpenAttempt{};
+        bool m_openFailed = false;
+
+        // Held while a callback runs, so a removed watcher's callback is never called once Remove returned
+        std::mutex m_callbackMutex;
+    };
+
+    size_t FileWatcherService::Add(const std::wstring& path, std::function<void()> callback, std::chrono::milliseconds debounce)
+    {
+        std::filesystem::path fsPath{ path };
+        Watch watch{
+            .path = path,
+            .folder = ToUpper(fsPath.parent_path().wstring()),
+            .fileName = ToUpper(fsPath.filename().wstring()),
+            .callback = std::move(callback),
+            .filter = FileChangeFilter(debounce, FileChangeFilter::HashFile(path))
+        };
+
+        std::scoped_lock lock{ m_mutex };
+        const size_t id = m_nextId++;
+        m_watches.emplace(id, std::move(watch));
+        m_nextOpenAttempt = {};
+
+        if (!m_port)
+        {
+            m_port = CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 1);
+            if (!m_port)
+            {
+                Logger::error("FileWatcher: CreateIoCompletionPort failed with {}", GetLastError());
+                return id;
+            }
+            m_thread = std::thread([this, port = m_port]() { Run(port); });
+        }
+
+        PostQueuedCompletionStatus(m_port, 0, WakeUpKey, nullptr);
+        return id;
+    }
+
+    void FileWatcherService::Remove(size_t id)
+    {
+        std::thread thread;
+        {
+            std::scoped_lock lock{ m_mutex };
+            m_watches.erase(id);
+
+            // Stop the thread with the last watcher, instead of when the module unloads
+            if (m_watches.empty() && m_port)
+            {
+                PostQueuedCompletionStatus(m_port, 0, ShutdownKey, nullptr);
+                m_port = nullptr;
+                thread = std::move(m_thread);
+            }
+            else if (m_port)
+            {
+                PostQueuedCompletionStatus(m_port, 0, WakeUpKey, nullptr);
+            }
+        }
+
+        if (thread.joinable())
+        {
+            thread.join();
+        }
+
+        // Wait for a callback in progress
+        std::scoped_lock callbackLock{ m_callbackMutex };
+    }
+
+    void FileWatcherService::Run(HANDLE port)
     {
-        auto lastWrite = MyFileTime();
-        if (!m_lastWrite.has_value())
+        Directories directories;
+        std::vector<std::unique_ptr<Directory>> closing;
+
+        while (true)
         {
-            m_lastWrite = lastWrite;
+            SyncDirectories(port, directories, closing);
+            CheckDueWatches();
+
+            DWORD bytes = 0;
+            ULONG_PTR key = 0;
+            LPOVERLAPPED overlapped = nullptr;
+            const BOOL succeeded = GetQueuedCompletionStatus(port, &bytes, &key, &overlapped, WaitTimeout());
+            if (!overlapped)
+            {
+                if (succeeded && key == ShutdownKey)
+                {
+                    break;
+                }
+                // Woken up or timed out
+                continue;
+            }
+
+            auto directory = CONTAINING_RECORD(overlapped, Directory, overlapped);
+            directory->pending = false;
+
+            auto closingIt = std::find_if(closing.begin(), closing.end(), [directory](const auto& item) { return item.get() == directory; });
+            if (closingIt != closing.end())
+            {
+                closing.erase(closingIt);
+                continue;
+            }
+
+            auto it = std::find_if(directories.begin(), directories.end(), [directory](const auto& item) { return item.second.get() == directory; });
+            if (it == directories.end())
+            {
+                continue;
+            }
+
+            if (succeeded)
+            {
+                // No bytes means the buffer overflowed, and any file of the folder could have changed
+                OnChanges(it->first, *directory, bytes);
+            }
+
+            directory->pending = ReadDirectoryChangesW(directory->handle.get(), directory->buffer.data(), NotificationBufferSize, FALSE, NotifyFilter, nullptr, &directory->overlapped, nullptr);
+            if (!directory->pending)
+            {
+                Logger::error(L"FileWatcher: ReadDirectoryChangesW failed for {} with {}", it->first, GetLastError());
+                directories.erase(it);
+
+                std::scoped_lock lock{ m_mutex };
+                m_nextOpenAttempt = {};
+            }
         }
-        else if (lastWrite.has_value())
+
+        // Requests complete after their handle is closed, their buffers must stay around until then
+        for (auto& [folder, directory] : directories)
         {
-            if (m_lastWrite->dwHighDateTime != lastWrite->dwHighDateTime ||
-                m_lastWrite->dwLowDateTime != lastWrite->dwLowDateTime)
+            if (directory->pending)
             {
-                m_lastWrite = lastWrite;
-                m_callback();
+                closing.push_back(std::move(directory));
             }
         }
+        directories.clear();
+
+        for (auto& directory : closing)
+        {
+            directory->handle.reset();
+        }
 
-        if (WaitForSingleObject(m_abortEvent, m_refreshPeriod) == WAIT_OBJECT_0)
+        while (std::any_of(closing.begin(), closing.end(), [](const auto& directory) { return directory->pending; }))
+        {
+            DWORD bytes = 0;
+            ULONG_PTR key = 0;
+            LPOVERLAPPED overlapped = nullptr;
+            GetQueuedCompletionStatus(port, &bytes, &key, &overlapped, INFINITE);
+            if (overlapped)
+            {
+                CONTAINING_RECORD(overlapped, Directory, overlapped)->pending = false;
+            }
+        }
+
+        CloseHandle(port);
+    }
+
+    void FileWatcherService::SyncDirectories(HANDLE port, Directories& directories, std::vector<std::unique_ptr<Directory>>& closing)
+    {
+        std::scoped_lock lock{ m_mutex };
+
+        // Close folders without watchers
+        for (auto it = directories.begin(); it != directories.end();)
+        {
+            const bool watched = std::any_of(m_watches.begin(), m_watches.end(), [&](const auto& item) { return item.second.folder == it->first; });
+            if (watched)
+            {
+                ++it;
+                continue;
+            }
+
+            it->second->handle.reset();
+            if (it->second->pending)
+            {
+                closing.push_back(std::move(it->second));
+            }
+            it = directories.erase(it);
+        }
+
+        const auto now = FileChangeFilter::Clock::now();
+        if (now < m_nextOpenAttempt)
         {
             return;
         }
+
+        m_openFailed = false;
+        std::set<std::wstring> opened;
+        for (const auto& [id, watch] : m_watches)
+        {
+            if (directories.contains(watch.folder))
+            {
+                continue;
+            }
+
+            auto directory = std::make_unique<Directory>();
+            directory->handle.reset(CreateFileW(watch.folder.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr));
+            if (!directory->handle ||
+                !CreateIoCompletionPort(directory->handle.get(), port, DirectoryKey, 0) ||
+                !ReadDirectoryChangesW(directory->handle.get(), directory->buffer.data(), NotificationBufferSize, FALSE, NotifyFilter, nullptr, &directory->overlapped, nullptr))
+            {
+                m_openFailed = true;
+                continue;
+            }
+
+            directory->pending = true;
+            directories.emplace(watch.folder, std::move(directory));
+            opened.insert(watch.folder);
+        }
+
+        // The file could have changed between adding the watcher and opening its folder
+        for (auto& [id, watch] : m_watches)
+        {
+            if (opened.contains(watch.folder))
+            {
+                watch.filter.Notify(now);
+            }
+        }
+
+        m_nextOpenAttempt = m_openFailed ? now + OpenRetryPeriod : FileChangeFilter::Clock::time_point::max();
+    }
+
+    void FileWatcherService::OnChanges(const std::wstring& folder, const Directory& directory, DWORD bytes)
+    {
+        const auto now = FileChangeFilter::Clock::now();
+        std::scoped_lock lock{ m_mutex };
+
+        if (bytes == 0)
+        {
+            for (auto& [id, watch] : m_watches)
+            {
+                if (watch.folder == folder)
+                {
+                    watch.filter.Notify(now);
+                }
+            }
+            return;
+        }
+
+        const auto* buffer = reinterpret_cast<const BYTE*>(directory.buffer.data());
+        for (DWORD offset = 0; offset < bytes;)
+        {
+            const auto* info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(buffer + offset);
+            const std::wstring fileName = ToUpper(std::wstring_view(info->FileName, info->FileNameLength / sizeof(WCHAR)));
+            for (auto& [id, watch] : m_watches)
+            {
+                if (watch.folder == folder && watch.fileName == fileName)
+                {
+                    watch.filter.Notify(now);
+                }
+            }
+
+            if (info->NextEntryOffset == 0)
+            {
+                break;
+            }
+            offset += info->NextEntryOffset;
+        }
+    }
+
+    void FileWatcherService::CheckDueWatches()
+    {
+        const auto now = FileChangeFilter::Clock::now();
+
+        std::vector<std::pair<size_t, std::wstring>> due;
+        {
+            std::scoped_lock lock{ m_mutex };
+            for (const auto& [id, watch] : m_watches)
+            {
+                if (watch.filter.Deadline() && *watch.filter.Deadline() <= now)
+                {
+                    due.emplace_back(id, watch.path);
+                }
+            }
+        }
+
+        // Read the files without blocking Add and Remove
+        std::vector<std::pair<size_t, std::optional<uint64_t>>> hashes;
+        for (const auto& [id, path] : due)
+        {
+            hashes.emplace_back(id, FileChangeFilter::HashFile(path));
+        }
+
+        std::vector<size_t> changed;
+        {
+            std::scoped_lock lock{ m_mutex };
+            for (const auto& [id, hash] : hashes)
+            {
+                auto it = m_watches.find(id);
+                if (it != m_watches.end() && it->second.filter.Check(hash, now))
+                {
+                    changed.push_back(id);
+                }
+            }
+        }
+
+        for (size_t id : changed)
+        {
+            std::scoped_lock callbackLock{ m_callbackMutex };
+            std::function<void()> callback;
+            {
+                std::scoped_lock lock{ m_mutex };
+                auto it = m_watches.find(id);
+                if (it == m_watches.end())
+                {
+                    continue;
+                }
+                callback = it->second.callback;
+            }
+
+            callback();
+        }
+    }
+
+    DWORD FileWatcherService::WaitTimeout() const
+    {
+        std::scoped_lock lock{ m_mutex };
+
+        auto wakeUp = m_openFailed ? m_nextOpenAttempt : FileChangeFilter::Clock::time_point::max();
+        for (const auto& [id, watch] : m_watches)
+        {
+            if (watch.filter.Deadline())
+            {
+                wakeUp = (std::min)(wakeUp, *watch.filter.Deadline());
+            }
+        }
+
+        if (wakeUp == FileChangeFilter::Clock::time_point::max())
+        {
+            return INFINITE;
+        }
+
+        const auto now = FileChangeFilter::Clock::now();
+        if (wakeUp <= now)
+        {
+            return 0;
+        }
+
+        // Round up, waking up early would spin until the deadline
+        const auto millis = std::chrono::ceil<std::chrono::milliseconds>(wakeUp - now).count();
+        return static_cast<DWORD>((std::min)(millis, static_cast<decltype(millis)>(INFINITE - 1)));
     }
 }
 
-FileWatcher::FileWatcher(const std::wstring& path, std::function<void()> callback, DWORD refreshPeriod) :
-    m_refreshPeriod(refreshPeriod),
-    m_path(path),
-    m_callback(callback)
+bool FileChangeFilter::Check(std::optional<uint64_t> hash, Clock::time_point now) noexcept
 {
-    m_abortEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
-    if (m_abortEvent)
+    if (!hash)
+    {
+        if (++m_readRetries <= MaxReadRetries)
+        {
+            m_deadline = now + m_debounce;
+        }
+        else
+        {
+            m_deadline.reset();
+            m_readRetries = 0;
+        }
+        return false;
+    }
+
+    m_deadline.reset();
+    m_readRetries = 0;
+
+    if (hash == m_lastHash)
     {
-        m_thread = std::thread([this]() { Run(); });
+        return false;
     }
+
+    m_lastHash = hash;
+    return true;
 }
 
-FileWatcher::~FileWatcher()
+uint64_t FileChangeFilter::Hash(std::string_view contents) noexcept
+{
+    return HashBytes(FnvOffsetBasis, contents.data(), contents.size());
+}
+
+std::optional<uint64_t> FileChangeFilter::HashFile(const std::wstring& path)
 {
-    if (m_abortEvent)
+    wil::unique_hfile file{ CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_DELETE | FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr) };
+    if (!file)
     {
-        SetEvent(m_abortEvent);
-        m_thread.join();
-        CloseHandle(m_abortEvent);
+        return std::nullopt;
     }
+
+    uint64_t hash = FnvOffsetBasis;
+    char buffer[64 * 1024];
+    DWORD read = 0;
+    while (ReadFile(file.get(), buffer, sizeof(buffer), &read, nullptr))
+    {
+        if (read == 0)
+        {
+            return hash;
+        }
+        hash = HashBytes(hash, buffer, read);
+    }
+
+    return std::nullopt;
+}
+
+FileWatcher::FileWatcher(const std::wstring& path, std::function<void()> callback, DWORD debounceMillis)
+{
+    m_id = FileWatcherService::Instance().Add(path, std::move(callback), std::chrono::milliseconds(debounceMillis));
+}
+
+FileWatcher::~FileWatcher()
+{
+    FileWatcherService::Instance().Remove(m_id);
 }
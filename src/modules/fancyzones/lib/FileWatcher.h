@@ -2,18 +2,68 @@
 
 #include "pch.h"
 
+#include <chrono>
+#include <cstdint>
+#include <string_view>
+
+/**
+ * Decides when a watched file really changed. Change notifications arriving within the debounce time of
+ * each other are merged, and the merged change only counts if the file contents differ from the contents
+ * seen last.
+ */
+class FileChangeFilter
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    FileChangeFilter(std::chrono::milliseconds debounce, std::optional<uint64_t> initialHash) :
+        m_debounce(debounce), m_lastHash(initialHash)
+    {
+    }
+
+    // A change notification arrived, restart the debounce time
+    void Notify(Clock::time_point now) noexcept { m_deadline = now + m_debounce; }
+
+    // When the file should be checked, if a notification is waiting
+    std::optional<Clock::time_point> Deadline() const noexcept { return m_deadline; }
+
+    /**
+     * Compare the contents after the debounce time passed. A file that couldn't be read, usually because
+     * it's still being written, is checked again after another debounce time, a few times at most.
+     *
+     * @param   hash Hash of the current contents, or nothing if the file couldn't be read.
+     * @param   now  Current time.
+     *
+     * @returns Boolean indicating whether the contents changed.
+     */
+    bool Check(std::optional<uint64_t> hash, Clock::time_point now) noexcept;
+
+    static uint64_t Hash(std::string_view contents) noexcept;
+
+    // Hash of the contents of the file, or nothing if it doesn't exist or is locked
+    static std::optional<uint64_t> HashFile(const std::wstring& path);
+
+private:
+    static constexpr int MaxReadRetries = 5;
+
+    std::chrono::milliseconds m_debounce;
+    std::optional<Clock::time_point> m_deadline;
+    int m_readRetries = 0;
+    std::optional<uint64_t> m_lastHash;
+};
+
+/**
+ * Calls the callback when the contents of the file change. All watchers share a single thread, which
+ * waits for change notifications of the watched folders.
+ */
 class FileWatcher
 {
-    DWORD m_refreshPeriod;
-    std::wstring m_path;
-    std::optional<FILETIME> m_lastWrite;
-    std::function<void()> m_callback;
-    HANDLE m_abortEvent;
-    std::thread m_thread;
-    
-    std::optional<FILETIME> MyFileTime();
-    void Run();
+    size_t m_id = 0;
+
 public:
-    FileWatcher(const std::wstring& path, std::function<void()> callback, DWORD refreshPeriod = 1000);
+    FileWatcher(const std::wstring& path, std::function<void()> callback, DWORD debounceMillis = 100);
     ~FileWatcher();
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
 };
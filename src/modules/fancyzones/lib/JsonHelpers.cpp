@@ -606,6 +606,15 @@ namespace JSONHelpers
         }
     }
 
+    std::string SerializeAppZoneHistoryFile(const TAppZoneHistoryMap& appZoneHistoryMap)
+    {
+        json::JsonObject root{};
+
+        root.SetNamedValue(NonLocalizable::AppZoneHistoryStr, JSONHelpers::SerializeAppZoneHistory(appZoneHistoryMap));
+
+        return winrt::to_string(root.Stringify());
+    }
+
     TAppZoneHistoryMap ParseAppZoneHistory(const json::JsonObject& fancyZonesDataJSON)
     {
         try
@@ -1,47 +1,205 @@
 #include "pch.h"
 
 #include "on_thread_executor.h"
-#include "CallTracer.h"
+#include <common/logger/call_tracer.h>
+
+#include <algorithm>
+#include <vector>
 
 OnThreadExecutor::OnThreadExecutor() :
     _shutdown_request{ false }, _worker_thread{ [this] { worker_thread(); } }
 {
 }
 
-std::future<void> OnThreadExecutor::submit(task_t task)
+std::future<void> OnThreadExecutor::submit(task_t task, priority task_priority)
 {
     auto future = task.get_future();
     std::lock_guard lock{ _task_mutex };
-    _task_queue.emplace(std::move(task));
-    _task_cv.notify_one();
+    enqueue(queued_task{ .task = std::move(task) }, task_priority);
+    return future;
+}
+
+std::shared_future<void> OnThreadExecutor::submit(const std::string& key, std::function<void()> work, priority task_priority)
+{
+    std::lock_guard lock{ _task_mutex };
+    auto pending = _pending_keys.find(key);
+    if (pending != _pending_keys.end())
+    {
+        *pending->second.work = std::move(work);
+        _coalesced++;
+        return pending->second.future;
+    }
+
+    auto shared_work = std::make_shared<std::function<void()>>(std::move(work));
+    task_t task{ [shared_work] { (*shared_work)(); } };
+    std::shared_future<void> future = task.get_future().share();
+    _pending_keys.emplace(key, keyed_work{ shared_work, future });
+    enqueue(queued_task{ .task = std::move(task), .key = key, .work = std::move(shared_work) }, task_priority);
     return future;
 }
 
+void OnThreadExecutor::enqueue(queued_task task, priority task_priority)
+{
+    const auto lane = static_cast<size_t>(task_priority);
+    task.lane = task_priority;
+    task.submitted = std::chrono::steady_clock::now();
+    _task_queues[lane].emplace_back(std::move(task));
+    _lane_sizes[lane]++;
+    _queue_depth++;
+    _max_queue_depth = (std::max)(_max_queue_depth, _queue_depth);
+    _task_cv.notify_one();
+}
+
 void OnThreadExecutor::cancel()
 {
     std::lock_guard lock{ _task_mutex };
-    _task_queue = {};
+    for (size_t lane = 0; lane < _task_queues.size(); lane++)
+    {
+        _task_queues[lane].clear();
+        _lane_sizes[lane] = 0;
+    }
+    _pending_keys.clear();
+    _queue_depth = 0;
+    // Drops the tasks the worker took but hasn't run yet
+    _cancel_epoch++;
     _task_cv.notify_one();
 }
 
+bool OnThreadExecutor::cancel(const std::string& key)
+{
+    std::lock_guard lock{ _task_mutex };
+    if (!_pending_keys.erase(key))
+    {
+        return false;
+    }
+
+    // The task isn't queued if the worker took it already, in which case start_keyed skips it
+    for (size_t lane = 0; lane < _task_queues.size(); lane++)
+    {
+        auto& queue = _task_queues[lane];
+        auto it = std::find_if(queue.begin(), queue.end(), [&key](const queued_task& task) { return task.key == key; });
+        if (it != queue.end())
+        {
+            queue.erase(it);
+            _lane_sizes[lane]--;
+            _queue_depth--;
+            break;
+        }
+    }
+    return true;
+}
+
+OnThreadExecutor::statistics OnThreadExecutor::get_statistics() const
+{
+    std::lock_guard lock{ _task_mutex };
+    return statistics{ .queue_depth = _queue_depth,
+                       .max_queue_depth = _max_queue_depth,
+                       .executed = _executed,
+                       .coalesced = _coalesced,
+                       .total_latency = std::chrono::microseconds{ _total_latency_us.load() },
+                       .max_latency = std::chrono::microseconds{ _max_latency_us.load() } };
+}
+
+bool OnThreadExecutor::can_run(const queued_task& remaining, uint64_t cancel_epoch) const
+{
+    if (_shutdown_request || _cancel_epoch != cancel_epoch)
+    {
+        return false;
+    }
+
+    for (size_t lane = 0; lane < static_cast<size_t>(remaining.lane); lane++)
+    {
+        if (_lane_sizes[lane] != 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool OnThreadExecutor::start_keyed(const queued_task& task)
+{
+    std::lock_guard lock{ _task_mutex };
+    auto pending = _pending_keys.find(task.key);
+    if (pending == _pending_keys.end() || pending->second.work != task.work)
+    {
+        return false;
+    }
+
+    // Until now a submission with the key replaced the work of the taken task, from now on it is queued again
+    _pending_keys.erase(pending);
+    return true;
+}
 
 void OnThreadExecutor::worker_thread()
 {
+    std::vector<queued_task> batch;
+    batch.reserve(max_batch_size);
+
     while (!_shutdown_request)
     {
-        task_t task;
+        uint64_t cancel_epoch;
         {
             CallTracer callTracer(__FUNCTION__ "(loop)");
             std::unique_lock task_lock{ _task_mutex };
-            _task_cv.wait(task_lock, [this] { return !_task_queue.empty() || _shutdown_request; });
+            _task_cv.wait(task_lock, [this] { return _queue_depth != 0 || _shutdown_request; });
             if (_shutdown_request)
             {
                 return;
             }
-            task = std::move(_task_queue.front());
-            _task_queue.pop();
+
+            // Take what is pending at once instead of locking for every task, higher priorities first
+            for (size_t lane = 0; lane < _task_queues.size(); lane++)
+            {
+                auto& queue = _task_queues[lane];
+                while (!queue.empty() && batch.size() < max_batch_size)
+                {
+                    batch.emplace_back(std::move(queue.front()));
+                    queue.pop_front();
+                    _lane_sizes[lane]--;
+                    _queue_depth--;
+                }
+            }
+            cancel_epoch = _cancel_epoch;
+        }
+
+        for (size_t i = 0; i < batch.size(); i++)
+        {
+            auto& task = batch[i];
+            if (!can_run(task, cancel_epoch))
+            {
+                // A cancel or a shutdown drops the rest of the batch. Otherwise a task of a higher priority was
+                // submitted, and the rest goes back to the front of its queues to run after it.
+                std::lock_guard lock{ _task_mutex };
+                if (_cancel_epoch == cancel_epoch && !_shutdown_request)
+                {
+                    for (size_t remaining = batch.size(); remaining-- > i;)
+                    {
+                        const auto lane = static_cast<size_t>(batch[remaining].lane);
+                        _task_queues[lane].emplace_front(std::move(batch[remaining]));
+                        _lane_sizes[lane]++;
+                        _queue_depth++;
+                    }
+                }
+                break;
+            }
+
+            // Keyed tasks lock once more, as a submission with the key may replace their work until they start
+            if (!task.key.empty() && !start_keyed(task))
+            {
+                continue;
+            }
+
+            const auto latency = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - task.submitted).count();
+            _total_latency_us += latency;
+            for (auto current = _max_latency_us.load(); latency > current && !_max_latency_us.compare_exchange_weak(current, latency);)
+            {
+            }
+
+            _executed++;
+            task.task();
         }
-        task();
+        batch.clear();
     }
 }
 
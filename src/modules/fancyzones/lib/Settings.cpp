@@ -4,6 +4,7 @@
 
 #include "lib/Settings.h"
 #include "lib/FancyZones.h"
+#include "lib/ZonableAppFilter.h"
 #include "trace.h"
 
 // Non-Localizable strings
@@ -233,6 +234,7 @@ void FancyZonesSettings::LoadSettings(PCWSTR config, bool fromFile) noexcept
                     view.remove_prefix(1);
                 }
             }
+            ZonableAppFilterInstance().SetExcludedApps(m_settings.excludedAppsArray);
         }
 
         if (auto val = values.get_int_value(NonLocalizable::ZoneHighlightOpacityID))
@@ -0,0 +1,133 @@
+#include "pch.h"
+#include "ZonableAppFilter.h"
+
+#include <algorithm>
+
+// Non-Localizable strings
+namespace NonLocalizable
+{
+    const wchar_t PowerToysAppPowerLauncher[] = L"POWERLAUNCHER.EXE";
+    const wchar_t PowerToysAppFZEditor[] = L"FANCYZONESEDITOR.EXE";
+}
+
+namespace
+{
+    bool find_app_name_in_path(const std::wstring& where, const std::vector<std::wstring>& what)
+    {
+        for (const auto& row : what)
+        {
+            const auto pos = where.rfind(row);
+            const auto last_slash = where.rfind('\\');
+            //Check that row occurs in where, and its last occurrence contains in itself the first character after the last backslash.
+            if (pos != std::wstring::npos && pos <= last_slash + 1 && pos + row.length() > last_slash)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+}
+
+ZonableAppFilter::ZonableAppFilter(size_t capacity) :
+    m_capacity(capacity)
+{
+    SetExcludedApps({});
+}
+
+void ZonableAppFilter::SetExcludedApps(const std::vector<std::wstring>& excludedApps)
+{
+    std::scoped_lock lock{ m_mutex };
+
+    m_names = { NonLocalizable::PowerToysAppPowerLauncher, NonLocalizable::PowerToysAppFZEditor };
+    m_paths.clear();
+    for (const auto& app : excludedApps)
+    {
+        if (app.empty() || app.find(L'\\') != std::wstring::npos)
+        {
+            m_paths.push_back(app);
+        }
+        else
+        {
+            m_names.push_back(app);
+        }
+    }
+
+    m_nameSet.clear();
+    m_nameLengths.clear();
+    for (const auto& name : m_names)
+    {
+        m_nameSet.insert(name);
+        m_nameLengths.push_back(name.length());
+    }
+    std::sort(m_nameLengths.begin(), m_nameLengths.end());
+    m_nameLengths.erase(std::unique(m_nameLengths.begin(), m_nameLengths.end()), m_nameLengths.end());
+
+    m_decisionIndex.clear();
+    m_decisions.clear();
+}
+
+bool ZonableAppFilter::IsZonable(const std::wstring& processPath)
+{
+    std::scoped_lock lock{ m_mutex };
+
+    auto it = m_decisionIndex.find(processPath);
+    if (it != m_decisionIndex.end())
+    {
+        m_decisions.splice(m_decisions.begin(), m_decisions, it->second);
+        return it->second->second;
+    }
+
+    std::wstring upperPath = processPath;
+    CharUpperBuffW(upperPath.data(), static_cast<DWORD>(upperPath.length()));
+    const bool zonable = !IsExcluded(upperPath);
+
+    m_decisions.emplace_front(processPath, zonable);
+    m_decisionIndex.emplace(m_decisions.front().first, m_decisions.begin());
+    if (m_decisions.size() > m_capacity)
+    {
+        m_decisionIndex.erase(m_decisions.back().first);
+        m_decisions.pop_back();
+    }
+
+    return zonable;
+}
+
+size_t ZonableAppFilter::CacheSize() const
+{
+    std::scoped_lock lock{ m_mutex };
+    return m_decisions.size();
+}
+
+bool ZonableAppFilter::IsExcluded(const std::wstring& processPath) const
+{
+    const auto lastSlash = processPath.rfind(L'\\');
+    if (lastSlash == std::wstring::npos)
+    {
+        return false;
+    }
+
+    // An excluded app without a backslash has to begin at the file name, and it must not occur again
+    // later in the file name, since the last occurrence in the path is the one that counts.
+    const std::wstring_view fileName = std::wstring_view(processPath).substr(lastSlash + 1);
+    for (size_t length : m_nameLengths)
+    {
+        if (length > fileName.length())
+        {
+            break;
+        }
+
+        const auto name = fileName.substr(0, length);
+        if (m_nameSet.contains(name) && fileName.find(name, 1) == std::wstring_view::npos)
+        {
+            return true;
+        }
+    }
+
+    return find_app_name_in_path(processPath, m_paths);
+}
+
+ZonableAppFilter& ZonableAppFilterInstance()
+{
+    static ZonableAppFilter instance;
+    return instance;
+}
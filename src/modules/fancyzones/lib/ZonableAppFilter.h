@@ -0,0 +1,49 @@
+#pragma once
+
+#include <list>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/**
+ * Decides whether windows of a process can be zoned, based on the excluded apps from the settings.
+ * Windows are checked on every creation and every move, mostly for the same few processes, so the
+ * decisions for recently checked process paths are remembered until the excluded apps change.
+ */
+class ZonableAppFilter
+{
+public:
+    static constexpr size_t DefaultCapacity = 128;
+
+    ZonableAppFilter(size_t capacity = DefaultCapacity);
+
+    // Excluded apps are upper case, as in Settings::excludedAppsArray
+    void SetExcludedApps(const std::vector<std::wstring>& excludedApps);
+
+    bool IsZonable(const std::wstring& processPath);
+
+    size_t CacheSize() const;
+
+private:
+    bool IsExcluded(const std::wstring& processPath) const;
+
+    const size_t m_capacity;
+
+    mutable std::mutex m_mutex;
+
+    // Excluded apps that can only match the beginning of the file name, by length
+    std::vector<std::wstring> m_names;
+    std::unordered_set<std::wstring_view> m_nameSet;
+    std::vector<size_t> m_nameLengths;
+    // Excluded apps containing a backslash, which are searched in the whole path
+    std::vector<std::wstring> m_paths;
+
+    // Most recently used first
+    std::list<std::pair<std::wstring, bool>> m_decisions;
+    std::unordered_map<std::wstring_view, std::list<std::pair<std::wstring, bool>>::iterator> m_decisionIndex;
+};
+
+ZonableAppFilter& ZonableAppFilterInstance();
@@ -9,18 +9,15 @@
 #include "Settings.h"
 #include "util.h"
 
-namespace
+bool ValidateZoneRect(const RECT& rect) noexcept
 {
-    bool ValidateZoneRect(const RECT& rect)
-    {
-        int width  = rect.right - rect.left;
-        int height = rect.bottom - rect.top;
-        return rect.left   >= ZoneConstants::MAX_NEGATIVE_SPACING &&
-               rect.right  >= ZoneConstants::MAX_NEGATIVE_SPACING &&
-               rect.top    >= ZoneConstants::MAX_NEGATIVE_SPACING &&
-               rect.bottom >= ZoneConstants::MAX_NEGATIVE_SPACING &&
-               width >= 0 && height >= 0;
-    }
+    int width  = rect.right - rect.left;
+    int height = rect.bottom - rect.top;
+    return rect.left   >= ZoneConstants::MAX_NEGATIVE_SPACING &&
+           rect.right  >= ZoneConstants::MAX_NEGATIVE_SPACING &&
+           rect.top    >= ZoneConstants::MAX_NEGATIVE_SPACING &&
+           rect.bottom >= ZoneConstants::MAX_NEGATIVE_SPACING &&
+           width >= 0 && height >= 0;
 }
 
 struct Zone : winrt::implements<Zone, IZone>
@@ -30,4 +30,7 @@ interface __declspec(uuid("{8228E934-B6EF-402A-9892-15A1441BF8B0}")) IZone : pub
 
 };
 
+// Whether a zone can have the rectangle, MakeZone fails for the others
+bool ValidateZoneRect(const RECT& rect) noexcept;
+
 winrt::com_ptr<IZone> MakeZone(const RECT& zoneRect, const size_t zoneId) noexcept;
@@ -0,0 +1,194 @@
+#include "pch.h"
+
+#include "ZoneHitTestIndex.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // Keeps the grid small for layouts with a handful of zones, while large canvas layouts end up
+    // with about one zone per cell
+    constexpr LONGLONG MaxGridSize = 64;
+
+    bool ZonesOverlap(const RECT& rectI, const RECT& rectJ, int sensitivityRadius) noexcept
+    {
+        return max(rectI.top, rectJ.top) + sensitivityRadius < min(rectI.bottom, rectJ.bottom) &&
+               max(rectI.left, rectJ.left) + sensitivityRadius < min(rectI.right, rectJ.right);
+    }
+}
+
+void ZoneHitTestIndex::Build(const std::map<size_t, winrt::com_ptr<IZone>>& zones, int sensitivityRadius)
+{
+    ZoneLayout layout;
+    layout.reserve(zones.size());
+    for (const auto& [zoneId, zone] : zones)
+    {
+        layout.emplace_back(zoneId, zone->GetZoneRect());
+    }
+    Build(layout, sensitivityRadius);
+}
+
+void ZoneHitTestIndex::Build(const ZoneLayout& layout, int sensitivityRadius)
+{
+    Clear();
+
+    m_entries.reserve(layout.size());
+    for (const auto& [zoneId, rect] : layout)
+    {
+        const RECT inflatedRect{ rect.left - sensitivityRadius, rect.top - sensitivityRadius, rect.right + sensitivityRadius, rect.bottom + sensitivityRadius };
+        m_entries.push_back({ zoneId, rect, inflatedRect });
+    }
+
+    // Entries are kept in id order, like the zones of a zone set. The zone set only creates the
+    // first zone of an id listed twice, so only the first rectangle is kept.
+    std::stable_sort(m_entries.begin(), m_entries.end(), [](const Entry& a, const Entry& b) { return a.id < b.id; });
+    m_entries.erase(std::unique(m_entries.begin(), m_entries.end(), [](const Entry& a, const Entry& b) { return a.id == b.id; }), m_entries.end());
+
+    for (const auto& entry : m_entries)
+    {
+        if (&entry == &m_entries.front())
+        {
+            m_bounds = entry.inflatedRect;
+        }
+        else
+        {
+            m_bounds.left = min(m_bounds.left, entry.inflatedRect.left);
+            m_bounds.top = min(m_bounds.top, entry.inflatedRect.top);
+            m_bounds.right = max(m_bounds.right, entry.inflatedRect.right);
+            m_bounds.bottom = max(m_bounds.bottom, entry.inflatedRect.bottom);
+        }
+    }
+
+    const size_t count = m_entries.size();
+    if (count == 0)
+    {
+        return;
+    }
+
+    const LONGLONG gridSize = std::clamp(static_cast<LONGLONG>(std::ceil(std::sqrt(static_cast<double>(count)))), 1LL, MaxGridSize);
+    m_columns = static_cast<size_t>(gridSize);
+    m_rows = static_cast<size_t>(gridSize);
+
+    // Inflated rectangles include their right and bottom edges
+    const LONGLONG width = static_cast<LONGLONG>(m_bounds.right) - m_bounds.left + 1;
+    const LONGLONG height = static_cast<LONGLONG>(m_bounds.bottom) - m_bounds.top + 1;
+    m_cellWidth = (width + gridSize - 1) / gridSize;
+    m_cellHeight = (height + gridSize - 1) / gridSize;
+
+    // Count the entries of each cell, then fill them in. Entries are visited in id order, so each
+    // cell lists its entries in id order as well.
+    m_cellStarts.assign(m_columns * m_rows + 1, 0);
+    auto forEachCell = [this](const RECT& rect, auto callback) {
+        for (size_t row = RowFromY(rect.top); row <= RowFromY(rect.bottom); row++)
+        {
+            for (size_t column = ColumnFromX(rect.left); column <= ColumnFromX(rect.right); column++)
+            {
+                callback(row * m_columns + column);
+            }
+        }
+    };
+
+    for (const auto& entry : m_entries)
+    {
+        forEachCell(entry.inflatedRect, [this](size_t cell) { m_cellStarts[cell + 1]++; });
+    }
+
+    for (size_t cell = 1; cell < m_cellStarts.size(); cell++)
+    {
+        m_cellStarts[cell] += m_cellStarts[cell - 1];
+    }
+
+    std::vector<size_t> cellFill(m_cellStarts.begin(), m_cellStarts.end() - 1);
+    m_cellEntries.resize(m_cellStarts.back());
+    for (size_t i = 0; i < count; i++)
+    {
+        forEachCell(m_entries[i].inflatedRect, [&](size_t cell) { m_cellEntries[cellFill[cell]++] = i; });
+    }
+
+    // Overlapping zones always share a cell, so only pairs within a cell need to be compared
+    m_overlaps.assign(count * count, false);
+    for (size_t cell = 0; cell + 1 < m_cellStarts.size(); cell++)
+    {
+        for (size_t a = m_cellStarts[cell]; a < m_cellStarts[cell + 1]; a++)
+        {
+            for (size_t b = a + 1; b < m_cellStarts[cell + 1]; b++)
+            {
+                const size_t i = m_cellEntries[a];
+                const size_t j = m_cellEntries[b];
+                if (ZonesOverlap(m_entries[i].rect, m_entries[j].rect, sensitivityRadius))
+                {
+                    m_overlaps[i * count + j] = true;
+                    m_overlaps[j * count + i] = true;
+                }
+            }
+        }
+    }
+}
+
+void ZoneHitTestIndex::Clear() noexcept
+{
+    m_entries.clear();
+    m_bounds = {};
+    m_columns = 0;
+    m_rows = 0;
+    m_cellStarts.clear();
+    m_cellEntries.clear();
+    m_overlaps.clear();
+}
+
+bool ZoneHitTestIndex::ZonesFromPoint(POINT pt, std::vector<size_t>& capturedZones, size_t& strictlyCapturedCount) const
+{
+    capturedZones.clear();
+    strictlyCapturedCount = 0;
+
+    if (m_entries.empty() ||
+        pt.x < m_bounds.left || pt.x > m_bounds.right ||
+        pt.y < m_bounds.top || pt.y > m_bounds.bottom)
+    {
+        return false;
+    }
+
+    const size_t cell = RowFromY(pt.y) * m_columns + ColumnFromX(pt.x);
+    std::vector<size_t> capturedEntries;
+    for (size_t k = m_cellStarts[cell]; k < m_cellStarts[cell + 1]; k++)
+    {
+        const Entry& entry = m_entries[m_cellEntries[k]];
+        if (entry.inflatedRect.left <= pt.x && pt.x <= entry.inflatedRect.right &&
+            entry.inflatedRect.top <= pt.y && pt.y <= entry.inflatedRect.bottom)
+        {
+            capturedEntries.push_back(m_cellEntries[k]);
+            capturedZones.push_back(entry.id);
+
+            if (entry.rect.left <= pt.x && pt.x < entry.rect.right &&
+                entry.rect.top <= pt.y && pt.y < entry.rect.bottom)
+            {
+                strictlyCapturedCount++;
+            }
+        }
+    }
+
+    const size_t count = m_entries.size();
+    for (size_t a = 0; a < capturedEntries.size(); a++)
+    {
+        for (size_t b = a + 1; b < capturedEntries.size(); b++)
+        {
+            if (m_overlaps[capturedEntries[a] * count + capturedEntries[b]])
+            {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+size_t ZoneHitTestIndex::ColumnFromX(LONG x) const noexcept
+{
+    return (std::min)(static_cast<size_t>((x - static_cast<LONGLONG>(m_bounds.left)) / m_cellWidth), m_columns - 1);
+}
+
+size_t ZoneHitTestIndex::RowFromY(LONG y) const noexcept
+{
+    return (std::min)(static_cast<size_t>((y - static_cast<LONGLONG>(m_bounds.top)) / m_cellHeight), m_rows - 1);
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "Zone.h"
+#include "ZoneLayoutCache.h"
+
+#include <map>
+#include <vector>
+
+/**
+ * Uniform grid over the zones of a zone layout, used to find the zones under the cursor without
+ * checking every zone. Each cell lists the zones whose rectangle, inflated by the sensitivity radius,
+ * reaches into it. Which zones overlap each other is worked out once when the index is built.
+ */
+class ZoneHitTestIndex
+{
+public:
+    /**
+     * Build the index for the given zones, replacing the previous one.
+     *
+     * @param   zones             Zones of the layout, by zone id.
+     * @param   sensitivityRadius Distance from a zone within which the cursor still captures it.
+     */
+    void Build(const std::map<size_t, winrt::com_ptr<IZone>>& zones, int sensitivityRadius);
+
+    /**
+     * Build the index for the zones of a calculated layout, before the zones themselves are created.
+     *
+     * @param   layout            Zone ids and rectangles of the layout.
+     * @param   sensitivityRadius Distance from a zone within which the cursor still captures it.
+     */
+    void Build(const ZoneLayout& layout, int sensitivityRadius);
+
+    void Clear() noexcept;
+
+    /**
+     * Find the zones captured by the cursor.
+     *
+     * @param   pt                    Cursor coordinates.
+     * @param   capturedZones         Receives the ids of the captured zones, in ascending order.
+     * @param   strictlyCapturedCount Receives how many of them contain the point without the sensitivity radius.
+     *
+     * @returns Boolean indicating whether any two of the captured zones overlap.
+     */
+    bool ZonesFromPoint(POINT pt, std::vector<size_t>& capturedZones, size_t& strictlyCapturedCount) const;
+
+private:
+    struct Entry
+    {
+        size_t id;
+        RECT rect;
+        RECT inflatedRect;
+    };
+
+    size_t ColumnFromX(LONG x) const noexcept;
+    size_t RowFromY(LONG y) const noexcept;
+
+    std::vector<Entry> m_entries;
+
+    // Bounds of all inflated rectangles, points outside of them capture nothing
+    RECT m_bounds{};
+    size_t m_columns = 0;
+    size_t m_rows = 0;
+    LONGLONG m_cellWidth = 1;
+    LONGLONG m_cellHeight = 1;
+
+    // Entries of cell c are m_cellEntries[m_cellStarts[c]] up to m_cellEntries[m_cellStarts[c + 1]]
+    std::vector<size_t> m_cellStarts;
+    std::vector<size_t> m_cellEntries;
+
+    // Entry i overlaps entry j if m_overlaps[i * m_entries.size() + j] is set
+    std::vector<bool> m_overlaps;
+};
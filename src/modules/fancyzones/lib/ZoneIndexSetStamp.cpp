@@ -0,0 +1,218 @@
+#include "pch.h"
+
+#include "ZoneIndexSetStamp.h"
+#include "Settings.h"
+
+#include <algorithm>
+#include <bit>
+#include <limits>
+#include <mutex>
+#include <unordered_map>
+
+namespace
+{
+    // Property values with the top bit set are keys into the out of line table, so inline bitmasks
+    // hold zone ids up to 62
+    constexpr size_t OutOfLineTag = size_t{ 1 } << (std::numeric_limits<size_t>::digits - 1);
+    constexpr size_t InlineIdLimit = std::numeric_limits<size_t>::digits - 1;
+
+    struct OutOfLineEntry
+    {
+        // Property value the window was stamped with, a stale entry of a destroyed window whose handle
+        // got reused doesn't match the property of the new window
+        size_t stamp;
+        std::vector<uint8_t> data;
+    };
+
+    std::mutex outOfLineMutex;
+    std::unordered_map<HWND, OutOfLineEntry> outOfLineEntries;
+    size_t nextOutOfLineStamp = 1;
+    size_t pruneSize = 64;
+
+    size_t GetProperty(HWND window) noexcept
+    {
+        return reinterpret_cast<size_t>(::GetProp(window, ZonedWindowProperties::PropertyMultipleZoneID));
+    }
+
+    // Windows are usually unstamped when they are dragged out of their zones, but not when they are
+    // closed, so entries of destroyed windows are dropped whenever the table doubles in size
+    void PruneOutOfLineEntries() noexcept
+    {
+        if (outOfLineEntries.size() < pruneSize)
+        {
+            return;
+        }
+
+        std::erase_if(outOfLineEntries, [](const auto& entry) {
+            return !IsWindow(entry.first) || GetProperty(entry.first) != entry.second.stamp;
+        });
+        pruneSize = (std::max)(size_t{ 64 }, outOfLineEntries.size() * 2);
+    }
+
+    void AppendVarint(std::vector<uint8_t>& data, size_t value)
+    {
+        while (value >= 0x80)
+        {
+            data.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        data.push_back(static_cast<uint8_t>(value));
+    }
+
+    bool ReadVarint(const std::vector<uint8_t>& data, size_t& pos, size_t& value) noexcept
+    {
+        value = 0;
+        for (int shift = 0; pos < data.size() && shift < std::numeric_limits<size_t>::digits; shift += 7)
+        {
+            const uint8_t byte = data[pos++];
+            value |= static_cast<size_t>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+}
+
+namespace ZoneIndexSetStamp
+{
+    void Stamp(HWND window, const std::vector<size_t>& zoneIds) noexcept
+    {
+        if (zoneIds.empty())
+        {
+            Remove(window);
+            return;
+        }
+
+        size_t bitmask = 0;
+        bool fitsInline = true;
+        for (size_t id : zoneIds)
+        {
+            if (id >= InlineIdLimit)
+            {
+                fitsInline = false;
+                break;
+            }
+            bitmask |= size_t{ 1 } << id;
+        }
+
+        if (fitsInline)
+        {
+            std::scoped_lock lock(outOfLineMutex);
+            outOfLineEntries.erase(window);
+            SetProp(window, ZonedWindowProperties::PropertyMultipleZoneID, reinterpret_cast<HANDLE>(bitmask));
+            return;
+        }
+
+        try
+        {
+            auto data = Encode(zoneIds);
+
+            std::scoped_lock lock(outOfLineMutex);
+            const size_t stamp = OutOfLineTag | nextOutOfLineStamp;
+            nextOutOfLineStamp = (nextOutOfLineStamp + 1) & ~OutOfLineTag;
+            if (nextOutOfLineStamp == 0)
+            {
+                nextOutOfLineStamp = 1;
+            }
+
+            outOfLineEntries[window] = OutOfLineEntry{ stamp, std::move(data) };
+            SetProp(window, ZonedWindowProperties::PropertyMultipleZoneID, reinterpret_cast<HANDLE>(stamp));
+            PruneOutOfLineEntries();
+        }
+        catch (const std::bad_alloc&)
+        {
+            Remove(window);
+        }
+    }
+
+    std::vector<size_t> Get(HWND window) noexcept
+    {
+        std::vector<size_t> zoneIds;
+        try
+        {
+            size_t bitmask = GetProperty(window);
+            if ((bitmask & OutOfLineTag) == 0)
+            {
+                zoneIds.reserve(std::popcount(bitmask));
+                while (bitmask != 0)
+                {
+                    zoneIds.push_back(static_cast<size_t>(std::countr_zero(bitmask)));
+                    bitmask &= bitmask - 1;
+                }
+                return zoneIds;
+            }
+
+            std::scoped_lock lock(outOfLineMutex);
+            const auto entry = outOfLineEntries.find(window);
+            if (entry != outOfLineEntries.end() && entry->second.stamp == bitmask)
+            {
+                zoneIds = Decode(entry->second.data);
+            }
+        }
+        catch (const std::bad_alloc&)
+        {
+            zoneIds.clear();
+        }
+        return zoneIds;
+    }
+
+    bool IsStamped(HWND window) noexcept
+    {
+        return GetProperty(window) != 0;
+    }
+
+    void Remove(HWND window) noexcept
+    {
+        std::scoped_lock lock(outOfLineMutex);
+        outOfLineEntries.erase(window);
+        ::RemoveProp(window, ZonedWindowProperties::PropertyMultipleZoneID);
+    }
+
+    std::vector<uint8_t> Encode(std::vector<size_t> zoneIds)
+    {
+        std::sort(zoneIds.begin(), zoneIds.end());
+        zoneIds.erase(std::unique(zoneIds.begin(), zoneIds.end()), zoneIds.end());
+
+        std::vector<uint8_t> data;
+        size_t previousEnd = 0;
+        for (size_t i = 0; i < zoneIds.size();)
+        {
+            size_t length = 1;
+            while (i + length < zoneIds.size() && zoneIds[i + length] == zoneIds[i] + length)
+            {
+                length++;
+            }
+
+            AppendVarint(data, zoneIds[i] - previousEnd);
+            AppendVarint(data, length - 1);
+            previousEnd = zoneIds[i] + length;
+            i += length;
+        }
+        return data;
+    }
+
+    std::vector<size_t> Decode(const std::vector<uint8_t>& data)
+    {
+        std::vector<size_t> zoneIds;
+        size_t pos = 0;
+        size_t previousEnd = 0;
+        while (pos < data.size())
+        {
+            size_t gap, length;
+            if (!ReadVarint(data, pos, gap) || !ReadVarint(data, pos, length))
+            {
+                break;
+            }
+
+            const size_t start = previousEnd + gap;
+            for (size_t id = start; id <= start + length; id++)
+            {
+                zoneIds.push_back(id);
+            }
+            previousEnd = start + length + 1;
+        }
+        return zoneIds;
+    }
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * Zones a window is snapped to, stored with the window in the ZonedWindowProperties::PropertyMultipleZoneID
+ * property. Sets of zone ids below 63 are a bitmask in the property itself, like they have always been.
+ * Larger ids don't fit, so those sets are run-length encoded and kept in a table keyed by the window, and the
+ * property holds a tagged key into it.
+ */
+namespace ZoneIndexSetStamp
+{
+    /**
+     * Stamp the window with the zones it is snapped to, replacing the previous stamp.
+     *
+     * @param   window  Window handle.
+     * @param   zoneIds Zone ids, in any order. An empty set removes the stamp.
+     */
+    void Stamp(HWND window, const std::vector<size_t>& zoneIds) noexcept;
+
+    /**
+     * @returns Zone ids the window is stamped with, in ascending order, or an empty set if it isn't stamped.
+     */
+    std::vector<size_t> Get(HWND window) noexcept;
+
+    /**
+     * @returns Boolean indicating whether the window is stamped with any zone.
+     */
+    bool IsStamped(HWND window) noexcept;
+
+    void Remove(HWND window) noexcept;
+
+    /**
+     * Run-length encoding of the out of line sets: the gap from the end of the previous run and the length
+     * of each run, as variable-length integers.
+     */
+    std::vector<uint8_t> Encode(std::vector<size_t> zoneIds);
+    std::vector<size_t> Decode(const std::vector<uint8_t>& data);
+}
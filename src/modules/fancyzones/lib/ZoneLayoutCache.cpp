@@ -0,0 +1,145 @@
+#include "pch.h"
+#include "ZoneLayoutCache.h"
+
+namespace
+{
+    constexpr uint64_t FnvOffsetBasis = 14695981039346656037ull;
+    constexpr uint64_t FnvPrime = 1099511628211ull;
+
+    class Hasher
+    {
+    public:
+        template<class T>
+        void Add(const T& value) noexcept
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+            const auto* bytes = reinterpret_cast<const uint8_t*>(&value);
+            for (size_t i = 0; i < sizeof(T); i++)
+            {
+                m_hash ^= bytes[i];
+                m_hash *= FnvPrime;
+            }
+        }
+
+        void Add(const std::vector<int>& values) noexcept
+        {
+            Add(values.size());
+            for (int value : values)
+            {
+                Add(value);
+            }
+        }
+
+        uint64_t Hash() const noexcept { return m_hash; }
+
+    private:
+        uint64_t m_hash = FnvOffsetBasis;
+    };
+}
+
+bool ZoneLayoutKey::operator==(const ZoneLayoutKey& other) const noexcept
+{
+    return type == other.type && IsEqualGUID(id, other.id) && contentHash == other.contentHash &&
+           dpiX == other.dpiX && dpiY == other.dpiY && width == other.width && height == other.height &&
+           zoneCount == other.zoneCount && spacing == other.spacing;
+}
+
+size_t ZoneLayoutCache::KeyHash::operator()(const ZoneLayoutKey& key) const noexcept
+{
+    Hasher hasher;
+    hasher.Add(key.type);
+    hasher.Add(key.id);
+    hasher.Add(key.contentHash);
+    hasher.Add(key.dpiX);
+    hasher.Add(key.dpiY);
+    hasher.Add(key.width);
+    hasher.Add(key.height);
+    hasher.Add(key.zoneCount);
+    hasher.Add(key.spacing);
+    return static_cast<size_t>(hasher.Hash());
+}
+
+std::shared_ptr<const ZoneLayout> ZoneLayoutCache::Get(const ZoneLayoutKey& key, const Calculate& calculate)
+{
+    {
+        std::scoped_lock lock{ m_mutex };
+        auto it = m_index.find(key);
+        if (it != m_index.end())
+        {
+            m_entries.splice(m_entries.begin(), m_entries, it->second);
+            return it->second->second;
+        }
+    }
+
+    auto layout = std::make_shared<ZoneLayout>();
+    if (!calculate(*layout))
+    {
+        return nullptr;
+    }
+
+    std::scoped_lock lock{ m_mutex };
+    auto it = m_index.find(key);
+    if (it != m_index.end())
+    {
+        // Calculated on another thread meanwhile
+        return it->second->second;
+    }
+
+    m_entries.emplace_front(key, layout);
+    m_index.emplace(key, m_entries.begin());
+    if (m_entries.size() > m_capacity)
+    {
+        m_index.erase(m_entries.back().first);
+        m_entries.pop_back();
+    }
+
+    return layout;
+}
+
+void ZoneLayoutCache::Clear()
+{
+    std::scoped_lock lock{ m_mutex };
+    m_index.clear();
+    m_entries.clear();
+}
+
+size_t ZoneLayoutCache::Size() const
+{
+    std::scoped_lock lock{ m_mutex };
+    return m_entries.size();
+}
+
+uint64_t ZoneLayoutCache::Hash(const FancyZonesDataTypes::CustomZoneSetData& data) noexcept
+{
+    Hasher hasher;
+    hasher.Add(data.type);
+
+    if (const auto* canvas = std::get_if<FancyZonesDataTypes::CanvasLayoutInfo>(&data.info))
+    {
+        hasher.Add(canvas->zones.size());
+        for (const auto& zone : canvas->zones)
+        {
+            hasher.Add(zone);
+        }
+    }
+    else if (const auto* grid = std::get_if<FancyZonesDataTypes::GridLayoutInfo>(&data.info))
+    {
+        hasher.Add(grid->rows());
+        hasher.Add(grid->columns());
+        hasher.Add(grid->rowsPercents());
+        hasher.Add(grid->columnsPercents());
+        hasher.Add(grid->cellChildMap().size());
+        for (const auto& row : grid->cellChildMap())
+        {
+            hasher.Add(row);
+        }
+    }
+
+    return hasher.Hash();
+}
+
+ZoneLayoutCache& ZoneLayoutCacheInstance()
+{
+    static ZoneLayoutCache instance;
+    return instance;
+}
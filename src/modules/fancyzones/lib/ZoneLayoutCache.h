@@ -0,0 +1,83 @@
+#pragma once
+
+#include "FancyZonesDataTypes.h"
+
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Zone ids and rectangles of a calculated layout, in the order the zones are added to the zone set
+using ZoneLayout = std::vector<std::pair<size_t, RECT>>;
+
+/**
+ * Everything a calculated layout depends on. Predefined layouts leave the id, the content hash and the
+ * DPI at zero, as they don't depend on them.
+ */
+struct ZoneLayoutKey
+{
+    FancyZonesDataTypes::ZoneSetLayoutType type{};
+    GUID id{};
+    // Hash of the custom layout data, so edited layouts aren't taken from the cache
+    uint64_t contentHash = 0;
+    int dpiX = 0;
+    int dpiY = 0;
+    long width = 0;
+    long height = 0;
+    int zoneCount = 0;
+    int spacing = 0;
+
+    bool operator==(const ZoneLayoutKey& other) const noexcept;
+};
+
+/**
+ * Remembers recently calculated layouts. Zone sets of every monitor and virtual desktop are calculated
+ * again whenever the displays change, which is mostly the same few layouts on the same few work areas.
+ * Cached layouts are immutable and shared by the zone sets created from them.
+ */
+class ZoneLayoutCache
+{
+public:
+    // Fills the layout, returns false if it can't be calculated
+    using Calculate = std::function<bool(ZoneLayout&)>;
+
+    static constexpr size_t DefaultCapacity = 64;
+
+    ZoneLayoutCache(size_t capacity = DefaultCapacity) :
+        m_capacity(capacity)
+    {
+    }
+
+    /**
+     * Get the layout for the key, calculating it if it isn't cached. Layouts that can't be calculated
+     * aren't cached.
+     *
+     * @returns The layout, or nullptr if it can't be calculated.
+     */
+    std::shared_ptr<const ZoneLayout> Get(const ZoneLayoutKey& key, const Calculate& calculate);
+
+    void Clear();
+    size_t Size() const;
+
+    static uint64_t Hash(const FancyZonesDataTypes::CustomZoneSetData& data) noexcept;
+
+private:
+    struct KeyHash
+    {
+        size_t operator()(const ZoneLayoutKey& key) const noexcept;
+    };
+
+    using Entry = std::pair<ZoneLayoutKey, std::shared_ptr<const ZoneLayout>>;
+
+    const size_t m_capacity;
+
+    mutable std::mutex m_mutex;
+    // Most recently used first
+    std::list<Entry> m_entries;
+    std::unordered_map<ZoneLayoutKey, std::list<Entry>::iterator, KeyHash> m_index;
+};
+
+ZoneLayoutCache& ZoneLayoutCacheInstance();
@@ -0,0 +1,155 @@
+#include "pch.h"
+
+#include "ZoneNeighborGraph.h"
+#include "util.h"
+
+namespace
+{
+    constexpr DWORD DirectionKeys[] = { VK_LEFT, VK_UP, VK_RIGHT, VK_DOWN };
+
+    std::optional<size_t> DirectionFromKey(DWORD vkCode) noexcept
+    {
+        for (size_t i = 0; i < std::size(DirectionKeys); i++)
+        {
+            if (DirectionKeys[i] == vkCode)
+            {
+                return i;
+            }
+        }
+        return std::nullopt;
+    }
+}
+
+void ZoneNeighborGraph::Build(std::vector<MonitorLayout> layouts, RECT combinedRect)
+{
+    Clear();
+    m_layouts = std::move(layouts);
+    m_nodesByZone.resize(m_layouts.size());
+
+    for (size_t monitorIndex = 0; monitorIndex < m_layouts.size(); monitorIndex++)
+    {
+        const auto& layout = m_layouts[monitorIndex];
+        if (!layout.zoneSet)
+        {
+            continue;
+        }
+
+        for (const auto& [zoneId, zone] : layout.zoneSet->GetZones())
+        {
+            RECT zoneRect = zone->GetZoneRect();
+            zoneRect.left += layout.workAreaRect.left;
+            zoneRect.right += layout.workAreaRect.left;
+            zoneRect.top += layout.workAreaRect.top;
+            zoneRect.bottom += layout.workAreaRect.top;
+
+            Node node{ monitorIndex, zoneId, zoneRect };
+            node.next.fill(NoNode);
+            node.cycleNext.fill(NoNode);
+            m_nodesByZone[monitorIndex][zoneId] = m_nodes.size();
+            m_nodes.push_back(node);
+        }
+    }
+
+    // Candidates are ordered like FancyZones::OnSnapHotkeyBasedOnPosition orders them: zones of the other
+    // monitors first, followed by the zones of the monitor itself when cycling. The order breaks ties
+    // between zones with the same center.
+    for (size_t monitorIndex = 0; monitorIndex < m_layouts.size(); monitorIndex++)
+    {
+        std::vector<size_t> candidates;
+        std::vector<RECT> candidateRects;
+        for (size_t i = 0; i < m_nodes.size(); i++)
+        {
+            if (m_nodes[i].monitorIndex != monitorIndex)
+            {
+                candidates.push_back(i);
+                candidateRects.push_back(m_nodes[i].rect);
+            }
+        }
+        const size_t otherCount = candidates.size();
+
+        for (size_t i = 0; i < m_nodes.size(); i++)
+        {
+            if (m_nodes[i].monitorIndex == monitorIndex)
+            {
+                candidates.push_back(i);
+                candidateRects.push_back(m_nodes[i].rect);
+            }
+        }
+        const std::vector<RECT> otherRects(candidateRects.begin(), candidateRects.begin() + otherCount);
+
+        for (auto& [zoneId, nodeIndex] : m_nodesByZone[monitorIndex])
+        {
+            Node& node = m_nodes[nodeIndex];
+            for (size_t direction = 0; direction < DirectionCount; direction++)
+            {
+                const DWORD vkCode = DirectionKeys[direction];
+
+                size_t chosen = FancyZonesUtils::ChooseNextZoneByPosition(vkCode, node.rect, otherRects);
+                if (chosen < otherRects.size())
+                {
+                    node.next[direction] = candidates[chosen];
+                }
+
+                RECT cycleRect = FancyZonesUtils::PrepareRectForCycling(node.rect, combinedRect, vkCode);
+                chosen = FancyZonesUtils::ChooseNextZoneByPosition(vkCode, cycleRect, candidateRects);
+                if (chosen < candidateRects.size())
+                {
+                    node.cycleNext[direction] = candidates[chosen];
+                }
+            }
+        }
+    }
+}
+
+void ZoneNeighborGraph::Clear() noexcept
+{
+    m_layouts.clear();
+    m_nodes.clear();
+    m_nodesByZone.clear();
+}
+
+bool ZoneNeighborGraph::IsBuiltFrom(const std::vector<MonitorLayout>& layouts) const noexcept
+{
+    if (layouts.size() != m_layouts.size())
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < layouts.size(); i++)
+    {
+        const auto& current = layouts[i];
+        const auto& built = m_layouts[i];
+        if (current.monitor != built.monitor ||
+            !EqualRect(&current.workAreaRect, &built.workAreaRect) ||
+            current.zoneSet.get() != built.zoneSet.get())
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+std::optional<ZoneNeighborGraph::Target> ZoneNeighborGraph::Next(size_t monitorIndex, size_t zoneId, DWORD vkCode, bool cycle) const noexcept
+{
+    const auto direction = DirectionFromKey(vkCode);
+    if (!direction || monitorIndex >= m_nodesByZone.size())
+    {
+        return std::nullopt;
+    }
+
+    const auto it = m_nodesByZone[monitorIndex].find(zoneId);
+    if (it == m_nodesByZone[monitorIndex].end())
+    {
+        return std::nullopt;
+    }
+
+    const Node& node = m_nodes[it->second];
+    const size_t next = cycle ? node.cycleNext[*direction] : node.next[*direction];
+    if (next == NoNode)
+    {
+        return std::nullopt;
+    }
+
+    return Target{ m_nodes[next].monitorIndex, m_nodes[next].zoneId };
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "ZoneSet.h"
+
+#include <array>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Zones of all monitors in screen coordinates, with the zone a window snapped to a single zone moves to when
+ * it leaves its monitor with WIN + arrow keys. Choosing that zone scores every zone on the other monitors,
+ * so the choices are made once when the layouts change, and each hotkey press is a lookup.
+ *
+ * The choices are made from the zone rectangle, not from the rectangle of the window snapped to it. They are
+ * the same unless the window doesn't cover its zone, or the window is right between two candidate zones.
+ */
+class ZoneNeighborGraph
+{
+public:
+    struct MonitorLayout
+    {
+        HMONITOR monitor{};
+        // Work area of the monitor in screen coordinates, zone rects are relative to it
+        RECT workAreaRect{};
+        // Active zone set of the monitor, or null
+        winrt::com_ptr<IZoneSet> zoneSet;
+    };
+
+    struct Target
+    {
+        // Index of the monitor in the layouts the graph was built from
+        size_t monitorIndex;
+        size_t zoneId;
+    };
+
+    /**
+     * Choose the neighbors of every zone, replacing the previous graph.
+     *
+     * @param   layouts      Monitors in the order they are enumerated in.
+     * @param   combinedRect Rectangle covering the work areas of all monitors.
+     */
+    void Build(std::vector<MonitorLayout> layouts, RECT combinedRect);
+
+    void Clear() noexcept;
+
+    /**
+     * @returns Boolean indicating whether the graph was built from the same monitors and zone sets.
+     */
+    bool IsBuiltFrom(const std::vector<MonitorLayout>& layouts) const noexcept;
+
+    /**
+     * Get the zone a window snapped to a zone moves to.
+     *
+     * @param   monitorIndex Index of the monitor of the zone.
+     * @param   zoneId       Zone the window is snapped to.
+     * @param   vkCode       Pressed arrow key.
+     * @param   cycle        Whether to wrap around the edge of all monitors. Without cycling only zones on the
+     *                       other monitors are considered.
+     *
+     * @returns The chosen zone, or nothing if there is no zone in that direction.
+     */
+    std::optional<Target> Next(size_t monitorIndex, size_t zoneId, DWORD vkCode, bool cycle) const noexcept;
+
+private:
+    static constexpr size_t DirectionCount = 4;
+    static constexpr size_t NoNode = static_cast<size_t>(-1);
+
+    struct Node
+    {
+        size_t monitorIndex;
+        size_t zoneId;
+        RECT rect;
+        std::array<size_t, DirectionCount> next;
+        std::array<size_t, DirectionCount> cycleNext;
+    };
+
+    std::vector<MonitorLayout> m_layouts;
+    std::vector<Node> m_nodes;
+    // For each monitor, node index by zone id
+    std::vector<std::unordered_map<size_t, size_t>> m_nodesByZone;
+};
@@ -0,0 +1,164 @@
+#include "pch.h"
+
+#include "ZoneOverlayD2DBackend.h"
+
+#include <common/logger/logger.h>
+
+namespace NonLocalizable
+{
+    const wchar_t SegoeUiFont[] = L"Segoe ui";
+}
+
+std::unique_ptr<ZoneOverlayD2DBackend> ZoneOverlayD2DBackend::Create(HWND window)
+{
+    // Obtain the size of the drawing area.
+    RECT clientRect{};
+    if (!GetClientRect(window, &clientRect))
+    {
+        Logger::error("couldn't initialize ZoneWindowDrawing: GetClientRect failed");
+        return nullptr;
+    }
+
+    // Create a Direct2D render target
+    // We should always use the DPI value of 96 since we're running in DPI aware mode
+    auto renderTargetProperties = D2D1::RenderTargetProperties(
+        D2D1_RENDER_TARGET_TYPE_DEFAULT,
+        D2D1::PixelFormat(DXGI_FORMAT_UNKNOWN, D2D1_ALPHA_MODE_PREMULTIPLIED),
+        96.f,
+        96.f);
+
+    auto renderTargetSize = D2D1::SizeU(clientRect.right - clientRect.left, clientRect.bottom - clientRect.top);
+    auto hwndRenderTargetProperties = D2D1::HwndRenderTargetProperties(window, renderTargetSize);
+
+    winrt::com_ptr<ID2D1HwndRenderTarget> renderTarget;
+    HRESULT hr = GetD2DFactory()->CreateHwndRenderTarget(renderTargetProperties, hwndRenderTargetProperties, renderTarget.put());
+    if (!SUCCEEDED(hr))
+    {
+        Logger::error("couldn't initialize ZoneWindowDrawing: CreateHwndRenderTarget failed with {}", hr);
+        return nullptr;
+    }
+
+    return std::unique_ptr<ZoneOverlayD2DBackend>(new ZoneOverlayD2DBackend(std::move(renderTarget)));
+}
+
+ZoneOverlayD2DBackend::ZoneOverlayD2DBackend(winrt::com_ptr<ID2D1HwndRenderTarget> renderTarget) :
+    m_renderTarget(std::move(renderTarget))
+{
+    // Colors are set on every frame, as the scene colors can change without the geometry
+    const auto black = D2D1::ColorF(D2D1::ColorF::Black);
+    m_renderTarget->CreateSolidColorBrush(black, m_borderBrush.put());
+    m_renderTarget->CreateSolidColorBrush(black, m_inactiveBrush.put());
+    m_renderTarget->CreateSolidColorBrush(black, m_highlightBrush.put());
+    m_renderTarget->CreateSolidColorBrush(black, m_textBrush.put());
+
+    if (auto writeFactory = GetWriteFactory())
+    {
+        writeFactory->CreateTextFormat(NonLocalizable::SegoeUiFont, nullptr, DWRITE_FONT_WEIGHT_NORMAL, DWRITE_FONT_STYLE_NORMAL, DWRITE_FONT_STRETCH_NORMAL, 80.f, L"en-US", m_textFormat.put());
+        if (m_textFormat)
+        {
+            m_textFormat->SetTextAlignment(DWRITE_TEXT_ALIGNMENT_CENTER);
+            m_textFormat->SetParagraphAlignment(DWRITE_PARAGRAPH_ALIGNMENT_CENTER);
+        }
+    }
+}
+
+ID2D1Factory* ZoneOverlayD2DBackend::GetD2DFactory()
+{
+    static auto pD2DFactory = [] {
+        ID2D1Factory* res = nullptr;
+        D2D1CreateFactory(D2D1_FACTORY_TYPE_MULTI_THREADED, &res);
+        return res;
+    }();
+    return pD2DFactory;
+}
+
+IDWriteFactory* ZoneOverlayD2DBackend::GetWriteFactory()
+{
+    static auto pDWriteFactory = [] {
+        IUnknown* res = nullptr;
+        DWriteCreateFactory(DWRITE_FACTORY_TYPE_SHARED, __uuidof(IDWriteFactory), &res);
+        return reinterpret_cast<IDWriteFactory*>(res);
+    }();
+    return pDWriteFactory;
+}
+
+void ZoneOverlayD2DBackend::UpdateTextLayouts(const ZoneOverlayScene& scene)
+{
+    if (m_textLayoutsVersion == scene.GetVersion() && m_textLayouts.size() == scene.GetZones().size())
+    {
+        return;
+    }
+
+    m_textLayouts.clear();
+    m_textLayouts.resize(scene.GetZones().size());
+    m_textLayoutsVersion = scene.GetVersion();
+
+    auto writeFactory = GetWriteFactory();
+    if (!writeFactory || !m_textFormat)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < scene.GetZones().size(); i++)
+    {
+        const auto& zone = scene.GetZones()[i];
+        const float width = (std::max)(zone.rect.right - zone.rect.left, 0.f);
+        const float height = (std::max)(zone.rect.bottom - zone.rect.top, 0.f);
+        writeFactory->CreateTextLayout(zone.label.c_str(), static_cast<UINT32>(zone.label.size()), m_textFormat.get(), width, height, m_textLayouts[i].put());
+    }
+}
+
+bool ZoneOverlayD2DBackend::Draw(const ZoneOverlayScene& scene, float alpha)
+{
+    if (!m_borderBrush || !m_inactiveBrush || !m_highlightBrush || !m_textBrush)
+    {
+        return false;
+    }
+
+    UpdateTextLayouts(scene);
+
+    const auto& colors = scene.GetColors();
+    const auto& zones = scene.GetZones();
+    const auto& highlighted = scene.GetHighlighted();
+
+    m_borderBrush->SetColor(colors.border);
+    m_inactiveBrush->SetColor(colors.inactive);
+    m_highlightBrush->SetColor(colors.highlight);
+    for (auto* brush : { m_borderBrush.get(), m_inactiveBrush.get(), m_highlightBrush.get(), m_textBrush.get() })
+    {
+        brush->SetOpacity(alpha);
+    }
+
+    m_renderTarget->BeginDraw();
+
+    // Draw backdrop
+    m_renderTarget->Clear(D2D1::ColorF(0.f, 0.f, 0.f, 0.f));
+
+    // First draw the inactive zones, then the active zones on top of them
+    for (bool highlightPass : { false, true })
+    {
+        ID2D1SolidColorBrush* fillBrush = highlightPass ? m_highlightBrush.get() : m_inactiveBrush.get();
+        for (size_t i = 0; i < zones.size(); i++)
+        {
+            if (highlighted[i] != highlightPass)
+            {
+                continue;
+            }
+
+            m_renderTarget->FillRectangle(zones[i].rect, fillBrush);
+            m_renderTarget->DrawRectangle(zones[i].rect, m_borderBrush.get());
+
+            if (m_textLayouts[i])
+            {
+                m_renderTarget->DrawTextLayout(D2D1::Point2F(zones[i].rect.left, zones[i].rect.top), m_textLayouts[i].get(), m_textBrush.get());
+            }
+        }
+    }
+
+    return true;
+}
+
+void ZoneOverlayD2DBackend::Present()
+{
+    m_renderTarget->EndDraw();
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <winrt/base.h>
+#include <d2d1.h>
+#include <dwrite.h>
+
+#include "ZoneOverlayScene.h"
+
+/**
+ * Draws the scene into a window with Direct2D. Brushes and the text format live as long as the backend,
+ * text layouts of the labels as long as the scene geometry, and frames only change brush opacities.
+ */
+class ZoneOverlayD2DBackend : public ZoneOverlayBackend
+{
+public:
+    /**
+     * @returns The backend drawing into the client area of the window, or null if the render target
+     *          couldn't be created.
+     */
+    static std::unique_ptr<ZoneOverlayD2DBackend> Create(HWND window);
+
+    bool Draw(const ZoneOverlayScene& scene, float alpha) override;
+    void Present() override;
+
+private:
+    ZoneOverlayD2DBackend(winrt::com_ptr<ID2D1HwndRenderTarget> renderTarget);
+
+    static ID2D1Factory* GetD2DFactory();
+    static IDWriteFactory* GetWriteFactory();
+
+    void UpdateTextLayouts(const ZoneOverlayScene& scene);
+
+    winrt::com_ptr<ID2D1HwndRenderTarget> m_renderTarget;
+    winrt::com_ptr<ID2D1SolidColorBrush> m_borderBrush;
+    winrt::com_ptr<ID2D1SolidColorBrush> m_inactiveBrush;
+    winrt::com_ptr<ID2D1SolidColorBrush> m_highlightBrush;
+    winrt::com_ptr<ID2D1SolidColorBrush> m_textBrush;
+    winrt::com_ptr<IDWriteTextFormat> m_textFormat;
+
+    // Label layout of each zone of the scene, for the scene version m_textLayoutsVersion
+    std::vector<winrt::com_ptr<IDWriteTextLayout>> m_textLayouts;
+    size_t m_textLayoutsVersion = 0;
+};
@@ -0,0 +1,65 @@
+#include "pch.h"
+
+#include "ZoneOverlayScene.h"
+
+#include <algorithm>
+
+void ZoneOverlayScene::SetZones(const IZoneSet::ZonesMap& zones)
+{
+    size_t count = 0;
+    bool changed = false;
+    for (const auto& [zoneId, zone] : zones)
+    {
+        if (!zone)
+        {
+            continue;
+        }
+
+        const D2D1_RECT_F rect = ConvertRect(zone->GetZoneRect());
+        if (count >= m_zones.size() || m_zones[count].id != zoneId ||
+            m_zones[count].rect.left != rect.left || m_zones[count].rect.top != rect.top ||
+            m_zones[count].rect.right != rect.right || m_zones[count].rect.bottom != rect.bottom)
+        {
+            changed = true;
+            break;
+        }
+        count++;
+    }
+
+    if (!changed && count == m_zones.size())
+    {
+        return;
+    }
+
+    m_zones.clear();
+    for (const auto& [zoneId, zone] : zones)
+    {
+        if (zone)
+        {
+            m_zones.push_back(Zone{ zoneId, ConvertRect(zone->GetZoneRect()), std::to_wstring(zone->Id() + 1) });
+        }
+    }
+
+    m_highlighted.assign(m_zones.size(), false);
+    m_version++;
+}
+
+void ZoneOverlayScene::SetHighlight(const std::vector<size_t>& zoneIds)
+{
+    std::fill(m_highlighted.begin(), m_highlighted.end(), false);
+
+    // Zones are sorted by id, like the zones map
+    for (size_t zoneId : zoneIds)
+    {
+        auto it = std::lower_bound(m_zones.begin(), m_zones.end(), zoneId, [](const Zone& zone, size_t id) { return zone.id < id; });
+        if (it != m_zones.end() && it->id == zoneId)
+        {
+            m_highlighted[it - m_zones.begin()] = true;
+        }
+    }
+}
+
+D2D1_RECT_F ZoneOverlayScene::ConvertRect(RECT rect) noexcept
+{
+    return D2D1::RectF((float)rect.left + 0.5f, (float)rect.top + 0.5f, (float)rect.right - 0.5f, (float)rect.bottom - 0.5f);
+}
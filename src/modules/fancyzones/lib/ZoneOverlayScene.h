@@ -0,0 +1,80 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <d2d1.h>
+
+#include "ZoneSet.h"
+
+/**
+ * Zones drawn by the zone window, kept between frames. Rectangles and labels only change with the layout,
+ * while showing the zones under the cursor only flips their highlight flags, so a frame doesn't rebuild
+ * anything but applies the current alpha.
+ */
+class ZoneOverlayScene
+{
+public:
+    struct Colors
+    {
+        D2D1_COLOR_F border{};
+        D2D1_COLOR_F inactive{};
+        D2D1_COLOR_F highlight{};
+    };
+
+    struct Zone
+    {
+        size_t id;
+        D2D1_RECT_F rect;
+        std::wstring label;
+    };
+
+    /**
+     * Update the geometry to the given zones. Rectangles and labels are only rebuilt if a zone was added,
+     * removed or moved, which changes the version. Highlight flags are cleared in that case.
+     */
+    void SetZones(const IZoneSet::ZonesMap& zones);
+    void SetColors(const Colors& colors) noexcept { m_colors = colors; }
+
+    /**
+     * Highlight the given zones, ids not in the scene are ignored.
+     */
+    void SetHighlight(const std::vector<size_t>& zoneIds);
+
+    const std::vector<Zone>& GetZones() const noexcept { return m_zones; }
+    // Highlight flag of each zone, by position in GetZones()
+    const std::vector<bool>& GetHighlighted() const noexcept { return m_highlighted; }
+    const Colors& GetColors() const noexcept { return m_colors; }
+
+    // Changes whenever the rectangles or labels change, backends rebuild their cached resources then
+    size_t GetVersion() const noexcept { return m_version; }
+
+    static D2D1_RECT_F ConvertRect(RECT rect) noexcept;
+
+private:
+    std::vector<Zone> m_zones;
+    std::vector<bool> m_highlighted;
+    Colors m_colors;
+    size_t m_version = 0;
+};
+
+/**
+ * Draws a scene into the zone window. The scene is locked while drawing, but not while presenting,
+ * as presenting waits for the vertical sync.
+ */
+class ZoneOverlayBackend
+{
+public:
+    virtual ~ZoneOverlayBackend() = default;
+
+    /**
+     * Draw the inactive zones and the highlighted zones on top of them, with every color faded by alpha.
+     *
+     * @returns Boolean indicating whether the frame was drawn.
+     */
+    virtual bool Draw(const ZoneOverlayScene& scene, float alpha) = 0;
+
+    /**
+     * Show the frame drawn last.
+     */
+    virtual void Present() = 0;
+};
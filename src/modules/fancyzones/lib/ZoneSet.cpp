@@ -6,6 +6,9 @@
 #include "FancyZonesDataTypes.h"
 #include "Settings.h"
 #include "Zone.h"
+#include "ZoneHitTestIndex.h"
+#include "ZoneIndexSetStamp.h"
+#include "ZoneLayoutCache.h"
 #include "util.h"
 
 #include <common/logger/logger.h>
@@ -101,11 +104,6 @@ namespace
             .columnsPercents = { 2500, 2500, 2500, 2500 },
             .cellChildMap = { { 0, 1, 2, 3 }, { 4, 1, 5, 6 }, { 7, 8, 9, 10 } } }),
     };
-
-    inline void StampWindow(HWND window, size_t bitmask) noexcept
-    {
-        SetProp(window, ZonedWindowProperties::PropertyMultipleZoneID, reinterpret_cast<HANDLE>(bitmask));
-    }
 }
 
 struct ZoneSet : winrt::implements<ZoneSet, IZoneSet>
@@ -132,7 +130,11 @@ public:
     IFACEMETHODIMP_(std::vector<size_t>)
     GetZoneIndexSetFromWindow(HWND window) const noexcept;
     IFACEMETHODIMP_(ZonesMap)
-    GetZones()const noexcept override { return m_zones; }
+    GetZones() const noexcept override
+    {
+        EnsureZones();
+        return m_zones;
+    }
     IFACEMETHODIMP_(void)
     MoveWindowIntoZoneByIndex(HWND window, HWND workAreaWindow, size_t index) noexcept;
     IFACEMETHODIMP_(void)
@@ -153,21 +155,29 @@ public:
     GetCombinedZoneRange(const std::vector<size_t>& initialZones, const std::vector<size_t>& finalZones) const noexcept;
 
 private:
-    bool CalculateFocusLayout(Rect workArea, int zoneCount) noexcept;
-    bool CalculateColumnsAndRowsLayout(Rect workArea, FancyZonesDataTypes::ZoneSetLayoutType type, int zoneCount, int spacing) noexcept;
-    bool CalculateGridLayout(Rect workArea, FancyZonesDataTypes::ZoneSetLayoutType type, int zoneCount, int spacing) noexcept;
-    bool CalculateUniquePriorityGridLayout(Rect workArea, int zoneCount, int spacing) noexcept;
-    bool CalculateCustomLayout(Rect workArea, int spacing) noexcept;
-    bool CalculateGridZones(Rect workArea, FancyZonesDataTypes::GridLayoutInfo gridLayoutInfo, int spacing);
+    bool CalculateFocusLayout(Rect workArea, int zoneCount, ZoneLayout& layout) const;
+    bool CalculateColumnsAndRowsLayout(Rect workArea, FancyZonesDataTypes::ZoneSetLayoutType type, int zoneCount, int spacing, ZoneLayout& layout) const;
+    bool CalculateGridLayout(Rect workArea, FancyZonesDataTypes::ZoneSetLayoutType type, int zoneCount, int spacing, ZoneLayout& layout) const;
+    bool CalculateUniquePriorityGridLayout(Rect workArea, int zoneCount, int spacing, ZoneLayout& layout) const;
+    bool CalculateCustomLayout(Rect workArea, int spacing, const FancyZonesDataTypes::CustomZoneSetData& zoneSet, ZoneLayout& layout) const;
+    bool CalculateGridZones(Rect workArea, const FancyZonesDataTypes::GridLayoutInfo& gridLayoutInfo, int spacing, ZoneLayout& layout) const;
+    // Create the zones of the calculated layout, if they haven't been created yet
+    void EnsureZones() const noexcept;
     std::vector<size_t> ZoneSelectSubregion(const std::vector<size_t>& capturedZones, POINT pt) const;
 
     // `compare` should return true if the first argument is a better choice than the second argument.
     template<class CompareF>
     std::vector<size_t> ZoneSelectPriority(const std::vector<size_t>& capturedZones, CompareF compare) const;
 
-    ZonesMap m_zones;
+    mutable ZonesMap m_zones;
     std::map<HWND, std::vector<size_t>> m_windowIndexSet;
 
+    // Calculated by CalculateZones, its zones are created when they're first needed
+    mutable std::shared_ptr<const ZoneLayout> m_pendingLayout;
+
+    // Rebuilt whenever the zones or the calculated layout change, so that hit tests don't allocate it
+    mutable ZoneHitTestIndex m_hitTestIndex;
+
     // Needed for ExtendWindowByDirectionAndPosition
     std::map<HWND, std::vector<size_t>> m_windowInitialIndexSet;
     std::map<HWND, size_t> m_windowFinalIndex;
@@ -178,12 +188,15 @@ private:
 
 IFACEMETHODIMP ZoneSet::AddZone(winrt::com_ptr<IZone> zone) noexcept
 {
+    EnsureZones();
+
     auto zoneId = zone->Id();
     if (m_zones.contains(zoneId))
     {
         return S_FALSE;
     }
     m_zones[zoneId] = zone;
+    m_hitTestIndex.Build(m_zones, m_config.SensitivityRadius);
 
     return S_OK;
 }
@@ -191,63 +204,21 @@ IFACEMETHODIMP ZoneSet::AddZone(winrt::com_ptr<IZone> zone) noexcept
 IFACEMETHODIMP_(std::vector<size_t>)
 ZoneSet::ZonesFromPoint(POINT pt) const noexcept
 {
+    EnsureZones();
+
     std::vector<size_t> capturedZones;
-    std::vector<size_t> strictlyCapturedZones;
-    for (const auto& [zoneId, zone] : m_zones)
-    {
-        const RECT& zoneRect = zone->GetZoneRect();
-        if (zoneRect.left - m_config.SensitivityRadius <= pt.x && pt.x <= zoneRect.right + m_config.SensitivityRadius &&
-            zoneRect.top - m_config.SensitivityRadius <= pt.y && pt.y <= zoneRect.bottom + m_config.SensitivityRadius)
-        {
-            capturedZones.emplace_back(zoneId);
-        }
-            
-        if (zoneRect.left <= pt.x && pt.x < zoneRect.right &&
-            zoneRect.top <= pt.y && pt.y < zoneRect.bottom)
-        {
-            strictlyCapturedZones.emplace_back(zoneId);
-        }
-    }
+    size_t strictlyCapturedCount = 0;
+    const bool overlap = m_hitTestIndex.ZonesFromPoint(pt, capturedZones, strictlyCapturedCount);
 
     // If only one zone is captured, but it's not strictly captured
     // don't consider it as captured
-    if (capturedZones.size() == 1 && strictlyCapturedZones.size() == 0)
+    if (capturedZones.size() == 1 && strictlyCapturedCount == 0)
     {
         return {};
     }
 
     // If captured zones do not overlap, return all of them
     // Otherwise, return one of them based on the chosen selection algorithm.
-    bool overlap = false;
-    for (size_t i = 0; i < capturedZones.size(); ++i)
-    {
-        for (size_t j = i + 1; j < capturedZones.size(); ++j)
-        {
-            RECT rectI;
-            RECT rectJ;
-            try
-            {
-                rectI = m_zones.at(capturedZones[i])->GetZoneRect();
-                rectJ = m_zones.at(capturedZones[j])->GetZoneRect();
-            }
-            catch (std::out_of_range)
-            {
-                return {};
-            }
-
-            if (max(rectI.top, rectJ.top) + m_config.SensitivityRadius < min(rectI.bottom, rectJ.bottom) &&
-                max(rectI.left, rectJ.left) + m_config.SensitivityRadius < min(rectI.right, rectJ.right))
-            {
-                overlap = true;
-                break;
-            }
-        }
-        if (overlap)
-        {
-            break;
-        }
-    }
-
     if (overlap)
     {
         auto zoneArea = [](auto zone) {
@@ -301,6 +272,8 @@ ZoneSet::MoveWindowIntoZoneByIndex(HWND window, HWND workAreaWindow, size_t inde
 IFACEMETHODIMP_(void)
 ZoneSet::MoveWindowIntoZoneByIndexSet(HWND window, HWND workAreaWindow, const std::vector<size_t>& zoneIds) noexcept
 {
+    EnsureZones();
+
     if (m_zones.empty())
     {
         return;
@@ -315,8 +288,6 @@ ZoneSet::MoveWindowIntoZoneByIndexSet(HWND window, HWND workAreaWindow, const st
 
     RECT size;
     bool sizeEmpty = true;
-    size_t bitmask = 0;
-
     m_windowIndexSet[window] = {};
 
     for (size_t id : zoneIds)
@@ -340,24 +311,21 @@ ZoneSet::MoveWindowIntoZoneByIndexSet(HWND window, HWND workAreaWindow, const st
 
             m_windowIndexSet[window].push_back(id);
         }
-
-        if (id < std::numeric_limits<size_t>::digits)
-        {
-            bitmask |= 1ull << id;
-        }
     }
 
     if (!sizeEmpty)
     {
         SaveWindowSizeAndOrigin(window);
         SizeWindowToRect(window, size);
-        StampWindow(window, bitmask);
+        ZoneIndexSetStamp::Stamp(window, zoneIds);
     }
 }
 
 IFACEMETHODIMP_(bool)
 ZoneSet::MoveWindowIntoZoneByDirectionAndIndex(HWND window, HWND workAreaWindow, DWORD vkCode, bool cycle) noexcept
 {
+    EnsureZones();
+
     if (m_zones.empty())
     {
         return false;
@@ -405,6 +373,8 @@ ZoneSet::MoveWindowIntoZoneByDirectionAndIndex(HWND window, HWND workAreaWindow,
 IFACEMETHODIMP_(bool)
 ZoneSet::MoveWindowIntoZoneByDirectionAndPosition(HWND window, HWND workAreaWindow, DWORD vkCode, bool cycle) noexcept
 {
+    EnsureZones();
+
     if (m_zones.empty())
     {
         return false;
@@ -466,6 +436,8 @@ ZoneSet::MoveWindowIntoZoneByDirectionAndPosition(HWND window, HWND workAreaWind
 IFACEMETHODIMP_(bool)
 ZoneSet::ExtendWindowByDirectionAndPosition(HWND window, HWND workAreaWindow, DWORD vkCode) noexcept
 {
+    EnsureZones();
+
     if (m_zones.empty())
     {
         return false;
@@ -572,26 +544,74 @@ ZoneSet::CalculateZones(RECT workAreaRect, int zoneCount, int spacing) noexcept
         return false;
     }
 
-    bool success = true;
-    switch (m_config.LayoutType)
+    ZoneLayoutKey key{
+        .type = m_config.LayoutType,
+        .width = workArea.width(),
+        .height = workArea.height(),
+        .zoneCount = zoneCount,
+        .spacing = spacing
+    };
+
+    std::optional<FancyZonesDataTypes::CustomZoneSetData> customZoneSet;
+    if (m_config.LayoutType == FancyZonesDataTypes::ZoneSetLayoutType::Custom)
     {
-    case FancyZonesDataTypes::ZoneSetLayoutType::Focus:
-        success = CalculateFocusLayout(workArea, zoneCount);
-        break;
-    case FancyZonesDataTypes::ZoneSetLayoutType::Columns:
-    case FancyZonesDataTypes::ZoneSetLayoutType::Rows:
-        success = CalculateColumnsAndRowsLayout(workArea, m_config.LayoutType, zoneCount, spacing);
-        break;
-    case FancyZonesDataTypes::ZoneSetLayoutType::Grid:
-    case FancyZonesDataTypes::ZoneSetLayoutType::PriorityGrid:
-        success = CalculateGridLayout(workArea, m_config.LayoutType, zoneCount, spacing);
-        break;
-    case FancyZonesDataTypes::ZoneSetLayoutType::Custom:
-        success = CalculateCustomLayout(workArea, spacing);
-        break;
+        wil::unique_cotaskmem_string guidStr;
+        if (SUCCEEDED(StringFromCLSID(m_config.Id, &guidStr)))
+        {
+            customZoneSet = FancyZonesDataInstance().FindCustomZoneSet(guidStr.get());
+        }
+
+        if (!customZoneSet.has_value())
+        {
+            m_zones.clear();
+            m_pendingLayout = nullptr;
+            m_hitTestIndex.Clear();
+            return false;
+        }
+
+        key.id = m_config.Id;
+        key.zoneCount = 0;
+        key.contentHash = ZoneLayoutCache::Hash(*customZoneSet);
+
+        // Canvas zones are scaled to the DPI of the monitor
+        key.dpiX = DPIAware::DEFAULT_DPI;
+        key.dpiY = DPIAware::DEFAULT_DPI;
+        DPIAware::Convert(m_config.Monitor, key.dpiX, key.dpiY);
     }
 
-    return success;
+    auto layout = ZoneLayoutCacheInstance().Get(key, [&](ZoneLayout& layout) {
+        bool success = true;
+        switch (m_config.LayoutType)
+        {
+        case FancyZonesDataTypes::ZoneSetLayoutType::Focus:
+            success = CalculateFocusLayout(workArea, zoneCount, layout);
+            break;
+        case FancyZonesDataTypes::ZoneSetLayoutType::Columns:
+        case FancyZonesDataTypes::ZoneSetLayoutType::Rows:
+            success = CalculateColumnsAndRowsLayout(workArea, m_config.LayoutType, zoneCount, spacing, layout);
+            break;
+        case FancyZonesDataTypes::ZoneSetLayoutType::Grid:
+        case FancyZonesDataTypes::ZoneSetLayoutType::PriorityGrid:
+            success = CalculateGridLayout(workArea, m_config.LayoutType, zoneCount, spacing, layout);
+            break;
+        case FancyZonesDataTypes::ZoneSetLayoutType::Custom:
+            success = CalculateCustomLayout(workArea, spacing, *customZoneSet, layout);
+            break;
+        }
+
+        // All zones within zone set should be valid in order to use its functionality.
+        return success && std::all_of(layout.begin(), layout.end(), [](const auto& zone) { return ValidateZoneRect(zone.second); });
+    });
+
+    m_zones.clear();
+    m_pendingLayout = std::move(layout);
+    m_hitTestIndex.Clear();
+    if (m_pendingLayout)
+    {
+        // Zones are created lazily, but the hit test index only needs the rectangles
+        m_hitTestIndex.Build(*m_pendingLayout, m_config.SensitivityRadius);
+    }
+    return m_pendingLayout != nullptr;
 }
 
 bool ZoneSet::IsZoneEmpty(int zoneIndex) const noexcept
@@ -607,7 +627,36 @@ bool ZoneSet::IsZoneEmpty(int zoneIndex) const noexcept
     return true;
 }
 
-bool ZoneSet::CalculateFocusLayout(Rect workArea, int zoneCount) noexcept
+void ZoneSet::EnsureZones() const noexcept
+{
+    if (!m_pendingLayout)
+    {
+        return;
+    }
+
+    // The hit test index was built from the layout when it was calculated
+    auto layout = std::move(m_pendingLayout);
+    m_pendingLayout = nullptr;
+
+    for (const auto& [zoneId, rect] : *layout)
+    {
+        if (m_zones.contains(zoneId))
+        {
+            continue;
+        }
+
+        auto zone = MakeZone(rect, zoneId);
+        if (!zone)
+        {
+            m_zones.clear();
+            m_hitTestIndex.Clear();
+            return;
+        }
+        m_zones[zoneId] = zone;
+    }
+}
+
+bool ZoneSet::CalculateFocusLayout(Rect workArea, int zoneCount, ZoneLayout& layout) const
 {
     long left{ 100 };
     long top{ 100 };
@@ -621,17 +670,8 @@ bool ZoneSet::CalculateFocusLayout(Rect workArea, int zoneCount) noexcept
 
     for (int i = 0; i < zoneCount; i++)
     {
-        auto zone = MakeZone(focusZoneRect, m_zones.size());
-        if (zone)
-        {
-            AddZone(zone);
-        }
-        else
-        {
-            // All zones within zone set should be valid in order to use its functionality.
-            m_zones.clear();
-            return false;
-        }
+        layout.emplace_back(layout.size(), focusZoneRect);
+
         focusZoneRect.left += focusRectXIncrement;
         focusZoneRect.right += focusRectXIncrement;
         focusZoneRect.bottom += focusRectYIncrement;
@@ -641,7 +681,7 @@ bool ZoneSet::CalculateFocusLayout(Rect workArea, int zoneCount) noexcept
     return true;
 }
 
-bool ZoneSet::CalculateColumnsAndRowsLayout(Rect workArea, FancyZonesDataTypes::ZoneSetLayoutType type, int zoneCount, int spacing) noexcept
+bool ZoneSet::CalculateColumnsAndRowsLayout(Rect workArea, FancyZonesDataTypes::ZoneSetLayoutType type, int zoneCount, int spacing, ZoneLayout& layout) const
 {
     long totalWidth;
     long totalHeight;
@@ -677,18 +717,7 @@ bool ZoneSet::CalculateColumnsAndRowsLayout(Rect workArea, FancyZonesDataTypes::
             bottom = top + (zoneIndex + 1) * totalHeight / zoneCount - zoneIndex * totalHeight / zoneCount;
         }
 
-
-        auto zone = MakeZone(RECT{ left, top, right, bottom }, m_zones.size());
-        if (zone)
-        {
-            AddZone(zone);
-        }
-        else
-        {
-            // All zones within zone set should be valid in order to use its functionality.
-            m_zones.clear();
-            return false;
-        }
+        layout.emplace_back(layout.size(), RECT{ left, top, right, bottom });
 
         if (type == FancyZonesDataTypes::ZoneSetLayoutType::Columns)
         {
@@ -703,12 +732,12 @@ bool ZoneSet::CalculateColumnsAndRowsLayout(Rect workArea, FancyZonesDataTypes::
     return true;
 }
 
-bool ZoneSet::CalculateGridLayout(Rect workArea, FancyZonesDataTypes::ZoneSetLayoutType type, int zoneCount, int spacing) noexcept
+bool ZoneSet::CalculateGridLayout(Rect workArea, FancyZonesDataTypes::ZoneSetLayoutType type, int zoneCount, int spacing, ZoneLayout& layout) const
 {
     const auto count = sizeof(predefinedPriorityGridLayouts) / sizeof(FancyZonesDataTypes::GridLayoutInfo);
     if (type == FancyZonesDataTypes::ZoneSetLayoutType::PriorityGrid && zoneCount < count)
     {
-        return CalculateUniquePriorityGridLayout(workArea, zoneCount, spacing);
+        return CalculateUniquePriorityGridLayout(workArea, zoneCount, spacing, layout);
     }
 
     int rows = 1, columns = 1;
@@ -757,73 +786,49 @@ bool ZoneSet::CalculateGridLayout(Rect workArea, FancyZonesDataTypes::ZoneSetLay
             }
         }
     }
-    return CalculateGridZones(workArea, gridLayoutInfo, spacing);
+    return CalculateGridZones(workArea, gridLayoutInfo, spacing, layout);
 }
 
-bool ZoneSet::CalculateUniquePriorityGridLayout(Rect workArea, int zoneCount, int spacing) noexcept
+bool ZoneSet::CalculateUniquePriorityGridLayout(Rect workArea, int zoneCount, int spacing, ZoneLayout& layout) const
 {
     if (zoneCount <= 0 || zoneCount >= sizeof(predefinedPriorityGridLayouts))
     {
         return false;
     }
 
-    return CalculateGridZones(workArea, predefinedPriorityGridLayouts[zoneCount - 1], spacing);
+    return CalculateGridZones(workArea, predefinedPriorityGridLayouts[zoneCount - 1], spacing, layout);
 }
 
-bool ZoneSet::CalculateCustomLayout(Rect workArea, int spacing) noexcept
+bool ZoneSet::CalculateCustomLayout(Rect workArea, int spacing, const FancyZonesDataTypes::CustomZoneSetData& zoneSet, ZoneLayout& layout) const
 {
-    wil::unique_cotaskmem_string guidStr;
-    if (SUCCEEDED(StringFromCLSID(m_config.Id, &guidStr)))
+    if (zoneSet.type == FancyZonesDataTypes::CustomLayoutType::Canvas && std::holds_alternative<FancyZonesDataTypes::CanvasLayoutInfo>(zoneSet.info))
     {
-        const std::wstring guid = guidStr.get();
-
-        const auto zoneSetSearchResult = FancyZonesDataInstance().FindCustomZoneSet(guid);
-
-        if (!zoneSetSearchResult.has_value())
+        const auto& zoneSetInfo = std::get<FancyZonesDataTypes::CanvasLayoutInfo>(zoneSet.info);
+        for (const auto& zone : zoneSetInfo.zones)
         {
-            return false;
-        }
+            int x = zone.x;
+            int y = zone.y;
+            int width = zone.width;
+            int height = zone.height;
 
-        const auto& zoneSet = *zoneSetSearchResult;
-        if (zoneSet.type == FancyZonesDataTypes::CustomLayoutType::Canvas && std::holds_alternative<FancyZonesDataTypes::CanvasLayoutInfo>(zoneSet.info))
-        {
-            const auto& zoneSetInfo = std::get<FancyZonesDataTypes::CanvasLayoutInfo>(zoneSet.info);
-            for (const auto& zone : zoneSetInfo.zones)
-            {
-                int x = zone.x;
-                int y = zone.y;
-                int width = zone.width;
-                int height = zone.height;
-
-                DPIAware::Convert(m_config.Monitor, x, y);
-                DPIAware::Convert(m_config.Monitor, width, height);
-
-                auto zone = MakeZone(RECT{ x, y, x + width, y + height }, m_zones.size());
-                if (zone)
-                {
-                    AddZone(zone);
-                }
-                else
-                {
-                    // All zones within zone set should be valid in order to use its functionality.
-                    m_zones.clear();
-                    return false;
-                }
-            }
+            DPIAware::Convert(m_config.Monitor, x, y);
+            DPIAware::Convert(m_config.Monitor, width, height);
 
-            return true;
-        }
-        else if (zoneSet.type == FancyZonesDataTypes::CustomLayoutType::Grid && std::holds_alternative<FancyZonesDataTypes::GridLayoutInfo>(zoneSet.info))
-        {
-            const auto& info = std::get<FancyZonesDataTypes::GridLayoutInfo>(zoneSet.info);
-            return CalculateGridZones(workArea, info, spacing);
+            layout.emplace_back(layout.size(), RECT{ x, y, x + width, y + height });
         }
+
+        return true;
+    }
+    else if (zoneSet.type == FancyZonesDataTypes::CustomLayoutType::Grid && std::holds_alternative<FancyZonesDataTypes::GridLayoutInfo>(zoneSet.info))
+    {
+        const auto& info = std::get<FancyZonesDataTypes::GridLayoutInfo>(zoneSet.info);
+        return CalculateGridZones(workArea, info, spacing, layout);
     }
 
     return false;
 }
 
-bool ZoneSet::CalculateGridZones(Rect workArea, FancyZonesDataTypes::GridLayoutInfo gridLayoutInfo, int spacing)
+bool ZoneSet::CalculateGridZones(Rect workArea, const FancyZonesDataTypes::GridLayoutInfo& gridLayoutInfo, int spacing, ZoneLayout& layout) const
 {
     long totalWidth = workArea.width();
     long totalHeight = workArea.height();
@@ -836,7 +841,7 @@ bool ZoneSet::CalculateGridZones(Rect workArea, FancyZonesDataTypes::GridLayoutI
     std::vector<Info> rowInfo(gridLayoutInfo.rows());
     std::vector<Info> columnInfo(gridLayoutInfo.columns());
 
-    // Note: The expressions below are carefully written to 
+    // Note: The expressions below are carefully written to
     // make the sum of all zones' sizes exactly total{Width|Height}
     int totalPercents = 0;
     for (int row = 0; row < gridLayoutInfo.rows(); row++)
@@ -886,17 +891,7 @@ bool ZoneSet::CalculateGridZones(Rect workArea, FancyZonesDataTypes::GridLayoutI
                 left += col == 0 ? spacing : spacing / 2;
                 right -= maxCol == gridLayoutInfo.columns() - 1 ? spacing : spacing / 2;
 
-                auto zone = MakeZone(RECT{ left, top, right, bottom }, i);
-                if (zone)
-                {
-                    AddZone(zone);
-                }
-                else
-                {
-                    // All zones within zone set should be valid in order to use its functionality.
-                    m_zones.clear();
-                    return false;
-                }
+                layout.emplace_back(static_cast<size_t>(i), RECT{ left, top, right, bottom });
             }
         }
     }
@@ -906,6 +901,8 @@ bool ZoneSet::CalculateGridZones(Rect workArea, FancyZonesDataTypes::GridLayoutI
 
 std::vector<size_t> ZoneSet::GetCombinedZoneRange(const std::vector<size_t>& initialZones, const std::vector<size_t>& finalZones) const noexcept
 {
+    EnsureZones();
+
     std::vector<size_t> combinedZones, result;
     std::set_union(begin(initialZones), end(initialZones), begin(finalZones), end(finalZones), std::back_inserter(combinedZones));
 
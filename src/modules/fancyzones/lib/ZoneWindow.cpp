@@ -10,7 +10,7 @@
 #include "util.h"
 #include "on_thread_executor.h"
 #include "Settings.h"
-#include "CallTracer.h"
+#include <common/logger/call_tracer.h>
 
 #include <ShellScalingApi.h>
 #include <mutex>
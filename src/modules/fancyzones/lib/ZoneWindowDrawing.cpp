@@ -1,6 +1,7 @@
 #include "pch.h"
 #include "ZoneWindowDrawing.h"
-#include "CallTracer.h"
+#include "ZoneOverlayD2DBackend.h"
+#include <common/logger/call_tracer.h>
 
 #include <algorithm>
 #include <map>
@@ -15,11 +16,6 @@ namespace
     const int FlashZonesDurationMillis = 700;
 }
 
-namespace NonLocalizable
-{
-    const wchar_t SegoeUiFont[] = L"Segoe ui";
-}
-
 float ZoneWindowDrawing::GetAnimationAlpha()
 {
     // Lock is held by the caller
@@ -41,26 +37,6 @@ float ZoneWindowDrawing::GetAnimationAlpha()
     return std::clamp(millis / FadeInDurationMillis, 0.001f, 1.f);
 }
 
-ID2D1Factory* ZoneWindowDrawing::GetD2DFactory()
-{
-    static auto pD2DFactory = [] {
-        ID2D1Factory* res = nullptr;
-        D2D1CreateFactory(D2D1_FACTORY_TYPE_MULTI_THREADED, &res);
-        return res;
-    }();
-    return pD2DFactory;
-}
-
-IDWriteFactory* ZoneWindowDrawing::GetWriteFactory()
-{
-    static auto pDWriteFactory = [] {
-        IUnknown* res = nullptr;
-        DWriteCreateFactory(DWRITE_FACTORY_TYPE_SHARED, __uuidof(IDWriteFactory), &res);
-        return reinterpret_cast<IDWriteFactory*>(res);
-    }();
-    return pDWriteFactory;
-}
-
 D2D1_COLOR_F ZoneWindowDrawing::ConvertColor(COLORREF color)
 {
     return D2D1::ColorF(GetRValue(color) / 255.f,
@@ -69,41 +45,17 @@ D2D1_COLOR_F ZoneWindowDrawing::ConvertColor(COLORREF color)
                         1.f);
 }
 
-D2D1_RECT_F ZoneWindowDrawing::ConvertRect(RECT rect)
+ZoneWindowDrawing::ZoneWindowDrawing(HWND window) :
+    ZoneWindowDrawing(window, ZoneOverlayD2DBackend::Create(window))
 {
-    return D2D1::RectF((float)rect.left + 0.5f, (float)rect.top + 0.5f, (float)rect.right - 0.5f, (float)rect.bottom - 0.5f);
 }
 
-ZoneWindowDrawing::ZoneWindowDrawing(HWND window)
+ZoneWindowDrawing::ZoneWindowDrawing(HWND window, std::unique_ptr<ZoneOverlayBackend> backend) :
+    m_window(window),
+    m_backend(std::move(backend))
 {
-    HRESULT hr;
-    m_window = window;
-    m_renderTarget = nullptr;
-    m_shouldRender = false;
-
-    // Obtain the size of the drawing area.
-    if (!GetClientRect(window, &m_clientRect))
-    {
-        Logger::error("couldn't initialize ZoneWindowDrawing: GetClientRect failed");
-        return;
-    }
-
-    // Create a Direct2D render target
-    // We should always use the DPI value of 96 since we're running in DPI aware mode
-    auto renderTargetProperties = D2D1::RenderTargetProperties(
-        D2D1_RENDER_TARGET_TYPE_DEFAULT,
-        D2D1::PixelFormat(DXGI_FORMAT_UNKNOWN, D2D1_ALPHA_MODE_PREMULTIPLIED),
-        96.f,
-        96.f);
-
-    auto renderTargetSize = D2D1::SizeU(m_clientRect.right - m_clientRect.left, m_clientRect.bottom - m_clientRect.top);
-    auto hwndRenderTargetProperties = D2D1::HwndRenderTargetProperties(window, renderTargetSize);
-
-    hr = GetD2DFactory()->CreateHwndRenderTarget(renderTargetProperties, hwndRenderTargetProperties, &m_renderTarget);
-
-    if (!SUCCEEDED(hr))
+    if (!m_backend)
     {
-        Logger::error("couldn't initialize ZoneWindowDrawing: CreateHwndRenderTarget failed with {}", hr);
         return;
     }
 
@@ -114,7 +66,7 @@ ZoneWindowDrawing::RenderResult ZoneWindowDrawing::Render()
 {
     std::unique_lock lock(m_mutex);
 
-    if (!m_renderTarget)
+    if (!m_backend)
     {
         return RenderResult::Failed;
     }
@@ -126,70 +78,15 @@ ZoneWindowDrawing::RenderResult ZoneWindowDrawing::Render()
         return RenderResult::AnimationEnded;
     }
 
-    m_renderTarget->BeginDraw();
-
-    // Draw backdrop
-    m_renderTarget->Clear(D2D1::ColorF(0.f, 0.f, 0.f, 0.f));
-
-    ID2D1SolidColorBrush* textBrush = nullptr;
-    IDWriteTextFormat* textFormat = nullptr;
-
-    m_renderTarget->CreateSolidColorBrush(D2D1::ColorF(D2D1::ColorF::Black, animationAlpha), &textBrush);
-    auto writeFactory = GetWriteFactory();
-
-    if (writeFactory)
-    {
-        writeFactory->CreateTextFormat(NonLocalizable::SegoeUiFont, nullptr, DWRITE_FONT_WEIGHT_NORMAL, DWRITE_FONT_STYLE_NORMAL, DWRITE_FONT_STRETCH_NORMAL, 80.f, L"en-US", &textFormat);
-    }
-
-    for (auto drawableRect : m_sceneRects)
+    if (!m_backend->Draw(m_scene, animationAlpha))
     {
-        ID2D1SolidColorBrush* borderBrush = nullptr;
-        ID2D1SolidColorBrush* fillBrush = nullptr;
-
-        // Need to copy the rect from m_sceneRects
-        drawableRect.borderColor.a *= animationAlpha;
-        drawableRect.fillColor.a *= animationAlpha;
-
-        m_renderTarget->CreateSolidColorBrush(drawableRect.borderColor, &borderBrush);
-        m_renderTarget->CreateSolidColorBrush(drawableRect.fillColor, &fillBrush);
-
-        if (fillBrush)
-        {
-            m_renderTarget->FillRectangle(drawableRect.rect, fillBrush);
-            fillBrush->Release();
-        }
-
-        if (borderBrush)
-        {
-            m_renderTarget->DrawRectangle(drawableRect.rect, borderBrush);
-            borderBrush->Release();
-        }
-
-        std::wstring idStr = std::to_wstring(drawableRect.id + 1);
-
-        if (textFormat && textBrush)
-        {
-            textFormat->SetTextAlignment(DWRITE_TEXT_ALIGNMENT_CENTER);
-            textFormat->SetParagraphAlignment(DWRITE_PARAGRAPH_ALIGNMENT_CENTER);
-            m_renderTarget->DrawTextW(idStr.c_str(), (UINT32)idStr.size(), textFormat, drawableRect.rect, textBrush);
-        }
-    }
-
-    if (textFormat)
-    {
-        textFormat->Release();
-    }
-
-    if (textBrush)
-    {
-        textBrush->Release();
+        return RenderResult::Failed;
     }
 
-    // The lock must be released here, as EndDraw() will wait for vertical sync
+    // The lock must be released here, as presenting will wait for vertical sync
     lock.unlock();
 
-    m_renderTarget->EndDraw();
+    m_backend->Present();
     return RenderResult::Ok;
 }
 
@@ -284,62 +181,19 @@ void ZoneWindowDrawing::DrawActiveZoneSet(const IZoneSet::ZonesMap& zones,
     _TRACER_;
     std::unique_lock lock(m_mutex);
 
-    m_sceneRects = {};
-
-    auto borderColor = ConvertColor(host->GetZoneBorderColor());
-    auto inactiveColor = ConvertColor(host->GetZoneColor());
-    auto highlightColor = ConvertColor(host->GetZoneHighlightColor());
+    ZoneOverlayScene::Colors colors{
+        .border = ConvertColor(host->GetZoneBorderColor()),
+        .inactive = ConvertColor(host->GetZoneColor()),
+        .highlight = ConvertColor(host->GetZoneHighlightColor())
+    };
 
-    inactiveColor.a = host->GetZoneHighlightOpacity() / 100.f;
-    highlightColor.a = host->GetZoneHighlightOpacity() / 100.f;
+    colors.inactive.a = host->GetZoneHighlightOpacity() / 100.f;
+    colors.highlight.a = host->GetZoneHighlightOpacity() / 100.f;
 
-    std::vector<bool> isHighlighted(zones.size() + 1, false);
-    for (size_t x : highlightZones)
-    {
-        isHighlighted[x] = true;
-    }
-
-    // First draw the inactive zones
-    for (const auto& [zoneId, zone] : zones)
-    {
-        if (!zone)
-        {
-            continue;
-        }
-
-        if (!isHighlighted[zoneId])
-        {
-            DrawableRect drawableRect{
-                .rect = ConvertRect(zone->GetZoneRect()),
-                .borderColor = borderColor,
-                .fillColor = inactiveColor,
-                .id = zone->Id()
-            };
-
-            m_sceneRects.push_back(drawableRect);
-        }
-    }
-
-    // Draw the active zones on top of the inactive zones
-    for (const auto& [zoneId, zone] : zones)
-    {
-        if (!zone)
-        {
-            continue;
-        }
-
-        if (isHighlighted[zoneId])
-        {
-            DrawableRect drawableRect{
-                .rect = ConvertRect(zone->GetZoneRect()),
-                .borderColor = borderColor,
-                .fillColor = highlightColor,
-                .id = zone->Id()
-            };
-
-            m_sceneRects.push_back(drawableRect);
-        }
-    }
+    // Rectangles and labels are kept unless the layout changed
+    m_scene.SetZones(zones);
+    m_scene.SetColors(colors);
+    m_scene.SetHighlight(highlightZones);
 }
 
 ZoneWindowDrawing::~ZoneWindowDrawing()
@@ -350,10 +204,8 @@ ZoneWindowDrawing::~ZoneWindowDrawing()
         m_shouldRender = true;
     }
     m_cv.notify_all();
-    m_renderThread.join();
-
-    if (m_renderTarget)
+    if (m_renderThread.joinable())
     {
-        m_renderTarget->Release();
+        m_renderThread.join();
     }
 }
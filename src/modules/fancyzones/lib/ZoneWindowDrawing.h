@@ -1,27 +1,20 @@
 #pragma once
 
 #include <map>
+#include <memory>
 #include <vector>
 #include <wil\resource.h>
 #include <winrt/base.h>
 #include <d2d1.h>
-#include <dwrite.h>
 
 #include "util.h"
 #include "Zone.h"
 #include "ZoneSet.h"
 #include "FancyZones.h"
+#include "ZoneOverlayScene.h"
 
 class ZoneWindowDrawing
 {
-    struct DrawableRect
-    {
-        D2D1_RECT_F rect;
-        D2D1_COLOR_F borderColor;
-        D2D1_COLOR_F fillColor;
-        size_t id;
-    };
-
     struct AnimationInfo
     {
         std::chrono::steady_clock::time_point tStart;
@@ -36,18 +29,14 @@ class ZoneWindowDrawing
     };
 
     HWND m_window = nullptr;
-    RECT m_clientRect{};
-    ID2D1HwndRenderTarget* m_renderTarget = nullptr;
+    std::unique_ptr<ZoneOverlayBackend> m_backend;
     std::optional<AnimationInfo> m_animation;
 
     std::mutex m_mutex;
-    std::vector<DrawableRect> m_sceneRects;
+    ZoneOverlayScene m_scene;
 
     float GetAnimationAlpha();
-    static ID2D1Factory* GetD2DFactory();
-    static IDWriteFactory* GetWriteFactory();
     static D2D1_COLOR_F ConvertColor(COLORREF color);
-    static D2D1_RECT_F ConvertRect(RECT rect);
     RenderResult Render();
     void RenderLoop();
 
@@ -60,6 +49,7 @@ public:
 
     ~ZoneWindowDrawing();
     ZoneWindowDrawing(HWND window);
+    ZoneWindowDrawing(HWND window, std::unique_ptr<ZoneOverlayBackend> backend);
     void Hide();
     void Show();
     void Flash();
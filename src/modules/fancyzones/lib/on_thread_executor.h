@@ -3,29 +3,101 @@
 #include <future>
 #include <thread>
 #include <functional>
-#include <queue>
+#include <deque>
+#include <array>
 #include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <unordered_map>
 
 // OnThreadExecutor allows its caller to off-load some work to a persistently running background thread.
 // This might come in handy if you use the API which sets thread-wide global state and the state needs
 // to be isolated.
+//
+// Tasks run in the order they were submitted within a priority, higher priorities first. Tasks submitted
+// with a key replace the pending task with the same key, so a burst of updates runs once. The worker takes
+// up to max_batch_size tasks at once, and a cancel, a shutdown or a task of a higher priority submitted
+// meanwhile still applies to the tasks it took but hasn't run yet.
 
 class OnThreadExecutor final
 {
 public:
     using task_t = std::packaged_task<void()>;
 
+    enum class priority
+    {
+        high,
+        normal,
+        low,
+    };
+
+    struct statistics
+    {
+        size_t queue_depth = 0;
+        size_t max_queue_depth = 0;
+        uint64_t executed = 0;
+        uint64_t coalesced = 0;
+        // Time from submitting a task until it starts
+        std::chrono::microseconds total_latency{};
+        std::chrono::microseconds max_latency{};
+    };
+
     OnThreadExecutor();
     ~OnThreadExecutor();
-    std::future<void> submit(task_t task);
+    std::future<void> submit(task_t task, priority task_priority = priority::normal);
+
+    // Replaces the pending task with the same key, which keeps its place in the queue. The returned future
+    // is shared by the replaced submissions and becomes ready once the latest of them has run.
+    std::shared_future<void> submit(const std::string& key, std::function<void()> work, priority task_priority = priority::normal);
+
     void cancel();
+    // Drops the pending task with the key, returns false if there is none
+    bool cancel(const std::string& key);
+
+    statistics get_statistics() const;
 
 private:
+    static constexpr size_t max_batch_size = 32;
+
+    struct queued_task
+    {
+        task_t task;
+        std::string key;
+        // The work of a keyed task, which identifies the submission in _pending_keys
+        std::shared_ptr<std::function<void()>> work;
+        priority lane = priority::normal;
+        std::chrono::steady_clock::time_point submitted;
+    };
+
+    struct keyed_work
+    {
+        std::shared_ptr<std::function<void()>> work;
+        std::shared_future<void> future;
+    };
+
+    void enqueue(queued_task task, priority task_priority);
+    // Whether the rest of a batch taken at cancel_epoch can run before the remaining task
+    bool can_run(const queued_task& remaining, uint64_t cancel_epoch) const;
+    // Removes the key of a taken task from _pending_keys, returns false if the task was cancelled
+    bool start_keyed(const queued_task& task);
     void worker_thread();
 
-    std::mutex _task_mutex;
+    mutable std::mutex _task_mutex;
     std::condition_variable _task_cv;
     std::atomic_bool _shutdown_request;
-    std::queue<std::packaged_task<void()>> _task_queue;
+    std::array<std::deque<queued_task>, 3> _task_queues;
+    std::unordered_map<std::string, keyed_work> _pending_keys;
+    // Read by the worker between the tasks of a batch without taking the lock
+    std::atomic<uint64_t> _cancel_epoch = 0;
+    std::array<std::atomic<size_t>, 3> _lane_sizes{};
+
+    size_t _queue_depth = 0;
+    size_t _max_queue_depth = 0;
+    uint64_t _coalesced = 0;
+    std::atomic<uint64_t> _executed = 0;
+    std::atomic<int64_t> _total_latency_us = 0;
+    std::atomic<int64_t> _max_latency_us = 0;
+
     std::thread _worker_thread;
 };
@@ -194,8 +194,9 @@ namespace FancyZonesUtils
 
     bool HasNoVisibleOwner(HWND window) noexcept;
     bool IsStandardWindow(HWND window);
-    bool IsCandidateForLastKnownZone(HWND window, const std::vector<std::wstring>& excludedApps) noexcept;
-    bool IsCandidateForZoning(HWND window, const std::vector<std::wstring>& excludedApps) noexcept;
+    // Excluded apps are taken from ZonableAppFilterInstance()
+    bool IsCandidateForLastKnownZone(HWND window) noexcept;
+    bool IsCandidateForZoning(HWND window) noexcept;
 
     bool IsWindowMaximized(HWND window) noexcept;
     void SaveWindowSizeAndOrigin(HWND window) noexcept;
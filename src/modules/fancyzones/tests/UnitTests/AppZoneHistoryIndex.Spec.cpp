@@ -0,0 +1,152 @@
+#include "pch.h"
+#include "lib\AppZoneHistoryIndex.h"
+
+#include <chrono>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace FancyZonesDataTypes;
+
+namespace FancyZonesUnitTests
+{
+    TEST_CLASS (AppZoneHistoryIndexUnitTests)
+    {
+        using HistoryMap = std::unordered_map<std::wstring, AppZoneHistoryIndex::History>;
+
+        static AppZoneHistoryData MakeData(const std::wstring& deviceId, const std::wstring& zoneSetId, size_t zoneIndex)
+        {
+            return AppZoneHistoryData{ .zoneSetUuid = zoneSetId, .deviceId = deviceId, .zoneIndexSet = { zoneIndex } };
+        }
+
+        static std::wstring AppPath(int app)
+        {
+            return L"C:\\Program Files\\App" + std::to_wstring(app) + L"\\app.exe";
+        }
+
+        static std::wstring DeviceId(int device)
+        {
+            return L"DELA026#5&10a58c63&0&UID" + std::to_wstring(device) + L"_1920_1200_{39B25DD2-130D-4B5D-8851-4791D66B1539}";
+        }
+
+        static inline const std::wstring m_zoneSetId = L"{33A2B101-06E0-437B-A61E-CDBECF502906}";
+
+    public:
+        TEST_METHOD (FindsEntries)
+        {
+            HistoryMap map;
+            map[AppPath(0)] = { MakeData(DeviceId(0), m_zoneSetId, 1), MakeData(DeviceId(1), m_zoneSetId, 2) };
+            map[AppPath(1)] = { MakeData(DeviceId(1), m_zoneSetId, 3) };
+
+            AppZoneHistoryIndex index;
+            index.Rebuild(map);
+
+            Assert::AreEqual(size_t{ 3 }, index.Size());
+            Assert::IsTrue(&map[AppPath(0)][1] == index.Find(AppPath(0), DeviceId(1)));
+            Assert::IsTrue(&map[AppPath(1)][0] == index.Find(AppPath(1), DeviceId(1), m_zoneSetId));
+            Assert::IsNull(index.Find(AppPath(1), DeviceId(0)));
+            Assert::IsNull(index.Find(AppPath(2), DeviceId(0)));
+            Assert::IsNull(index.Find(AppPath(0), DeviceId(0), L"{00000000-0000-0000-0000-000000000000}"));
+        }
+
+        TEST_METHOD (UpdateAfterChange)
+        {
+            HistoryMap map;
+            map[AppPath(0)] = { MakeData(DeviceId(0), m_zoneSetId, 1) };
+
+            AppZoneHistoryIndex index;
+            index.Rebuild(map);
+
+            map[AppPath(0)].push_back(MakeData(DeviceId(1), m_zoneSetId, 2));
+            map[AppPath(0)].erase(map[AppPath(0)].begin());
+            index.Update(AppPath(0), &map[AppPath(0)]);
+            Assert::IsNull(index.Find(AppPath(0), DeviceId(0)));
+            Assert::IsTrue(&map[AppPath(0)][0] == index.Find(AppPath(0), DeviceId(1)));
+
+            map.erase(AppPath(0));
+            index.Update(AppPath(0), nullptr);
+            Assert::IsNull(index.Find(AppPath(0), DeviceId(1)));
+            Assert::AreEqual(size_t{ 0 }, index.Size());
+        }
+
+        TEST_METHOD (DuplicatedDeviceFindsFirstMatch)
+        {
+            const std::wstring otherZoneSetId = L"{A5C4BA58-C3B0-4DB3-9E8E-7DE1E9E5B5C4}";
+            HistoryMap map;
+            map[AppPath(0)] = { MakeData(DeviceId(0), m_zoneSetId, 1), MakeData(DeviceId(0), otherZoneSetId, 2) };
+
+            AppZoneHistoryIndex index;
+            index.Rebuild(map);
+
+            Assert::IsTrue(&map[AppPath(0)][0] == index.Find(AppPath(0), DeviceId(0)));
+            Assert::IsTrue(&map[AppPath(0)][0] == index.Find(AppPath(0), DeviceId(0), m_zoneSetId));
+            Assert::IsTrue(&map[AppPath(0)][1] == index.Find(AppPath(0), DeviceId(0), otherZoneSetId));
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(LookupBenchmark)
+            TEST_METHOD_ATTRIBUTE(L"TestCategory", L"Benchmark")
+            TEST_METHOD_ATTRIBUTE(L"Ignore", L"true")
+        END_TEST_METHOD_ATTRIBUTE()
+        TEST_METHOD (LookupBenchmark)
+        {
+            constexpr int apps = 5000;
+            constexpr int devices = 20;
+
+            HistoryMap map;
+            for (int app = 0; app < apps; app++)
+            {
+                auto& history = map[AppPath(app)];
+                for (int device = 0; device < devices; device++)
+                {
+                    history.push_back(MakeData(DeviceId(device), m_zoneSetId, app));
+                }
+            }
+
+            std::vector<std::pair<std::wstring, std::wstring>> queries;
+            for (int i = 0; i < apps * devices; i++)
+            {
+                queries.emplace_back(AppPath((i * 7919) % apps), DeviceId(i % devices));
+            }
+
+            AppZoneHistoryIndex index;
+            auto start = std::chrono::steady_clock::now();
+            index.Rebuild(map);
+            const auto rebuild = std::chrono::steady_clock::now() - start;
+            Assert::AreEqual(size_t{ apps * devices }, index.Size());
+
+            size_t found = 0;
+            start = std::chrono::steady_clock::now();
+            for (const auto& [processPath, deviceId] : queries)
+            {
+                // As done by FancyZonesData before the index
+                auto history = map.find(processPath);
+                if (history != map.end())
+                {
+                    for (const auto& data : history->second)
+                    {
+                        if (data.zoneSetUuid == m_zoneSetId && data.deviceId == deviceId)
+                        {
+                            found++;
+                            break;
+                        }
+                    }
+                }
+            }
+            const auto mapLookup = std::chrono::steady_clock::now() - start;
+
+            start = std::chrono::steady_clock::now();
+            for (const auto& [processPath, deviceId] : queries)
+            {
+                if (index.Find(processPath, deviceId, m_zoneSetId))
+                {
+                    found++;
+                }
+            }
+            const auto indexLookup = std::chrono::steady_clock::now() - start;
+            Assert::AreEqual(queries.size() * 2, found);
+
+            auto ms = [](auto duration) { return std::to_wstring(std::chrono::duration<double, std::milli>(duration).count()); };
+            Logger::WriteMessage((L"5000 apps x 20 devices, " + std::to_wstring(queries.size()) + L" lookups: map " + ms(mapLookup) +
+                                  L" ms, index " + ms(indexLookup) + L" ms, index rebuild " + ms(rebuild) + L" ms\n")
+                                     .c_str());
+        }
+    };
+}
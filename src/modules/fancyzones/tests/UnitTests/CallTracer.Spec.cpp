@@ -0,0 +1,116 @@
+#include "pch.h"
+#include <common/logger/call_tracer.h>
+
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <winrt/Windows.Data.Json.h>
+
+#include "Util.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace winrt::Windows::Data::Json;
+
+namespace FancyZonesUnitTests
+{
+    namespace
+    {
+        void TracedInner()
+        {
+            _TRACER_;
+        }
+
+        void TracedOuter()
+        {
+            _TRACER_;
+            TracedInner();
+        }
+    }
+
+    TEST_CLASS (CallTracerUnitTests)
+    {
+        std::filesystem::path m_folder;
+        std::wstring m_fileName;
+
+        JsonArray ReadTrace()
+        {
+            std::ifstream file{ m_fileName, std::ios::binary };
+            std::string contents{ std::istreambuf_iterator<char>{ file }, std::istreambuf_iterator<char>{} };
+            return JsonArray::Parse(winrt::to_hstring(contents));
+        }
+
+        TEST_METHOD_INITIALIZE(Init)
+        {
+            m_folder = std::filesystem::temp_directory_path() / L"FancyZonesUnitTests-CallTracer";
+            std::filesystem::remove_all(m_folder);
+            std::filesystem::create_directories(m_folder);
+            m_fileName = (m_folder / L"trace.json").wstring();
+        }
+
+        TEST_METHOD_CLEANUP(Cleanup)
+        {
+            CallTracer::stop();
+            std::filesystem::remove_all(m_folder);
+        }
+
+    public:
+        TEST_METHOD (NothingRecordedWhenStopped)
+        {
+            TracedOuter();
+
+            CallTracer::start(m_fileName);
+            CallTracer::stop();
+
+            Assert::AreEqual(0u, ReadTrace().Size());
+        }
+
+        TEST_METHOD (CallsAreNested)
+        {
+            CallTracer::start(m_fileName);
+            TracedOuter();
+            CallTracer::stop();
+
+            const auto events = ReadTrace();
+            Assert::AreEqual(4u, events.Size());
+
+            const wchar_t* expectedPhases[] = { L"B", L"B", L"E", L"E" };
+            for (uint32_t i = 0; i < events.Size(); i++)
+            {
+                const auto event = events.GetObjectAt(i);
+                Assert::AreEqual(std::wstring(expectedPhases[i]), std::wstring(event.GetNamedString(L"ph")));
+            }
+
+            Assert::AreEqual(events.GetObjectAt(0).GetNamedString(L"name"), events.GetObjectAt(3).GetNamedString(L"name"));
+            Assert::AreEqual(events.GetObjectAt(1).GetNamedString(L"name"), events.GetObjectAt(2).GetNamedString(L"name"));
+            Assert::IsTrue(events.GetObjectAt(0).GetNamedNumber(L"ts") <= events.GetObjectAt(3).GetNamedNumber(L"ts"));
+        }
+
+        TEST_METHOD (ThreadsAreRecordedSeparately)
+        {
+            CallTracer::start(m_fileName);
+            std::thread first([] { TracedOuter(); });
+            std::thread second([] { TracedOuter(); });
+            first.join();
+            second.join();
+            CallTracer::stop();
+
+            const auto events = ReadTrace();
+            Assert::AreEqual(8u, events.Size());
+
+            std::map<double, int> depthByThread;
+            for (const auto& value : events)
+            {
+                const auto event = value.GetObject();
+                int& depth = depthByThread[event.GetNamedNumber(L"tid")];
+                depth += event.GetNamedString(L"ph") == L"B" ? 1 : -1;
+                Assert::IsTrue(depth >= 0);
+            }
+
+            Assert::AreEqual(size_t{ 2 }, depthByThread.size());
+            for (const auto& [tid, depth] : depthByThread)
+            {
+                Assert::AreEqual(0, depth);
+            }
+        }
+    };
+}
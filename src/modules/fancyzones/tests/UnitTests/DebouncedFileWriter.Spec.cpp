@@ -0,0 +1,142 @@
+#include "pch.h"
+#include "lib\DebouncedFileWriter.h"
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <thread>
+
+#include "Util.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace FancyZonesUnitTests
+{
+    TEST_CLASS (DebouncedFileWriterUnitTests)
+    {
+        std::filesystem::path m_folder;
+        std::wstring m_fileName;
+
+        std::string ReadFile(const std::wstring& fileName)
+        {
+            std::ifstream file{ fileName, std::ios::binary };
+            return std::string{ std::istreambuf_iterator<char>{ file }, std::istreambuf_iterator<char>{} };
+        }
+
+        bool WaitUntilWritten(const DebouncedFileWriter& writer)
+        {
+            const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+            while (writer.HasPending() && std::chrono::steady_clock::now() < deadline)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+            return !writer.HasPending();
+        }
+
+        TEST_METHOD_INITIALIZE(Init)
+        {
+            m_folder = std::filesystem::temp_directory_path() / L"FancyZonesUnitTests-DebouncedFileWriter";
+            std::filesystem::remove_all(m_folder);
+            std::filesystem::create_directories(m_folder);
+            m_fileName = (m_folder / L"data.json").wstring();
+        }
+
+        TEST_METHOD_CLEANUP(Cleanup)
+        {
+            std::filesystem::remove_all(m_folder);
+        }
+
+    public:
+        TEST_METHOD (CoalescesRequests)
+        {
+            std::atomic<int> serializations = 0;
+            DebouncedFileWriter writer{ std::chrono::milliseconds(500) };
+
+            for (int i = 0; i < 100; i++)
+            {
+                writer.Schedule(m_fileName, [i, &serializations] {
+                    serializations++;
+                    return std::to_string(i);
+                });
+            }
+            Assert::IsTrue(writer.HasPending());
+
+            Assert::IsTrue(WaitUntilWritten(writer));
+            // Waits for the callback to finish the write
+            writer.Flush();
+            Assert::AreEqual(1, serializations.load());
+            Assert::AreEqual(std::string("99"), ReadFile(m_fileName));
+        }
+
+        TEST_METHOD (FlushWritesRightAway)
+        {
+            DebouncedFileWriter writer{ std::chrono::hours(1) };
+            writer.Schedule(m_fileName, [] { return std::string("first"); });
+            Assert::IsFalse(std::filesystem::exists(m_fileName));
+
+            writer.Flush();
+            Assert::IsFalse(writer.HasPending());
+            Assert::AreEqual(std::string("first"), ReadFile(m_fileName));
+        }
+
+        TEST_METHOD (CancelDropsPendingContents)
+        {
+            DebouncedFileWriter writer{ std::chrono::hours(1) };
+            writer.Schedule(m_fileName, [] { return std::string("dropped"); });
+            writer.Cancel();
+            writer.Flush();
+            Assert::IsFalse(std::filesystem::exists(m_fileName));
+        }
+
+        // The serializer takes its snapshot under a lock of the data, which the owner of the data holds while
+        // cancelling. The cancel must not wait for the serializer, and the snapshot taken then is dropped.
+        TEST_METHOD (CancelWhileSerializing)
+        {
+            std::mutex dataLock;
+            std::atomic<bool> serializing = false;
+            DebouncedFileWriter writer{ std::chrono::milliseconds(1) };
+            {
+                std::scoped_lock lock{ dataLock };
+                writer.Schedule(m_fileName, [&] {
+                    serializing = true;
+                    std::scoped_lock lock{ dataLock };
+                    return std::string("dropped");
+                });
+
+                const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+                while (!serializing && std::chrono::steady_clock::now() < deadline)
+                {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+                Assert::IsTrue(serializing.load());
+
+                writer.Cancel();
+            }
+
+            // Waits for the dropped write
+            writer.Flush();
+            Assert::IsFalse(std::filesystem::exists(m_fileName));
+        }
+
+        TEST_METHOD (DestructorWritesPendingContents)
+        {
+            {
+                DebouncedFileWriter writer{ std::chrono::hours(1) };
+                writer.Schedule(m_fileName, [] { return std::string("last"); });
+            }
+            Assert::AreEqual(std::string("last"), ReadFile(m_fileName));
+        }
+
+        TEST_METHOD (WriteAtomicallyReplacesFile)
+        {
+            Assert::IsTrue(DebouncedFileWriter::WriteAtomically(m_fileName, "old contents which are longer"));
+            Assert::IsTrue(DebouncedFileWriter::WriteAtomically(m_fileName, "new"));
+            Assert::AreEqual(std::string("new"), ReadFile(m_fileName));
+
+            // No temporary file is left behind
+            Assert::AreEqual(size_t{ 1 }, static_cast<size_t>(std::distance(std::filesystem::directory_iterator(m_folder), std::filesystem::directory_iterator())));
+        }
+    };
+}
@@ -0,0 +1,173 @@
+#include "pch.h"
+#include "lib\FileWatcher.h"
+
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+
+#include "Util.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace FancyZonesUnitTests
+{
+    TEST_CLASS (FileChangeFilterUnitTests)
+    {
+        const std::chrono::milliseconds m_debounce{ 100 };
+        const FileChangeFilter::Clock::time_point m_start = FileChangeFilter::Clock::now();
+
+    public:
+        TEST_METHOD (NotificationsAreMerged)
+        {
+            FileChangeFilter filter(m_debounce, FileChangeFilter::Hash("old"));
+            Assert::IsFalse(filter.Deadline().has_value());
+
+            filter.Notify(m_start);
+            filter.Notify(m_start + std::chrono::milliseconds(50));
+            Assert::IsTrue(m_start + std::chrono::milliseconds(150) == *filter.Deadline());
+
+            Assert::IsTrue(filter.Check(FileChangeFilter::Hash("new"), m_start + std::chrono::milliseconds(150)));
+            Assert::IsFalse(filter.Deadline().has_value());
+        }
+
+        TEST_METHOD (SameContentsAreNoChange)
+        {
+            FileChangeFilter filter(m_debounce, FileChangeFilter::Hash("contents"));
+            filter.Notify(m_start);
+            Assert::IsFalse(filter.Check(FileChangeFilter::Hash("contents"), m_start + m_debounce));
+            Assert::IsFalse(filter.Deadline().has_value());
+        }
+
+        TEST_METHOD (UnreadableFileIsCheckedAgain)
+        {
+            FileChangeFilter filter(m_debounce, FileChangeFilter::Hash("old"));
+            filter.Notify(m_start);
+
+            auto now = m_start + m_debounce;
+            Assert::IsFalse(filter.Check(std::nullopt, now));
+            Assert::IsTrue(now + m_debounce == *filter.Deadline());
+
+            now += m_debounce;
+            Assert::IsTrue(filter.Check(FileChangeFilter::Hash("new"), now));
+        }
+
+        TEST_METHOD (UnreadableFileIsGivenUpOn)
+        {
+            FileChangeFilter filter(m_debounce, std::nullopt);
+            filter.Notify(m_start);
+
+            auto now = m_start;
+            for (int i = 0; i < 10 && filter.Deadline(); i++)
+            {
+                now += m_debounce;
+                Assert::IsFalse(filter.Check(std::nullopt, now));
+            }
+            Assert::IsFalse(filter.Deadline().has_value());
+        }
+
+        TEST_METHOD (CreatedFileIsChange)
+        {
+            FileChangeFilter filter(m_debounce, std::nullopt);
+            filter.Notify(m_start);
+            Assert::IsTrue(filter.Check(FileChangeFilter::Hash(""), m_start + m_debounce));
+        }
+    };
+
+    TEST_CLASS (FileWatcherUnitTests)
+    {
+        std::filesystem::path m_folder;
+
+        void WriteFile(const std::filesystem::path& path, const std::string& contents)
+        {
+            std::ofstream{ path, std::ios::binary | std::ios::trunc } << contents;
+        }
+
+        struct Counter
+        {
+            std::atomic<int> count = 0;
+            wil::unique_event event{ wil::EventOptions::None };
+
+            std::function<void()> Callback()
+            {
+                return [this] {
+                    count++;
+                    event.SetEvent();
+                };
+            }
+
+            bool Wait(DWORD millis) { return event.wait(millis); }
+        };
+
+        TEST_METHOD_INITIALIZE(Init)
+        {
+            m_folder = std::filesystem::temp_directory_path() / L"FancyZonesUnitTests-FileWatcher";
+            std::filesystem::remove_all(m_folder);
+            std::filesystem::create_directories(m_folder);
+        }
+
+        TEST_METHOD_CLEANUP(Cleanup)
+        {
+            std::filesystem::remove_all(m_folder);
+        }
+
+    public:
+        TEST_METHOD (CallbackOnChange)
+        {
+            const auto path = m_folder / L"zones-settings.json";
+            WriteFile(path, "{}");
+
+            Counter counter;
+            FileWatcher watcher(path.wstring(), counter.Callback(), 50);
+
+            WriteFile(path, "{ \"changed\": true }");
+            Assert::IsTrue(counter.Wait(5000));
+            Assert::AreEqual(1, counter.count.load());
+        }
+
+        TEST_METHOD (NoCallbackForSameContents)
+        {
+            const auto path = m_folder / L"zones-settings.json";
+            WriteFile(path, "{}");
+
+            Counter counter;
+            FileWatcher watcher(path.wstring(), counter.Callback(), 50);
+
+            WriteFile(path, "{}");
+            Assert::IsFalse(counter.Wait(500));
+        }
+
+        TEST_METHOD (WatchersOfOneFolderShareNotifications)
+        {
+            const auto first = m_folder / L"first.json";
+            const auto second = m_folder / L"second.json";
+            WriteFile(first, "1");
+            WriteFile(second, "2");
+
+            Counter firstCounter, secondCounter;
+            FileWatcher firstWatcher(first.wstring(), firstCounter.Callback(), 50);
+            FileWatcher secondWatcher(second.wstring(), secondCounter.Callback(), 50);
+
+            WriteFile(second, "changed");
+            Assert::IsTrue(secondCounter.Wait(5000));
+            Assert::IsFalse(firstCounter.Wait(200));
+        }
+
+        TEST_METHOD (BurstOfWritesIsOneChange)
+        {
+            const auto path = m_folder / L"app-zone-history.json";
+            WriteFile(path, "0");
+
+            Counter counter;
+            FileWatcher watcher(path.wstring(), counter.Callback(), 300);
+
+            for (int i = 1; i <= 10; i++)
+            {
+                WriteFile(path, std::to_string(i));
+            }
+
+            Assert::IsTrue(counter.Wait(5000));
+            Assert::IsFalse(counter.Wait(600));
+            Assert::AreEqual(1, counter.count.load());
+        }
+    };
+}
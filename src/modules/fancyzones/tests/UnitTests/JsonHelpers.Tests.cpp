@@ -1903,6 +1903,28 @@ namespace FancyZonesUnitTests
                 Assert::IsTrue(std::vector<size_t>{ expectedZoneIndex } == data.GetAppLastZoneIndexSet(window, deviceId, zoneSetId));
             }
 
+            TEST_METHOD (AppLastZonesWrittenTogether)
+            {
+                const std::wstring zoneSetId = L"zoneset-uuid";
+                const std::wstring deviceId = L"device-id";
+                const auto window = Mocks::WindowCreate(m_hInst);
+                FancyZonesData data;
+                data.SetSettingsModulePath(m_moduleName);
+                data.SetSaveDelay(std::chrono::hours(1));
+
+                Assert::IsTrue(data.SetAppLastZones(window, deviceId, zoneSetId, { 1 }));
+                Assert::IsTrue(data.SetAppLastZones(window, deviceId, zoneSetId, { 2 }));
+                Assert::IsFalse(std::filesystem::exists(data.appZoneHistoryFileName));
+
+                data.FlushPendingSaves();
+                auto saved = json::from_file(data.appZoneHistoryFileName);
+                Assert::IsTrue(saved.has_value());
+
+                auto history = JSONHelpers::ParseAppZoneHistory(*saved);
+                Assert::AreEqual(size_t{ 1 }, history.size());
+                Assert::IsTrue(std::vector<size_t>{ 2 } == history.begin()->second[0].zoneIndexSet);
+            }
+
             TEST_METHOD (AppLastZoneInvalidWindow)
             {
                 const std::wstring zoneSetId = L"zoneset-uuid";
@@ -0,0 +1,237 @@
+#include "pch.h"
+#include "lib\on_thread_executor.h"
+
+#include <chrono>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace FancyZonesUnitTests
+{
+    TEST_CLASS (OnThreadExecutorUnitTests)
+    {
+        // Keeps the worker busy until released, so the following tasks stay queued
+        struct Blocker
+        {
+            std::promise<void> started;
+            std::promise<void> release;
+
+            void Block(OnThreadExecutor& executor)
+            {
+                executor.submit(OnThreadExecutor::task_t{ [this, released = release.get_future().share()] {
+                    started.set_value();
+                    released.wait();
+                } });
+                started.get_future().wait();
+            }
+        };
+
+        static std::thread::id WorkerId(OnThreadExecutor& executor)
+        {
+            std::thread::id id;
+            executor.submit(OnThreadExecutor::task_t{ [&id] { id = std::this_thread::get_id(); } }).wait();
+            return id;
+        }
+
+    public:
+        TEST_METHOD (TasksRunOnSameThread)
+        {
+            OnThreadExecutor executor;
+            const auto worker = WorkerId(executor);
+
+            bool sameThread = false;
+            executor.submit("key", [&] { sameThread = std::this_thread::get_id() == worker; }, OnThreadExecutor::priority::high).wait();
+
+            Assert::IsTrue(worker != std::this_thread::get_id());
+            Assert::IsTrue(sameThread);
+            Assert::IsTrue(worker == WorkerId(executor));
+        }
+
+        TEST_METHOD (PendingTaskWithKeyIsReplaced)
+        {
+            OnThreadExecutor executor;
+            Blocker blocker;
+            blocker.Block(executor);
+
+            int runs = 0;
+            int last = -1;
+            std::vector<std::shared_future<void>> futures;
+            for (int i = 0; i < 10; i++)
+            {
+                futures.push_back(executor.submit("UpdateZoneWindows", [&, i] {
+                    runs++;
+                    last = i;
+                }));
+            }
+
+            blocker.release.set_value();
+            for (auto& future : futures)
+            {
+                future.wait();
+            }
+
+            Assert::AreEqual(1, runs);
+            Assert::AreEqual(9, last);
+            Assert::AreEqual(uint64_t{ 9 }, executor.get_statistics().coalesced);
+        }
+
+        TEST_METHOD (HigherPriorityRunsFirst)
+        {
+            OnThreadExecutor executor;
+            Blocker blocker;
+            blocker.Block(executor);
+
+            std::vector<int> order;
+            executor.submit(OnThreadExecutor::task_t{ [&] { order.push_back(3); } }, OnThreadExecutor::priority::low);
+            executor.submit(OnThreadExecutor::task_t{ [&] { order.push_back(2); } });
+            auto last = executor.submit(OnThreadExecutor::task_t{ [&] { order.push_back(1); } }, OnThreadExecutor::priority::high);
+
+            Assert::AreEqual(size_t{ 3 }, executor.get_statistics().queue_depth);
+            blocker.release.set_value();
+            last.wait();
+            executor.submit(OnThreadExecutor::task_t{ [] {} }, OnThreadExecutor::priority::low).wait();
+
+            Assert::IsTrue(std::vector<int>{ 1, 2, 3 } == order);
+        }
+
+        TEST_METHOD (CancelKey)
+        {
+            OnThreadExecutor executor;
+            Blocker blocker;
+            blocker.Block(executor);
+
+            bool cancelledRan = false;
+            bool otherRan = false;
+            executor.submit("cancelled", [&] { cancelledRan = true; });
+            auto other = executor.submit("other", [&] { otherRan = true; });
+
+            Assert::IsTrue(executor.cancel("cancelled"));
+            Assert::IsFalse(executor.cancel("cancelled"));
+
+            blocker.release.set_value();
+            other.wait();
+            Assert::IsFalse(cancelledRan);
+            Assert::IsTrue(otherRan);
+            Assert::AreEqual(size_t{ 0 }, executor.get_statistics().queue_depth);
+        }
+
+        // Tasks queued together are taken together, and a cancel while one of them runs still drops the rest
+        TEST_METHOD (CancelWhileRunning)
+        {
+            OnThreadExecutor executor;
+            Blocker blocker;
+            blocker.Block(executor);
+
+            Blocker running;
+            bool cancelledRan = false;
+            executor.submit(OnThreadExecutor::task_t{ [&running, released = running.release.get_future().share()] {
+                running.started.set_value();
+                released.wait();
+            } });
+            executor.submit(OnThreadExecutor::task_t{ [&] { cancelledRan = true; } });
+
+            blocker.release.set_value();
+            running.started.get_future().wait();
+            executor.cancel();
+            running.release.set_value();
+
+            executor.submit(OnThreadExecutor::task_t{ [] {} }, OnThreadExecutor::priority::low).wait();
+            Assert::IsFalse(cancelledRan);
+        }
+
+        TEST_METHOD (HigherPriorityPreemptsTakenTasks)
+        {
+            OnThreadExecutor executor;
+            Blocker blocker;
+            blocker.Block(executor);
+
+            Blocker running;
+            std::vector<int> order;
+            executor.submit(OnThreadExecutor::task_t{ [&running, released = running.release.get_future().share()] {
+                running.started.set_value();
+                released.wait();
+            } });
+            executor.submit(OnThreadExecutor::task_t{ [&] { order.push_back(2); } }, OnThreadExecutor::priority::low);
+
+            blocker.release.set_value();
+            running.started.get_future().wait();
+            executor.submit(OnThreadExecutor::task_t{ [&] { order.push_back(1); } }, OnThreadExecutor::priority::high);
+            running.release.set_value();
+
+            executor.submit(OnThreadExecutor::task_t{ [] {} }, OnThreadExecutor::priority::low).wait();
+            Assert::IsTrue(std::vector<int>{ 1, 2 } == order);
+        }
+
+        TEST_METHOD (TakenTaskWithKeyIsReplaced)
+        {
+            OnThreadExecutor executor;
+            Blocker blocker;
+            blocker.Block(executor);
+
+            Blocker running;
+            int last = -1;
+            executor.submit(OnThreadExecutor::task_t{ [&running, released = running.release.get_future().share()] {
+                running.started.set_value();
+                released.wait();
+            } });
+            executor.submit("UpdateZoneWindows", [&] { last = 0; });
+
+            blocker.release.set_value();
+            running.started.get_future().wait();
+            auto replaced = executor.submit("UpdateZoneWindows", [&] { last = 1; });
+            running.release.set_value();
+
+            replaced.wait();
+            Assert::AreEqual(1, last);
+            Assert::AreEqual(uint64_t{ 1 }, executor.get_statistics().coalesced);
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(StressBenchmark)
+            TEST_METHOD_ATTRIBUTE(L"TestCategory", L"Benchmark")
+            TEST_METHOD_ATTRIBUTE(L"Ignore", L"true")
+        END_TEST_METHOD_ATTRIBUTE()
+        TEST_METHOD (StressBenchmark)
+        {
+            constexpr int threads = 8;
+            constexpr int tasksPerThread = 20000;
+
+            OnThreadExecutor executor;
+            std::atomic<int> runs = 0;
+
+            const auto start = std::chrono::steady_clock::now();
+            std::vector<std::thread> submitters;
+            for (int thread = 0; thread < threads; thread++)
+            {
+                submitters.emplace_back([&executor, &runs] {
+                    for (int i = 0; i < tasksPerThread; i++)
+                    {
+                        if (i % 4 == 0)
+                        {
+                            // As a burst of display change events
+                            executor.submit("UpdateZoneWindows", [&runs] { runs++; });
+                        }
+                        else
+                        {
+                            executor.submit(OnThreadExecutor::task_t{ [&runs] { runs++; } }, static_cast<OnThreadExecutor::priority>(i % 3));
+                        }
+                    }
+                });
+            }
+            for (auto& submitter : submitters)
+            {
+                submitter.join();
+            }
+            executor.submit(OnThreadExecutor::task_t{ [] {} }, OnThreadExecutor::priority::low).wait();
+            const auto elapsed = std::chrono::steady_clock::now() - start;
+
+            const auto statistics = executor.get_statistics();
+            Assert::AreEqual(uint64_t{ threads * tasksPerThread }, runs + statistics.coalesced);
+            Assert::AreEqual(size_t{ 0 }, statistics.queue_depth);
+
+            auto ms = [](auto duration) { return std::to_wstring(std::chrono::duration<double, std::milli>(duration).count()); };
+            Logger::WriteMessage((std::to_wstring(threads * tasksPerThread) + L" tasks from " + std::to_wstring(threads) + L" threads: " + ms(elapsed) +
+                                  L" ms, " + std::to_wstring(statistics.coalesced) + L" coalesced, max queue depth " + std::to_wstring(statistics.max_queue_depth) +
+                                  L", max latency " + ms(statistics.max_latency) + L" ms\n")
+                                     .c_str());
+        }
+    };
+}
@@ -0,0 +1,154 @@
+#include "pch.h"
+#include "lib\ZonableAppFilter.h"
+
+#include <chrono>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace FancyZonesUnitTests
+{
+    TEST_CLASS (ZonableAppFilterUnitTests)
+    {
+    public:
+        TEST_METHOD (ExcludedAppIsNotZonable)
+        {
+            ZonableAppFilter filter;
+            filter.SetExcludedApps({ L"NOTEPAD", L"PAINT.EXE" });
+
+            Assert::IsFalse(filter.IsZonable(L"C:\\Windows\\System32\\notepad.exe"));
+            Assert::IsFalse(filter.IsZonable(L"C:\\Windows\\System32\\notepad++.exe"));
+            Assert::IsFalse(filter.IsZonable(L"C:\\Windows\\paint.exe"));
+            Assert::IsTrue(filter.IsZonable(L"C:\\Windows\\mspaint.exe"));
+            Assert::IsTrue(filter.IsZonable(L"C:\\Notepad\\calc.exe"));
+        }
+
+        TEST_METHOD (ExcludedAppWithFolder)
+        {
+            ZonableAppFilter filter;
+            filter.SetExcludedApps({ L"SYSTEM32\\NOTEPAD" });
+
+            Assert::IsFalse(filter.IsZonable(L"C:\\Windows\\System32\\notepad.exe"));
+            Assert::IsTrue(filter.IsZonable(L"C:\\Windows\\notepad.exe"));
+        }
+
+        TEST_METHOD (LastOccurrenceInFileName)
+        {
+            ZonableAppFilter filter;
+            filter.SetExcludedApps({ L"APP" });
+
+            // The excluded app occurs again later in the file name
+            Assert::IsTrue(filter.IsZonable(L"C:\\Program Files\\appapp.exe"));
+            Assert::IsFalse(filter.IsZonable(L"C:\\Program Files\\app.exe"));
+        }
+
+        TEST_METHOD (PowerToysAppsAreNotZonable)
+        {
+            ZonableAppFilter filter;
+
+            Assert::IsFalse(filter.IsZonable(L"C:\\Program Files\\PowerToys\\modules\\launcher\\PowerLauncher.exe"));
+            Assert::IsFalse(filter.IsZonable(L"C:\\Program Files\\PowerToys\\modules\\FancyZones\\FancyZonesEditor.exe"));
+            Assert::IsTrue(filter.IsZonable(L"C:\\Program Files\\PowerToys\\PowerToys.exe"));
+        }
+
+        TEST_METHOD (DecisionsAreForgottenWhenExcludedAppsChange)
+        {
+            ZonableAppFilter filter;
+            const std::wstring path = L"C:\\Windows\\System32\\notepad.exe";
+
+            Assert::IsTrue(filter.IsZonable(path));
+            Assert::AreEqual(size_t{ 1 }, filter.CacheSize());
+
+            filter.SetExcludedApps({ L"NOTEPAD" });
+            Assert::AreEqual(size_t{ 0 }, filter.CacheSize());
+            Assert::IsFalse(filter.IsZonable(path));
+        }
+
+        TEST_METHOD (LeastRecentlyUsedDecisionIsEvicted)
+        {
+            ZonableAppFilter filter(2);
+
+            filter.IsZonable(L"C:\\a.exe");
+            filter.IsZonable(L"C:\\b.exe");
+            filter.IsZonable(L"C:\\a.exe");
+            filter.IsZonable(L"C:\\c.exe");
+
+            Assert::AreEqual(size_t{ 2 }, filter.CacheSize());
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(ExcludedAppsBenchmark)
+            TEST_METHOD_ATTRIBUTE(L"TestCategory", L"Benchmark")
+            TEST_METHOD_ATTRIBUTE(L"Ignore", L"true")
+        END_TEST_METHOD_ATTRIBUTE()
+        TEST_METHOD (ExcludedAppsBenchmark)
+        {
+            std::vector<std::wstring> excludedApps;
+            for (int i = 0; i < 500; i++)
+            {
+                excludedApps.push_back(L"EXCLUDEDAPP" + std::to_wstring(i) + L".EXE");
+            }
+
+            std::vector<std::wstring> paths;
+            for (int i = 0; i < 1000; i++)
+            {
+                paths.push_back(L"C:\\Program Files\\Vendor" + std::to_wstring(i % 50) + L"\\Product\\app" + std::to_wstring(i % 50) + L".exe");
+            }
+
+            constexpr int rounds = 20;
+            size_t zonable = 0;
+
+            // As done before the filter, for every window
+            auto start = std::chrono::steady_clock::now();
+            for (int round = 0; round < rounds; round++)
+            {
+                for (auto path : paths)
+                {
+                    CharUpperBuffW(path.data(), static_cast<DWORD>(path.length()));
+                    bool excluded = false;
+                    for (const auto& app : excludedApps)
+                    {
+                        const auto pos = path.rfind(app);
+                        const auto lastSlash = path.rfind('\\');
+                        if (pos != std::wstring::npos && pos <= lastSlash + 1 && pos + app.length() > lastSlash)
+                        {
+                            excluded = true;
+                            break;
+                        }
+                    }
+                    zonable += excluded ? 0 : 1;
+                }
+            }
+            const auto linear = std::chrono::steady_clock::now() - start;
+
+            ZonableAppFilter uncached(0);
+            uncached.SetExcludedApps(excludedApps);
+            start = std::chrono::steady_clock::now();
+            for (int round = 0; round < rounds; round++)
+            {
+                for (const auto& path : paths)
+                {
+                    zonable += uncached.IsZonable(path) ? 1 : 0;
+                }
+            }
+            const auto matcher = std::chrono::steady_clock::now() - start;
+
+            ZonableAppFilter cached;
+            cached.SetExcludedApps(excludedApps);
+            start = std::chrono::steady_clock::now();
+            for (int round = 0; round < rounds; round++)
+            {
+                for (const auto& path : paths)
+                {
+                    zonable += cached.IsZonable(path) ? 1 : 0;
+                }
+            }
+            const auto cache = std::chrono::steady_clock::now() - start;
+
+            Assert::AreEqual(paths.size() * rounds * 3, zonable);
+
+            auto ms = [](auto duration) { return std::to_wstring(std::chrono::duration<double, std::milli>(duration).count()); };
+            Logger::WriteMessage((L"500 excluded apps, " + std::to_wstring(paths.size() * rounds) + L" checks: linear " + ms(linear) +
+                                  L" ms, matcher " + ms(matcher) + L" ms, cached " + ms(cache) + L" ms\n")
+                                     .c_str());
+        }
+    };
+}
@@ -0,0 +1,134 @@
+#include "pch.h"
+#include "lib\Settings.h"
+#include "lib\ZoneIndexSetStamp.h"
+
+#include <numeric>
+
+#include "Util.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace FancyZonesUnitTests
+{
+    TEST_CLASS (ZoneIndexSetStampUnitTests)
+    {
+        HINSTANCE m_hInst{};
+        HWND m_window{};
+
+        std::vector<size_t> AllZones(size_t count)
+        {
+            std::vector<size_t> zoneIds(count);
+            std::iota(zoneIds.begin(), zoneIds.end(), 0);
+            return zoneIds;
+        }
+
+        size_t Property(HWND window)
+        {
+            return reinterpret_cast<size_t>(::GetProp(window, ZonedWindowProperties::PropertyMultipleZoneID));
+        }
+
+        void AssertRoundTrip(const std::vector<size_t>& zoneIds)
+        {
+            ZoneIndexSetStamp::Stamp(m_window, zoneIds);
+            Assert::IsTrue(ZoneIndexSetStamp::IsStamped(m_window));
+            Assert::IsTrue(zoneIds == ZoneIndexSetStamp::Get(m_window));
+            Assert::IsTrue(zoneIds == ZoneIndexSetStamp::Decode(ZoneIndexSetStamp::Encode(zoneIds)));
+        }
+
+        TEST_METHOD_INITIALIZE(Init)
+        {
+            m_hInst = (HINSTANCE)GetModuleHandleW(nullptr);
+            m_window = Mocks::WindowCreate(m_hInst);
+        }
+
+        TEST_METHOD_CLEANUP(Cleanup)
+        {
+            ZoneIndexSetStamp::Remove(m_window);
+        }
+
+    public:
+        TEST_METHOD (OneZone)
+        {
+            AssertRoundTrip({ 0 });
+            Assert::AreEqual(size_t{ 1 }, Property(m_window));
+
+            AssertRoundTrip({ 1023 });
+        }
+
+        TEST_METHOD (SixtyFourZones)
+        {
+            // Zone 63 doesn't fit next to the tag bit, so the whole layout is stored out of line
+            AssertRoundTrip(AllZones(63));
+            Assert::AreEqual((size_t{ 1 } << 63) - 1, Property(m_window));
+
+            AssertRoundTrip(AllZones(64));
+            AssertRoundTrip({ 63 });
+        }
+
+        TEST_METHOD (SixtyFiveZones)
+        {
+            AssertRoundTrip(AllZones(65));
+            AssertRoundTrip({ 0, 64 });
+            AssertRoundTrip({ 1, 2, 3, 64 });
+        }
+
+        TEST_METHOD (ThousandTwentyFourZones)
+        {
+            const auto zoneIds = AllZones(1024);
+            AssertRoundTrip(zoneIds);
+            // A contiguous set is a single run
+            Assert::AreEqual(size_t{ 3 }, ZoneIndexSetStamp::Encode(zoneIds).size());
+
+            std::vector<size_t> everyOther;
+            for (size_t id = 0; id < 1024; id += 2)
+            {
+                everyOther.push_back(id);
+            }
+            AssertRoundTrip(everyOther);
+        }
+
+        TEST_METHOD (EncodeSortsAndRemovesDuplicates)
+        {
+            Assert::IsTrue(std::vector<size_t>{ 3, 100, 101 } == ZoneIndexSetStamp::Decode(ZoneIndexSetStamp::Encode({ 101, 3, 100, 3 })));
+            Assert::IsTrue(ZoneIndexSetStamp::Encode({}).empty());
+        }
+
+        TEST_METHOD (RestampReplacesOutOfLineSet)
+        {
+            AssertRoundTrip({ 100, 200 });
+            AssertRoundTrip({ 2, 5 });
+            AssertRoundTrip({ 300 });
+        }
+
+        TEST_METHOD (EmptySetRemovesStamp)
+        {
+            AssertRoundTrip({ 70 });
+            ZoneIndexSetStamp::Stamp(m_window, {});
+            Assert::IsFalse(ZoneIndexSetStamp::IsStamped(m_window));
+            Assert::IsTrue(ZoneIndexSetStamp::Get(m_window).empty());
+        }
+
+        TEST_METHOD (StaleOutOfLineStampIsIgnored)
+        {
+            AssertRoundTrip({ 70 });
+            // The property of a window stamped by a previous FancyZones instance outlives the table
+            SetProp(m_window, ZonedWindowProperties::PropertyMultipleZoneID, reinterpret_cast<HANDLE>((size_t{ 1 } << 63) | 12345));
+            Assert::IsTrue(ZoneIndexSetStamp::IsStamped(m_window));
+            Assert::IsTrue(ZoneIndexSetStamp::Get(m_window).empty());
+        }
+
+        TEST_METHOD (OutOfLineStampsAreKeptPerWindow)
+        {
+            const auto otherWindow = Mocks::WindowCreate(m_hInst);
+            ZoneIndexSetStamp::Stamp(m_window, AllZones(65));
+            ZoneIndexSetStamp::Stamp(otherWindow, { 1000 });
+
+            Assert::IsTrue(AllZones(65) == ZoneIndexSetStamp::Get(m_window));
+            Assert::IsTrue(std::vector<size_t>{ 1000 } == ZoneIndexSetStamp::Get(otherWindow));
+
+            ZoneIndexSetStamp::Remove(otherWindow);
+            Assert::IsFalse(ZoneIndexSetStamp::IsStamped(otherWindow));
+            Assert::IsTrue(AllZones(65) == ZoneIndexSetStamp::Get(m_window));
+        }
+    };
+}
@@ -0,0 +1,202 @@
+#include "pch.h"
+#include "lib\FancyZonesData.h"
+#include "lib\ZoneLayoutCache.h"
+#include "lib\ZoneSet.h"
+
+#include <array>
+#include <chrono>
+
+#include "Util.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace FancyZonesDataTypes;
+
+namespace FancyZonesUnitTests
+{
+    TEST_CLASS (ZoneLayoutCacheUnitTests)
+    {
+        ZoneLayoutKey MakeKey(long width)
+        {
+            return ZoneLayoutKey{ .type = ZoneSetLayoutType::Columns, .width = width, .height = 1080, .zoneCount = 3, .spacing = 16 };
+        }
+
+        ZoneLayoutCache::Calculate CountingCalculate(int& calls, bool success = true)
+        {
+            return [&calls, success](ZoneLayout& layout) {
+                calls++;
+                layout.emplace_back(0, RECT{ 0, 0, 100, 100 });
+                return success;
+            };
+        }
+
+    public:
+        TEST_METHOD (CalculatesOnce)
+        {
+            ZoneLayoutCache cache;
+            int calls = 0;
+
+            auto first = cache.Get(MakeKey(1920), CountingCalculate(calls));
+            auto second = cache.Get(MakeKey(1920), CountingCalculate(calls));
+
+            Assert::AreEqual(1, calls);
+            Assert::IsTrue(first == second);
+            Assert::AreEqual(size_t{ 1 }, first->size());
+        }
+
+        TEST_METHOD (DifferentKeysAreCalculatedSeparately)
+        {
+            ZoneLayoutCache cache;
+            int calls = 0;
+
+            cache.Get(MakeKey(1920), CountingCalculate(calls));
+            cache.Get(MakeKey(2560), CountingCalculate(calls));
+
+            auto key = MakeKey(1920);
+            key.dpiX = 144;
+            cache.Get(key, CountingCalculate(calls));
+
+            Assert::AreEqual(3, calls);
+            Assert::AreEqual(size_t{ 3 }, cache.Size());
+        }
+
+        TEST_METHOD (FailuresAreNotCached)
+        {
+            ZoneLayoutCache cache;
+            int calls = 0;
+
+            Assert::IsNull(cache.Get(MakeKey(1920), CountingCalculate(calls, false)).get());
+            Assert::IsNull(cache.Get(MakeKey(1920), CountingCalculate(calls, false)).get());
+
+            Assert::AreEqual(2, calls);
+            Assert::AreEqual(size_t{ 0 }, cache.Size());
+        }
+
+        TEST_METHOD (LeastRecentlyUsedIsEvicted)
+        {
+            ZoneLayoutCache cache(2);
+            int calls = 0;
+
+            cache.Get(MakeKey(1), CountingCalculate(calls));
+            cache.Get(MakeKey(2), CountingCalculate(calls));
+            cache.Get(MakeKey(1), CountingCalculate(calls));
+            cache.Get(MakeKey(3), CountingCalculate(calls));
+            Assert::AreEqual(3, calls);
+            Assert::AreEqual(size_t{ 2 }, cache.Size());
+
+            // 1 was used more recently than 2
+            cache.Get(MakeKey(1), CountingCalculate(calls));
+            Assert::AreEqual(3, calls);
+            cache.Get(MakeKey(2), CountingCalculate(calls));
+            Assert::AreEqual(4, calls);
+        }
+
+        TEST_METHOD (HashChangesWithLayout)
+        {
+            GridLayoutInfo grid(GridLayoutInfo::Full{
+                .rows = 1,
+                .columns = 3,
+                .rowsPercents = { 10000 },
+                .columnsPercents = { 2500, 5000, 2500 },
+                .cellChildMap = { { 0, 1, 2 } } });
+            CustomZoneSetData data{ L"name", CustomLayoutType::Grid, grid };
+            const auto hash = ZoneLayoutCache::Hash(data);
+
+            Assert::AreEqual(hash, ZoneLayoutCache::Hash(data));
+
+            std::get<GridLayoutInfo>(data.info).columnsPercents()[0] = 3000;
+            std::get<GridLayoutInfo>(data.info).columnsPercents()[1] = 4500;
+            Assert::AreNotEqual(hash, ZoneLayoutCache::Hash(data));
+
+            // The name isn't part of the layout
+            CustomZoneSetData renamed{ L"other name", CustomLayoutType::Grid, grid };
+            Assert::AreEqual(hash, ZoneLayoutCache::Hash(renamed));
+        }
+    };
+
+    TEST_CLASS (ZoneSetLayoutCacheUnitTests)
+    {
+        const std::array<RECT, 4> m_workAreas{
+            RECT{ 0, 0, 1920, 1040 },
+            RECT{ 1920, 0, 4480, 1400 },
+            RECT{ -1280, 0, 0, 984 },
+            RECT{ 0, 1040, 3840, 3120 },
+        };
+        static constexpr int m_desktops = 8;
+
+        winrt::com_ptr<IZoneSet> MakeSet(ZoneSetLayoutType type)
+        {
+            GUID id;
+            Assert::AreEqual(S_OK, CoCreateGuid(&id));
+            return MakeZoneSet(ZoneSetConfig(id, type, Mocks::Monitor(), DefaultValues::SensitivityRadius));
+        }
+
+        // Calculate the zone sets of every monitor and virtual desktop, as after docking
+        std::chrono::steady_clock::duration CalculateAll()
+        {
+            const auto start = std::chrono::steady_clock::now();
+            for (int desktop = 0; desktop < m_desktops; desktop++)
+            {
+                for (const auto& workArea : m_workAreas)
+                {
+                    for (auto type : { ZoneSetLayoutType::Grid, ZoneSetLayoutType::PriorityGrid, ZoneSetLayoutType::Columns })
+                    {
+                        auto set = MakeSet(type);
+                        Assert::IsTrue(set->CalculateZones(workArea, 24, 16));
+                        set->ZonesFromPoint(POINT{ 100, 100 });
+                    }
+                }
+            }
+            return std::chrono::steady_clock::now() - start;
+        }
+
+    public:
+        TEST_METHOD_INITIALIZE(Init)
+        {
+            ZoneLayoutCacheInstance().Clear();
+        }
+
+        TEST_METHOD (CachedLayoutHasSameZones)
+        {
+            auto first = MakeSet(ZoneSetLayoutType::Grid);
+            auto second = MakeSet(ZoneSetLayoutType::Grid);
+            Assert::IsTrue(first->CalculateZones(m_workAreas[0], 7, 10));
+            Assert::IsTrue(second->CalculateZones(m_workAreas[0], 7, 10));
+            Assert::AreEqual(size_t{ 1 }, ZoneLayoutCacheInstance().Size());
+
+            const auto firstZones = first->GetZones();
+            const auto secondZones = second->GetZones();
+            Assert::AreEqual(size_t{ 7 }, firstZones.size());
+            Assert::AreEqual(firstZones.size(), secondZones.size());
+            for (const auto& [id, zone] : firstZones)
+            {
+                const RECT expected = zone->GetZoneRect();
+                const RECT actual = secondZones.at(id)->GetZoneRect();
+                Assert::IsTrue(EqualRect(&expected, &actual));
+            }
+
+            // Zone objects aren't shared between zone sets
+            Assert::IsTrue(firstZones.at(0) != secondZones.at(0));
+        }
+
+        TEST_METHOD (InvalidLayoutIsNotCached)
+        {
+            auto set = MakeSet(ZoneSetLayoutType::Columns);
+            Assert::IsFalse(set->CalculateZones(m_workAreas[0], 10, m_workAreas[0].right));
+            Assert::IsTrue(set->GetZones().empty());
+            Assert::AreEqual(size_t{ 0 }, ZoneLayoutCacheInstance().Size());
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(ColdAndWarmBenchmark)
+            TEST_METHOD_ATTRIBUTE(L"TestCategory", L"Benchmark")
+            TEST_METHOD_ATTRIBUTE(L"Ignore", L"true")
+        END_TEST_METHOD_ATTRIBUTE()
+        TEST_METHOD (ColdAndWarmBenchmark)
+        {
+            const auto cold = CalculateAll();
+            const auto warm = CalculateAll();
+
+            auto ms = [](auto duration) { return std::to_wstring(std::chrono::duration<double, std::milli>(duration).count()); };
+            Logger::WriteMessage((L"4 monitors x 8 desktops x 3 layouts: cold " + ms(cold) + L" ms, warm " + ms(warm) + L" ms\n").c_str());
+        }
+    };
+}
@@ -0,0 +1,221 @@
+#include "pch.h"
+#include "lib\FancyZonesDataTypes.h"
+#include "lib\ZoneNeighborGraph.h"
+#include "lib\ZoneSet.h"
+#include "lib\util.h"
+
+#include <chrono>
+
+#include "Util.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace FancyZonesDataTypes;
+
+namespace FancyZonesUnitTests
+{
+    TEST_CLASS (ZoneNeighborGraphUnitTests)
+    {
+        // Monitors side by side, each with a grid of columns x rows zones
+        std::vector<ZoneNeighborGraph::MonitorLayout> MakeLayouts(int monitorCount, int columns, int rows)
+        {
+            const int width = 1920, height = 1080;
+            std::vector<ZoneNeighborGraph::MonitorLayout> layouts;
+            for (int i = 0; i < monitorCount; i++)
+            {
+                GUID id;
+                Assert::AreEqual(S_OK, CoCreateGuid(&id));
+                auto zoneSet = MakeZoneSet(ZoneSetConfig(id, ZoneSetLayoutType::Custom, Mocks::Monitor(), DefaultValues::SensitivityRadius));
+
+                size_t zoneId = 0;
+                for (int row = 0; row < rows; row++)
+                {
+                    for (int column = 0; column < columns; column++)
+                    {
+                        zoneSet->AddZone(MakeZone({ column * width / columns, row * height / rows, (column + 1) * width / columns, (row + 1) * height / rows }, zoneId++));
+                    }
+                }
+
+                layouts.push_back({ Mocks::Monitor(), RECT{ i * width, 0, (i + 1) * width, height }, zoneSet });
+            }
+            return layouts;
+        }
+
+        RECT CombinedRect(const std::vector<ZoneNeighborGraph::MonitorLayout>& layouts)
+        {
+            return RECT{ layouts.front().workAreaRect.left, layouts.front().workAreaRect.top, layouts.back().workAreaRect.right, layouts.back().workAreaRect.bottom };
+        }
+
+        // What FancyZones::OnSnapHotkeyBasedOnPosition computes on each key press for a window covering the zone.
+        // frame is how far the window rectangle extends past the zone on each side.
+        std::optional<ZoneNeighborGraph::Target> ChooseByPosition(const std::vector<ZoneNeighborGraph::MonitorLayout>& layouts, size_t monitorIndex, size_t zoneId, DWORD vkCode, RECT frame = {})
+        {
+            std::vector<RECT> zoneRects;
+            std::vector<ZoneNeighborGraph::Target> targets;
+            auto addZones = [&](size_t index) {
+                for (const auto& [id, zone] : layouts[index].zoneSet->GetZones())
+                {
+                    RECT rect = zone->GetZoneRect();
+                    OffsetRect(&rect, layouts[index].workAreaRect.left, layouts[index].workAreaRect.top);
+                    zoneRects.push_back(rect);
+                    targets.push_back({ index, id });
+                }
+            };
+
+            for (size_t i = 0; i < layouts.size(); i++)
+            {
+                if (i != monitorIndex)
+                {
+                    addZones(i);
+                }
+            }
+
+            RECT windowRect = layouts[monitorIndex].zoneSet->GetZones()[zoneId]->GetZoneRect();
+            OffsetRect(&windowRect, layouts[monitorIndex].workAreaRect.left, layouts[monitorIndex].workAreaRect.top);
+            windowRect = RECT{ windowRect.left - frame.left, windowRect.top - frame.top, windowRect.right + frame.right, windowRect.bottom + frame.bottom };
+
+            size_t chosen = FancyZonesUtils::ChooseNextZoneByPosition(vkCode, windowRect, zoneRects);
+            if (chosen < zoneRects.size())
+            {
+                return targets[chosen];
+            }
+
+            addZones(monitorIndex);
+            windowRect = FancyZonesUtils::PrepareRectForCycling(windowRect, CombinedRect(layouts), vkCode);
+            chosen = FancyZonesUtils::ChooseNextZoneByPosition(vkCode, windowRect, zoneRects);
+            if (chosen < zoneRects.size())
+            {
+                return targets[chosen];
+            }
+
+            return std::nullopt;
+        }
+
+        std::optional<ZoneNeighborGraph::Target> Next(const ZoneNeighborGraph& graph, size_t monitorIndex, size_t zoneId, DWORD vkCode)
+        {
+            auto target = graph.Next(monitorIndex, zoneId, vkCode, false);
+            return target ? target : graph.Next(monitorIndex, zoneId, vkCode, true);
+        }
+
+        void AssertSameTarget(const std::optional<ZoneNeighborGraph::Target>& expected, const std::optional<ZoneNeighborGraph::Target>& actual)
+        {
+            Assert::AreEqual(expected.has_value(), actual.has_value());
+            if (expected)
+            {
+                Assert::AreEqual(expected->monitorIndex, actual->monitorIndex);
+                Assert::AreEqual(expected->zoneId, actual->zoneId);
+            }
+        }
+
+    public:
+        TEST_METHOD (MoveAcrossMonitors)
+        {
+            auto layouts = MakeLayouts(2, 2, 1);
+            ZoneNeighborGraph graph;
+            graph.Build(layouts, CombinedRect(layouts));
+
+            // Right zone of the first monitor continues into the left zone of the second one
+            AssertSameTarget(ZoneNeighborGraph::Target{ 1, 0 }, graph.Next(0, 1, VK_RIGHT, false));
+            // Nothing on the other monitor to the left of the first one, unless cycling
+            Assert::IsFalse(graph.Next(0, 0, VK_LEFT, false).has_value());
+            AssertSameTarget(ZoneNeighborGraph::Target{ 1, 1 }, graph.Next(0, 0, VK_LEFT, true));
+            Assert::IsFalse(graph.Next(0, 5, VK_LEFT, true).has_value());
+        }
+
+        // The graph measures from the zone rather than from the window rectangle. The invisible resize
+        // borders of a snapped window extend it past its zone, without changing the zone it moves to.
+        TEST_METHOD (ZoneRectIsOrigin)
+        {
+            auto layouts = MakeLayouts(2, 2, 1);
+            ZoneNeighborGraph graph;
+            graph.Build(layouts, CombinedRect(layouts));
+
+            const RECT frame{ 7, 0, 7, 7 };
+            const DWORD keys[] = { VK_LEFT, VK_UP, VK_RIGHT, VK_DOWN };
+            for (size_t monitorIndex = 0; monitorIndex < layouts.size(); monitorIndex++)
+            {
+                for (size_t zoneId = 0; zoneId < 2; zoneId++)
+                {
+                    for (DWORD key : keys)
+                    {
+                        AssertSameTarget(ChooseByPosition(layouts, monitorIndex, zoneId, key, frame), Next(graph, monitorIndex, zoneId, key));
+                    }
+                }
+            }
+        }
+
+        TEST_METHOD (IsBuiltFrom)
+        {
+            auto layouts = MakeLayouts(2, 2, 1);
+            ZoneNeighborGraph graph;
+            Assert::IsFalse(graph.IsBuiltFrom(layouts));
+
+            graph.Build(layouts, CombinedRect(layouts));
+            Assert::IsTrue(graph.IsBuiltFrom(layouts));
+
+            auto changedLayouts = layouts;
+            changedLayouts[1].zoneSet = MakeLayouts(1, 3, 1)[0].zoneSet;
+            Assert::IsFalse(graph.IsBuiltFrom(changedLayouts));
+
+            changedLayouts = layouts;
+            changedLayouts[0].workAreaRect.bottom -= 40;
+            Assert::IsFalse(graph.IsBuiltFrom(changedLayouts));
+
+            graph.Clear();
+            Assert::IsFalse(graph.IsBuiltFrom(layouts));
+        }
+
+        // 6 monitors with 50 zones each. Checks the graph against choosing the zone on each key press
+        // and logs how long both take for a press of every arrow key in every zone.
+        BEGIN_TEST_METHOD_ATTRIBUTE(MatchesChooseByPositionBenchmark)
+            TEST_METHOD_ATTRIBUTE(L"TestCategory", L"Benchmark")
+            TEST_METHOD_ATTRIBUTE(L"Ignore", L"true")
+        END_TEST_METHOD_ATTRIBUTE()
+        TEST_METHOD (MatchesChooseByPositionBenchmark)
+        {
+            auto layouts = MakeLayouts(6, 10, 5);
+            const DWORD keys[] = { VK_LEFT, VK_UP, VK_RIGHT, VK_DOWN };
+
+            const auto buildStart = std::chrono::steady_clock::now();
+            ZoneNeighborGraph graph;
+            graph.Build(layouts, CombinedRect(layouts));
+            const auto buildTime = std::chrono::steady_clock::now() - buildStart;
+
+            std::vector<std::optional<ZoneNeighborGraph::Target>> lookups;
+            const auto lookupStart = std::chrono::steady_clock::now();
+            for (size_t monitorIndex = 0; monitorIndex < layouts.size(); monitorIndex++)
+            {
+                for (size_t zoneId = 0; zoneId < 50; zoneId++)
+                {
+                    for (DWORD key : keys)
+                    {
+                        lookups.push_back(Next(graph, monitorIndex, zoneId, key));
+                    }
+                }
+            }
+            const auto lookupTime = std::chrono::steady_clock::now() - lookupStart;
+
+            std::vector<std::optional<ZoneNeighborGraph::Target>> choices;
+            const auto chooseStart = std::chrono::steady_clock::now();
+            for (size_t monitorIndex = 0; monitorIndex < layouts.size(); monitorIndex++)
+            {
+                for (size_t zoneId = 0; zoneId < 50; zoneId++)
+                {
+                    for (DWORD key : keys)
+                    {
+                        choices.push_back(ChooseByPosition(layouts, monitorIndex, zoneId, key));
+                    }
+                }
+            }
+            const auto chooseTime = std::chrono::steady_clock::now() - chooseStart;
+
+            Assert::AreEqual(choices.size(), lookups.size());
+            for (size_t i = 0; i < choices.size(); i++)
+            {
+                AssertSameTarget(choices[i], lookups[i]);
+            }
+
+            auto toMs = [](auto duration) { return std::to_wstring(std::chrono::duration<double, std::milli>(duration).count()); };
+            Logger::WriteMessage((L"300 zones: build " + toMs(buildTime) + L" ms, " + std::to_wstring(lookups.size()) + L" lookups " + toMs(lookupTime) + L" ms, choosing on each press " + toMs(chooseTime) + L" ms\n").c_str());
+        }
+    };
+}
@@ -0,0 +1,298 @@
+#include "pch.h"
+#include "lib\ZoneOverlayScene.h"
+#include "lib\ZoneSet.h"
+
+#include <chrono>
+#include <cmath>
+
+#include "Util.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace FancyZonesUnitTests
+{
+    // Renders frames into memory, so the overlay can be drawn without a window or a GPU.
+    // Labels are only laid out, not rasterized.
+    class SoftwareZoneOverlayBackend : public ZoneOverlayBackend
+    {
+    public:
+        struct Pixel
+        {
+            // Premultiplied
+            float r, g, b, a;
+        };
+
+        SoftwareZoneOverlayBackend(int width, int height) :
+            m_width(width), m_height(height), m_pixels(static_cast<size_t>(width) * height)
+        {
+        }
+
+        bool Draw(const ZoneOverlayScene& scene, float alpha) override
+        {
+            if (m_labelsVersion != scene.GetVersion() || m_labelWidths.size() != scene.GetZones().size())
+            {
+                m_labelWidths.clear();
+                for (const auto& zone : scene.GetZones())
+                {
+                    m_labelWidths.push_back(zone.label.size() * LabelCharWidth);
+                }
+                m_labelsVersion = scene.GetVersion();
+                m_labelLayoutCount++;
+            }
+
+            std::fill(m_pixels.begin(), m_pixels.end(), Pixel{});
+
+            const auto& colors = scene.GetColors();
+            const auto& zones = scene.GetZones();
+            for (bool highlightPass : { false, true })
+            {
+                for (size_t i = 0; i < zones.size(); i++)
+                {
+                    if (scene.GetHighlighted()[i] == highlightPass)
+                    {
+                        Fill(zones[i].rect, highlightPass ? colors.highlight : colors.inactive, alpha);
+                        Outline(zones[i].rect, colors.border, alpha);
+                    }
+                }
+            }
+
+            return true;
+        }
+
+        void Present() override
+        {
+            m_presentedFrames++;
+        }
+
+        Pixel At(int x, int y) const
+        {
+            return m_pixels[static_cast<size_t>(y) * m_width + x];
+        }
+
+        // Drop the label layouts, as a backend without a retained scene would after every frame
+        void ReleaseResources()
+        {
+            m_labelWidths.clear();
+            m_labelsVersion = 0;
+        }
+
+        size_t LabelLayoutCount() const { return m_labelLayoutCount; }
+        size_t PresentedFrames() const { return m_presentedFrames; }
+
+    private:
+        static constexpr size_t LabelCharWidth = 40;
+
+        void Blend(int x, int y, const D2D1_COLOR_F& color, float alpha)
+        {
+            if (x < 0 || y < 0 || x >= m_width || y >= m_height)
+            {
+                return;
+            }
+
+            Pixel& pixel = m_pixels[static_cast<size_t>(y) * m_width + x];
+            const float a = color.a * alpha;
+            pixel.r = color.r * a + pixel.r * (1 - a);
+            pixel.g = color.g * a + pixel.g * (1 - a);
+            pixel.b = color.b * a + pixel.b * (1 - a);
+            pixel.a = a + pixel.a * (1 - a);
+        }
+
+        // Pixels whose center is inside the rectangle
+        void Fill(const D2D1_RECT_F& rect, const D2D1_COLOR_F& color, float alpha)
+        {
+            for (int y = static_cast<int>(std::ceil(rect.top - 0.5f)); y < static_cast<int>(std::ceil(rect.bottom - 0.5f)); y++)
+            {
+                for (int x = static_cast<int>(std::ceil(rect.left - 0.5f)); x < static_cast<int>(std::ceil(rect.right - 0.5f)); x++)
+                {
+                    Blend(x, y, color, alpha);
+                }
+            }
+        }
+
+        // One pixel wide stroke centered on the edges
+        void Outline(const D2D1_RECT_F& rect, const D2D1_COLOR_F& color, float alpha)
+        {
+            const int left = static_cast<int>(std::floor(rect.left));
+            const int top = static_cast<int>(std::floor(rect.top));
+            const int right = static_cast<int>(std::floor(rect.right));
+            const int bottom = static_cast<int>(std::floor(rect.bottom));
+            for (int x = left; x <= right; x++)
+            {
+                Blend(x, top, color, alpha);
+                Blend(x, bottom, color, alpha);
+            }
+            for (int y = top + 1; y < bottom; y++)
+            {
+                Blend(left, y, color, alpha);
+                Blend(right, y, color, alpha);
+            }
+        }
+
+        int m_width;
+        int m_height;
+        std::vector<Pixel> m_pixels;
+
+        std::vector<size_t> m_labelWidths;
+        size_t m_labelsVersion = 0;
+        size_t m_labelLayoutCount = 0;
+        size_t m_presentedFrames = 0;
+    };
+
+    TEST_CLASS (ZoneOverlaySceneUnitTests)
+    {
+        const ZoneOverlayScene::Colors m_colors{
+            .border = D2D1::ColorF(1.f, 1.f, 1.f, 1.f),
+            .inactive = D2D1::ColorF(0.f, 0.f, 1.f, 0.5f),
+            .highlight = D2D1::ColorF(1.f, 0.f, 0.f, 0.5f)
+        };
+
+        IZoneSet::ZonesMap MakeGrid(int columns, int rows, int width, int height)
+        {
+            IZoneSet::ZonesMap zones;
+            size_t zoneId = 0;
+            for (int row = 0; row < rows; row++)
+            {
+                for (int column = 0; column < columns; column++)
+                {
+                    zones[zoneId] = MakeZone({ column * width / columns, row * height / rows, (column + 1) * width / columns, (row + 1) * height / rows }, zoneId);
+                    zoneId++;
+                }
+            }
+            return zones;
+        }
+
+        void AssertPixel(const D2D1_COLOR_F& expected, float alpha, const SoftwareZoneOverlayBackend::Pixel& actual)
+        {
+            const float a = expected.a * alpha;
+            Assert::AreEqual(expected.r * a, actual.r, 0.001f);
+            Assert::AreEqual(expected.g * a, actual.g, 0.001f);
+            Assert::AreEqual(expected.b * a, actual.b, 0.001f);
+            Assert::AreEqual(a, actual.a, 0.001f);
+        }
+
+    public:
+        TEST_METHOD (SetZonesKeepsUnchangedGeometry)
+        {
+            ZoneOverlayScene scene;
+            auto zones = MakeGrid(2, 1, 200, 100);
+            scene.SetZones(zones);
+            const size_t version = scene.GetVersion();
+            Assert::AreEqual(size_t{ 2 }, scene.GetZones().size());
+            Assert::AreEqual(std::wstring(L"2"), scene.GetZones()[1].label);
+
+            scene.SetZones(MakeGrid(2, 1, 200, 100));
+            Assert::AreEqual(version, scene.GetVersion());
+
+            scene.SetZones(MakeGrid(2, 1, 300, 100));
+            Assert::AreNotEqual(version, scene.GetVersion());
+
+            const size_t movedVersion = scene.GetVersion();
+            zones = MakeGrid(3, 1, 300, 100);
+            scene.SetZones(zones);
+            Assert::AreNotEqual(movedVersion, scene.GetVersion());
+            Assert::AreEqual(size_t{ 3 }, scene.GetZones().size());
+        }
+
+        TEST_METHOD (HighlightSparseZoneIds)
+        {
+            IZoneSet::ZonesMap zones;
+            for (size_t zoneId : { 0, 5, 9 })
+            {
+                zones[zoneId] = MakeZone({ 0, 0, 100, 100 }, zoneId);
+            }
+
+            ZoneOverlayScene scene;
+            scene.SetZones(zones);
+            scene.SetHighlight({ 9, 42 });
+
+            const std::vector<bool> expected{ false, false, true };
+            Assert::IsTrue(expected == scene.GetHighlighted());
+
+            scene.SetHighlight({});
+            Assert::IsTrue(std::vector<bool>(3, false) == scene.GetHighlighted());
+        }
+
+        TEST_METHOD (RenderHighlightedZone)
+        {
+            ZoneOverlayScene scene;
+            scene.SetZones(MakeGrid(2, 1, 200, 100));
+            scene.SetColors(m_colors);
+            scene.SetHighlight({ 1 });
+
+            SoftwareZoneOverlayBackend backend(200, 100);
+            Assert::IsTrue(backend.Draw(scene, 1.f));
+            AssertPixel(m_colors.inactive, 1.f, backend.At(50, 50));
+            AssertPixel(m_colors.highlight, 1.f, backend.At(150, 50));
+            AssertPixel(m_colors.border, 1.f, backend.At(0, 50));
+
+            // Frames of the fade in only change the alpha
+            Assert::IsTrue(backend.Draw(scene, 0.5f));
+            AssertPixel(m_colors.inactive, 0.5f, backend.At(50, 50));
+            AssertPixel(m_colors.highlight, 0.5f, backend.At(150, 50));
+        }
+
+        TEST_METHOD (HighlightChangesKeepLabelLayouts)
+        {
+            const auto zones = MakeGrid(4, 4, 400, 400);
+            ZoneOverlayScene scene;
+            SoftwareZoneOverlayBackend backend(400, 400);
+
+            for (size_t frame = 0; frame < 32; frame++)
+            {
+                scene.SetZones(zones);
+                scene.SetColors(m_colors);
+                scene.SetHighlight({ frame % zones.size() });
+                Assert::IsTrue(backend.Draw(scene, 1.f));
+                backend.Present();
+            }
+
+            Assert::AreEqual(size_t{ 1 }, backend.LabelLayoutCount());
+            Assert::AreEqual(size_t{ 32 }, backend.PresentedFrames());
+        }
+
+        // 400 zones, dragging a window across them with the highlight moving on every frame. Logs the cost of
+        // a frame with the retained scene, and with the scene and label layouts rebuilt on every frame. Both
+        // draw into the same backend, so only the rebuilt resources differ and not the frame buffer allocation.
+        BEGIN_TEST_METHOD_ATTRIBUTE(FrameCostBenchmark)
+            TEST_METHOD_ATTRIBUTE(L"TestCategory", L"Benchmark")
+            TEST_METHOD_ATTRIBUTE(L"Ignore", L"true")
+        END_TEST_METHOD_ATTRIBUTE()
+        TEST_METHOD (FrameCostBenchmark)
+        {
+            const int width = 1280, height = 720;
+            const auto zones = MakeGrid(20, 20, width, height);
+            const size_t frames = 120;
+
+            ZoneOverlayScene scene;
+            SoftwareZoneOverlayBackend backend(width, height);
+            const auto retainedStart = std::chrono::steady_clock::now();
+            for (size_t frame = 0; frame < frames; frame++)
+            {
+                scene.SetZones(zones);
+                scene.SetColors(m_colors);
+                scene.SetHighlight({ frame % zones.size() });
+                backend.Draw(scene, 1.f);
+                backend.Present();
+            }
+            const auto retainedTime = std::chrono::steady_clock::now() - retainedStart;
+            Assert::AreEqual(size_t{ 1 }, backend.LabelLayoutCount());
+
+            const auto rebuiltStart = std::chrono::steady_clock::now();
+            for (size_t frame = 0; frame < frames; frame++)
+            {
+                ZoneOverlayScene frameScene;
+                backend.ReleaseResources();
+                frameScene.SetZones(zones);
+                frameScene.SetColors(m_colors);
+                frameScene.SetHighlight({ frame % zones.size() });
+                backend.Draw(frameScene, 1.f);
+                backend.Present();
+            }
+            const auto rebuiltTime = std::chrono::steady_clock::now() - rebuiltStart;
+            Assert::AreEqual(1 + frames, backend.LabelLayoutCount());
+
+            auto perFrameMs = [frames](auto duration) { return std::to_wstring(std::chrono::duration<double, std::milli>(duration).count() / frames); };
+            Logger::WriteMessage((L"400 zones: retained " + perFrameMs(retainedTime) + L" ms per frame, rebuilt " + perFrameMs(rebuiltTime) + L" ms per frame\n").c_str());
+        }
+    };
+}
@@ -5,6 +5,7 @@
 #include "lib\VirtualDesktopUtils.h"
 #include "lib\ZoneSet.h"
 
+#include <chrono>
 #include <filesystem>
 
 #include "Util.h"
@@ -294,6 +295,106 @@ namespace FancyZonesUnitTests
                 compareZones(zone4, m_set->GetZones()[actual[3]]);
             }
 
+            // Same hit test as ZonesFromPoint with the Smallest algorithm, checking every zone
+            std::vector<size_t> ZonesFromPointLinearScan(POINT pt)
+            {
+                const int radius = DefaultValues::SensitivityRadius;
+                std::vector<size_t> captured;
+                size_t strictlyCaptured = 0;
+                for (const auto& [zoneId, zone] : m_set->GetZones())
+                {
+                    const RECT rect = zone->GetZoneRect();
+                    if (rect.left - radius <= pt.x && pt.x <= rect.right + radius && rect.top - radius <= pt.y && pt.y <= rect.bottom + radius)
+                    {
+                        captured.push_back(zoneId);
+                        if (rect.left <= pt.x && pt.x < rect.right && rect.top <= pt.y && pt.y < rect.bottom)
+                        {
+                            strictlyCaptured++;
+                        }
+                    }
+                }
+
+                if (captured.size() == 1 && strictlyCaptured == 0)
+                {
+                    return {};
+                }
+
+                auto zones = m_set->GetZones();
+                auto area = [&](size_t id) {
+                    RECT rect = zones[id]->GetZoneRect();
+                    return max(rect.bottom - rect.top, 0) * max(rect.right - rect.left, 0);
+                };
+
+                for (size_t i = 0; i < captured.size(); i++)
+                {
+                    for (size_t j = i + 1; j < captured.size(); j++)
+                    {
+                        RECT rectI = zones[captured[i]]->GetZoneRect();
+                        RECT rectJ = zones[captured[j]]->GetZoneRect();
+                        if (max(rectI.top, rectJ.top) + radius < min(rectI.bottom, rectJ.bottom) &&
+                            max(rectI.left, rectJ.left) + radius < min(rectI.right, rectJ.right))
+                        {
+                            size_t chosen = captured[0];
+                            for (size_t id : captured)
+                            {
+                                if (area(id) < area(chosen))
+                                {
+                                    chosen = id;
+                                }
+                            }
+                            return { chosen };
+                        }
+                    }
+                }
+
+                return captured;
+            }
+
+            // Canvas layout of an ultrawide monitor, a 10x8 grid with 20 overlapping zones on top, hit tested
+            // along a drag path sweeping across the whole monitor
+            TEST_METHOD (ZoneFromPointManyZonesDragPath)
+            {
+                const int width = 5120, height = 1440;
+                size_t zoneId = 0;
+                for (int row = 0; row < 8; row++)
+                {
+                    for (int column = 0; column < 10; column++)
+                    {
+                        m_set->AddZone(MakeZone({ column * width / 10, row * height / 8, (column + 1) * width / 10, (row + 1) * height / 8 }, zoneId++));
+                    }
+                }
+                for (int i = 0; i < 20; i++)
+                {
+                    const int left = (i * 241) % (width - 800);
+                    const int top = (i * 137) % (height - 400);
+                    m_set->AddZone(MakeZone({ left, top, left + 300 + (i % 5) * 100, top + 200 + (i % 3) * 100 }, zoneId++));
+                }
+
+                std::vector<POINT> path;
+                for (int step = 0; step < 20000; step++)
+                {
+                    path.push_back(POINT{ (step * 7) % (width + 40) - 20, (step * 3 + (step / 700) * 53) % (height + 40) - 20 });
+                }
+
+                const auto indexStart = std::chrono::steady_clock::now();
+                std::vector<std::vector<size_t>> actual;
+                for (const auto& pt : path)
+                {
+                    actual.push_back(m_set->ZonesFromPoint(pt));
+                }
+                const auto indexTime = std::chrono::steady_clock::now() - indexStart;
+
+                const auto scanStart = std::chrono::steady_clock::now();
+                for (size_t i = 0; i < path.size(); i++)
+                {
+                    Assert::IsTrue(actual[i] == ZonesFromPointLinearScan(path[i]));
+                }
+                const auto scanTime = std::chrono::steady_clock::now() - scanStart;
+
+                auto toMs = [](auto duration) { return std::to_wstring(std::chrono::duration<double, std::milli>(duration).count()); };
+                Logger::WriteMessage((L"Hit tested " + std::to_wstring(path.size()) + L" points in " + toMs(indexTime) + L" ms, linear scan " + toMs(scanTime) + L" ms\n").c_str());
+            }
+
             TEST_METHOD (ZoneIndexFromWindowUnknown)
             {
                 winrt::com_ptr<IZone> zone = MakeZone({ 0, 0, 100, 100 }, 1);
@@ -1,4 +1,5 @@
 #pragma once
+#include "KeyboardStateSnapshot.h"
 
 // Interface used to wrap keyboard input library methods
 class InputInterface
@@ -10,6 +11,12 @@ public:
     // Function to get the state of a particular key
     virtual bool GetVirtualKeyState(int key) = 0;
 
+    // Function to get the state of all the keys at once
+    virtual KeyboardStateSnapshot GetKeyboardStateSnapshot() = 0;
+
     // Function to get the foreground process name
     virtual void GetForegroundProcess(_Out_ std::wstring& foregroundProcess) = 0;
+
+    // Function to get the number of times the foreground window has changed, so that the foreground process is only read again after it changes
+    virtual uint64_t GetForegroundChangeCount() = 0;
 };
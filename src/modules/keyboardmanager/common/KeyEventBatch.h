@@ -0,0 +1,51 @@
+#pragma once
+#include <array>
+#include <algorithm>
+
+// Class to store the key events which are sent together with a single SendInput call. They are stored in a fixed-size array, so that no memory is allocated on the hook thread when remapping keys
+class KeyEventBatch
+{
+public:
+    // Maximum number of key events. A shortcut has at most 5 keys, and a remap sends at most the dummy key events, the source shortcut except its action key, the target shortcut and 2 more key events
+    static constexpr size_t Capacity = 16;
+
+private:
+    std::array<INPUT, Capacity> keyEvents{};
+    size_t size = 0;
+
+public:
+    // Function to set the number of key events and reset them, so that they can be set by index. Returns false and leaves the batch empty if count is larger than Capacity, in which case no key events must be set or sent
+    bool Reset(size_t count)
+    {
+        if (count > Capacity)
+        {
+            size = 0;
+            return false;
+        }
+
+        size = count;
+        std::fill_n(keyEvents.begin(), size, INPUT{});
+        return true;
+    }
+
+    // Function to set the scan codes of the key events from their key codes with the keyboard layout of the calling thread. Key events which are set ahead of time have to be updated with this when they are sent, since the layout can change in between
+    void SetScanCodes()
+    {
+        for (size_t i = 0; i < size; i++)
+        {
+            keyEvents[i].ki.wScan = (WORD)MapVirtualKey(keyEvents[i].ki.wVk, MAPVK_VK_TO_VSC);
+        }
+    }
+
+    // Function to get the key events
+    LPINPUT Data()
+    {
+        return keyEvents.data();
+    }
+
+    // Function to get the number of key events
+    size_t Size() const
+    {
+        return size;
+    }
+};
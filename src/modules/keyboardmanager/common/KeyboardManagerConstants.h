@@ -105,9 +105,19 @@ namespace KeyboardManagerConstants
     // Number of key messages required while sending a dummy key event
     inline const size_t DUMMY_KEY_EVENT_SIZE = 2;
 
+    // Time in milliseconds without key events after which the key states tracked by the hook are read again
+    inline const ULONGLONG KeyboardStateResyncInterval = 1000;
+
     // String constant for the default app name in Remap shortcuts
     inline const std::wstring DefaultAppName = GET_RESOURCE_STRING(IDS_EDITSHORTCUTS_ALLAPPS);
 
     // String constant to represent no activated application in app-specific shortcuts
     inline const std::wstring NoActivatedApp = L"";
+
+    // Id to represent no activated application in app-specific shortcuts. A shortcut remap event handled with this id uses the os level shortcut remaps
+    inline const int NoActivatedAppId = -1;
+
+    // Ids of the foreground app in app-specific shortcuts when there is no foreground process, and when the foreground process has no app-specific shortcuts
+    inline const int NoForegroundAppId = -1;
+    inline const int UnmappedForegroundAppId = -2;
 }
\ No newline at end of file
@@ -5,10 +5,11 @@
 #include <common/SettingsAPI/settings_helpers.h>
 #include "KeyDelay.h"
 #include "Helpers.h"
+#include "InputInterface.h"
 
 // Constructor
 KeyboardManagerState::KeyboardManagerState() :
-    uiState(KeyboardManagerUIState::Deactivated), currentUIWindow(nullptr), currentShortcutUI1(nullptr), currentShortcutUI2(nullptr), currentSingleKeyUI(nullptr), detectedRemapKey(NULL), remappingsEnabled(true)
+    uiState(KeyboardManagerUIState::Deactivated), currentUIWindow(nullptr), currentShortcutUI1(nullptr), currentShortcutUI2(nullptr), currentSingleKeyUI(nullptr), detectedRemapKey(NULL), remapSnapshot(std::make_shared<RemapSnapshot>()), foregroundAppId(KeyboardManagerConstants::NoForegroundAppId), foregroundAppChangeCount(0), isForegroundAppIdValid(false), activatedAppId(KeyboardManagerConstants::NoActivatedAppId)
 {
     configFile_mutex = CreateMutex(
         NULL, // default security descriptor
@@ -104,103 +105,138 @@ void KeyboardManagerState::ResetUIState()
 // Function to clear the OS Level shortcut remapping table
 void KeyboardManagerState::ClearOSLevelShortcuts()
 {
-    osLevelShortcutReMap.clear();
-    osLevelShortcutReMapSortedKeys.clear();
+    RemapSnapshotUpdateWrapper([](RemapSnapshot& snapshot) {
+        snapshot.ClearOSLevelShortcuts();
+    });
 }
 
 // Function to clear the Keys remapping table.
 void KeyboardManagerState::ClearSingleKeyRemaps()
 {
-    singleKeyReMap.clear();
+    RemapSnapshotUpdateWrapper([](RemapSnapshot& snapshot) {
+        snapshot.ClearSingleKeyRemaps();
+    });
 }
 
 // Function to clear the App specific shortcut remapping table
 void KeyboardManagerState::ClearAppSpecificShortcuts()
 {
-    appSpecificShortcutReMap.clear();
-    appSpecificShortcutReMapSortedKeys.clear();
+    RemapSnapshotUpdateWrapper([](RemapSnapshot& snapshot) {
+        snapshot.ClearAppSpecificShortcuts();
+    });
 }
 
 // Function to add a new OS level shortcut remapping
 bool KeyboardManagerState::AddOSLevelShortcut(const Shortcut& originalSC, const KeyShortcutUnion& newSC)
 {
-    // Check if the shortcut is already remapped
-    auto it = osLevelShortcutReMap.find(originalSC);
-    if (it != osLevelShortcutReMap.end())
-    {
-        return false;
-    }
-
-    osLevelShortcutReMap[originalSC] = RemapShortcut(newSC);
-    osLevelShortcutReMapSortedKeys.push_back(originalSC);
-    KeyboardManagerHelper::SortShortcutVectorBasedOnSize(osLevelShortcutReMapSortedKeys);
-
-    return true;
+    bool result = false;
+    RemapSnapshotUpdateWrapper([&](RemapSnapshot& snapshot) {
+        result = snapshot.AddOSLevelShortcut(originalSC, newSC);
+    });
+    return result;
 }
 
 // Function to add a new single key to key/shortcut remapping
 bool KeyboardManagerState::AddSingleKeyRemap(const DWORD& originalKey, const KeyShortcutUnion& newRemapKey)
 {
-    // Check if the key is already remapped
-    auto it = singleKeyReMap.find(originalKey);
-    if (it != singleKeyReMap.end())
-    {
-        return false;
-    }
-
-    singleKeyReMap[originalKey] = newRemapKey;
-    return true;
+    bool result = false;
+    RemapSnapshotUpdateWrapper([&](RemapSnapshot& snapshot) {
+        result = snapshot.AddSingleKeyRemap(originalKey, newRemapKey);
+    });
+    return result;
 }
 
 // Function to add a new App specific shortcut remapping
 bool KeyboardManagerState::AddAppSpecificShortcut(const std::wstring& app, const Shortcut& originalSC, const KeyShortcutUnion& newSC)
 {
-    // Convert app name to lower case
-    std::wstring process_name;
-    process_name.resize(app.length());
-    std::transform(app.begin(), app.end(), process_name.begin(), towlower);
+    bool result = false;
+    RemapSnapshotUpdateWrapper([&](RemapSnapshot& snapshot) {
+        result = snapshot.AddAppSpecificShortcut(app, originalSC, newSC);
+    });
+    return result;
+}
+
+// Function to change the remaps. The method changes a copy of the current remap snapshot, which is published once the method returns. The hook keeps remapping with the current snapshot until then.
+void KeyboardManagerState::RemapSnapshotUpdateWrapper(std::function<void(RemapSnapshot&)> method)
+{
+    std::lock_guard<std::mutex> lock(remapSnapshotUpdate_mutex);
+    auto snapshot = std::make_shared<RemapSnapshot>(*remapSnapshot.load());
+
+    // Run the method which changes the remaps
+    method(*snapshot);
+
+    snapshot->CompileShortcutRemapLookups();
+    remapSnapshot.store(std::move(snapshot));
+}
 
-    // Check if there are any app specific shortcuts for this app
-    auto appIt = appSpecificShortcutReMap.find(process_name);
-    if (appIt != appSpecificShortcutReMap.end())
+// Function to get the current remap snapshot
+std::shared_ptr<const RemapSnapshot> KeyboardManagerState::GetRemapSnapshot()
+{
+    return remapSnapshot.load();
+}
+
+// Function to get the remap snapshot to handle a key event with. It is only called by the hook, and moves the state of the shortcut remaps to the snapshot when it has changed
+std::shared_ptr<const RemapSnapshot> KeyboardManagerState::AcquireRemapSnapshot()
+{
+    auto snapshot = remapSnapshot.load();
+    if (snapshot == hookRemapSnapshot)
     {
-        // Check if the shortcut is already remapped
-        auto shortcutIt = appSpecificShortcutReMap[process_name].find(originalSC);
-        if (shortcutIt != appSpecificShortcutReMap[process_name].end())
+        return snapshot;
+    }
+
+    std::vector<ShortcutRemapState> states(snapshot->shortcutRemapStateCount);
+    if (hookRemapSnapshot)
+    {
+        MoveShortcutRemapStates(hookRemapSnapshot->osLevelShortcutReMapLookup, snapshot->osLevelShortcutReMapLookup, states);
+        for (size_t appId = 0; appId < hookRemapSnapshot->appSpecificShortcutReMapLookups.size(); appId++)
         {
-            return false;
+            MoveShortcutRemapStates(hookRemapSnapshot->appSpecificShortcutReMapLookups[appId], snapshot->GetShortcutRemapLookup(hookRemapSnapshot->appSpecificShortcutReMapAppNames[appId]), states);
         }
     }
-    else
+
+    // The app ids may have changed, so the activated app is looked up by its name in the new snapshot. It is no longer activated if it has no app-specific shortcuts in it
+    if (activatedAppId != KeyboardManagerConstants::NoActivatedAppId)
     {
-        appSpecificShortcutReMapSortedKeys[process_name] = std::vector<Shortcut>();
+        auto it = snapshot->appSpecificShortcutReMapAppIds.find(hookRemapSnapshot->appSpecificShortcutReMapAppNames[activatedAppId]);
+        activatedAppId = (it != snapshot->appSpecificShortcutReMapAppIds.end()) ? it->second : KeyboardManagerConstants::NoActivatedAppId;
     }
 
-    appSpecificShortcutReMap[process_name][originalSC] = RemapShortcut(newSC);
-    appSpecificShortcutReMapSortedKeys[process_name].push_back(originalSC);
-    KeyboardManagerHelper::SortShortcutVectorBasedOnSize(appSpecificShortcutReMapSortedKeys[process_name]);
-    return true;
+    shortcutRemapStates = std::move(states);
+    hookRemapSnapshot = snapshot;
+
+    isForegroundAppIdValid = false;
+    return snapshot;
 }
 
-// Function to get the iterator of a single key remap given the source key. Returns nullopt if it isn't remapped
-std::optional<SingleKeyRemapTable::iterator> KeyboardManagerState::GetSingleKeyRemap(const DWORD& originalKey)
+// Function to move the state of the shortcut remaps which are invoked to the same remaps in a new snapshot, so that a shortcut which is held down while the remaps change can still be released
+void KeyboardManagerState::MoveShortcutRemapStates(const ShortcutRemapLookup& previousLookup, const ShortcutRemapLookup& lookup, std::vector<ShortcutRemapState>& states)
 {
-    auto it = singleKeyReMap.find(originalKey);
-    if (it != singleKeyReMap.end())
+    for (const auto& previousRemap : previousLookup.GetAll())
     {
-        return it;
-    }
+        const ShortcutRemapState& state = shortcutRemapStates[previousRemap.stateIndex];
+        if (!state.isShortcutInvoked && !state.isOriginalActionKeyPressed)
+        {
+            continue;
+        }
 
-    return std::nullopt;
+        // The state is only kept if the shortcut is remapped to the same target
+        for (const auto& remap : lookup.GetByActionKey(previousRemap.remap->first.GetActionKey()))
+        {
+            if (remap.remap->first == previousRemap.remap->first && remap.remap->second == previousRemap.remap->second)
+            {
+                states[remap.stateIndex] = state;
+                break;
+            }
+        }
+    }
 }
 
-bool KeyboardManagerState::CheckShortcutRemapInvoked(const std::optional<std::wstring>& appName)
+// Function to check if any shortcut remap of the os level remap table, or of the app-specific remap table of the given app id, is invoked
+bool KeyboardManagerState::CheckShortcutRemapInvoked(const RemapSnapshot& snapshot, int appId)
 {
-    // Assumes appName exists in the app-specific remap table
-    ShortcutRemapTable& currentRemapTable = appName ? appSpecificShortcutReMap[*appName] : osLevelShortcutReMap;
-    for (auto& it : currentRemapTable)
+    for (const auto& remap : snapshot.GetShortcutRemapLookup(appId).GetAll())
     {
-        if (it.second.isShortcutInvoked)
+        if (GetShortcutRemapState(remap).isShortcutInvoked)
         {
             return true;
         }
@@ -209,25 +245,65 @@ bool KeyboardManagerState::CheckShortcutRemapInvoked(const std::optional<std::ws
     return false;
 }
 
-std::vector<Shortcut>& KeyboardManagerState::GetSortedShortcutRemapVector(const std::optional<std::wstring>& appName)
+// Function to get the state of a shortcut remap. Assumes the remap is from the snapshot returned by the last AcquireRemapSnapshot call
+ShortcutRemapState& KeyboardManagerState::GetShortcutRemapState(const ShortcutRemapLookup::Candidate& remap)
 {
-    // Assumes appName exists in the app-specific remap table
-    return appName ? appSpecificShortcutReMapSortedKeys[*appName] : osLevelShortcutReMapSortedKeys;
+    return shortcutRemapStates[remap.stateIndex];
 }
 
-// Function to get the source and target of a shortcut remap given the source shortcut. Returns nullopt if it isn't remapped
-ShortcutRemapTable& KeyboardManagerState::GetShortcutRemapTable(const std::optional<std::wstring>& appName)
+// Function to get the state of a shortcut remap given the source shortcut. Returns the state of a remap which is not invoked if it isn't remapped
+const ShortcutRemapState& KeyboardManagerState::GetShortcutRemapState(const Shortcut& originalSC, const std::optional<std::wstring>& appName)
 {
-    if (appName)
+    static const ShortcutRemapState notInvoked;
+    if (!hookRemapSnapshot)
     {
-        auto itTable = appSpecificShortcutReMap.find(*appName);
-        if (itTable != appSpecificShortcutReMap.end())
+        return notInvoked;
+    }
+
+    for (const auto& remap : hookRemapSnapshot->GetShortcutRemapLookup(appName).GetByActionKey(originalSC.GetActionKey()))
+    {
+        if (remap.remap->first == originalSC)
         {
-            return itTable->second;
+            return GetShortcutRemapState(remap);
         }
     }
 
-    return osLevelShortcutReMap;
+    return notInvoked;
+}
+
+// Function to get the id of the foreground app for app-specific shortcuts. Returns NoForegroundAppId if there is no foreground process and UnmappedForegroundAppId if it has no app-specific shortcuts. Assumes the snapshot was returned by the last AcquireRemapSnapshot call
+int KeyboardManagerState::GetForegroundAppId(InputInterface& ii, const RemapSnapshot& snapshot)
+{
+    // Resolving the foreground process is expensive, so it is only done when the foreground window changes instead of on every key event
+    const uint64_t changeCount = ii.GetForegroundChangeCount();
+    if (isForegroundAppIdValid && changeCount == foregroundAppChangeCount)
+    {
+        return foregroundAppId;
+    }
+
+    foregroundAppChangeCount = changeCount;
+    isForegroundAppIdValid = true;
+
+    std::wstring process_name;
+
+    // Allocate MAX_PATH amount of memory
+    process_name.resize(MAX_PATH);
+    ii.GetForegroundProcess(process_name);
+
+    // Remove elements after null character
+    process_name.erase(std::find(process_name.begin(), process_name.end(), L'\0'), process_name.end());
+
+    if (process_name.empty())
+    {
+        foregroundAppId = KeyboardManagerConstants::NoForegroundAppId;
+        return foregroundAppId;
+    }
+
+    // Convert process name to lower case
+    std::transform(process_name.begin(), process_name.end(), process_name.begin(), towlower);
+
+    foregroundAppId = snapshot.GetAppSpecificShortcutAppId(process_name);
+    return foregroundAppId;
 }
 
 // Function to set the textblock of the detect shortcut UI so that it can be accessed by the hook
@@ -507,7 +583,8 @@ bool KeyboardManagerState::SaveConfigToFile()
     json::JsonArray inProcessRemapKeysArray;
     json::JsonArray appSpecificRemapShortcutsArray;
     json::JsonArray globalRemapShortcutsArray;
-    for (const auto& it : singleKeyReMap)
+    const auto snapshot = GetRemapSnapshot();
+    for (const auto& it : snapshot->singleKeyReMap)
     {
         json::JsonObject keys;
         keys.SetNamedValue(KeyboardManagerConstants::OriginalKeysSettingName, json::value(winrt::to_hstring((unsigned int)it.first)));
@@ -527,7 +604,7 @@ bool KeyboardManagerState::SaveConfigToFile()
         inProcessRemapKeysArray.Append(keys);
     }
 
-    for (const auto& it : osLevelShortcutReMap)
+    for (const auto& it : snapshot->osLevelShortcutReMap)
     {
         json::JsonObject keys;
         keys.SetNamedValue(KeyboardManagerConstants::OriginalKeysSettingName, json::value(it.first.ToHstringVK()));
@@ -547,7 +624,7 @@ bool KeyboardManagerState::SaveConfigToFile()
         globalRemapShortcutsArray.Append(keys);
     }
 
-    for (const auto& itApp : appSpecificShortcutReMap)
+    for (const auto& itApp : snapshot->appSpecificShortcutReMap)
     {
         // Iterate over apps
         for (const auto& itKeys : itApp.second)
@@ -618,31 +695,25 @@ std::wstring KeyboardManagerState::GetCurrentConfigName()
     return currentConfig;
 }
 
-// Sets the activated target application in app-specific shortcut
-void KeyboardManagerState::SetActivatedApp(const std::wstring& appName)
-{
-    activatedAppSpecificShortcutTarget = appName;
-}
-
-// Gets the activated target application in app-specific shortcut
-std::wstring KeyboardManagerState::GetActivatedApp()
+// Sets the id of the activated target application in app-specific shortcut. Assumes the id is from the snapshot returned by the last AcquireRemapSnapshot call
+void KeyboardManagerState::SetActivatedAppId(int appId)
 {
-    return activatedAppSpecificShortcutTarget;
+    activatedAppId = appId;
 }
 
-bool KeyboardManagerState::AreRemappingsEnabled()
+// Gets the id of the activated target application in app-specific shortcut, or NoActivatedAppId if none is activated
+int KeyboardManagerState::GetActivatedAppId() const
 {
-    return remappingsEnabled;
+    return activatedAppId;
 }
 
-void KeyboardManagerState::RemappingsDisabledWrapper(std::function<void()> method)
+// Gets the name of the activated target application in app-specific shortcut
+std::wstring KeyboardManagerState::GetActivatedApp()
 {
-    // Disable keyboard remappings
-    remappingsEnabled = false;
-
-    // Run the method which requires the remappings to be disabled
-    method();
+    if (activatedAppId == KeyboardManagerConstants::NoActivatedAppId)
+    {
+        return KeyboardManagerConstants::NoActivatedApp;
+    }
 
-    // Re-enable the keyboard remappings
-    remappingsEnabled = true;
+    return hookRemapSnapshot->GetAppSpecificShortcutAppName(activatedAppId);
 }
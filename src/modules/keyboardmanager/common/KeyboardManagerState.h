@@ -1,5 +1,7 @@
 #pragma once
 #include <mutex>
+#include <atomic>
+#include <memory>
 #include "KeyboardManagerConstants.h"
 #include <common/interop/keyboard_layout.h>
 #include "../common/hooks/LowlevelKeyboardEvent.h"
@@ -7,8 +9,10 @@
 #include <variant>
 #include "Shortcut.h"
 #include "RemapShortcut.h"
+#include "RemapSnapshot.h"
 
 class KeyDelay;
+class InputInterface;
 
 namespace KeyboardManagerHelper
 {
@@ -20,10 +24,6 @@ namespace winrt::Windows::UI::Xaml::Controls
     struct StackPanel;
 }
 
-using SingleKeyRemapTable = std::unordered_map<DWORD, KeyShortcutUnion>;
-using ShortcutRemapTable = std::map<Shortcut, RemapShortcut>;
-using AppSpecificShortcutRemapTable = std::map<std::wstring, ShortcutRemapTable>;
-
 // Enum type to store different states of the UI
 enum class KeyboardManagerUIState
 {
@@ -85,35 +85,37 @@ private:
     std::map<DWORD, std::unique_ptr<KeyDelay>> keyDelays;
     std::mutex keyDelays_mutex;
 
-    // Stores the activated target application in app-specific shortcut
-    std::wstring activatedAppSpecificShortcutTarget;
+    // Stores the remap tables. The remaps are changed by publishing a new snapshot, so the hook keeps remapping with the previous snapshot while the next one is built instead of the remappings being disabled
+    std::atomic<std::shared_ptr<const RemapSnapshot>> remapSnapshot;
+
+    // Mutex to allow only one thread at a time to build a new remap snapshot, so that the changes of another thread are not lost
+    std::mutex remapSnapshotUpdate_mutex;
+
+    // Stores the remap snapshot last used by the hook, and the state of its shortcut remaps indexed by their state index. These are only used by the hook
+    std::shared_ptr<const RemapSnapshot> hookRemapSnapshot;
+    std::vector<ShortcutRemapState> shortcutRemapStates;
+
+    // Stores the id of the foreground app for app-specific shortcuts and the foreground change count of the input when it was read. It is read again when the foreground window or the remap snapshot change
+    int foregroundAppId;
+    uint64_t foregroundAppChangeCount;
+    bool isForegroundAppIdValid;
 
-    // Thread safe boolean value to check if remappings are currently enabled. This is used to disable remappings while the remap tables are being updated by the UI thread
-    std::atomic_bool remappingsEnabled;
+    // Stores the id of the activated target application in app-specific shortcut in the remap snapshot last used by the hook. It is only used by the hook
+    int activatedAppId;
 
     // Display a key by appending a border Control as a child of the panel.
     void AddKeyToLayout(const winrt::Windows::UI::Xaml::Controls::StackPanel& panel, const winrt::hstring& key);
 
-public:
-    // The map members and their mutexes are left as public since the maps are used extensively in dllmain.cpp.
-    // Maps which store the remappings for each of the features. The bool fields should be initialized to false. They are used to check the current state of the shortcut (i.e is that particular shortcut currently pressed down or not).
-    // Stores single key remappings
-    std::unordered_map<DWORD, KeyShortcutUnion> singleKeyReMap;
+    // Function to move the state of the shortcut remaps which are invoked to the same remaps in a new snapshot, so that a shortcut which is held down while the remaps change can still be released
+    void MoveShortcutRemapStates(const ShortcutRemapLookup& previousLookup, const ShortcutRemapLookup& lookup, std::vector<ShortcutRemapState>& states);
 
+public:
     /* This feature has not been enabled (code from proof of concept stage)
     * 
     // Stores keys which need to be changed from toggle behavior to modifier behavior. Eg. Caps Lock
     std::unordered_map<DWORD, bool> singleKeyToggleToMod;
     */
 
-    // Stores the os level shortcut remappings
-    ShortcutRemapTable osLevelShortcutReMap;
-    std::vector<Shortcut> osLevelShortcutReMapSortedKeys;
-
-    // Stores the app-specific shortcut remappings. Maps application name to the shortcut map
-    AppSpecificShortcutRemapTable appSpecificShortcutReMap;
-    std::map<std::wstring, std::vector<Shortcut>> appSpecificShortcutReMapSortedKeys;
-
     // Stores the keyboard layout
     LayoutMap keyboardMap;
 
@@ -153,15 +155,26 @@ public:
     // Function to add a new App specific level shortcut remapping
     bool AddAppSpecificShortcut(const std::wstring& app, const Shortcut& originalSC, const KeyShortcutUnion& newSC);
 
-    // Function to get the iterator of a single key remap given the source key. Returns nullopt if it isn't remapped
-    std::optional<SingleKeyRemapTable::iterator> GetSingleKeyRemap(const DWORD& originalKey);
+    // Function to change the remaps. The method changes a copy of the current remap snapshot, which is published once the method returns. The hook keeps remapping with the current snapshot until then.
+    void RemapSnapshotUpdateWrapper(std::function<void(RemapSnapshot&)> method);
+
+    // Function to get the current remap snapshot
+    std::shared_ptr<const RemapSnapshot> GetRemapSnapshot();
+
+    // Function to get the remap snapshot to handle a key event with. It is only called by the hook, and moves the state of the shortcut remaps to the snapshot when it has changed
+    std::shared_ptr<const RemapSnapshot> AcquireRemapSnapshot();
+
+    // Function to check if any shortcut remap of the os level remap table, or of the app-specific remap table of the given app id, is invoked
+    bool CheckShortcutRemapInvoked(const RemapSnapshot& snapshot, int appId);
 
-    bool CheckShortcutRemapInvoked(const std::optional<std::wstring>& appName);
+    // Function to get the state of a shortcut remap. Assumes the remap is from the snapshot returned by the last AcquireRemapSnapshot call
+    ShortcutRemapState& GetShortcutRemapState(const ShortcutRemapLookup::Candidate& remap);
 
-    std::vector<Shortcut>& GetSortedShortcutRemapVector(const std::optional<std::wstring>& appName);
+    // Function to get the state of a shortcut remap given the source shortcut. Returns the state of a remap which is not invoked if it isn't remapped
+    const ShortcutRemapState& GetShortcutRemapState(const Shortcut& originalSC, const std::optional<std::wstring>& appName = std::nullopt);
 
-    // Function to get the source and target of a shortcut remap given the source shortcut. Returns nullopt if it isn't remapped
-    ShortcutRemapTable& GetShortcutRemapTable(const std::optional<std::wstring>& appName);
+    // Function to get the id of the foreground app for app-specific shortcuts. Returns NoForegroundAppId if there is no foreground process and UnmappedForegroundAppId if it has no app-specific shortcuts. Assumes the snapshot was returned by the last AcquireRemapSnapshot call
+    int GetForegroundAppId(InputInterface& ii, const RemapSnapshot& snapshot);
 
     // Function to set the textblock of the detect shortcut UI so that it can be accessed by the hook
     void ConfigureDetectShortcutUI(const winrt::Windows::UI::Xaml::Controls::StackPanel& textBlock1, const winrt::Windows::UI::Xaml::Controls::StackPanel& textBlock2);
@@ -225,13 +238,12 @@ public:
     // Gets the Current Active Configuration Name.
     std::wstring GetCurrentConfigName();
 
-    // Sets the activated target application in app-specific shortcut
-    void SetActivatedApp(const std::wstring& appName);
+    // Sets the id of the activated target application in app-specific shortcut. Assumes the id is from the snapshot returned by the last AcquireRemapSnapshot call
+    void SetActivatedAppId(int appId);
 
-    // Gets the activated target application in app-specific shortcut
-    std::wstring GetActivatedApp();
-
-    bool AreRemappingsEnabled();
+    // Gets the id of the activated target application in app-specific shortcut, or NoActivatedAppId if none is activated
+    int GetActivatedAppId() const;
 
-    void RemappingsDisabledWrapper(std::function<void()> method);
+    // Gets the name of the activated target application in app-specific shortcut
+    std::wstring GetActivatedApp();
 };
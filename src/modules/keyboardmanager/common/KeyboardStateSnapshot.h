@@ -0,0 +1,54 @@
+#pragma once
+#include <array>
+#include <cstdint>
+
+// Class to store which of the 256 virtual key codes are pressed down as a bit set, so that the state of many keys can be checked with a few word operations instead of one query per key
+class KeyboardStateSnapshot
+{
+private:
+    std::array<uint64_t, 4> words{};
+
+public:
+    // Function to set the state of a key - false for key up, and true for key down
+    void SetKeyState(DWORD key, bool isDown)
+    {
+        const uint64_t bit = uint64_t(1) << (key & 63);
+        if (isDown)
+        {
+            words[(key >> 6) & 3] |= bit;
+        }
+        else
+        {
+            words[(key >> 6) & 3] &= ~bit;
+        }
+    }
+
+    // Function to check if a key is pressed down
+    bool IsKeyDown(DWORD key) const
+    {
+        return (words[(key >> 6) & 3] >> (key & 63)) & 1;
+    }
+
+    // Function to check if any key is pressed down
+    bool IsAnyKeyDown() const
+    {
+        return (words[0] | words[1] | words[2] | words[3]) != 0;
+    }
+
+    // Function to check if any key is pressed down which is not in the given set of keys
+    bool IsAnyKeyDownExcept(const KeyboardStateSnapshot& keys) const
+    {
+        return ((words[0] & ~keys.words[0]) | (words[1] & ~keys.words[1]) | (words[2] & ~keys.words[2]) | (words[3] & ~keys.words[3])) != 0;
+    }
+
+    // Function to set all the keys to key up
+    void Clear()
+    {
+        words = {};
+    }
+
+    inline bool operator==(const KeyboardStateSnapshot& snapshot) const
+    {
+        return words == snapshot.words;
+    }
+};
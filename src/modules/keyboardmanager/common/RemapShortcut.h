@@ -2,28 +2,33 @@
 #include "Shortcut.h"
 #include <variant>
 
-// This class stores all the variables associated with each shortcut remapping
+// This class stores the target of each shortcut remapping. The state of the remapping while it is being used is stored separately in ShortcutRemapState, so that the remap tables are not changed by the hook
 class RemapShortcut
 {
 public:
     KeyShortcutUnion targetShortcut;
-    bool isShortcutInvoked;
-    ModifierKey winKeyInvoked;
-    // This bool value is only required for remapping shortcuts to Disable
-    bool isOriginalActionKeyPressed;
 
     RemapShortcut(const KeyShortcutUnion& sc) :
-        targetShortcut(sc), isShortcutInvoked(false), winKeyInvoked(ModifierKey::Disabled), isOriginalActionKeyPressed(false)
+        targetShortcut(sc)
     {
     }
 
     RemapShortcut() :
-        targetShortcut(Shortcut()), isShortcutInvoked(false), winKeyInvoked(ModifierKey::Disabled), isOriginalActionKeyPressed(false)
+        targetShortcut(Shortcut())
     {
     }
 
     inline bool operator==(const RemapShortcut& sc) const
     {
-        return targetShortcut == sc.targetShortcut && isShortcutInvoked == sc.isShortcutInvoked && winKeyInvoked == sc.winKeyInvoked;
+        return targetShortcut == sc.targetShortcut;
     }
 };
+
+// This struct stores the state of a shortcut remapping, which is only changed by the hook
+struct ShortcutRemapState
+{
+    bool isShortcutInvoked = false;
+    ModifierKey winKeyInvoked = ModifierKey::Disabled;
+    // This bool value is only required for remapping shortcuts to Disable
+    bool isOriginalActionKeyPressed = false;
+};
@@ -0,0 +1,219 @@
+#include "pch.h"
+#include "RemapSnapshot.h"
+#include "KeyboardManagerConstants.h"
+#include "Helpers.h"
+#include <common/interop/shared_constants.h>
+
+// Constructor
+RemapSnapshot::RemapSnapshot() :
+    shortcutRemapStateCount(0)
+{
+}
+
+// Copy constructor. The lookups refer to the copied tables, so they are compiled again
+RemapSnapshot::RemapSnapshot(const RemapSnapshot& other) :
+    singleKeyReMap(other.singleKeyReMap), singleKeyReMapKeyEvents(other.singleKeyReMapKeyEvents), osLevelShortcutReMap(other.osLevelShortcutReMap), osLevelShortcutReMapSortedKeys(other.osLevelShortcutReMapSortedKeys), appSpecificShortcutReMap(other.appSpecificShortcutReMap), appSpecificShortcutReMapSortedKeys(other.appSpecificShortcutReMapSortedKeys), appSpecificShortcutReMapAppNames(other.appSpecificShortcutReMapAppNames), appSpecificShortcutReMapAppIds(other.appSpecificShortcutReMapAppIds), shortcutRemapStateCount(0)
+{
+    CompileShortcutRemapLookups();
+}
+
+// Function to clear the OS Level shortcut remapping table
+void RemapSnapshot::ClearOSLevelShortcuts()
+{
+    osLevelShortcutReMap.clear();
+    osLevelShortcutReMapSortedKeys.clear();
+    osLevelShortcutReMapLookup.Clear();
+}
+
+// Function to clear the Keys remapping table.
+void RemapSnapshot::ClearSingleKeyRemaps()
+{
+    singleKeyReMap.clear();
+    singleKeyReMapKeyEvents.clear();
+}
+
+// Function to clear the App specific shortcut remapping table
+void RemapSnapshot::ClearAppSpecificShortcuts()
+{
+    appSpecificShortcutReMap.clear();
+    appSpecificShortcutReMapSortedKeys.clear();
+    appSpecificShortcutReMapAppNames.clear();
+    appSpecificShortcutReMapAppIds.clear();
+    appSpecificShortcutReMapLookups.clear();
+}
+
+// Function to add a new OS level shortcut remapping
+bool RemapSnapshot::AddOSLevelShortcut(const Shortcut& originalSC, const KeyShortcutUnion& newSC)
+{
+    // Check if the shortcut is already remapped
+    auto it = osLevelShortcutReMap.find(originalSC);
+    if (it != osLevelShortcutReMap.end())
+    {
+        return false;
+    }
+
+    osLevelShortcutReMap[originalSC] = RemapShortcut(newSC);
+    osLevelShortcutReMapSortedKeys.push_back(originalSC);
+    KeyboardManagerHelper::SortShortcutVectorBasedOnSize(osLevelShortcutReMapSortedKeys);
+
+    return true;
+}
+
+// Function to add a new single key to key/shortcut remapping
+bool RemapSnapshot::AddSingleKeyRemap(const DWORD& originalKey, const KeyShortcutUnion& newRemapKey)
+{
+    // Check if the key is already remapped
+    auto it = singleKeyReMap.find(originalKey);
+    if (it != singleKeyReMap.end())
+    {
+        return false;
+    }
+
+    // Set the key events sent by the remap, so that they are not built on every key event. Only their key codes and flags are used, their scan codes are set by the hook when they are sent since they depend on the keyboard layout at that time. Remaps to VK_DISABLED do not send any key events
+    SingleKeyRemapKeyEvents keyEvents;
+    if (newRemapKey.index() == 0)
+    {
+        if (std::get<DWORD>(newRemapKey) != CommonSharedConstants::VK_DISABLED)
+        {
+            // Handle remaps to VK_WIN_BOTH
+            WORD target = (WORD)KeyboardManagerHelper::FilterArtificialKeys(std::get<DWORD>(newRemapKey));
+            keyEvents.keyDown.Reset(1);
+            KeyboardManagerHelper::SetKeyEvent(keyEvents.keyDown.Data(), 0, INPUT_KEYBOARD, target, 0, KeyboardManagerConstants::KEYBOARDMANAGER_SINGLEKEY_FLAG);
+            keyEvents.keyUp.Reset(1);
+            KeyboardManagerHelper::SetKeyEvent(keyEvents.keyUp.Data(), 0, INPUT_KEYBOARD, target, KEYEVENTF_KEYUP, KeyboardManagerConstants::KEYBOARDMANAGER_SINGLEKEY_FLAG);
+        }
+    }
+    else
+    {
+        const Shortcut& targetShortcut = std::get<Shortcut>(newRemapKey);
+
+        // The key events of a shortcut which is longer than a batch cannot be sent
+        if (!keyEvents.keyDown.Reset(targetShortcut.Size()) || !keyEvents.keyUp.Reset(targetShortcut.Size()))
+        {
+            return false;
+        }
+
+        // Dummy key is not required here since SetModifierKeyEvents will only add key-down events for the modifiers here, and the action key key-down is sent after it
+        int i = 0;
+        KeyboardManagerHelper::SetModifierKeyEvents(targetShortcut, ModifierKey::Disabled, keyEvents.keyDown.Data(), i, true, KeyboardManagerConstants::KEYBOARDMANAGER_SINGLEKEY_FLAG);
+        KeyboardManagerHelper::SetKeyEvent(keyEvents.keyDown.Data(), i, INPUT_KEYBOARD, (WORD)targetShortcut.GetActionKey(), 0, KeyboardManagerConstants::KEYBOARDMANAGER_SINGLEKEY_FLAG);
+
+        // Dummy key is not required here since SetModifierKeyEvents will only add key-up events for the modifiers here, and the action key key-up is sent before it
+        i = 0;
+        KeyboardManagerHelper::SetKeyEvent(keyEvents.keyUp.Data(), i, INPUT_KEYBOARD, (WORD)targetShortcut.GetActionKey(), KEYEVENTF_KEYUP, KeyboardManagerConstants::KEYBOARDMANAGER_SINGLEKEY_FLAG);
+        i++;
+        KeyboardManagerHelper::SetModifierKeyEvents(targetShortcut, ModifierKey::Disabled, keyEvents.keyUp.Data(), i, false, KeyboardManagerConstants::KEYBOARDMANAGER_SINGLEKEY_FLAG);
+    }
+
+    singleKeyReMap[originalKey] = newRemapKey;
+    singleKeyReMapKeyEvents[originalKey] = keyEvents;
+    return true;
+}
+
+// Function to add a new App specific shortcut remapping
+bool RemapSnapshot::AddAppSpecificShortcut(const std::wstring& app, const Shortcut& originalSC, const KeyShortcutUnion& newSC)
+{
+    // Convert app name to lower case
+    std::wstring process_name;
+    process_name.resize(app.length());
+    std::transform(app.begin(), app.end(), process_name.begin(), towlower);
+
+    // Check if there are any app specific shortcuts for this app
+    auto appIt = appSpecificShortcutReMap.find(process_name);
+    if (appIt != appSpecificShortcutReMap.end())
+    {
+        // Check if the shortcut is already remapped
+        auto shortcutIt = appSpecificShortcutReMap[process_name].find(originalSC);
+        if (shortcutIt != appSpecificShortcutReMap[process_name].end())
+        {
+            return false;
+        }
+    }
+    else
+    {
+        appSpecificShortcutReMapSortedKeys[process_name] = std::vector<Shortcut>();
+        appSpecificShortcutReMapAppIds[process_name] = static_cast<int>(appSpecificShortcutReMapAppNames.size());
+        appSpecificShortcutReMapAppNames.push_back(process_name);
+    }
+
+    appSpecificShortcutReMap[process_name][originalSC] = RemapShortcut(newSC);
+    appSpecificShortcutReMapSortedKeys[process_name].push_back(originalSC);
+    KeyboardManagerHelper::SortShortcutVectorBasedOnSize(appSpecificShortcutReMapSortedKeys[process_name]);
+    return true;
+}
+
+// Function to compile the lookups of the shortcut remaps and set the state indices of the remaps. This has to be called after the shortcut remaps are changed, before the snapshot is published
+void RemapSnapshot::CompileShortcutRemapLookups()
+{
+    osLevelShortcutReMapLookup.Compile(osLevelShortcutReMap, osLevelShortcutReMapSortedKeys);
+    shortcutRemapStateCount = osLevelShortcutReMapLookup.GetAll().size();
+
+    appSpecificShortcutReMapLookups.resize(appSpecificShortcutReMapAppNames.size());
+    for (size_t appId = 0; appId < appSpecificShortcutReMapAppNames.size(); appId++)
+    {
+        const std::wstring& appName = appSpecificShortcutReMapAppNames[appId];
+        ShortcutRemapLookup& lookup = appSpecificShortcutReMapLookups[appId];
+        lookup.Compile(appSpecificShortcutReMap[appName], appSpecificShortcutReMapSortedKeys[appName], shortcutRemapStateCount);
+        shortcutRemapStateCount += lookup.GetAll().size();
+    }
+}
+
+// Function to get the iterator of a single key remap given the source key. Returns nullopt if it isn't remapped
+std::optional<SingleKeyRemapTable::const_iterator> RemapSnapshot::GetSingleKeyRemap(const DWORD& originalKey) const
+{
+    auto it = singleKeyReMap.find(originalKey);
+    if (it != singleKeyReMap.end())
+    {
+        return it;
+    }
+
+    return std::nullopt;
+}
+
+// Function to get the key events sent by a single key remap given the source key
+const SingleKeyRemapKeyEvents& RemapSnapshot::GetSingleKeyRemapKeyEvents(const DWORD& originalKey) const
+{
+    // Assumes originalKey exists in the single key remap table
+    return singleKeyReMapKeyEvents.find(originalKey)->second;
+}
+
+// Function to get the lookup of the shortcut remaps which can apply to a key event given the app id, or NoActivatedAppId for the os level shortcut remaps
+const ShortcutRemapLookup& RemapSnapshot::GetShortcutRemapLookup(int appId) const
+{
+    return (appId == KeyboardManagerConstants::NoActivatedAppId) ? osLevelShortcutReMapLookup : appSpecificShortcutReMapLookups[appId];
+}
+
+// Function to get the lookup of the shortcut remaps given the app name, or nullopt for the os level shortcut remaps. Returns an empty lookup if the app has no app-specific shortcuts
+const ShortcutRemapLookup& RemapSnapshot::GetShortcutRemapLookup(const std::optional<std::wstring>& appName) const
+{
+    if (!appName)
+    {
+        return osLevelShortcutReMapLookup;
+    }
+
+    static const ShortcutRemapLookup noRemaps;
+    auto it = appSpecificShortcutReMapAppIds.find(*appName);
+    return (it != appSpecificShortcutReMapAppIds.end()) ? appSpecificShortcutReMapLookups[it->second] : noRemaps;
+}
+
+// Function to get the id of an app from its lower case process name, with or without the file extension. Returns UnmappedForegroundAppId if it has no app-specific shortcuts
+int RemapSnapshot::GetAppSpecificShortcutAppId(const std::wstring& processName) const
+{
+    auto it = appSpecificShortcutReMapAppIds.find(processName);
+
+    // If no entry is found, search for the process name without it's file extension
+    if (it == appSpecificShortcutReMapAppIds.end())
+    {
+        // Find index of the file extension
+        size_t extensionIndex = processName.find_last_of(L".");
+        it = appSpecificShortcutReMapAppIds.find(processName.substr(0, extensionIndex));
+    }
+
+    return (it != appSpecificShortcutReMapAppIds.end()) ? it->second : KeyboardManagerConstants::UnmappedForegroundAppId;
+}
+
+// Function to get the name of an app which has app-specific shortcuts from its id
+const std::wstring& RemapSnapshot::GetAppSpecificShortcutAppName(int appId) const
+{
+    return appSpecificShortcutReMapAppNames[appId];
+}
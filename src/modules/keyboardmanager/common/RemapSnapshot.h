@@ -0,0 +1,96 @@
+#pragma once
+#include <map>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+#include "Shortcut.h"
+#include "RemapShortcut.h"
+#include "ShortcutRemapLookup.h"
+#include "KeyEventBatch.h"
+
+using SingleKeyRemapTable = std::unordered_map<DWORD, KeyShortcutUnion>;
+using AppSpecificShortcutRemapTable = std::map<std::wstring, ShortcutRemapTable>;
+
+// Key events sent by a single key remap when the original key is pressed down and released
+struct SingleKeyRemapKeyEvents
+{
+    KeyEventBatch keyDown;
+    KeyEventBatch keyUp;
+};
+
+// Class to store the remap tables of all the features. A snapshot is built from a copy of the current one by the thread which loads the remaps, and is not changed once it is published to the hook. This allows the hook to keep remapping with the current snapshot while the next one is built.
+class RemapSnapshot
+{
+public:
+    // Stores single key remappings
+    SingleKeyRemapTable singleKeyReMap;
+
+    // Stores the key events sent by the single key remappings, which are set when the remaps are added except for their scan codes
+    std::unordered_map<DWORD, SingleKeyRemapKeyEvents> singleKeyReMapKeyEvents;
+
+    // Stores the os level shortcut remappings
+    ShortcutRemapTable osLevelShortcutReMap;
+    std::vector<Shortcut> osLevelShortcutReMapSortedKeys;
+    ShortcutRemapLookup osLevelShortcutReMapLookup;
+
+    // Stores the app-specific shortcut remappings. Maps application name to the shortcut map
+    AppSpecificShortcutRemapTable appSpecificShortcutReMap;
+    std::map<std::wstring, std::vector<Shortcut>> appSpecificShortcutReMapSortedKeys;
+
+    // Stores the names of the apps which have app-specific shortcuts. They are interned so that the foreground app can be stored as the index of its name
+    std::vector<std::wstring> appSpecificShortcutReMapAppNames;
+    std::unordered_map<std::wstring, int> appSpecificShortcutReMapAppIds;
+
+    // Stores the lookups of the app-specific shortcut remaps indexed by app id, so the hook doesn't look up the app by name on every key event
+    std::vector<ShortcutRemapLookup> appSpecificShortcutReMapLookups;
+
+    // Number of shortcut remaps in all the tables, which is the number of states the hook stores for them
+    size_t shortcutRemapStateCount;
+
+    // Constructor
+    RemapSnapshot();
+
+    // Copy constructor. The lookups refer to the copied tables, so they are compiled again
+    RemapSnapshot(const RemapSnapshot& other);
+
+    RemapSnapshot& operator=(const RemapSnapshot&) = delete;
+
+    // Function to clear the OS Level shortcut remapping table
+    void ClearOSLevelShortcuts();
+
+    // Function to clear the Keys remapping table
+    void ClearSingleKeyRemaps();
+
+    // Function to clear the App specific shortcut remapping table
+    void ClearAppSpecificShortcuts();
+
+    // Function to add a new single key to key remapping. Returns false if the key is already remapped or the target shortcut has more keys than can be sent together
+    bool AddSingleKeyRemap(const DWORD& originalKey, const KeyShortcutUnion& newRemapKey);
+
+    // Function to add a new OS level shortcut remapping
+    bool AddOSLevelShortcut(const Shortcut& originalSC, const KeyShortcutUnion& newSC);
+
+    // Function to add a new App specific level shortcut remapping
+    bool AddAppSpecificShortcut(const std::wstring& app, const Shortcut& originalSC, const KeyShortcutUnion& newSC);
+
+    // Function to compile the lookups of the shortcut remaps and set the state indices of the remaps. This has to be called after the shortcut remaps are changed, before the snapshot is published
+    void CompileShortcutRemapLookups();
+
+    // Function to get the iterator of a single key remap given the source key. Returns nullopt if it isn't remapped
+    std::optional<SingleKeyRemapTable::const_iterator> GetSingleKeyRemap(const DWORD& originalKey) const;
+
+    // Function to get the key events sent by a single key remap given the source key
+    const SingleKeyRemapKeyEvents& GetSingleKeyRemapKeyEvents(const DWORD& originalKey) const;
+
+    // Function to get the lookup of the shortcut remaps which can apply to a key event given the app id, or NoActivatedAppId for the os level shortcut remaps
+    const ShortcutRemapLookup& GetShortcutRemapLookup(int appId) const;
+
+    // Function to get the lookup of the shortcut remaps given the app name, or nullopt for the os level shortcut remaps. Returns an empty lookup if the app has no app-specific shortcuts
+    const ShortcutRemapLookup& GetShortcutRemapLookup(const std::optional<std::wstring>& appName) const;
+
+    // Function to get the id of an app from its lower case process name, with or without the file extension. Returns UnmappedForegroundAppId if it has no app-specific shortcuts
+    int GetAppSpecificShortcutAppId(const std::wstring& processName) const;
+
+    // Function to get the name of an app which has app-specific shortcuts from its id
+    const std::wstring& GetAppSpecificShortcutAppName(int appId) const;
+};
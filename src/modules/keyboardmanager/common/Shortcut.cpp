@@ -520,25 +520,27 @@ void Shortcut::SetKeyCodes(const std::vector<int32_t>& keys)
 // Function to check if all the modifiers in the shortcut have been pressed down
 bool Shortcut::CheckModifiersKeyboardState(InputInterface& ii) const
 {
+    const KeyboardStateSnapshot keyboardState = ii.GetKeyboardStateSnapshot();
+
     // Check the win key state
     if (winKey == ModifierKey::Both)
     {
         // Since VK_WIN does not exist, we check both VK_LWIN and VK_RWIN
-        if ((!(ii.GetVirtualKeyState(VK_LWIN))) && (!(ii.GetVirtualKeyState(VK_RWIN))))
+        if ((!(keyboardState.IsKeyDown(VK_LWIN))) && (!(keyboardState.IsKeyDown(VK_RWIN))))
         {
             return false;
         }
     }
     else if (winKey == ModifierKey::Left)
     {
-        if (!(ii.GetVirtualKeyState(VK_LWIN)))
+        if (!(keyboardState.IsKeyDown(VK_LWIN)))
         {
             return false;
         }
     }
     else if (winKey == ModifierKey::Right)
     {
-        if (!(ii.GetVirtualKeyState(VK_RWIN)))
+        if (!(keyboardState.IsKeyDown(VK_RWIN)))
         {
             return false;
         }
@@ -547,21 +549,21 @@ bool Shortcut::CheckModifiersKeyboardState(InputInterface& ii) const
     // Check the ctrl key state
     if (ctrlKey == ModifierKey::Left)
     {
-        if (!(ii.GetVirtualKeyState(VK_LCONTROL)))
+        if (!(keyboardState.IsKeyDown(VK_LCONTROL)))
         {
             return false;
         }
     }
     else if (ctrlKey == ModifierKey::Right)
     {
-        if (!(ii.GetVirtualKeyState(VK_RCONTROL)))
+        if (!(keyboardState.IsKeyDown(VK_RCONTROL)))
         {
             return false;
         }
     }
     else if (ctrlKey == ModifierKey::Both)
     {
-        if (!(ii.GetVirtualKeyState(VK_CONTROL)))
+        if (!(keyboardState.IsKeyDown(VK_CONTROL)))
         {
             return false;
         }
@@ -570,21 +572,21 @@ bool Shortcut::CheckModifiersKeyboardState(InputInterface& ii) const
     // Check the alt key state
     if (altKey == ModifierKey::Left)
     {
-        if (!(ii.GetVirtualKeyState(VK_LMENU)))
+        if (!(keyboardState.IsKeyDown(VK_LMENU)))
         {
             return false;
         }
     }
     else if (altKey == ModifierKey::Right)
     {
-        if (!(ii.GetVirtualKeyState(VK_RMENU)))
+        if (!(keyboardState.IsKeyDown(VK_RMENU)))
         {
             return false;
         }
     }
     else if (altKey == ModifierKey::Both)
     {
-        if (!(ii.GetVirtualKeyState(VK_MENU)))
+        if (!(keyboardState.IsKeyDown(VK_MENU)))
         {
             return false;
         }
@@ -593,21 +595,21 @@ bool Shortcut::CheckModifiersKeyboardState(InputInterface& ii) const
     // Check the shift key state
     if (shiftKey == ModifierKey::Left)
     {
-        if (!(ii.GetVirtualKeyState(VK_LSHIFT)))
+        if (!(keyboardState.IsKeyDown(VK_LSHIFT)))
         {
             return false;
         }
     }
     else if (shiftKey == ModifierKey::Right)
     {
-        if (!(ii.GetVirtualKeyState(VK_RSHIFT)))
+        if (!(keyboardState.IsKeyDown(VK_RSHIFT)))
         {
             return false;
         }
     }
     else if (shiftKey == ModifierKey::Both)
     {
-        if (!(ii.GetVirtualKeyState(VK_SHIFT)))
+        if (!(keyboardState.IsKeyDown(VK_SHIFT)))
         {
             return false;
         }
@@ -668,154 +670,48 @@ bool IgnoreKeyCode(DWORD key)
     }
 }
 
-// Function to check if any keys are pressed down except those in the shortcut
-bool Shortcut::IsKeyboardStateClearExceptShortcut(InputInterface& ii) const
+// Function to get the set of key codes which are ignored when checking if the keyboard state is clear
+const KeyboardStateSnapshot& GetIgnoredKeyCodes()
 {
-    // Iterate through all the virtual key codes - 0xFF is set to key down because of the Num Lock
-    for (int keyVal = 1; keyVal < 0xFF; keyVal++)
-    {
-        // Ignore problematic key codes
-        if (IgnoreKeyCode(keyVal))
-        {
-            continue;
-        }
-        // Check state of the key. If the key is pressed down but it is not part of the shortcut then the keyboard state is not clear
-        if (ii.GetVirtualKeyState(keyVal))
+    static const KeyboardStateSnapshot ignoredKeyCodes = [] {
+        KeyboardStateSnapshot keys;
+
+        // 0xFF is set to key down because of the Num Lock
+        keys.SetKeyState(0, true);
+        keys.SetKeyState(0xFF, true);
+        for (DWORD keyVal = 1; keyVal < 0xFF; keyVal++)
         {
-            // If one of the win keys is pressed check if it is part of the shortcut
-            if (keyVal == VK_LWIN)
-            {
-                if (winKey != ModifierKey::Left && winKey != ModifierKey::Both)
-                {
-                    return false;
-                }
-                else
-                {
-                    continue;
-                }
-            }
-            else if (keyVal == VK_RWIN)
-            {
-                if (winKey != ModifierKey::Right && winKey != ModifierKey::Both)
-                {
-                    return false;
-                }
-                else
-                {
-                    continue;
-                }
-            }
-            // If one of the ctrl keys is pressed check if it is part of the shortcut
-            else if (keyVal == VK_LCONTROL)
-            {
-                if (ctrlKey != ModifierKey::Left && ctrlKey != ModifierKey::Both)
-                {
-                    return false;
-                }
-                else
-                {
-                    continue;
-                }
-            }
-            else if (keyVal == VK_RCONTROL)
-            {
-                if (ctrlKey != ModifierKey::Right && ctrlKey != ModifierKey::Both)
-                {
-                    return false;
-                }
-                else
-                {
-                    continue;
-                }
-            }
-            else if (keyVal == VK_CONTROL)
-            {
-                if (ctrlKey == ModifierKey::Disabled)
-                {
-                    return false;
-                }
-                else
-                {
-                    continue;
-                }
-            }
-            // If one of the alt keys is pressed check if it is part of the shortcut
-            else if (keyVal == VK_LMENU)
-            {
-                if (altKey != ModifierKey::Left && altKey != ModifierKey::Both)
-                {
-                    return false;
-                }
-                else
-                {
-                    continue;
-                }
-            }
-            else if (keyVal == VK_RMENU)
-            {
-                if (altKey != ModifierKey::Right && altKey != ModifierKey::Both)
-                {
-                    return false;
-                }
-                else
-                {
-                    continue;
-                }
-            }
-            else if (keyVal == VK_MENU)
-            {
-                if (altKey == ModifierKey::Disabled)
-                {
-                    return false;
-                }
-                else
-                {
-                    continue;
-                }
-            }
-            // If one of the shift keys is pressed check if it is part of the shortcut
-            else if (keyVal == VK_LSHIFT)
-            {
-                if (shiftKey != ModifierKey::Left && shiftKey != ModifierKey::Both)
-                {
-                    return false;
-                }
-                else
-                {
-                    continue;
-                }
-            }
-            else if (keyVal == VK_RSHIFT)
-            {
-                if (shiftKey != ModifierKey::Right && shiftKey != ModifierKey::Both)
-                {
-                    return false;
-                }
-                else
-                {
-                    continue;
-                }
-            }
-            else if (keyVal == VK_SHIFT)
-            {
-                if (shiftKey == ModifierKey::Disabled)
-                {
-                    return false;
-                }
-                else
-                {
-                    continue;
-                }
-            }
-            // If any other key is pressed check if it is the action key
-            else if (keyVal != actionKey)
-            {
-                return false;
-            }
+            keys.SetKeyState(keyVal, IgnoreKeyCode(keyVal));
         }
-    }
+        return keys;
+    }();
 
-    return true;
+    return ignoredKeyCodes;
+}
+
+// Function to check if any keys are pressed down except those in the shortcut
+bool Shortcut::IsKeyboardStateClearExceptShortcut(InputInterface& ii) const
+{
+    KeyboardStateSnapshot allowedKeys = GetIgnoredKeyCodes();
+
+    // The action key is allowed to be pressed down
+    allowedKeys.SetKeyState(actionKey, true);
+
+    // The left and right modifier keys are allowed if they are part of the shortcut, and the common modifier keys if any of them is part of the shortcut
+    allowedKeys.SetKeyState(VK_LWIN, winKey == ModifierKey::Left || winKey == ModifierKey::Both);
+    allowedKeys.SetKeyState(VK_RWIN, winKey == ModifierKey::Right || winKey == ModifierKey::Both);
+    allowedKeys.SetKeyState(VK_LCONTROL, ctrlKey == ModifierKey::Left || ctrlKey == ModifierKey::Both);
+    allowedKeys.SetKeyState(VK_RCONTROL, ctrlKey == ModifierKey::Right || ctrlKey == ModifierKey::Both);
+    allowedKeys.SetKeyState(VK_CONTROL, ctrlKey != ModifierKey::Disabled);
+    allowedKeys.SetKeyState(VK_LMENU, altKey == ModifierKey::Left || altKey == ModifierKey::Both);
+    allowedKeys.SetKeyState(VK_RMENU, altKey == ModifierKey::Right || altKey == ModifierKey::Both);
+    allowedKeys.SetKeyState(VK_MENU, altKey != ModifierKey::Disabled);
+    allowedKeys.SetKeyState(VK_LSHIFT, shiftKey == ModifierKey::Left || shiftKey == ModifierKey::Both);
+    allowedKeys.SetKeyState(VK_RSHIFT, shiftKey == ModifierKey::Right || shiftKey == ModifierKey::Both);
+    allowedKeys.SetKeyState(VK_SHIFT, shiftKey != ModifierKey::Disabled);
+
+    // If a key is pressed down but it is not allowed then the keyboard state is not clear
+    return !ii.GetKeyboardStateSnapshot().IsAnyKeyDownExcept(allowedKeys);
 }
 
 // Function to get the number of modifiers that are common between the current shortcut and the shortcut in the argument
@@ -0,0 +1,106 @@
+#include "pch.h"
+#include "ShortcutRemapLookup.h"
+#include "InputInterface.h"
+#include <common/interop/shared_constants.h>
+
+namespace
+{
+    // Function to get the modifier state bits which CheckModifiersKeyboardState reads for a modifier key code of the shortcut
+    uint16_t GetModifierMask(DWORD key)
+    {
+        switch (key)
+        {
+        case VK_LWIN:
+            return ShortcutRemapLookup::LeftWin;
+        case VK_RWIN:
+            return ShortcutRemapLookup::RightWin;
+        case CommonSharedConstants::VK_WIN_BOTH:
+            return ShortcutRemapLookup::LeftWin | ShortcutRemapLookup::RightWin;
+        case VK_LCONTROL:
+            return ShortcutRemapLookup::LeftCtrl;
+        case VK_RCONTROL:
+            return ShortcutRemapLookup::RightCtrl;
+        case VK_CONTROL:
+            return ShortcutRemapLookup::Ctrl;
+        case VK_LMENU:
+            return ShortcutRemapLookup::LeftAlt;
+        case VK_RMENU:
+            return ShortcutRemapLookup::RightAlt;
+        case VK_MENU:
+            return ShortcutRemapLookup::Alt;
+        case VK_LSHIFT:
+            return ShortcutRemapLookup::LeftShift;
+        case VK_RSHIFT:
+            return ShortcutRemapLookup::RightShift;
+        case VK_SHIFT:
+            return ShortcutRemapLookup::Shift;
+        default:
+            return 0;
+        }
+    }
+}
+
+// Function to check if all the modifiers in the shortcut are pressed down in the modifier state. Same as Shortcut::CheckModifiersKeyboardState.
+bool ShortcutRemapLookup::Candidate::CheckModifiers(uint16_t modifierState) const
+{
+    return (winMask == 0 || (modifierState & winMask)) &&
+           (ctrlMask == 0 || (modifierState & ctrlMask)) &&
+           (altMask == 0 || (modifierState & altMask)) &&
+           (shiftMask == 0 || (modifierState & shiftMask));
+}
+
+// Function to compile the lookup from the remap table and the keys sorted in the order the remaps are to be applied. The state indices of the remaps start from firstStateIndex
+void ShortcutRemapLookup::Compile(const ShortcutRemapTable& table, const std::vector<Shortcut>& sortedKeys, size_t firstStateIndex)
+{
+    Clear();
+    all.reserve(sortedKeys.size());
+    for (const auto& shortcut : sortedKeys)
+    {
+        auto it = table.find(shortcut);
+        if (it == table.end())
+        {
+            continue;
+        }
+
+        // Both win keys are returned as VK_WIN_BOTH when the argument is Both
+        Candidate candidate{ it, firstStateIndex + all.size(), GetModifierMask(shortcut.GetWinKey(ModifierKey::Both)), GetModifierMask(shortcut.GetCtrlKey()), GetModifierMask(shortcut.GetAltKey()), GetModifierMask(shortcut.GetShiftKey()) };
+        all.push_back(candidate);
+        byActionKey[shortcut.GetActionKey()].push_back(candidate);
+    }
+}
+
+// Function to clear the lookup
+void ShortcutRemapLookup::Clear()
+{
+    all.clear();
+    byActionKey.clear();
+}
+
+// Function to return all the remaps in the order they are to be applied
+const std::vector<ShortcutRemapLookup::Candidate>& ShortcutRemapLookup::GetAll() const
+{
+    return all;
+}
+
+// Function to return the remaps with the given action key in the order they are to be applied
+const std::vector<ShortcutRemapLookup::Candidate>& ShortcutRemapLookup::GetByActionKey(DWORD actionKey) const
+{
+    static const std::vector<Candidate> none;
+    auto it = byActionKey.find(actionKey);
+    return it != byActionKey.end() ? it->second : none;
+}
+
+// Function to read the state of all the modifier keys at once
+uint16_t ShortcutRemapLookup::GetModifierState(InputInterface& ii)
+{
+    const KeyboardStateSnapshot keyboardState = ii.GetKeyboardStateSnapshot();
+    uint16_t state = 0;
+    for (DWORD key : { VK_LWIN, VK_RWIN, VK_LCONTROL, VK_RCONTROL, VK_CONTROL, VK_LMENU, VK_RMENU, VK_MENU, VK_LSHIFT, VK_RSHIFT, VK_SHIFT })
+    {
+        if (keyboardState.IsKeyDown(key))
+        {
+            state |= GetModifierMask(key);
+        }
+    }
+    return state;
+}
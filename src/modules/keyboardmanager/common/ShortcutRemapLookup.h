@@ -0,0 +1,65 @@
+#pragma once
+#include "Shortcut.h"
+#include "RemapShortcut.h"
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+class InputInterface;
+
+using ShortcutRemapTable = std::map<Shortcut, RemapShortcut>;
+
+// Class to look up the shortcut remaps which can apply to a key event, compiled from a shortcut remap table and its sorted keys whenever they change. This avoids searching the table and reading the keyboard state for every remap on every key event.
+class ShortcutRemapLookup
+{
+public:
+    // Bits of the modifier keys which are pressed down. The generic keys are separate bits since their state is read separately.
+    enum ModifierState : uint16_t
+    {
+        LeftWin = 1 << 0,
+        RightWin = 1 << 1,
+        LeftCtrl = 1 << 2,
+        RightCtrl = 1 << 3,
+        Ctrl = 1 << 4,
+        LeftAlt = 1 << 5,
+        RightAlt = 1 << 6,
+        Alt = 1 << 7,
+        LeftShift = 1 << 8,
+        RightShift = 1 << 9,
+        Shift = 1 << 10
+    };
+
+    struct Candidate
+    {
+        ShortcutRemapTable::const_iterator remap;
+        // Index of the state of the remap among the states of all the shortcut remaps in the remap snapshot
+        size_t stateIndex;
+        // For each modifier of the shortcut, at least one of the bits has to be set for the modifier to be pressed. Modifiers which are not part of the shortcut have no bits.
+        uint16_t winMask;
+        uint16_t ctrlMask;
+        uint16_t altMask;
+        uint16_t shiftMask;
+
+        // Function to check if all the modifiers in the shortcut are pressed down in the modifier state. Same as Shortcut::CheckModifiersKeyboardState.
+        bool CheckModifiers(uint16_t modifierState) const;
+    };
+
+    // Function to compile the lookup from the remap table and the keys sorted in the order the remaps are to be applied. The state indices of the remaps start from firstStateIndex
+    void Compile(const ShortcutRemapTable& table, const std::vector<Shortcut>& sortedKeys, size_t firstStateIndex = 0);
+
+    // Function to clear the lookup
+    void Clear();
+
+    // Function to return all the remaps in the order they are to be applied
+    const std::vector<Candidate>& GetAll() const;
+
+    // Function to return the remaps with the given action key in the order they are to be applied
+    const std::vector<Candidate>& GetByActionKey(DWORD actionKey) const;
+
+    // Function to read the state of all the modifier keys at once
+    static uint16_t GetModifierState(InputInterface& ii);
+
+private:
+    std::vector<Candidate> all;
+    std::unordered_map<DWORD, std::vector<Candidate>> byActionKey;
+};
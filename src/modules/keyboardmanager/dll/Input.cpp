@@ -1,6 +1,7 @@
 #include "pch.h"
 #include "Input.h"
 #include <keyboardmanager/common/Helpers.h>
+#include <keyboardmanager/common/KeyboardManagerConstants.h>
 
 // Function to simulate input
 UINT Input::SendVirtualInput(UINT cInputs, LPINPUT pInputs, int cbSize)
@@ -14,8 +15,86 @@ bool Input::GetVirtualKeyState(int key)
     return (GetAsyncKeyState(key) & 0x8000);
 }
 
+// Function to get the state of all the keys at once
+KeyboardStateSnapshot Input::GetKeyboardStateSnapshot()
+{
+    // Read all the key states only if the tracked states may be out of date. Key events are not seen by the hook while it is blocked or on the secure desktop, so this is also done after a pause
+    const ULONGLONG currentTime = GetTickCount64();
+    if (!isKeyboardStateSynced || currentTime - lastKeyEventTime > KeyboardManagerConstants::KeyboardStateResyncInterval)
+    {
+        for (int key = 1; key <= 0xFF; key++)
+        {
+            keyboardState.SetKeyState(key, GetVirtualKeyState(key));
+        }
+        isKeyboardStateSynced = true;
+        lastKeyEventTime = currentTime;
+    }
+
+    return keyboardState;
+}
+
+// Function to update the tracked key states with a key event which is not suppressed by the hook
+void Input::UpdateKeyboardState(const LowlevelKeyboardEvent* data)
+{
+    // If there was a pause the tracked states may have missed some key events, so they are read again on the next query
+    const ULONGLONG currentTime = GetTickCount64();
+    if (currentTime - lastKeyEventTime > KeyboardManagerConstants::KeyboardStateResyncInterval)
+    {
+        isKeyboardStateSynced = false;
+    }
+    lastKeyEventTime = currentTime;
+
+    if (!isKeyboardStateSynced)
+    {
+        return;
+    }
+
+    const bool isDown = (data->wParam == WM_KEYDOWN || data->wParam == WM_SYSKEYDOWN);
+    DWORD key = data->lParam->vkCode;
+
+    // Key events sent with the common modifier key codes change the state of the left keys
+    switch (key)
+    {
+    case VK_CONTROL:
+        key = VK_LCONTROL;
+        break;
+    case VK_MENU:
+        key = VK_LMENU;
+        break;
+    case VK_SHIFT:
+        key = VK_LSHIFT;
+        break;
+    }
+    keyboardState.SetKeyState(key, isDown);
+
+    // The common modifier key codes are pressed down while either of the left or right keys is pressed down
+    keyboardState.SetKeyState(VK_CONTROL, keyboardState.IsKeyDown(VK_LCONTROL) || keyboardState.IsKeyDown(VK_RCONTROL));
+    keyboardState.SetKeyState(VK_MENU, keyboardState.IsKeyDown(VK_LMENU) || keyboardState.IsKeyDown(VK_RMENU));
+    keyboardState.SetKeyState(VK_SHIFT, keyboardState.IsKeyDown(VK_LSHIFT) || keyboardState.IsKeyDown(VK_RSHIFT));
+}
+
 // Function to get the foreground process name
 void Input::GetForegroundProcess(_Out_ std::wstring& foregroundProcess)
 {
     foregroundProcess = KeyboardManagerHelper::GetCurrentApplication(false);
 }
+
+// Function to get the number of times the foreground window has changed, so that the foreground process is only read again after it changes
+uint64_t Input::GetForegroundChangeCount()
+{
+    // If the changes are not reported, every query is treated as a change
+    return isForegroundChangeTracked ? foregroundChangeCount.load() : ++foregroundChangeCount;
+}
+
+// Function to set whether the foreground window changes are reported with OnForegroundChanged
+void Input::SetForegroundChangeTracked(bool isTracked)
+{
+    isForegroundChangeTracked = isTracked;
+    OnForegroundChanged();
+}
+
+// Function to be called when the foreground window changes
+void Input::OnForegroundChanged()
+{
+    foregroundChangeCount++;
+}
@@ -1,10 +1,28 @@
 #pragma once
 #include <keyboardmanager/common/InputInterface.h>
+#include <common/hooks/LowlevelKeyboardEvent.h>
+#include <atomic>
 
 // Class used to wrap keyboard input library methods
 class Input :
     public InputInterface
 {
+private:
+    // Stores the states of the keys, tracked from the key events which are not suppressed by the hook
+    KeyboardStateSnapshot keyboardState;
+
+    // Set to false when the tracked states may have missed some key events, so that they are read again on the next query
+    bool isKeyboardStateSynced = false;
+
+    // Tick count of the last key event seen by the hook or of the last time all the key states were read
+    ULONGLONG lastKeyEventTime = 0;
+
+    // Incremented whenever the foreground window changes
+    std::atomic<uint64_t> foregroundChangeCount = 0;
+
+    // Set to true while foreground window changes are reported with OnForegroundChanged. Otherwise the foreground process is read on every query
+    bool isForegroundChangeTracked = false;
+
 public:
     // Function to simulate input
     UINT SendVirtualInput(UINT cInputs, LPINPUT pInputs, int cbSize);
@@ -12,6 +30,21 @@ public:
     // Function to get the state of a particular key
     bool GetVirtualKeyState(int key);
 
+    // Function to get the state of all the keys at once
+    KeyboardStateSnapshot GetKeyboardStateSnapshot();
+
+    // Function to update the tracked key states with a key event which is not suppressed by the hook
+    void UpdateKeyboardState(const LowlevelKeyboardEvent* data);
+
     // Function to get the foreground process name
     void GetForegroundProcess(_Out_ std::wstring& foregroundProcess);
+
+    // Function to get the number of times the foreground window has changed, so that the foreground process is only read again after it changes
+    uint64_t GetForegroundChangeCount();
+
+    // Function to set whether the foreground window changes are reported with OnForegroundChanged
+    void SetForegroundChangeTracked(bool isTracked);
+
+    // Function to be called when the foreground window changes
+    void OnForegroundChanged();
 };
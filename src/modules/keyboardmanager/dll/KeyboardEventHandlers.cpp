@@ -4,6 +4,7 @@
 #include "keyboardmanager/common/RemapShortcut.h"
 #include <common/interop/shared_constants.h>
 #include <keyboardmanager/common/KeyboardManagerState.h>
+#include <keyboardmanager/common/KeyEventBatch.h>
 #include <keyboardmanager/common/InputInterface.h>
 #include <keyboardmanager/common/Helpers.h>
 #include <keyboardmanager/common/trace.h>
@@ -16,7 +17,8 @@ namespace KeyboardEventHandlers
         // Check if the key event was generated by KeyboardManager to avoid remapping events generated by us.
         if (!(data->lParam->dwExtraInfo & CommonSharedConstants::KEYBOARDMANAGER_INJECTED_FLAG))
         {
-            const auto remapping = keyboardManagerState.GetSingleKeyRemap(data->lParam->vkCode);
+            const auto remapSnapshot = keyboardManagerState.AcquireRemapSnapshot();
+            const auto remapping = remapSnapshot->GetSingleKeyRemap(data->lParam->vkCode);
             if (remapping)
             {
                 auto it = remapping.value();
@@ -33,18 +35,6 @@ namespace KeyboardEventHandlers
                     }
                 }
 
-                int key_count;
-                if (remapToKey)
-                {
-                    key_count = 1;
-                }
-                else
-                {
-                    key_count = std::get<Shortcut>(it->second).Size();
-                }
-                LPINPUT keyEventList = new INPUT[size_t(key_count)]();
-                memset(keyEventList, 0, sizeof(keyEventList));
-
                 // Handle remaps to VK_WIN_BOTH
                 DWORD target;
                 if (remapToKey)
@@ -62,39 +52,11 @@ namespace KeyboardEventHandlers
                     ResetIfModifierKeyForLowerLevelKeyHandlers(ii, it->first, target);
                 }
 
-                if (remapToKey)
-                {
-                    if (data->wParam == WM_KEYUP || data->wParam == WM_SYSKEYUP)
-                    {
-                        KeyboardManagerHelper::SetKeyEvent(keyEventList, 0, INPUT_KEYBOARD, (WORD)target, KEYEVENTF_KEYUP, KeyboardManagerConstants::KEYBOARDMANAGER_SINGLEKEY_FLAG);
-                    }
-                    else
-                    {
-                        KeyboardManagerHelper::SetKeyEvent(keyEventList, 0, INPUT_KEYBOARD, (WORD)target, 0, KeyboardManagerConstants::KEYBOARDMANAGER_SINGLEKEY_FLAG);
-                    }
-                }
-                else
-                {
-                    int i = 0;
-                    Shortcut targetShortcut = std::get<Shortcut>(it->second);
-                    if (data->wParam == WM_KEYUP || data->wParam == WM_SYSKEYUP)
-                    {
-                        KeyboardManagerHelper::SetKeyEvent(keyEventList, i, INPUT_KEYBOARD, (WORD)targetShortcut.GetActionKey(), KEYEVENTF_KEYUP, KeyboardManagerConstants::KEYBOARDMANAGER_SINGLEKEY_FLAG);
-                        i++;
-                        KeyboardManagerHelper::SetModifierKeyEvents(targetShortcut, ModifierKey::Disabled, keyEventList, i, false, KeyboardManagerConstants::KEYBOARDMANAGER_SINGLEKEY_FLAG);
-                        // Dummy key is not required here since SetModifierKeyEvents will only add key-up events for the modifiers here, and the action key key-up is already sent before it
-                    }
-                    else
-                    {
-                        // Dummy key is not required here since SetModifierKeyEvents will only add key-down events for the modifiers here, and the action key key-down is already sent after it
-                        KeyboardManagerHelper::SetModifierKeyEvents(targetShortcut, ModifierKey::Disabled, keyEventList, i, true, KeyboardManagerConstants::KEYBOARDMANAGER_SINGLEKEY_FLAG);
-                        KeyboardManagerHelper::SetKeyEvent(keyEventList, i, INPUT_KEYBOARD, (WORD)targetShortcut.GetActionKey(), 0, KeyboardManagerConstants::KEYBOARDMANAGER_SINGLEKEY_FLAG);
-                        i++;
-                    }
-                }
-
-                UINT res = ii.SendVirtualInput(key_count, keyEventList, sizeof(INPUT));
-                delete[] keyEventList;
+                // Send the key events which were set when the remap was added, with the scan codes of the current keyboard layout
+                const SingleKeyRemapKeyEvents& keyEvents = remapSnapshot->GetSingleKeyRemapKeyEvents(it->first);
+                KeyEventBatch keyEventList = (data->wParam == WM_KEYUP || data->wParam == WM_SYSKEYUP) ? keyEvents.keyUp : keyEvents.keyDown;
+                keyEventList.SetScanCodes();
+                UINT res = ii.SendVirtualInput((UINT)keyEventList.Size(), keyEventList.Data(), sizeof(INPUT));
 
                 if (data->wParam == WM_KEYDOWN || data->wParam == WM_SYSKEYDOWN)
                 {
@@ -150,14 +112,13 @@ namespace KeyboardEventHandlers
                     }
                 }
                 int key_count = 2;
-                LPINPUT keyEventList = new INPUT[size_t(key_count)]();
-                memset(keyEventList, 0, sizeof(keyEventList));
-                KeyboardManagerHelper::SetKeyEvent(keyEventList, 0, INPUT_KEYBOARD, (WORD)data->lParam->vkCode, 0, KeyboardManagerConstants::KEYBOARDMANAGER_SINGLEKEY_FLAG);
-                KeyboardManagerHelper::SetKeyEvent(keyEventList, 1, INPUT_KEYBOARD, (WORD)data->lParam->vkCode, KEYEVENTF_KEYUP, KeyboardManagerConstants::KEYBOARDMANAGER_SINGLEKEY_FLAG);
+                KeyEventBatch keyEventList;
+                keyEventList.Reset(key_count);
+                KeyboardManagerHelper::SetKeyEvent(keyEventList.Data(), 0, INPUT_KEYBOARD, (WORD)data->lParam->vkCode, 0, KeyboardManagerConstants::KEYBOARDMANAGER_SINGLEKEY_FLAG);
+                KeyboardManagerHelper::SetKeyEvent(keyEventList.Data(), 1, INPUT_KEYBOARD, (WORD)data->lParam->vkCode, KEYEVENTF_KEYUP, KeyboardManagerConstants::KEYBOARDMANAGER_SINGLEKEY_FLAG);
 
                 lock.unlock();
-                UINT res = ii.SendVirtualInput(key_count, keyEventList, sizeof(INPUT));
-                delete[] keyEventList;
+                UINT res = ii.SendVirtualInput(key_count, keyEventList.Data(), sizeof(INPUT));
 
                 // Reset the long press flag when the key has been lifted.
                 if (data->wParam == WM_KEYUP || data->wParam == WM_SYSKEYUP)
@@ -175,22 +136,34 @@ namespace KeyboardEventHandlers
     }
     */
 
-    // Function to a handle a shortcut remap
-    __declspec(dllexport) intptr_t HandleShortcutRemapEvent(InputInterface& ii, LowlevelKeyboardEvent* data, KeyboardManagerState& keyboardManagerState, const std::optional<std::wstring>& activatedApp) noexcept
+    // Function to a handle a shortcut remap. The app-specific shortcut remaps of activatedAppId are used, or the os level shortcut remaps for NoActivatedAppId
+    __declspec(dllexport) intptr_t HandleShortcutRemapEvent(InputInterface& ii, LowlevelKeyboardEvent* data, KeyboardManagerState& keyboardManagerState, int activatedAppId) noexcept
     {
+        // Get the remap snapshot, which is kept for the whole key event even if the remaps are changed in the meantime
+        const auto remapSnapshot = keyboardManagerState.AcquireRemapSnapshot();
+
         // Check if any shortcut is currently in the invoked state
-        bool isShortcutInvoked = keyboardManagerState.CheckShortcutRemapInvoked(activatedApp);
+        bool isShortcutInvoked = keyboardManagerState.CheckShortcutRemapInvoked(*remapSnapshot, activatedAppId);
 
-        // Get shortcut table for given activatedApp
-        ShortcutRemapTable& reMap = keyboardManagerState.GetShortcutRemapTable(activatedApp);
+        // Get shortcut remaps lookup for given activatedAppId
+        const ShortcutRemapLookup& lookup = remapSnapshot->GetShortcutRemapLookup(activatedAppId);
+
+        // If no shortcut is invoked, a remap can only be applied by pressing its action key, so only the remaps with this action key have to be checked
+        const bool isKeyDown = (data->wParam == WM_KEYDOWN || data->wParam == WM_SYSKEYDOWN);
+        static const std::vector<ShortcutRemapLookup::Candidate> noCandidates;
+        const auto& candidates = isShortcutInvoked ? lookup.GetAll() : (isKeyDown ? lookup.GetByActionKey(data->lParam->vkCode) : noCandidates);
+
+        // Read the modifier state once for all the candidates. It is only used before any input is sent
+        const uint16_t modifierState = (!isShortcutInvoked && !candidates.empty()) ? ShortcutRemapLookup::GetModifierState(ii) : 0;
 
         // Iterate through the shortcut remaps and apply whichever has been pressed
-        for (auto& itShortcut : keyboardManagerState.GetSortedShortcutRemapVector(activatedApp))
+        for (const auto& candidate : candidates)
         {
-            const auto it = reMap.find(itShortcut);
+            const auto it = candidate.remap;
+            ShortcutRemapState& remapState = keyboardManagerState.GetShortcutRemapState(candidate);
 
             // If a shortcut is currently in the invoked state then skip till the shortcut that is currently invoked
-            if (isShortcutInvoked && !it->second.isShortcutInvoked)
+            if (isShortcutInvoked && !remapState.isShortcutInvoked)
             {
                 continue;
             }
@@ -201,7 +174,7 @@ namespace KeyboardEventHandlers
             const size_t dest_size = remapToShortcut ? std::get<Shortcut>(it->second.targetShortcut).Size() : 1;
 
             // If the shortcut has been pressed down
-            if (!it->second.isShortcutInvoked && it->first.CheckModifiersKeyboardState(ii))
+            if (!remapState.isShortcutInvoked && candidate.CheckModifiers(modifierState))
             {
                 if (data->lParam->vkCode == it->first.GetActionKey() && (data->wParam == WM_KEYDOWN || data->wParam == WM_SYSKEYDOWN))
                 {
@@ -212,16 +185,16 @@ namespace KeyboardEventHandlers
                     }
 
                     size_t key_count;
-                    LPINPUT keyEventList;
+                    KeyEventBatch keyEventList;
 
                     // Remember which win key was pressed initially
                     if (ii.GetVirtualKeyState(VK_RWIN))
                     {
-                        it->second.winKeyInvoked = ModifierKey::Right;
+                        remapState.winKeyInvoked = ModifierKey::Right;
                     }
                     else if (ii.GetVirtualKeyState(VK_LWIN))
                     {
-                        it->second.winKeyInvoked = ModifierKey::Left;
+                        remapState.winKeyInvoked = ModifierKey::Left;
                     }
 
                     if (remapToShortcut)
@@ -234,30 +207,34 @@ namespace KeyboardEventHandlers
                         {
                             // key down for all new shortcut keys except the common modifiers
                             key_count = dest_size - commonKeys;
-                            keyEventList = new INPUT[key_count]();
-                            memset(keyEventList, 0, sizeof(keyEventList));
+                            if (!keyEventList.Reset(key_count))
+                            {
+                                return 0;
+                            }
                             int i = 0;
-                            KeyboardManagerHelper::SetModifierKeyEvents(std::get<Shortcut>(it->second.targetShortcut), it->second.winKeyInvoked, keyEventList, i, true, KeyboardManagerConstants::KEYBOARDMANAGER_SHORTCUT_FLAG, it->first);
-                            KeyboardManagerHelper::SetKeyEvent(keyEventList, i, INPUT_KEYBOARD, (WORD)std::get<Shortcut>(it->second.targetShortcut).GetActionKey(), 0, KeyboardManagerConstants::KEYBOARDMANAGER_SHORTCUT_FLAG);
+                            KeyboardManagerHelper::SetModifierKeyEvents(std::get<Shortcut>(it->second.targetShortcut), remapState.winKeyInvoked, keyEventList.Data(), i, true, KeyboardManagerConstants::KEYBOARDMANAGER_SHORTCUT_FLAG, it->first);
+                            KeyboardManagerHelper::SetKeyEvent(keyEventList.Data(), i, INPUT_KEYBOARD, (WORD)std::get<Shortcut>(it->second.targetShortcut).GetActionKey(), 0, KeyboardManagerConstants::KEYBOARDMANAGER_SHORTCUT_FLAG);
                             i++;
                         }
                         else
                         {
                             // Dummy key, key up for all the original shortcut modifier keys and key down for all the new shortcut keys but common keys in each are not repeated
                             key_count = KeyboardManagerConstants::DUMMY_KEY_EVENT_SIZE + (src_size - 1) + (dest_size) - (2 * (size_t)commonKeys);
-                            keyEventList = new INPUT[key_count]();
-                            memset(keyEventList, 0, sizeof(keyEventList));
+                            if (!keyEventList.Reset(key_count))
+                            {
+                                return 0;
+                            }
 
                             // Send a dummy key event to prevent modifier press+release from being triggered. Example: Win+A->Ctrl+V, press Win+A, since Win will be released here we need to send a dummy event before it
                             int i = 0;
-                            KeyboardManagerHelper::SetDummyKeyEvent(keyEventList, i, KeyboardManagerConstants::KEYBOARDMANAGER_SHORTCUT_FLAG);
+                            KeyboardManagerHelper::SetDummyKeyEvent(keyEventList.Data(), i, KeyboardManagerConstants::KEYBOARDMANAGER_SHORTCUT_FLAG);
 
                             // Release original shortcut state (release in reverse order of shortcut to be accurate)
-                            KeyboardManagerHelper::SetModifierKeyEvents(it->first, it->second.winKeyInvoked, keyEventList, i, false, KeyboardManagerConstants::KEYBOARDMANAGER_SHORTCUT_FLAG, std::get<Shortcut>(it->second.targetShortcut));
+                            KeyboardManagerHelper::SetModifierKeyEvents(it->first, remapState.winKeyInvoked, keyEventList.Data(), i, false, KeyboardManagerConstants::KEYBOARDMANAGER_SHORTCUT_FLAG, std::get<Shortcut>(it->second.targetShortcut));
 
                             // Set new shortcut key down state
-                            KeyboardManagerHelper::SetModifierKeyEvents(std::get<Shortcut>(it->second.targetShortcut), it->second.winKeyInvoked, keyEventList, i, true, KeyboardManagerConstants::KEYBOARDMANAGER_SHORTCUT_FLAG, it->first);
-                            KeyboardManagerHelper::SetKeyEvent(keyEventList, i, INPUT_KEYBOARD, (WORD)std::get<Shortcut>(it->second.targetShortcut).GetActionKey(), 0, KeyboardManagerConstants::KEYBOARDMANAGER_SHORTCUT_FLAG);
+                            KeyboardManagerHelper::SetModifierKeyEvents(std::get<Shortcut>(it->second.targetShortcut), remapState.winKeyInvoked, keyEventList.Data(), i, true, KeyboardManagerConstants::KEYBOARDMANAGER_SHORTCUT_FLAG, it->first);
+                            KeyboardManagerHelper::SetKeyEvent(keyEventList.Data(), i, INPUT_KEYBOARD, (WORD)std::get<Shortcut>(it->second.targetShortcut).GetActionKey(), 0, KeyboardManagerConstants::KEYBOARDMANAGER_SHORTCUT_FLAG);
                             i++;
                         }
 
@@ -280,23 +257,25 @@ namespace KeyboardEventHandlers
                         {
                             key_count--;
                             // Since the original shortcut's action key is pressed, set it to true
-                            it->second.isOriginalActionKeyPressed = true;
+                            remapState.isOriginalActionKeyPressed = true;
                         }
 
-                        keyEventList = new INPUT[key_count]();
-                        memset(keyEventList, 0, sizeof(keyEventList));
+                        if (!keyEventList.Reset(key_count))
+                        {
+                            return 0;
+                        }
 
                         // Send a dummy key event to prevent modifier press+release from being triggered. Example: Win+A->V, press Win+A, since Win will be released here we need to send a dummy event before it
                         int i = 0;
-                        KeyboardManagerHelper::SetDummyKeyEvent(keyEventList, i, KeyboardManagerConstants::KEYBOARDMANAGER_SHORTCUT_FLAG);
+                        KeyboardManagerHelper::SetDummyKeyEvent(keyEventList.Data(), i, KeyboardManagerConstants::KEYBOARDMANAGER_SHORTCUT_FLAG);
 
                         // Release original shortcut state (release in reverse order of shortcut to be accurate)
-                        KeyboardManagerHelper::SetModifierKeyEvents(it->first, it->second.winKeyInvoked, keyEventList, i, false, KeyboardManagerConstants::KEYBOARDMANAGER_SHORTCUT_FLAG);
+                        KeyboardManagerHelper::SetModifierKeyEvents(it->first, remapState.winKeyInvoked, keyEventList.Data(), i, false, KeyboardManagerConstants::KEYBOARDMANAGER_SHORTCUT_FLAG);
 
                         // Set target key down state
                         if (std::get<DWORD>(it->second.targetShortcut) != CommonSharedConstants::VK_DISABLED)
                         {
-                            KeyboardManagerHelper::SetKeyEvent(keyEventList, i, INPUT_KEYBOARD, (WORD)KeyboardManagerHelper::FilterArtificialKeys(std::get<DWORD>(it->second.targetShortcut)), 0, KeyboardManagerConstants::KEYBOARDMANAGER_SHORTCUT_FLAG);
+                            KeyboardManagerHelper::SetKeyEvent(keyEventList.Data(), i, INPUT_KEYBOARD, (WORD)KeyboardManagerHelper::FilterArtificialKeys(std::get<DWORD>(it->second.targetShortcut)), 0, KeyboardManagerConstants::KEYBOARDMANAGER_SHORTCUT_FLAG);
                             i++;
                         }
 
@@ -307,18 +286,17 @@ namespace KeyboardEventHandlers
                         }
                     }
 
-                    it->second.isShortcutInvoked = true;
+                    remapState.isShortcutInvoked = true;
                     // If app specific shortcut is invoked, store the target application
-                    if (activatedApp)
+                    if (activatedAppId != KeyboardManagerConstants::NoActivatedAppId)
                     {
-                        keyboardManagerState.SetActivatedApp(*activatedApp);
+                        keyboardManagerState.SetActivatedAppId(activatedAppId);
                     }
 
-                    UINT res = ii.SendVirtualInput((UINT)key_count, keyEventList, sizeof(INPUT));
-                    delete[] keyEventList;
+                    UINT res = ii.SendVirtualInput((UINT)key_count, keyEventList.Data(), sizeof(INPUT));
 
                     // Log telemetry event when shortcut remap is invoked
-                    Trace::ShortcutRemapInvoked(remapToShortcut, activatedApp.has_value());
+                    Trace::ShortcutRemapInvoked(remapToShortcut, activatedAppId != KeyboardManagerConstants::NoActivatedAppId);
 
                     return 1;
                 }
@@ -331,7 +309,7 @@ namespace KeyboardEventHandlers
             // 4. The user presses a modifier key in the original shortcut - suppress that key event since the original shortcut is already held down physically (This case can occur only if a user has a duplicated modifier key (possibly by remapping) or if user presses both L/R versions of a modifier remapped with "Both")
             // 5. The user presses any key apart from the action key or a modifier key in the original shortcut - revert the keyboard state to just the original modifiers being held down along with the current key press
             // 6. The user releases any key apart from original modifier or original action key - This can't happen since the key down would have to happen first, which is handled above
-            else if (it->second.isShortcutInvoked)
+            else if (remapState.isShortcutInvoked)
             {
                 // Get the common keys between the two shortcuts
                 int commonKeys = remapToShortcut ? it->first.GetCommonModifiersCount(std::get<Shortcut>(it->second.targetShortcut)) : 0;
@@ -341,7 +319,7 @@ namespace KeyboardEventHandlers
                 {
                     // Release new shortcut, and set original shortcut keys except the one released
                     size_t key_count;
-                    LPINPUT keyEventList;
+                    KeyEventBatch keyEventList;
                     if (remapToShortcut)
                     {
                         // if the released key is present in both shortcuts' modifiers (i.e part of the common modifiers)
@@ -364,23 +342,25 @@ namespace KeyboardEventHandlers
                             key_count += 1;
                         }
 
-                        keyEventList = new INPUT[key_count]();
-                        memset(keyEventList, 0, sizeof(keyEventList));
+                        if (!keyEventList.Reset(key_count))
+                        {
+                            return 0;
+                        }
 
                         // Release new shortcut state (release in reverse order of shortcut to be accurate)
                         int i = 0;
                         if (isActionKeyPressed)
                         {
-                            KeyboardManagerHelper::SetKeyEvent(keyEventList, i, INPUT_KEYBOARD, (WORD)std::get<Shortcut>(it->second.targetShortcut).GetActionKey(), KEYEVENTF_KEYUP, KeyboardManagerConstants::KEYBOARDMANAGER_SHORTCUT_FLAG);
+                            KeyboardManagerHelper::SetKeyEvent(keyEventList.Data(), i, INPUT_KEYBOARD, (WORD)std::get<Shortcut>(it->second.targetShortcut).GetActionKey(), KEYEVENTF_KEYUP, KeyboardManagerConstants::KEYBOARDMANAGER_SHORTCUT_FLAG);
                             i++;
                         }
-                        KeyboardManagerHelper::SetModifierKeyEvents(std::get<Shortcut>(it->second.targetShortcut), it->second.winKeyInvoked, keyEventList, i, false, KeyboardManagerConstants::KEYBOARDMANAGER_SHORTCUT_FLAG, it->first, data->lParam->vkCode);
+                        KeyboardManagerHelper::SetModifierKeyEvents(std::get<Shortcut>(it->second.targetShortcut), remapState.winKeyInvoked, keyEventList.Data(), i, false, KeyboardManagerConstants::KEYBOARDMANAGER_SHORTCUT_FLAG, it->first, data->lParam->vkCode);
 
                         // Set original shortcut key down state except the action key and the released modifier since the original action key may or may not be held down. If it is held down it will generate it's own key message
-                        KeyboardManagerHelper::SetModifierKeyEvents(it->first, it->second.winKeyInvoked, keyEventList, i, true, KeyboardManagerConstants::KEYBOARDMANAGER_SHORTCUT_FLAG, std::get<Shortcut>(it->second.targetShortcut), data->lParam->vkCode);
+                        KeyboardManagerHelper::SetModifierKeyEvents(it->first, remapState.winKeyInvoked, keyEventList.Data(), i, true, KeyboardManagerConstants::KEYBOARDMANAGER_SHORTCUT_FLAG, std::get<Shortcut>(it->second.targetShortcut), data->lParam->vkCode);
 
                         // Send a dummy key event to prevent modifier press+release from being triggered. Example: Win+Ctrl+A->Ctrl+V, press Win+Ctrl+A and release A then Ctrl, since Win will be pressed here we need to send a dummy event after it
-                        KeyboardManagerHelper::SetDummyKeyEvent(keyEventList, i, KeyboardManagerConstants::KEYBOARDMANAGER_SHORTCUT_FLAG);
+                        KeyboardManagerHelper::SetDummyKeyEvent(keyEventList.Data(), i, KeyboardManagerConstants::KEYBOARDMANAGER_SHORTCUT_FLAG);
                     }
                     else
                     {
@@ -403,39 +383,40 @@ namespace KeyboardEventHandlers
                             key_count--;
                         }
 
-                        keyEventList = new INPUT[key_count]();
-                        memset(keyEventList, 0, sizeof(keyEventList));
+                        if (!keyEventList.Reset(key_count))
+                        {
+                            return 0;
+                        }
 
                         // Release new key state
                         int i = 0;
                         if (std::get<DWORD>(it->second.targetShortcut) != CommonSharedConstants::VK_DISABLED && isTargetKeyPressed)
                         {
-                            KeyboardManagerHelper::SetKeyEvent(keyEventList, i, INPUT_KEYBOARD, (WORD)KeyboardManagerHelper::FilterArtificialKeys(std::get<DWORD>(it->second.targetShortcut)), KEYEVENTF_KEYUP, KeyboardManagerConstants::KEYBOARDMANAGER_SHORTCUT_FLAG);
+                            KeyboardManagerHelper::SetKeyEvent(keyEventList.Data(), i, INPUT_KEYBOARD, (WORD)KeyboardManagerHelper::FilterArtificialKeys(std::get<DWORD>(it->second.targetShortcut)), KEYEVENTF_KEYUP, KeyboardManagerConstants::KEYBOARDMANAGER_SHORTCUT_FLAG);
                             i++;
                         }
 
                         // Set original shortcut key down state except the action key and the released modifier since the original action key may or may not be held down. If it is held down it will generate it's own key message
-                        KeyboardManagerHelper::SetModifierKeyEvents(it->first, it->second.winKeyInvoked, keyEventList, i, true, KeyboardManagerConstants::KEYBOARDMANAGER_SHORTCUT_FLAG, Shortcut(), data->lParam->vkCode);
+                        KeyboardManagerHelper::SetModifierKeyEvents(it->first, remapState.winKeyInvoked, keyEventList.Data(), i, true, KeyboardManagerConstants::KEYBOARDMANAGER_SHORTCUT_FLAG, Shortcut(), data->lParam->vkCode);
 
                         // Send a dummy key event to prevent modifier press+release from being triggered. Example: Win+Ctrl+A->V, press Win+Ctrl+A and release A then Ctrl, since Win will be pressed here we need to send a dummy event after it
-                        KeyboardManagerHelper::SetDummyKeyEvent(keyEventList, i, KeyboardManagerConstants::KEYBOARDMANAGER_SHORTCUT_FLAG);
+                        KeyboardManagerHelper::SetDummyKeyEvent(keyEventList.Data(), i, KeyboardManagerConstants::KEYBOARDMANAGER_SHORTCUT_FLAG);
                     }
 
                     // Reset the remap state
-                    it->second.isShortcutInvoked = false;
-                    it->second.winKeyInvoked = ModifierKey::Disabled;
-                    it->second.isOriginalActionKeyPressed = false;
+                    remapState.isShortcutInvoked = false;
+                    remapState.winKeyInvoked = ModifierKey::Disabled;
+                    remapState.isOriginalActionKeyPressed = false;
                     // If app specific shortcut has finished invoking, reset the target application
-                    if (activatedApp)
+                    if (activatedAppId != KeyboardManagerConstants::NoActivatedAppId)
                     {
-                        keyboardManagerState.SetActivatedApp(KeyboardManagerConstants::NoActivatedApp);
+                        keyboardManagerState.SetActivatedAppId(KeyboardManagerConstants::NoActivatedAppId);
                     }
 
-                    // key count can be 0 if both shortcuts have same modifiers and the action key is not held down. delete will throw an error if keyEventList is empty
+                    // key count can be 0 if both shortcuts have same modifiers and the action key is not held down
                     if (key_count > 0)
                     {
-                        UINT res = ii.SendVirtualInput((UINT)key_count, keyEventList, sizeof(INPUT));
-                        delete[] keyEventList;
+                        UINT res = ii.SendVirtualInput((UINT)key_count, keyEventList.Data(), sizeof(INPUT));
                     }
                     return 1;
                 }
@@ -450,24 +431,23 @@ namespace KeyboardEventHandlers
                         if (!remapToShortcut && std::get<DWORD>(it->second.targetShortcut) == CommonSharedConstants::VK_DISABLED)
                         {
                             // Since the original shortcut's action key is pressed, set it to true
-                            it->second.isOriginalActionKeyPressed = true;
+                            remapState.isOriginalActionKeyPressed = true;
                             return 1;
                         }
 
                         size_t key_count = 1;
-                        LPINPUT keyEventList = new INPUT[key_count]();
-                        memset(keyEventList, 0, sizeof(keyEventList));
+                        KeyEventBatch keyEventList;
+                        keyEventList.Reset(key_count);
                         if (remapToShortcut)
                         {
-                            KeyboardManagerHelper::SetKeyEvent(keyEventList, 0, INPUT_KEYBOARD, (WORD)std::get<Shortcut>(it->second.targetShortcut).GetActionKey(), 0, KeyboardManagerConstants::KEYBOARDMANAGER_SHORTCUT_FLAG);
+                            KeyboardManagerHelper::SetKeyEvent(keyEventList.Data(), 0, INPUT_KEYBOARD, (WORD)std::get<Shortcut>(it->second.targetShortcut).GetActionKey(), 0, KeyboardManagerConstants::KEYBOARDMANAGER_SHORTCUT_FLAG);
                         }
                         else
                         {
-                            KeyboardManagerHelper::SetKeyEvent(keyEventList, 0, INPUT_KEYBOARD, (WORD)KeyboardManagerHelper::FilterArtificialKeys(std::get<DWORD>(it->second.targetShortcut)), 0, KeyboardManagerConstants::KEYBOARDMANAGER_SHORTCUT_FLAG);
+                            KeyboardManagerHelper::SetKeyEvent(keyEventList.Data(), 0, INPUT_KEYBOARD, (WORD)KeyboardManagerHelper::FilterArtificialKeys(std::get<DWORD>(it->second.targetShortcut)), 0, KeyboardManagerConstants::KEYBOARDMANAGER_SHORTCUT_FLAG);
                         }
 
-                        UINT res = ii.SendVirtualInput((UINT)key_count, keyEventList, sizeof(INPUT));
-                        delete[] keyEventList;
+                        UINT res = ii.SendVirtualInput((UINT)key_count, keyEventList.Data(), sizeof(INPUT));
                         return 1;
                     }
 
@@ -475,18 +455,17 @@ namespace KeyboardEventHandlers
                     if (data->lParam->vkCode == it->first.GetActionKey() && (data->wParam == WM_KEYUP || data->wParam == WM_SYSKEYUP))
                     {
                         size_t key_count = 1;
-                        LPINPUT keyEventList;
+                        KeyEventBatch keyEventList;
                         if (remapToShortcut)
                         {
-                            keyEventList = new INPUT[key_count]();
-                            memset(keyEventList, 0, sizeof(keyEventList));
-                            KeyboardManagerHelper::SetKeyEvent(keyEventList, 0, INPUT_KEYBOARD, (WORD)std::get<Shortcut>(it->second.targetShortcut).GetActionKey(), KEYEVENTF_KEYUP, KeyboardManagerConstants::KEYBOARDMANAGER_SHORTCUT_FLAG);
+                            keyEventList.Reset(key_count);
+                            KeyboardManagerHelper::SetKeyEvent(keyEventList.Data(), 0, INPUT_KEYBOARD, (WORD)std::get<Shortcut>(it->second.targetShortcut).GetActionKey(), KEYEVENTF_KEYUP, KeyboardManagerConstants::KEYBOARDMANAGER_SHORTCUT_FLAG);
                         }
                         // If remapped to disable, do nothing and suppress the key event
                         else if (std::get<DWORD>(it->second.targetShortcut) == CommonSharedConstants::VK_DISABLED)
                         {
                             // Since the original shortcut's action key is released, set it to false
-                            it->second.isOriginalActionKeyPressed = false;
+                            remapState.isOriginalActionKeyPressed = false;
                             return 1;
                         }
                         else
@@ -496,9 +475,8 @@ namespace KeyboardEventHandlers
                             // If the keyboard state is clear, we release the target key but do not reset the remap state
                             if (isKeyboardStateClear)
                             {
-                                keyEventList = new INPUT[key_count]();
-                                memset(keyEventList, 0, sizeof(keyEventList));
-                                KeyboardManagerHelper::SetKeyEvent(keyEventList, 0, INPUT_KEYBOARD, (WORD)KeyboardManagerHelper::FilterArtificialKeys(std::get<DWORD>(it->second.targetShortcut)), KEYEVENTF_KEYUP, KeyboardManagerConstants::KEYBOARDMANAGER_SHORTCUT_FLAG);
+                                keyEventList.Reset(key_count);
+                                KeyboardManagerHelper::SetKeyEvent(keyEventList.Data(), 0, INPUT_KEYBOARD, (WORD)KeyboardManagerHelper::FilterArtificialKeys(std::get<DWORD>(it->second.targetShortcut)), KEYEVENTF_KEYUP, KeyboardManagerConstants::KEYBOARDMANAGER_SHORTCUT_FLAG);
                             }
                             // If any other key is pressed, then the keyboard state must be reverted back to the physical keys. This is to take cases like Ctrl+A->D remap and user presses B+Ctrl+A and releases A, or Ctrl+A+B and releases A
                             else
@@ -506,34 +484,35 @@ namespace KeyboardEventHandlers
                                 // 1 for releasing new key and original shortcut modifiers, and dummy key
                                 key_count = dest_size + (src_size - 1) + KeyboardManagerConstants::DUMMY_KEY_EVENT_SIZE;
 
-                                keyEventList = new INPUT[key_count]();
-                                memset(keyEventList, 0, sizeof(keyEventList));
+                                if (!keyEventList.Reset(key_count))
+                                {
+                                    return 0;
+                                }
 
                                 // Release new key state
                                 int i = 0;
-                                KeyboardManagerHelper::SetKeyEvent(keyEventList, i, INPUT_KEYBOARD, (WORD)KeyboardManagerHelper::FilterArtificialKeys(std::get<DWORD>(it->second.targetShortcut)), KEYEVENTF_KEYUP, KeyboardManagerConstants::KEYBOARDMANAGER_SHORTCUT_FLAG);
+                                KeyboardManagerHelper::SetKeyEvent(keyEventList.Data(), i, INPUT_KEYBOARD, (WORD)KeyboardManagerHelper::FilterArtificialKeys(std::get<DWORD>(it->second.targetShortcut)), KEYEVENTF_KEYUP, KeyboardManagerConstants::KEYBOARDMANAGER_SHORTCUT_FLAG);
                                 i++;
 
                                 // Set original shortcut key down state except the action key
-                                KeyboardManagerHelper::SetModifierKeyEvents(it->first, it->second.winKeyInvoked, keyEventList, i, true, KeyboardManagerConstants::KEYBOARDMANAGER_SHORTCUT_FLAG);
+                                KeyboardManagerHelper::SetModifierKeyEvents(it->first, remapState.winKeyInvoked, keyEventList.Data(), i, true, KeyboardManagerConstants::KEYBOARDMANAGER_SHORTCUT_FLAG);
 
                                 // Send a dummy key event to prevent modifier press+release from being triggered. Example: Win+A->V, press Shift+Win+A and release A, since Win will be pressed here we need to send a dummy event after it
-                                KeyboardManagerHelper::SetDummyKeyEvent(keyEventList, i, KeyboardManagerConstants::KEYBOARDMANAGER_SHORTCUT_FLAG);
+                                KeyboardManagerHelper::SetDummyKeyEvent(keyEventList.Data(), i, KeyboardManagerConstants::KEYBOARDMANAGER_SHORTCUT_FLAG);
 
                                 // Reset the remap state
-                                it->second.isShortcutInvoked = false;
-                                it->second.winKeyInvoked = ModifierKey::Disabled;
-                                it->second.isOriginalActionKeyPressed = false;
+                                remapState.isShortcutInvoked = false;
+                                remapState.winKeyInvoked = ModifierKey::Disabled;
+                                remapState.isOriginalActionKeyPressed = false;
                                 // If app specific shortcut has finished invoking, reset the target application
-                                if (activatedApp != KeyboardManagerConstants::NoActivatedApp)
+                                if (activatedAppId != KeyboardManagerConstants::NoActivatedAppId)
                                 {
-                                    keyboardManagerState.SetActivatedApp(KeyboardManagerConstants::NoActivatedApp);
+                                    keyboardManagerState.SetActivatedAppId(KeyboardManagerConstants::NoActivatedAppId);
                                 }
                             }
                         }
 
-                        UINT res = ii.SendVirtualInput((UINT)key_count, keyEventList, sizeof(INPUT));
-                        delete[] keyEventList;
+                        UINT res = ii.SendVirtualInput((UINT)key_count, keyEventList.Data(), sizeof(INPUT));
                         return 1;
                     }
 
@@ -571,7 +550,7 @@ namespace KeyboardEventHandlers
                             }
 
                             size_t key_count;
-                            LPINPUT keyEventList;
+                            KeyEventBatch keyEventList;
 
                             // If the original shortcut is a subset of the new shortcut
                             if (commonKeys == src_size - 1)
@@ -586,26 +565,28 @@ namespace KeyboardEventHandlers
                                     key_count += 2;
                                 }
 
-                                keyEventList = new INPUT[key_count]();
-                                memset(keyEventList, 0, sizeof(keyEventList));
+                                if (!keyEventList.Reset(key_count))
+                                {
+                                    return 0;
+                                }
 
                                 int i = 0;
                                 if (isActionKeyPressed)
                                 {
-                                    KeyboardManagerHelper::SetKeyEvent(keyEventList, i, INPUT_KEYBOARD, (WORD)std::get<Shortcut>(it->second.targetShortcut).GetActionKey(), KEYEVENTF_KEYUP, KeyboardManagerConstants::KEYBOARDMANAGER_SHORTCUT_FLAG);
+                                    KeyboardManagerHelper::SetKeyEvent(keyEventList.Data(), i, INPUT_KEYBOARD, (WORD)std::get<Shortcut>(it->second.targetShortcut).GetActionKey(), KEYEVENTF_KEYUP, KeyboardManagerConstants::KEYBOARDMANAGER_SHORTCUT_FLAG);
                                     i++;
                                 }
-                                KeyboardManagerHelper::SetModifierKeyEvents(std::get<Shortcut>(it->second.targetShortcut), it->second.winKeyInvoked, keyEventList, i, false, KeyboardManagerConstants::KEYBOARDMANAGER_SHORTCUT_FLAG, it->first);
+                                KeyboardManagerHelper::SetModifierKeyEvents(std::get<Shortcut>(it->second.targetShortcut), remapState.winKeyInvoked, keyEventList.Data(), i, false, KeyboardManagerConstants::KEYBOARDMANAGER_SHORTCUT_FLAG, it->first);
 
                                 // key down for original shortcut action key with shortcut flag so that we don't invoke the same shortcut remap again
                                 if (isActionKeyPressed)
                                 {
-                                    KeyboardManagerHelper::SetKeyEvent(keyEventList, i, INPUT_KEYBOARD, (WORD)it->first.GetActionKey(), 0, KeyboardManagerConstants::KEYBOARDMANAGER_SHORTCUT_FLAG);
+                                    KeyboardManagerHelper::SetKeyEvent(keyEventList.Data(), i, INPUT_KEYBOARD, (WORD)it->first.GetActionKey(), 0, KeyboardManagerConstants::KEYBOARDMANAGER_SHORTCUT_FLAG);
                                     i++;
                                 }
 
                                 // Send current key pressed without shortcut flag so that it can be reprocessed in case the physical keys pressed are a different remapped shortcut
-                                KeyboardManagerHelper::SetKeyEvent(keyEventList, i, INPUT_KEYBOARD, (WORD)data->lParam->vkCode, 0, 0);
+                                KeyboardManagerHelper::SetKeyEvent(keyEventList.Data(), i, INPUT_KEYBOARD, (WORD)data->lParam->vkCode, 0, 0);
                                 i++;
 
                                 // Do not send a dummy key as we want the current key press to behave as normal i.e. it can do press+release functionality if required. Required to allow a shortcut to Win key remap invoked directly after shortcut to shortcut is released to open start menu
@@ -623,47 +604,48 @@ namespace KeyboardEventHandlers
                                     key_count += 2;
                                 }
 
-                                keyEventList = new INPUT[key_count]();
-                                memset(keyEventList, 0, sizeof(keyEventList));
+                                if (!keyEventList.Reset(key_count))
+                                {
+                                    return 0;
+                                }
 
                                 // Release new shortcut state (release in reverse order of shortcut to be accurate)
                                 int i = 0;
                                 if (isActionKeyPressed)
                                 {
-                                    KeyboardManagerHelper::SetKeyEvent(keyEventList, i, INPUT_KEYBOARD, (WORD)std::get<Shortcut>(it->second.targetShortcut).GetActionKey(), KEYEVENTF_KEYUP, KeyboardManagerConstants::KEYBOARDMANAGER_SHORTCUT_FLAG);
+                                    KeyboardManagerHelper::SetKeyEvent(keyEventList.Data(), i, INPUT_KEYBOARD, (WORD)std::get<Shortcut>(it->second.targetShortcut).GetActionKey(), KEYEVENTF_KEYUP, KeyboardManagerConstants::KEYBOARDMANAGER_SHORTCUT_FLAG);
                                     i++;
                                 }
-                                KeyboardManagerHelper::SetModifierKeyEvents(std::get<Shortcut>(it->second.targetShortcut), it->second.winKeyInvoked, keyEventList, i, false, KeyboardManagerConstants::KEYBOARDMANAGER_SHORTCUT_FLAG, it->first);
+                                KeyboardManagerHelper::SetModifierKeyEvents(std::get<Shortcut>(it->second.targetShortcut), remapState.winKeyInvoked, keyEventList.Data(), i, false, KeyboardManagerConstants::KEYBOARDMANAGER_SHORTCUT_FLAG, it->first);
 
                                 // Set old shortcut key down state
-                                KeyboardManagerHelper::SetModifierKeyEvents(it->first, it->second.winKeyInvoked, keyEventList, i, true, KeyboardManagerConstants::KEYBOARDMANAGER_SHORTCUT_FLAG, std::get<Shortcut>(it->second.targetShortcut));
+                                KeyboardManagerHelper::SetModifierKeyEvents(it->first, remapState.winKeyInvoked, keyEventList.Data(), i, true, KeyboardManagerConstants::KEYBOARDMANAGER_SHORTCUT_FLAG, std::get<Shortcut>(it->second.targetShortcut));
 
                                 // key down for original shortcut action key with shortcut flag so that we don't invoke the same shortcut remap again
                                 if (isActionKeyPressed)
                                 {
-                                    KeyboardManagerHelper::SetKeyEvent(keyEventList, i, INPUT_KEYBOARD, (WORD)it->first.GetActionKey(), 0, KeyboardManagerConstants::KEYBOARDMANAGER_SHORTCUT_FLAG);
+                                    KeyboardManagerHelper::SetKeyEvent(keyEventList.Data(), i, INPUT_KEYBOARD, (WORD)it->first.GetActionKey(), 0, KeyboardManagerConstants::KEYBOARDMANAGER_SHORTCUT_FLAG);
                                     i++;
                                 }
 
                                 // Send current key pressed without shortcut flag so that it can be reprocessed in case the physical keys pressed are a different remapped shortcut
-                                KeyboardManagerHelper::SetKeyEvent(keyEventList, i, INPUT_KEYBOARD, (WORD)data->lParam->vkCode, 0, 0);
+                                KeyboardManagerHelper::SetKeyEvent(keyEventList.Data(), i, INPUT_KEYBOARD, (WORD)data->lParam->vkCode, 0, 0);
                                 i++;
 
                                 // Do not send a dummy key as we want the current key press to behave as normal i.e. it can do press+release functionality if required. Required to allow a shortcut to Win key remap invoked directly after shortcut to shortcut is released to open start menu
                             }
 
                             // Reset the remap state
-                            it->second.isShortcutInvoked = false;
-                            it->second.winKeyInvoked = ModifierKey::Disabled;
-                            it->second.isOriginalActionKeyPressed = false;
+                            remapState.isShortcutInvoked = false;
+                            remapState.winKeyInvoked = ModifierKey::Disabled;
+                            remapState.isOriginalActionKeyPressed = false;
                             // If app specific shortcut has finished invoking, reset the target application
-                            if (activatedApp)
+                            if (activatedAppId != KeyboardManagerConstants::NoActivatedAppId)
                             {
-                                keyboardManagerState.SetActivatedApp(KeyboardManagerConstants::NoActivatedApp);
+                                keyboardManagerState.SetActivatedAppId(KeyboardManagerConstants::NoActivatedAppId);
                             }
 
-                            UINT res = ii.SendVirtualInput((UINT)key_count, keyEventList, sizeof(INPUT));
-                            delete[] keyEventList;
+                            UINT res = ii.SendVirtualInput((UINT)key_count, keyEventList.Data(), sizeof(INPUT));
                             return 1;
                         }
                         // For remap to key, if the original action key is not currently pressed, we should revert the keyboard state to the physical keys. If it is pressed we should not suppress the event so that shortcut to key remaps can be pressed with other keys. Example use-case: Alt+D->Win, allows Alt+D+A to perform Win+A
@@ -686,7 +668,7 @@ namespace KeyboardEventHandlers
                             }
                             else
                             {
-                                isOriginalActionKeyPressed = it->second.isOriginalActionKeyPressed;
+                                isOriginalActionKeyPressed = remapState.isOriginalActionKeyPressed;
                             }
 
                             if (isRemapToDisable || !isOriginalActionKeyPressed)
@@ -694,18 +676,21 @@ namespace KeyboardEventHandlers
                                 // Key down for original shortcut modifiers and action key, and current key press
                                 size_t key_count = src_size + 1;
 
-                                LPINPUT keyEventList = new INPUT[key_count]();
-                                memset(keyEventList, 0, sizeof(keyEventList));
+                                KeyEventBatch keyEventList;
+                                if (!keyEventList.Reset(key_count))
+                                {
+                                    return 0;
+                                }
 
                                 // Set original shortcut key down state
                                 int i = 0;
-                                KeyboardManagerHelper::SetModifierKeyEvents(it->first, it->second.winKeyInvoked, keyEventList, i, true, KeyboardManagerConstants::KEYBOARDMANAGER_SHORTCUT_FLAG);
+                                KeyboardManagerHelper::SetModifierKeyEvents(it->first, remapState.winKeyInvoked, keyEventList.Data(), i, true, KeyboardManagerConstants::KEYBOARDMANAGER_SHORTCUT_FLAG);
 
                                 // Send the original action key only if it is physically pressed. For remappings to keys other than disabled we already check earlier that it is not pressed in this scenario. For remap to disable
                                 if (isRemapToDisable && isOriginalActionKeyPressed)
                                 {
                                     // Set original action key
-                                    KeyboardManagerHelper::SetKeyEvent(keyEventList, i, INPUT_KEYBOARD, (WORD)it->first.GetActionKey(), 0, KeyboardManagerConstants::KEYBOARDMANAGER_SHORTCUT_FLAG);
+                                    KeyboardManagerHelper::SetKeyEvent(keyEventList.Data(), i, INPUT_KEYBOARD, (WORD)it->first.GetActionKey(), 0, KeyboardManagerConstants::KEYBOARDMANAGER_SHORTCUT_FLAG);
                                     i++;
                                 }
                                 else
@@ -714,23 +699,22 @@ namespace KeyboardEventHandlers
                                 }
 
                                 // Send current key pressed without shortcut flag so that it can be reprocessed in case the physical keys pressed are a different remapped shortcut
-                                KeyboardManagerHelper::SetKeyEvent(keyEventList, i, INPUT_KEYBOARD, (WORD)data->lParam->vkCode, 0, 0);
+                                KeyboardManagerHelper::SetKeyEvent(keyEventList.Data(), i, INPUT_KEYBOARD, (WORD)data->lParam->vkCode, 0, 0);
                                 i++;
 
                                 // Do not send a dummy key as we want the current key press to behave as normal i.e. it can do press+release functionality if required. Required to allow a shortcut to Win key remap invoked directly after another shortcut to key remap is released to open start menu
 
                                 // Reset the remap state
-                                it->second.isShortcutInvoked = false;
-                                it->second.winKeyInvoked = ModifierKey::Disabled;
-                                it->second.isOriginalActionKeyPressed = false;
+                                remapState.isShortcutInvoked = false;
+                                remapState.winKeyInvoked = ModifierKey::Disabled;
+                                remapState.isOriginalActionKeyPressed = false;
                                 // If app specific shortcut has finished invoking, reset the target application
-                                if (activatedApp != KeyboardManagerConstants::NoActivatedApp)
+                                if (activatedAppId != KeyboardManagerConstants::NoActivatedAppId)
                                 {
-                                    keyboardManagerState.SetActivatedApp(KeyboardManagerConstants::NoActivatedApp);
+                                    keyboardManagerState.SetActivatedAppId(KeyboardManagerConstants::NoActivatedAppId);
                                 }
 
-                                UINT res = ii.SendVirtualInput((UINT)key_count, keyEventList, sizeof(INPUT));
-                                delete[] keyEventList;
+                                UINT res = ii.SendVirtualInput((UINT)key_count, keyEventList.Data(), sizeof(INPUT));
                                 return 1;
                             }
                             else
@@ -766,50 +750,27 @@ namespace KeyboardEventHandlers
         // Check if the key event was generated by KeyboardManager to avoid remapping events generated by us.
         if (data->lParam->dwExtraInfo != KeyboardManagerConstants::KEYBOARDMANAGER_SHORTCUT_FLAG)
         {
-            std::wstring process_name;
-
-            // Allocate MAX_PATH amount of memory
-            process_name.resize(MAX_PATH);
-            ii.GetForegroundProcess(process_name);
-
-            // Remove elements after null character
-            process_name.erase(std::find(process_name.begin(), process_name.end(), L'\0'), process_name.end());
-
-            if (process_name.empty())
+            // Get the foreground app, which is only read again when the foreground window or the remaps change
+            const auto remapSnapshot = keyboardManagerState.AcquireRemapSnapshot();
+            int appId = keyboardManagerState.GetForegroundAppId(ii, *remapSnapshot);
+            if (appId == KeyboardManagerConstants::NoForegroundAppId)
             {
                 return 0;
             }
 
-            // Convert process name to lower case
-            std::transform(process_name.begin(), process_name.end(), process_name.begin(), towlower);
-
-            std::wstring query_string;
-
-            AppSpecificShortcutRemapTable::iterator it;
-            // Check if an app-specific shortcut is already activated
-            if (keyboardManagerState.GetActivatedApp() == KeyboardManagerConstants::NoActivatedApp)
+            // Check if an app-specific shortcut is already activated. The activated app is cleared when a new snapshot no longer has app-specific shortcuts for it
+            int activatedAppId = keyboardManagerState.GetActivatedAppId();
+            if (activatedAppId == KeyboardManagerConstants::NoActivatedAppId)
             {
-                query_string = process_name;
-                it = keyboardManagerState.appSpecificShortcutReMap.find(query_string);
-
-                // If no entry is found, search for the process name without it's file extension
-                if (it == keyboardManagerState.appSpecificShortcutReMap.end())
+                if (appId != KeyboardManagerConstants::UnmappedForegroundAppId)
                 {
-                    // Find index of the file extension
-                    size_t extensionIndex = process_name.find_last_of(L".");
-                    query_string = process_name.substr(0, extensionIndex);
-                    it = keyboardManagerState.appSpecificShortcutReMap.find(query_string);
+                    bool result = HandleShortcutRemapEvent(ii, data, keyboardManagerState, appId);
+                    return result;
                 }
             }
             else
             {
-                query_string = keyboardManagerState.GetActivatedApp();
-                it = keyboardManagerState.appSpecificShortcutReMap.find(query_string);
-            }
-
-            if (it != keyboardManagerState.appSpecificShortcutReMap.end())
-            {
-                bool result = HandleShortcutRemapEvent(ii, data, keyboardManagerState, query_string);
+                bool result = HandleShortcutRemapEvent(ii, data, keyboardManagerState, activatedAppId);
                 return result;
             }
         }
@@ -823,14 +784,13 @@ namespace KeyboardEventHandlers
         // Num Lock's key state is applied before it is intercepted by low level keyboard hooks, so we have to manually set back the state when we suppress the key. This is done by sending an additional key up, key down set of messages.
         // We need 2 key events because after Num Lock is suppressed, key up to release num lock key and key down to revert the num lock state
         int key_count = 2;
-        LPINPUT keyEventList = new INPUT[size_t(key_count)]();
-        memset(keyEventList, 0, sizeof(keyEventList));
+        KeyEventBatch keyEventList;
+        keyEventList.Reset(key_count);
 
         // Use the suppress flag to ensure these are not intercepted by any remapped keys or shortcuts
-        KeyboardManagerHelper::SetKeyEvent(keyEventList, 0, INPUT_KEYBOARD, VK_NUMLOCK, KEYEVENTF_KEYUP, KeyboardManagerConstants::KEYBOARDMANAGER_SUPPRESS_FLAG);
-        KeyboardManagerHelper::SetKeyEvent(keyEventList, 1, INPUT_KEYBOARD, VK_NUMLOCK, 0, KeyboardManagerConstants::KEYBOARDMANAGER_SUPPRESS_FLAG);
-        UINT res = ii.SendVirtualInput((UINT)key_count, keyEventList, sizeof(INPUT));
-        delete[] keyEventList;
+        KeyboardManagerHelper::SetKeyEvent(keyEventList.Data(), 0, INPUT_KEYBOARD, VK_NUMLOCK, KEYEVENTF_KEYUP, KeyboardManagerConstants::KEYBOARDMANAGER_SUPPRESS_FLAG);
+        KeyboardManagerHelper::SetKeyEvent(keyEventList.Data(), 1, INPUT_KEYBOARD, VK_NUMLOCK, 0, KeyboardManagerConstants::KEYBOARDMANAGER_SUPPRESS_FLAG);
+        UINT res = ii.SendVirtualInput((UINT)key_count, keyEventList.Data(), sizeof(INPUT));
     }
 
     // Function to ensure Ctrl/Shift/Alt modifier key state is not detected as pressed down by applications which detect keys at a lower level than hooks when it is remapped for scenarios where its required
@@ -843,13 +803,12 @@ namespace KeyboardEventHandlers
             if (KeyboardManagerHelper::IsModifierKey(key) && !(key == VK_LWIN || key == VK_RWIN || key == CommonSharedConstants::VK_WIN_BOTH))
             {
                 int key_count = 1;
-                LPINPUT keyEventList = new INPUT[size_t(key_count)]();
-                memset(keyEventList, 0, sizeof(keyEventList));
+                KeyEventBatch keyEventList;
+                keyEventList.Reset(key_count);
 
                 // Use the suppress flag to ensure these are not intercepted by any remapped keys or shortcuts
-                KeyboardManagerHelper::SetKeyEvent(keyEventList, 0, INPUT_KEYBOARD, (WORD)key, KEYEVENTF_KEYUP, KeyboardManagerConstants::KEYBOARDMANAGER_SUPPRESS_FLAG);
-                UINT res = ii.SendVirtualInput((UINT)key_count, keyEventList, sizeof(INPUT));
-                delete[] keyEventList;
+                KeyboardManagerHelper::SetKeyEvent(keyEventList.Data(), 0, INPUT_KEYBOARD, (WORD)key, KEYEVENTF_KEYUP, KeyboardManagerConstants::KEYBOARDMANAGER_SUPPRESS_FLAG);
+                UINT res = ii.SendVirtualInput((UINT)key_count, keyEventList.Data(), sizeof(INPUT));
             }
         }
     }
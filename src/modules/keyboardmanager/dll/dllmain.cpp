@@ -53,6 +53,9 @@ private:
     // Required for Unhook in old versions of Windows
     static HHOOK hook_handle_copy;
 
+    // Handle of the event hook which reports foreground window changes, so that the foreground process is not read on every key event
+    static HWINEVENTHOOK foreground_event_hook_handle;
+
     // Static pointer to the current keyboardmanager object required for accessing the HandleKeyboardHookEvent function in the hook procedure (Only global or static variables can be accessed in a hook procedure CALLBACK)
     static KeyboardManager* keyboardmanager_object_ptr;
 
@@ -95,128 +98,131 @@ public:
                 {
                     auto jsonData = *configFile;
 
-                    // Load single key remaps
-                    try
-                    {
-                        auto remapKeysData = jsonData.GetNamedObject(KeyboardManagerConstants::RemapKeysSettingName);
-                        keyboardManagerState.ClearSingleKeyRemaps();
-
-                        if (remapKeysData)
+                    // Load the remaps into a copy of the current remaps, which replaces them once all the remaps are loaded. The hook keeps remapping with the current remaps until then
+                    keyboardManagerState.RemapSnapshotUpdateWrapper([&jsonData](RemapSnapshot& remapSnapshot) {
+                        // Load single key remaps
+                        try
                         {
-                            auto inProcessRemapKeys = remapKeysData.GetNamedArray(KeyboardManagerConstants::InProcessRemapKeysSettingName);
-                            for (const auto& it : inProcessRemapKeys)
-                            {
-                                try
-                                {
-                                    auto originalKey = it.GetObjectW().GetNamedString(KeyboardManagerConstants::OriginalKeysSettingName);
-                                    auto newRemapKey = it.GetObjectW().GetNamedString(KeyboardManagerConstants::NewRemapKeysSettingName);
-
-                                    // If remapped to a shortcut
-                                    if (std::wstring(newRemapKey).find(L";") != std::string::npos)
-                                    {
-                                        keyboardManagerState.AddSingleKeyRemap(std::stoul(originalKey.c_str()), Shortcut(newRemapKey.c_str()));
-                                    }
+                            auto remapKeysData = jsonData.GetNamedObject(KeyboardManagerConstants::RemapKeysSettingName);
+                            remapSnapshot.ClearSingleKeyRemaps();
 
-                                    // If remapped to a key
-                                    else
-                                    {
-                                        keyboardManagerState.AddSingleKeyRemap(std::stoul(originalKey.c_str()), std::stoul(newRemapKey.c_str()));
-                                    }
-                                }
-                                catch (...)
-                                {
-                                    // Improper Key Data JSON. Try the next remap.
-                                }
-                            }
-                        }
-                    }
-                    catch (...)
-                    {
-                        // Improper JSON format for single key remaps. Skip to next remap type
-                    }
-
-                    // Load shortcut remaps
-                    try
-                    {
-                        auto remapShortcutsData = jsonData.GetNamedObject(KeyboardManagerConstants::RemapShortcutsSettingName);
-                        keyboardManagerState.ClearOSLevelShortcuts();
-                        keyboardManagerState.ClearAppSpecificShortcuts();
-                        if (remapShortcutsData)
-                        {
-                            // Load os level shortcut remaps
-                            try
+                            if (remapKeysData)
                             {
-                                auto globalRemapShortcuts = remapShortcutsData.GetNamedArray(KeyboardManagerConstants::GlobalRemapShortcutsSettingName);
-                                for (const auto& it : globalRemapShortcuts)
+                                auto inProcessRemapKeys = remapKeysData.GetNamedArray(KeyboardManagerConstants::InProcessRemapKeysSettingName);
+                                for (const auto& it : inProcessRemapKeys)
                                 {
                                     try
                                     {
-                                        auto originalKeys = it.GetObjectW().GetNamedString(KeyboardManagerConstants::OriginalKeysSettingName);
-                                        auto newRemapKeys = it.GetObjectW().GetNamedString(KeyboardManagerConstants::NewRemapKeysSettingName);
+                                        auto originalKey = it.GetObjectW().GetNamedString(KeyboardManagerConstants::OriginalKeysSettingName);
+                                        auto newRemapKey = it.GetObjectW().GetNamedString(KeyboardManagerConstants::NewRemapKeysSettingName);
 
                                         // If remapped to a shortcut
-                                        if (std::wstring(newRemapKeys).find(L";") != std::string::npos)
+                                        if (std::wstring(newRemapKey).find(L";") != std::string::npos)
                                         {
-                                            keyboardManagerState.AddOSLevelShortcut(Shortcut(originalKeys.c_str()), Shortcut(newRemapKeys.c_str()));
+                                            remapSnapshot.AddSingleKeyRemap(std::stoul(originalKey.c_str()), Shortcut(newRemapKey.c_str()));
                                         }
 
                                         // If remapped to a key
                                         else
                                         {
-                                            keyboardManagerState.AddOSLevelShortcut(Shortcut(originalKeys.c_str()), std::stoul(newRemapKeys.c_str()));
+                                            remapSnapshot.AddSingleKeyRemap(std::stoul(originalKey.c_str()), std::stoul(newRemapKey.c_str()));
                                         }
                                     }
                                     catch (...)
                                     {
-                                        // Improper Key Data JSON. Try the next shortcut.
+                                        // Improper Key Data JSON. Try the next remap.
                                     }
                                 }
                             }
-                            catch (...)
-                            {
-                                // Improper JSON format for os level shortcut remaps. Skip to next remap type
-                            }
+                        }
+                        catch (...)
+                        {
+                            // Improper JSON format for single key remaps. Skip to next remap type
+                        }
 
-                            // Load app specific shortcut remaps
-                            try
+                        // Load shortcut remaps
+                        try
+                        {
+                            auto remapShortcutsData = jsonData.GetNamedObject(KeyboardManagerConstants::RemapShortcutsSettingName);
+                            remapSnapshot.ClearOSLevelShortcuts();
+                            remapSnapshot.ClearAppSpecificShortcuts();
+                            if (remapShortcutsData)
                             {
-                                auto appSpecificRemapShortcuts = remapShortcutsData.GetNamedArray(KeyboardManagerConstants::AppSpecificRemapShortcutsSettingName);
-                                for (const auto& it : appSpecificRemapShortcuts)
+                                // Load os level shortcut remaps
+                                try
                                 {
-                                    try
+                                    auto globalRemapShortcuts = remapShortcutsData.GetNamedArray(KeyboardManagerConstants::GlobalRemapShortcutsSettingName);
+                                    for (const auto& it : globalRemapShortcuts)
                                     {
-                                        auto originalKeys = it.GetObjectW().GetNamedString(KeyboardManagerConstants::OriginalKeysSettingName);
-                                        auto newRemapKeys = it.GetObjectW().GetNamedString(KeyboardManagerConstants::NewRemapKeysSettingName);
-                                        auto targetApp = it.GetObjectW().GetNamedString(KeyboardManagerConstants::TargetAppSettingName);
-
-                                        // If remapped to a shortcut
-                                        if (std::wstring(newRemapKeys).find(L";") != std::string::npos)
+                                        try
                                         {
-                                            keyboardManagerState.AddAppSpecificShortcut(targetApp.c_str(), Shortcut(originalKeys.c_str()), Shortcut(newRemapKeys.c_str()));
+                                            auto originalKeys = it.GetObjectW().GetNamedString(KeyboardManagerConstants::OriginalKeysSettingName);
+                                            auto newRemapKeys = it.GetObjectW().GetNamedString(KeyboardManagerConstants::NewRemapKeysSettingName);
+
+                                            // If remapped to a shortcut
+                                            if (std::wstring(newRemapKeys).find(L";") != std::string::npos)
+                                            {
+                                                remapSnapshot.AddOSLevelShortcut(Shortcut(originalKeys.c_str()), Shortcut(newRemapKeys.c_str()));
+                                            }
+
+                                            // If remapped to a key
+                                            else
+                                            {
+                                                remapSnapshot.AddOSLevelShortcut(Shortcut(originalKeys.c_str()), std::stoul(newRemapKeys.c_str()));
+                                            }
                                         }
-
-                                        // If remapped to a key
-                                        else
+                                        catch (...)
                                         {
-                                            keyboardManagerState.AddAppSpecificShortcut(targetApp.c_str(), Shortcut(originalKeys.c_str()), std::stoul(newRemapKeys.c_str()));
+                                            // Improper Key Data JSON. Try the next shortcut.
                                         }
                                     }
-                                    catch (...)
+                                }
+                                catch (...)
+                                {
+                                    // Improper JSON format for os level shortcut remaps. Skip to next remap type
+                                }
+
+                                // Load app specific shortcut remaps
+                                try
+                                {
+                                    auto appSpecificRemapShortcuts = remapShortcutsData.GetNamedArray(KeyboardManagerConstants::AppSpecificRemapShortcutsSettingName);
+                                    for (const auto& it : appSpecificRemapShortcuts)
                                     {
-                                        // Improper Key Data JSON. Try the next shortcut.
+                                        try
+                                        {
+                                            auto originalKeys = it.GetObjectW().GetNamedString(KeyboardManagerConstants::OriginalKeysSettingName);
+                                            auto newRemapKeys = it.GetObjectW().GetNamedString(KeyboardManagerConstants::NewRemapKeysSettingName);
+                                            auto targetApp = it.GetObjectW().GetNamedString(KeyboardManagerConstants::TargetAppSettingName);
+
+                                            // If remapped to a shortcut
+                                            if (std::wstring(newRemapKeys).find(L";") != std::string::npos)
+                                            {
+                                                remapSnapshot.AddAppSpecificShortcut(targetApp.c_str(), Shortcut(originalKeys.c_str()), Shortcut(newRemapKeys.c_str()));
+                                            }
+
+                                            // If remapped to a key
+                                            else
+                                            {
+                                                remapSnapshot.AddAppSpecificShortcut(targetApp.c_str(), Shortcut(originalKeys.c_str()), std::stoul(newRemapKeys.c_str()));
+                                            }
+                                        }
+                                        catch (...)
+                                        {
+                                            // Improper Key Data JSON. Try the next shortcut.
+                                        }
                                     }
                                 }
-                            }
-                            catch (...)
-                            {
-                                // Improper JSON format for os level shortcut remaps. Skip to next remap type
+                                catch (...)
+                                {
+                                    // Improper JSON format for os level shortcut remaps. Skip to next remap type
+                                }
                             }
                         }
-                    }
-                    catch (...)
-                    {
-                        // Improper JSON format for shortcut remaps. Skip to next remap type
-                    }
+                        catch (...)
+                        {
+                            // Improper JSON format for shortcut remaps. Skip to next remap type
+                        }
+                    });
                 }
             }
         }
@@ -356,10 +362,19 @@ public:
                 }
                 return 1;
             }
+
+            // Track the key states with the key events which are not suppressed
+            keyboardmanager_object_ptr->inputHandler.UpdateKeyboardState(&event);
         }
         return CallNextHookEx(hook_handle_copy, nCode, wParam, lParam);
     }
 
+    // Event hook procedure definition for foreground window changes
+    static void CALLBACK foreground_event_proc(HWINEVENTHOOK, DWORD, HWND, LONG, LONG, DWORD, DWORD)
+    {
+        keyboardmanager_object_ptr->inputHandler.OnForegroundChanged();
+    }
+
     void start_lowlevel_keyboard_hook()
     {
 #if defined(DISABLE_LOWLEVEL_HOOKS_WHEN_DEBUGGED)
@@ -381,6 +396,13 @@ public:
                 Trace::Error(errorCode, errorMessage.has_value() ? errorMessage.value() : L"", L"start_lowlevel_keyboard_hook.SetWindowsHookEx");
             }
         }
+
+        if (!foreground_event_hook_handle)
+        {
+            // If the event hook cannot be set, the foreground process is read on every key event
+            foreground_event_hook_handle = SetWinEventHook(EVENT_SYSTEM_FOREGROUND, EVENT_SYSTEM_FOREGROUND, nullptr, foreground_event_proc, 0, 0, WINEVENT_OUTOFCONTEXT);
+            inputHandler.SetForegroundChangeTracked(foreground_event_hook_handle != nullptr);
+        }
     }
 
     // Function to terminate the low level hook
@@ -391,17 +413,18 @@ public:
             UnhookWindowsHookEx(hook_handle);
             hook_handle = nullptr;
         }
+
+        if (foreground_event_hook_handle)
+        {
+            UnhookWinEvent(foreground_event_hook_handle);
+            foreground_event_hook_handle = nullptr;
+            inputHandler.SetForegroundChangeTracked(false);
+        }
     }
 
     // Function called by the hook procedure to handle the events. This is the starting point function for remapping
     intptr_t HandleKeyboardHookEvent(LowlevelKeyboardEvent* data) noexcept
     {
-        // If remappings are disabled (due to the remap tables getting updated) skip the rest of the hook
-        if (!keyboardManagerState.AreRemappingsEnabled())
-        {
-            return 0;
-        }
-
         // If key has suppress flag, then suppress it
         if (data->lParam->dwExtraInfo == KeyboardManagerConstants::KEYBOARDMANAGER_SUPPRESS_FLAG)
         {
@@ -472,6 +495,7 @@ public:
 
 HHOOK KeyboardManager::hook_handle = nullptr;
 HHOOK KeyboardManager::hook_handle_copy = nullptr;
+HWINEVENTHOOK KeyboardManager::foreground_event_hook_handle = nullptr;
 KeyboardManager* KeyboardManager::keyboardmanager_object_ptr = nullptr;
 
 extern "C" __declspec(dllexport) PowertoyModuleIface* __cdecl powertoy_create()
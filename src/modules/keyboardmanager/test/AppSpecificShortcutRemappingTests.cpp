@@ -5,6 +5,7 @@
 #include <keyboardmanager/dll/KeyboardEventHandlers.h>
 #include "TestHelpers.h"
 #include <common/interop/shared_constants.h>
+#include <chrono>
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 
@@ -342,5 +343,167 @@ namespace RemappingLogicTests
             Assert::AreEqual(mockedInputHandler.GetVirtualKeyState(VK_CONTROL), false);
             Assert::AreEqual(mockedInputHandler.GetVirtualKeyState(actionKey), false);
         }
+
+        // Test if the app specific remap takes place when it is added while the target app is already in foreground
+        TEST_METHOD (AppSpecificShortcut_ShouldGetRemapped_WhenItIsAddedWhileAppIsInForeground)
+        {
+            // Set the testApp as the foreground process and send a key event so that it is read
+            mockedInputHandler.SetForegroundProcess(testApp2);
+
+            const int nInputs = 2;
+            INPUT input[nInputs] = {};
+            input[0].type = INPUT_KEYBOARD;
+            input[0].ki.wVk = 0x42;
+            input[1].type = INPUT_KEYBOARD;
+            input[1].ki.wVk = 0x42;
+            input[1].ki.dwFlags = KEYEVENTF_KEYUP;
+            mockedInputHandler.SendVirtualInput(nInputs, input, sizeof(INPUT));
+
+            // Remap Ctrl+A to Alt+V for the app name without its file extension
+            Shortcut src;
+            src.SetKey(VK_CONTROL);
+            src.SetKey(0x41);
+            Shortcut dest;
+            dest.SetKey(VK_MENU);
+            dest.SetKey(0x56);
+            testState.AddAppSpecificShortcut(L"TestProcess2", src, dest);
+
+            input[0].type = INPUT_KEYBOARD;
+            input[0].ki.wVk = VK_CONTROL;
+            input[0].ki.dwFlags = 0;
+            input[1].type = INPUT_KEYBOARD;
+            input[1].ki.wVk = 0x41;
+            input[1].ki.dwFlags = 0;
+
+            // Send Ctrl+A keydown
+            mockedInputHandler.SendVirtualInput(nInputs, input, sizeof(INPUT));
+
+            // Ctrl and A key states should be unchanged, Alt and V key states should be true
+            Assert::AreEqual(mockedInputHandler.GetVirtualKeyState(VK_CONTROL), false);
+            Assert::AreEqual(mockedInputHandler.GetVirtualKeyState(0x41), false);
+            Assert::AreEqual(mockedInputHandler.GetVirtualKeyState(VK_MENU), true);
+            Assert::AreEqual(mockedInputHandler.GetVirtualKeyState(0x56), true);
+        }
+
+        // Test if the activated app is kept when its id changes in a new snapshot while the shortcut is invoked
+        TEST_METHOD (AppSpecificShortcut_ShouldKeepActivatedApp_WhenAppIdChangesWhileShortcutIsInvoked)
+        {
+            // Remap Ctrl+A to Alt+V for both apps
+            Shortcut src;
+            src.SetKey(VK_CONTROL);
+            src.SetKey(0x41);
+            Shortcut dest;
+            dest.SetKey(VK_MENU);
+            dest.SetKey(0x56);
+            testState.AddAppSpecificShortcut(testApp1, src, dest);
+            testState.AddAppSpecificShortcut(testApp2, src, dest);
+
+            // Set testApp2 as the foreground process
+            mockedInputHandler.SetForegroundProcess(testApp2);
+
+            const int nInputs = 2;
+            INPUT input[nInputs] = {};
+            input[0].type = INPUT_KEYBOARD;
+            input[0].ki.wVk = VK_CONTROL;
+            input[1].type = INPUT_KEYBOARD;
+            input[1].ki.wVk = 0x41;
+
+            // Send Ctrl+A keydown
+            mockedInputHandler.SendVirtualInput(nInputs, input, sizeof(INPUT));
+            Assert::AreEqual(testApp2, testState.GetActivatedApp());
+
+            // Remove the remaps of testApp1, which changes the id of testApp2
+            testState.RemapSnapshotUpdateWrapper([&](RemapSnapshot& snapshot) {
+                snapshot.ClearAppSpecificShortcuts();
+                snapshot.AddAppSpecificShortcut(testApp2, src, dest);
+            });
+
+            // Release A, which is handled with the new remaps
+            input[0].type = INPUT_KEYBOARD;
+            input[0].ki.wVk = 0x41;
+            input[0].ki.dwFlags = KEYEVENTF_KEYUP;
+            mockedInputHandler.SendVirtualInput(1, input, sizeof(INPUT));
+            Assert::AreEqual(testApp2, testState.GetActivatedApp());
+
+            // Release Ctrl
+            input[0].ki.wVk = VK_CONTROL;
+            mockedInputHandler.SendVirtualInput(1, input, sizeof(INPUT));
+
+            // All the keys should be released and the activated app should be empty string
+            Assert::AreEqual(mockedInputHandler.GetVirtualKeyState(VK_CONTROL), false);
+            Assert::AreEqual(mockedInputHandler.GetVirtualKeyState(VK_MENU), false);
+            Assert::AreEqual(mockedInputHandler.GetVirtualKeyState(0x56), false);
+            Assert::AreEqual(std::wstring(KeyboardManagerConstants::NoActivatedApp), testState.GetActivatedApp());
+        }
+
+        // Test the number of key events per second the app specific remapping hook handles while the foreground app switches
+        BEGIN_TEST_METHOD_ATTRIBUTE(AppSpecificShortcut_Benchmark)
+            TEST_METHOD_ATTRIBUTE(L"TestCategory", L"Benchmark")
+            TEST_METHOD_ATTRIBUTE(L"Ignore", L"true")
+        END_TEST_METHOD_ATTRIBUTE()
+        TEST_METHOD (AppSpecificShortcut_Benchmark)
+        {
+            // Remap Ctrl+A to Alt+V for 64 apps
+            Shortcut src;
+            src.SetKey(VK_CONTROL);
+            src.SetKey(0x41);
+            Shortcut dest;
+            dest.SetKey(VK_MENU);
+            dest.SetKey(0x56);
+            std::vector<std::wstring> apps;
+            for (int i = 0; i < 64; i++)
+            {
+                apps.push_back(L"benchmarkapp" + std::to_wstring(i) + L".exe");
+                testState.AddAppSpecificShortcut(apps.back(), src, dest);
+            }
+            apps.push_back(L"unmappedapp.exe");
+
+            // Switch the foreground app, type some text and invoke the remap
+            constexpr int rounds = 2000;
+            constexpr int keysPerSwitch = 40;
+            size_t events = 0;
+            int remapCount = 0;
+            INPUT input[2] = {};
+            input[0].type = INPUT_KEYBOARD;
+            input[1].type = INPUT_KEYBOARD;
+            const auto start = std::chrono::steady_clock::now();
+            for (int round = 0; round < rounds; round++)
+            {
+                mockedInputHandler.SetForegroundProcess(apps[round % apps.size()]);
+                for (int i = 0; i < keysPerSwitch; i++)
+                {
+                    input[0].ki.wVk = static_cast<WORD>(0x42 + i % 20);
+                    input[0].ki.dwFlags = 0;
+                    input[1].ki.wVk = input[0].ki.wVk;
+                    input[1].ki.dwFlags = KEYEVENTF_KEYUP;
+                    mockedInputHandler.SendVirtualInput(2, input, sizeof(INPUT));
+                    events += 2;
+                }
+
+                // Send Ctrl+A keydown, then release A then Ctrl
+                input[0].ki.wVk = VK_CONTROL;
+                input[0].ki.dwFlags = 0;
+                input[1].ki.wVk = 0x41;
+                input[1].ki.dwFlags = 0;
+                mockedInputHandler.SendVirtualInput(2, input, sizeof(INPUT));
+                remapCount += mockedInputHandler.GetVirtualKeyState(0x56) ? 1 : 0;
+                input[0].ki.wVk = 0x41;
+                input[0].ki.dwFlags = KEYEVENTF_KEYUP;
+                input[1].ki.wVk = VK_CONTROL;
+                input[1].ki.dwFlags = KEYEVENTF_KEYUP;
+                mockedInputHandler.SendVirtualInput(2, input, sizeof(INPUT));
+                events += 4;
+            }
+            const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            // The remap should only take place in the mapped apps
+            Assert::AreEqual(rounds - rounds / static_cast<int>(apps.size()), remapCount);
+            Assert::AreEqual(mockedInputHandler.GetVirtualKeyState(VK_MENU), false);
+            Assert::AreEqual(mockedInputHandler.GetVirtualKeyState(0x56), false);
+
+            Logger::WriteMessage((std::to_wstring(events) + L" events with " + std::to_wstring(rounds) + L" app switches in " + std::to_wstring(elapsed * 1000) +
+                                  L" ms, " + std::to_wstring(static_cast<size_t>(events / elapsed)) + L" events/s\n")
+                                     .c_str());
+        }
     };
 }
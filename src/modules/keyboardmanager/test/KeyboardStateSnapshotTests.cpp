@@ -0,0 +1,126 @@
+#include "pch.h"
+#include "CppUnitTest.h"
+#include "MockedInput.h"
+#include <keyboardmanager/common/KeyboardManagerState.h>
+#include <keyboardmanager/common/KeyboardStateSnapshot.h>
+#include "TestHelpers.h"
+#include <chrono>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace KeyboardManagerCommonTests
+{
+    // Tests for the KeyboardStateSnapshot class
+    TEST_CLASS (KeyboardStateSnapshotTests)
+    {
+    private:
+        MockedInput mockedInputHandler;
+        KeyboardManagerState testState;
+
+        // Function to send a key down event for each key in the list
+        void SendKeysDown(const std::vector<DWORD>& keys)
+        {
+            std::vector<INPUT> input(keys.size());
+            for (size_t i = 0; i < keys.size(); i++)
+            {
+                input[i].type = INPUT_KEYBOARD;
+                input[i].ki.wVk = static_cast<WORD>(keys[i]);
+            }
+
+            mockedInputHandler.SendVirtualInput(static_cast<UINT>(input.size()), input.data(), sizeof(INPUT));
+        }
+
+    public:
+        TEST_METHOD_INITIALIZE(InitializeTestEnv)
+        {
+            // Reset test environment
+            TestHelpers::ResetTestEnv(mockedInputHandler, testState);
+        }
+
+        // Test if the state of each key code is stored separately
+        TEST_METHOD (SetKeyState_ShouldChangeOnlyThatKey_ForAllKeyCodes)
+        {
+            for (DWORD key = 0; key <= 0xFF; key++)
+            {
+                KeyboardStateSnapshot snapshot;
+                snapshot.SetKeyState(key, true);
+                for (DWORD otherKey = 0; otherKey <= 0xFF; otherKey++)
+                {
+                    Assert::AreEqual(key == otherKey, snapshot.IsKeyDown(otherKey));
+                }
+
+                snapshot.SetKeyState(key, false);
+                Assert::IsFalse(snapshot.IsAnyKeyDown());
+            }
+        }
+
+        // Test if IsAnyKeyDownExcept only considers the keys which are not in the given set
+        TEST_METHOD (IsAnyKeyDownExcept_ShouldReturnFalse_WhenOnlyKeysInTheSetArePressed)
+        {
+            KeyboardStateSnapshot snapshot;
+            snapshot.SetKeyState(VK_LCONTROL, true);
+            snapshot.SetKeyState(0xFE, true);
+            KeyboardStateSnapshot keys;
+            keys.SetKeyState(VK_LCONTROL, true);
+
+            Assert::IsTrue(snapshot.IsAnyKeyDownExcept(keys));
+            keys.SetKeyState(0xFE, true);
+            Assert::IsFalse(snapshot.IsAnyKeyDownExcept(keys));
+            Assert::IsFalse(KeyboardStateSnapshot().IsAnyKeyDownExcept(KeyboardStateSnapshot()));
+        }
+
+        // Test if the snapshot of the mocked input matches the state of each key
+        TEST_METHOD (GetKeyboardStateSnapshot_ShouldMatchGetVirtualKeyState_WhenKeysArePressed)
+        {
+            SendKeysDown({ VK_RCONTROL, VK_LSHIFT, 0x41, VK_F12 });
+
+            const auto snapshot = mockedInputHandler.GetKeyboardStateSnapshot();
+            for (DWORD key = 0; key <= 0xFF; key++)
+            {
+                Assert::AreEqual(mockedInputHandler.GetVirtualKeyState(key), snapshot.IsKeyDown(key));
+            }
+            Assert::IsTrue(snapshot.IsKeyDown(VK_CONTROL));
+            Assert::IsTrue(snapshot.IsKeyDown(VK_SHIFT));
+        }
+
+        // Test if the keyboard state is clear except the shortcut only when the other pressed keys are ignored
+        TEST_METHOD (IsKeyboardStateClearExceptShortcut_ShouldIgnoreMouseButtonsAndIMEKeys)
+        {
+            Shortcut src;
+            src.SetKey(VK_LCONTROL);
+            src.SetKey(0x41);
+
+            SendKeysDown({ VK_LCONTROL, 0x41, VK_LBUTTON, VK_KANA, 0xFF });
+            Assert::IsTrue(src.IsKeyboardStateClearExceptShortcut(mockedInputHandler));
+
+            SendKeysDown({ VK_RCONTROL });
+            Assert::IsFalse(src.IsKeyboardStateClearExceptShortcut(mockedInputHandler));
+        }
+
+        // Test the time taken to check if the keyboard state is clear except the shortcut
+        BEGIN_TEST_METHOD_ATTRIBUTE(IsKeyboardStateClearExceptShortcut_Benchmark)
+            TEST_METHOD_ATTRIBUTE(L"TestCategory", L"Benchmark")
+            TEST_METHOD_ATTRIBUTE(L"Ignore", L"true")
+        END_TEST_METHOD_ATTRIBUTE()
+        TEST_METHOD (IsKeyboardStateClearExceptShortcut_Benchmark)
+        {
+            Shortcut src;
+            src.SetKey(VK_CONTROL);
+            src.SetKey(VK_SHIFT);
+            src.SetKey(0x41);
+            SendKeysDown({ VK_LCONTROL, VK_LSHIFT, 0x41 });
+
+            constexpr int iterations = 100000;
+            int clearCount = 0;
+            const auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < iterations; i++)
+            {
+                clearCount += src.IsKeyboardStateClearExceptShortcut(mockedInputHandler) ? 1 : 0;
+            }
+            const auto elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+            Assert::AreEqual(iterations, clearCount);
+            Logger::WriteMessage((std::to_wstring(iterations) + L" checks in " + std::to_wstring(elapsed / 1000) + L" ms, " + std::to_wstring(elapsed * 1000 / iterations) + L" ns per check\n").c_str());
+        }
+    };
+}
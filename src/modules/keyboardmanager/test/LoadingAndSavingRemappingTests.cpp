@@ -370,7 +370,7 @@ namespace RemappingUITests
             LoadingAndSavingRemappingHelper::ApplySingleKeyRemappings(testState, remapBuffer, false);
 
             // Assert that single key remapping in the kbm state variable is empty
-            Assert::AreEqual((size_t)0, testState.singleKeyReMap.size());
+            Assert::AreEqual((size_t)0, testState.GetRemapSnapshot()->singleKeyReMap.size());
         }
 
         // Test if the ApplySingleKeyRemappings method copies only the valid remappings to the keyboard manager state variable when some of the remappings are invalid
@@ -398,7 +398,7 @@ namespace RemappingUITests
             expectedTable[0x41] = 0x42;
             expectedTable[0x42] = s1;
 
-            bool areTablesEqual = (expectedTable == testState.singleKeyReMap);
+            bool areTablesEqual = (expectedTable == testState.GetRemapSnapshot()->singleKeyReMap);
             Assert::AreEqual(true, areTablesEqual);
         }
 
@@ -428,7 +428,7 @@ namespace RemappingUITests
             expectedTable[VK_LWIN] = 0x44;
             expectedTable[VK_RWIN] = 0x44;
 
-            bool areTablesEqual = (expectedTable == testState.singleKeyReMap);
+            bool areTablesEqual = (expectedTable == testState.GetRemapSnapshot()->singleKeyReMap);
             Assert::AreEqual(true, areTablesEqual);
         }
 
@@ -458,8 +458,8 @@ namespace RemappingUITests
             LoadingAndSavingRemappingHelper::ApplyShortcutRemappings(testState, remapBuffer, false);
 
             // Assert that shortcut remappings in the kbm state variable is empty
-            Assert::AreEqual((size_t)0, testState.osLevelShortcutReMap.size());
-            Assert::AreEqual((size_t)0, testState.appSpecificShortcutReMap.size());
+            Assert::AreEqual((size_t)0, testState.GetRemapSnapshot()->osLevelShortcutReMap.size());
+            Assert::AreEqual((size_t)0, testState.GetRemapSnapshot()->appSpecificShortcutReMap.size());
         }
 
         // Test if the ApplyShortcutRemappings method copies only the valid remappings to the keyboard manager state variable when some of the remappings are invalid
@@ -512,8 +512,8 @@ namespace RemappingUITests
             expectedAppSpecificLevelTable[testApp1][src3] = RemapShortcut(dest2);
             expectedAppSpecificLevelTable[testApp1][src4] = RemapShortcut(dest1);
 
-            bool areOSLevelTablesEqual = (expectedOSLevelTable == testState.osLevelShortcutReMap);
-            bool areAppSpecificTablesEqual = (expectedAppSpecificLevelTable == testState.appSpecificShortcutReMap);
+            bool areOSLevelTablesEqual = (expectedOSLevelTable == testState.GetRemapSnapshot()->osLevelShortcutReMap);
+            bool areAppSpecificTablesEqual = (expectedAppSpecificLevelTable == testState.GetRemapSnapshot()->appSpecificShortcutReMap);
             Assert::AreEqual(true, areOSLevelTablesEqual);
             Assert::AreEqual(true, areAppSpecificTablesEqual);
         }
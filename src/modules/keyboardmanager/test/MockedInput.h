@@ -11,7 +11,7 @@ class MockedInput :
 {
 private:
     // Stores the states for all the keys - false for key up, and true for key down
-    std::vector<bool> keyboardState;
+    KeyboardStateSnapshot keyboardState;
 
     // Function to be executed as a low level hook. By default it is nullptr so the hook is skipped
     std::function<intptr_t(LowlevelKeyboardEvent*)> hookProc;
@@ -22,12 +22,10 @@ private:
 
     std::wstring currentProcess;
 
-public:
-    MockedInput()
-    {
-        keyboardState.resize(256, false);
-    }
+    // Incremented whenever the foreground process is set
+    uint64_t foregroundChangeCount = 0;
 
+public:
     // Set the keyboard hook procedure to be tested
     void SetHookProc(std::function<intptr_t(LowlevelKeyboardEvent*)> hookProcedure);
 
@@ -40,6 +38,9 @@ public:
     // Function to get the state of a particular key
     bool GetVirtualKeyState(int key);
 
+    // Function to get the state of all the keys at once
+    KeyboardStateSnapshot GetKeyboardStateSnapshot();
+
     // Function to reset the mocked keyboard state
     void ResetKeyboardState();
 
@@ -54,4 +55,7 @@ public:
 
     // Function to get the foreground process name
     void GetForegroundProcess(_Out_ std::wstring& foregroundProcess);
+
+    // Function to get the number of times the foreground process has been set
+    uint64_t GetForegroundChangeCount();
 };
@@ -0,0 +1,241 @@
+#include "pch.h"
+#include "CppUnitTest.h"
+#include "MockedInput.h"
+#include <keyboardmanager/common/KeyboardManagerState.h>
+#include <keyboardmanager/common/RemapSnapshot.h>
+#include <keyboardmanager/dll/KeyboardEventHandlers.h>
+#include "TestHelpers.h"
+#include <common/interop/shared_constants.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace KeyboardManagerCommonTests
+{
+    // Tests for publishing the remaps through the RemapSnapshot class
+    TEST_CLASS (RemapSnapshotTests)
+    {
+    private:
+        MockedInput mockedInputHandler;
+        KeyboardManagerState testState;
+
+        // Function to send a key down or key up event
+        void SendKey(DWORD key, bool keyUp)
+        {
+            INPUT input[1] = {};
+            input[0].type = INPUT_KEYBOARD;
+            input[0].ki.wVk = static_cast<WORD>(key);
+            input[0].ki.dwFlags = keyUp ? KEYEVENTF_KEYUP : 0;
+            mockedInputHandler.SendVirtualInput(1, input, sizeof(INPUT));
+        }
+
+    public:
+        TEST_METHOD_INITIALIZE(InitializeTestEnv)
+        {
+            // Reset test environment
+            TestHelpers::ResetTestEnv(mockedInputHandler, testState);
+
+            // Set HandleSingleKeyRemapEvent followed by HandleOSLevelShortcutRemapEvent as the hook procedure
+            mockedInputHandler.SetHookProc([this](LowlevelKeyboardEvent* data) {
+                if (data->lParam->dwExtraInfo == KeyboardManagerConstants::KEYBOARDMANAGER_SUPPRESS_FLAG)
+                {
+                    return (intptr_t)1;
+                }
+
+                if (KeyboardEventHandlers::HandleSingleKeyRemapEvent(mockedInputHandler, data, testState) == 1)
+                {
+                    return (intptr_t)1;
+                }
+
+                return KeyboardEventHandlers::HandleOSLevelShortcutRemapEvent(mockedInputHandler, data, testState);
+            });
+        }
+
+        // Test if the lookups of a copied snapshot refer to the tables of the copy
+        TEST_METHOD (CopiedSnapshot_ShouldHaveLookupsOfCopiedTables)
+        {
+            RemapSnapshot snapshot;
+            Shortcut src;
+            src.SetKey(VK_CONTROL);
+            src.SetKey(0x41);
+            snapshot.AddOSLevelShortcut(src, VK_MENU);
+            snapshot.AddAppSpecificShortcut(L"testprocess.exe", src, VK_SHIFT);
+            snapshot.CompileShortcutRemapLookups();
+
+            RemapSnapshot copy(snapshot);
+            snapshot.ClearOSLevelShortcuts();
+            snapshot.ClearAppSpecificShortcuts();
+
+            const auto& osLevelRemaps = copy.GetShortcutRemapLookup(std::nullopt).GetAll();
+            const auto& appSpecificRemaps = copy.GetShortcutRemapLookup(L"testprocess.exe").GetAll();
+            Assert::AreEqual(size_t(1), osLevelRemaps.size());
+            Assert::AreEqual(size_t(1), appSpecificRemaps.size());
+            Assert::IsTrue(osLevelRemaps[0].remap == copy.osLevelShortcutReMap.find(src));
+            Assert::IsTrue(appSpecificRemaps[0].remap == copy.appSpecificShortcutReMap[L"testprocess.exe"].find(src));
+
+            // Each remap should have its own state
+            Assert::AreEqual(size_t(2), copy.shortcutRemapStateCount);
+            Assert::AreNotEqual(osLevelRemaps[0].stateIndex, appSpecificRemaps[0].stateIndex);
+        }
+
+        // Test if the hook keeps remapping with the current remaps while the new remaps are being built
+        TEST_METHOD (RemapSnapshotUpdateWrapper_ShouldKeepCurrentRemaps_UntilMethodReturns)
+        {
+            // Remap A to B
+            testState.AddSingleKeyRemap(0x41, 0x42);
+
+            testState.RemapSnapshotUpdateWrapper([this](RemapSnapshot& snapshot) {
+                // Remap A to C
+                snapshot.ClearSingleKeyRemaps();
+                snapshot.AddSingleKeyRemap(0x41, 0x43);
+
+                // Send A keydown, which should still be remapped to B
+                SendKey(0x41, false);
+                Assert::AreEqual(mockedInputHandler.GetVirtualKeyState(0x42), true);
+                Assert::AreEqual(mockedInputHandler.GetVirtualKeyState(0x43), false);
+                SendKey(0x41, true);
+                Assert::AreEqual(mockedInputHandler.GetVirtualKeyState(0x42), false);
+            });
+
+            // Send A keydown, which should be remapped to C
+            SendKey(0x41, false);
+            Assert::AreEqual(mockedInputHandler.GetVirtualKeyState(0x42), false);
+            Assert::AreEqual(mockedInputHandler.GetVirtualKeyState(0x43), true);
+            SendKey(0x41, true);
+            Assert::AreEqual(mockedInputHandler.GetVirtualKeyState(0x43), false);
+        }
+
+        // Test if a shortcut which is held down while the remaps change is released
+        TEST_METHOD (InvokedShortcut_ShouldBeReleased_WhenRemapsChangeWhileShortcutIsHeld)
+        {
+            // Remap Ctrl+A to Alt+V
+            Shortcut src;
+            src.SetKey(VK_CONTROL);
+            src.SetKey(0x41);
+            Shortcut dest;
+            dest.SetKey(VK_MENU);
+            dest.SetKey(0x56);
+            testState.AddOSLevelShortcut(src, dest);
+
+            // Press Ctrl+A
+            SendKey(VK_CONTROL, false);
+            SendKey(0x41, false);
+            Assert::AreEqual(mockedInputHandler.GetVirtualKeyState(VK_MENU), true);
+            Assert::AreEqual(mockedInputHandler.GetVirtualKeyState(0x56), true);
+
+            // Add a remap from Ctrl+B to Alt+C, which publishes a new snapshot
+            Shortcut otherSrc;
+            otherSrc.SetKey(VK_CONTROL);
+            otherSrc.SetKey(0x42);
+            Shortcut otherDest;
+            otherDest.SetKey(VK_MENU);
+            otherDest.SetKey(0x43);
+            testState.AddOSLevelShortcut(otherSrc, otherDest);
+
+            // Release A and Ctrl
+            SendKey(0x41, true);
+            Assert::AreEqual(true, testState.GetShortcutRemapState(src).isShortcutInvoked);
+            SendKey(VK_CONTROL, true);
+
+            // All the keys should be released
+            Assert::AreEqual(mockedInputHandler.GetVirtualKeyState(VK_CONTROL), false);
+            Assert::AreEqual(mockedInputHandler.GetVirtualKeyState(VK_MENU), false);
+            Assert::AreEqual(mockedInputHandler.GetVirtualKeyState(0x56), false);
+            Assert::AreEqual(false, testState.GetShortcutRemapState(src).isShortcutInvoked);
+        }
+
+        // Test if the state of a shortcut is dropped when it is remapped to another target while it is held down
+        TEST_METHOD (InvokedShortcutState_ShouldBeDropped_WhenShortcutIsRemappedToAnotherTarget)
+        {
+            // Remap Ctrl+A to Alt+V
+            Shortcut src;
+            src.SetKey(VK_CONTROL);
+            src.SetKey(0x41);
+            Shortcut dest;
+            dest.SetKey(VK_MENU);
+            dest.SetKey(0x56);
+            testState.AddOSLevelShortcut(src, dest);
+
+            // Press Ctrl+A
+            SendKey(VK_CONTROL, false);
+            SendKey(0x41, false);
+            Assert::AreEqual(true, testState.GetShortcutRemapState(src).isShortcutInvoked);
+
+            // Remap Ctrl+A to Shift+V
+            Shortcut newDest;
+            newDest.SetKey(VK_SHIFT);
+            newDest.SetKey(0x56);
+            testState.RemapSnapshotUpdateWrapper([&](RemapSnapshot& snapshot) {
+                snapshot.ClearOSLevelShortcuts();
+                snapshot.AddOSLevelShortcut(src, newDest);
+            });
+
+            // Send A keyup, which is handled with the new remaps
+            SendKey(0x41, true);
+            Assert::AreEqual(false, testState.GetShortcutRemapState(src).isShortcutInvoked);
+        }
+
+        // Test if remaps can be published while the hook handles key events, and measure the time taken by both
+        BEGIN_TEST_METHOD_ATTRIBUTE(RemapSnapshotUpdateWrapper_StressBenchmark)
+            TEST_METHOD_ATTRIBUTE(L"TestCategory", L"Benchmark")
+            TEST_METHOD_ATTRIBUTE(L"Ignore", L"true")
+        END_TEST_METHOD_ATTRIBUTE()
+        TEST_METHOD (RemapSnapshotUpdateWrapper_StressBenchmark)
+        {
+            // Remap A to B and Ctrl+C to Alt+V
+            testState.AddSingleKeyRemap(0x41, 0x42);
+            Shortcut src;
+            src.SetKey(VK_CONTROL);
+            src.SetKey(0x43);
+            Shortcut dest;
+            dest.SetKey(VK_MENU);
+            dest.SetKey(0x56);
+            testState.AddOSLevelShortcut(src, dest);
+
+            // Add and remove an unrelated remap on another thread as a user saving the settings
+            std::atomic_bool isTyping = true;
+            std::atomic<int> publishCount = 0;
+            std::thread publisher([&] {
+                Shortcut otherSrc;
+                otherSrc.SetKey(VK_CONTROL);
+                otherSrc.SetKey(0x44);
+                while (isTyping)
+                {
+                    testState.RemapSnapshotUpdateWrapper([&](RemapSnapshot& snapshot) {
+                        if (!snapshot.AddOSLevelShortcut(otherSrc, VK_ESCAPE))
+                        {
+                            snapshot.osLevelShortcutReMap.erase(otherSrc);
+                            snapshot.osLevelShortcutReMapSortedKeys.erase(std::find(snapshot.osLevelShortcutReMapSortedKeys.begin(), snapshot.osLevelShortcutReMapSortedKeys.end(), otherSrc));
+                        }
+                    });
+                    publishCount++;
+                }
+            });
+
+            constexpr int rounds = 20000;
+            const auto start = std::chrono::steady_clock::now();
+            for (int round = 0; round < rounds; round++)
+            {
+                SendKey(0x41, false);
+                SendKey(0x41, true);
+                SendKey(VK_CONTROL, false);
+                SendKey(0x43, false);
+                SendKey(0x43, true);
+                SendKey(VK_CONTROL, true);
+            }
+            const auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            isTyping = false;
+            publisher.join();
+
+            // All the keys should be released
+            Assert::AreEqual(mockedInputHandler.GetVirtualKeyState(0x42), false);
+            Assert::AreEqual(mockedInputHandler.GetVirtualKeyState(VK_CONTROL), false);
+            Assert::AreEqual(mockedInputHandler.GetVirtualKeyState(VK_MENU), false);
+            Assert::AreEqual(mockedInputHandler.GetVirtualKeyState(0x56), false);
+
+            Logger::WriteMessage((std::to_wstring(rounds * 6) + L" events in " + std::to_wstring(elapsed) + L" ms while " + std::to_wstring(publishCount) + L" snapshots were published\n").c_str());
+        }
+    };
+}
@@ -4,6 +4,7 @@
 #include <keyboardmanager/common/KeyboardManagerState.h>
 #include <keyboardmanager/dll/KeyboardEventHandlers.h>
 #include <keyboardmanager/common/Helpers.h>
+#include <keyboardmanager/common/KeyEventBatch.h>
 #include "TestHelpers.h"
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
@@ -55,5 +56,32 @@ namespace RemappingLogicTests
             Assert::AreEqual<unsigned int>(0, input[0].ki.wScan);
             Assert::AreEqual<unsigned int>(0, input[1].ki.wScan);
         }
+
+        // Test if KeyEventBatch::Reset fails and leaves the batch empty when there are more key events than fit in it
+        TEST_METHOD (KeyEventBatchReset_ShouldFail_WhenCountIsLargerThanCapacity)
+        {
+            KeyEventBatch keyEventList;
+            Assert::IsTrue(keyEventList.Reset(KeyEventBatch::Capacity));
+            Assert::AreEqual(KeyEventBatch::Capacity, keyEventList.Size());
+
+            Assert::IsFalse(keyEventList.Reset(KeyEventBatch::Capacity + 1));
+            Assert::AreEqual(size_t{ 0 }, keyEventList.Size());
+        }
+
+        // Test if KeyEventBatch::SetScanCodes replaces scan codes which were set with another keyboard layout by the ones of the current layout
+        TEST_METHOD (KeyEventBatchSetScanCodes_ShouldUseCurrentKeyboardLayout)
+        {
+            KeyEventBatch keyEventList;
+            keyEventList.Reset(2);
+            KeyboardManagerHelper::SetKeyEvent(keyEventList.Data(), 0, INPUT_KEYBOARD, 0x41, 0, 0);
+            KeyboardManagerHelper::SetKeyEvent(keyEventList.Data(), 1, INPUT_KEYBOARD, VK_CONTROL, KEYEVENTF_KEYUP, 0);
+            keyEventList.Data()[0].ki.wScan = 0x7F;
+            keyEventList.Data()[1].ki.wScan = 0x7F;
+
+            keyEventList.SetScanCodes();
+
+            Assert::AreEqual<unsigned int>(MapVirtualKey(0x41, MAPVK_VK_TO_VSC), keyEventList.Data()[0].ki.wScan);
+            Assert::AreEqual<unsigned int>(MapVirtualKey(VK_CONTROL, MAPVK_VK_TO_VSC), keyEventList.Data()[1].ki.wScan);
+        }
     };
 }
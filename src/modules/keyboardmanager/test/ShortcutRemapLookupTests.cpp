@@ -0,0 +1,237 @@
+#include "pch.h"
+#include "CppUnitTest.h"
+#include "MockedInput.h"
+#include <keyboardmanager/common/KeyboardManagerState.h>
+#include <keyboardmanager/common/ShortcutRemapLookup.h>
+#include <keyboardmanager/dll/KeyboardEventHandlers.h>
+#include "TestHelpers.h"
+#include <common/interop/shared_constants.h>
+#include <chrono>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace KeyboardManagerCommonTests
+{
+    // Tests for the ShortcutRemapLookup class
+    TEST_CLASS (ShortcutRemapLookupTests)
+    {
+    private:
+        MockedInput mockedInputHandler;
+        KeyboardManagerState testState;
+
+        // Function to send a key down or key up event for each key in the list
+        void SendKeys(const std::vector<DWORD>& keys, bool keyUp)
+        {
+            std::vector<INPUT> input(keys.size());
+            for (size_t i = 0; i < keys.size(); i++)
+            {
+                input[i].type = INPUT_KEYBOARD;
+                input[i].ki.wVk = static_cast<WORD>(keys[i]);
+                input[i].ki.dwFlags = keyUp ? KEYEVENTF_KEYUP : 0;
+            }
+
+            mockedInputHandler.SendVirtualInput(static_cast<UINT>(input.size()), input.data(), sizeof(INPUT));
+        }
+
+    public:
+        TEST_METHOD_INITIALIZE(InitializeTestEnv)
+        {
+            // Reset test environment
+            TestHelpers::ResetTestEnv(mockedInputHandler, testState);
+        }
+
+        // Test if the remaps with an action key are returned in the order of the sorted keys
+        TEST_METHOD (GetByActionKey_ShouldReturnRemapsInSortedOrder_WhenRemapsHaveSameActionKey)
+        {
+            Shortcut ctrlA;
+            ctrlA.SetKey(VK_CONTROL);
+            ctrlA.SetKey(0x41);
+            Shortcut ctrlShiftA;
+            ctrlShiftA.SetKey(VK_CONTROL);
+            ctrlShiftA.SetKey(VK_SHIFT);
+            ctrlShiftA.SetKey(0x41);
+            Shortcut altB;
+            altB.SetKey(VK_MENU);
+            altB.SetKey(0x42);
+            Shortcut dest;
+            dest.SetKey(VK_MENU);
+            dest.SetKey(0x56);
+            testState.AddOSLevelShortcut(ctrlA, dest);
+            testState.AddOSLevelShortcut(ctrlShiftA, dest);
+            testState.AddOSLevelShortcut(altB, dest);
+
+            const auto remapSnapshot = testState.GetRemapSnapshot();
+            const auto& lookup = remapSnapshot->GetShortcutRemapLookup(std::nullopt);
+            const auto& candidates = lookup.GetByActionKey(0x41);
+
+            // Larger shortcuts should be checked first
+            Assert::AreEqual(size_t(2), candidates.size());
+            Assert::IsTrue(candidates[0].remap->first == ctrlShiftA);
+            Assert::IsTrue(candidates[1].remap->first == ctrlA);
+            Assert::AreEqual(size_t(3), lookup.GetAll().size());
+            Assert::IsTrue(lookup.GetByActionKey(0x43).empty());
+        }
+
+        // Test if the lookup is updated when the remaps are cleared
+        TEST_METHOD (GetAll_ShouldReturnNoRemaps_WhenRemapsAreCleared)
+        {
+            Shortcut src;
+            src.SetKey(VK_CONTROL);
+            src.SetKey(0x41);
+            Shortcut dest;
+            dest.SetKey(VK_MENU);
+            dest.SetKey(0x56);
+            testState.AddOSLevelShortcut(src, dest);
+            testState.AddAppSpecificShortcut(L"testprocess.exe", src, dest);
+
+            testState.ClearOSLevelShortcuts();
+            testState.ClearAppSpecificShortcuts();
+
+            const auto remapSnapshot = testState.GetRemapSnapshot();
+            Assert::IsTrue(remapSnapshot->GetShortcutRemapLookup(std::nullopt).GetAll().empty());
+            Assert::IsTrue(remapSnapshot->GetShortcutRemapLookup(L"testprocess.exe").GetAll().empty());
+        }
+
+        // Test if CheckModifiers matches CheckModifiersKeyboardState for all the modifier combinations of the shortcut and the keyboard state
+        TEST_METHOD (CheckModifiers_ShouldMatchCheckModifiersKeyboardState_ForAllModifierStates)
+        {
+            const std::vector<DWORD> winKeys = { 0, VK_LWIN, VK_RWIN, CommonSharedConstants::VK_WIN_BOTH };
+            const std::vector<DWORD> ctrlKeys = { 0, VK_LCONTROL, VK_RCONTROL, VK_CONTROL };
+            const std::vector<DWORD> altKeys = { 0, VK_LMENU, VK_RMENU, VK_MENU };
+            const std::vector<DWORD> shiftKeys = { 0, VK_LSHIFT, VK_RSHIFT, VK_SHIFT };
+
+            ShortcutRemapTable table;
+            std::vector<Shortcut> keys;
+            Shortcut dest;
+            dest.SetKey(VK_MENU);
+            dest.SetKey(0x56);
+            for (DWORD winKey : winKeys)
+            {
+                for (DWORD ctrlKey : ctrlKeys)
+                {
+                    for (DWORD altKey : altKeys)
+                    {
+                        for (DWORD shiftKey : shiftKeys)
+                        {
+                            Shortcut src;
+                            for (DWORD key : { winKey, ctrlKey, altKey, shiftKey })
+                            {
+                                if (key != 0)
+                                {
+                                    src.SetKey(key);
+                                }
+                            }
+                            src.SetKey(0x41);
+                            table[src] = RemapShortcut(dest);
+                            keys.push_back(src);
+                        }
+                    }
+                }
+            }
+
+            ShortcutRemapLookup lookup;
+            lookup.Compile(table, keys);
+            Assert::AreEqual(keys.size(), lookup.GetByActionKey(0x41).size());
+
+            const std::vector<DWORD> modifiers = { VK_LWIN, VK_RWIN, VK_LCONTROL, VK_RCONTROL, VK_CONTROL, VK_LMENU, VK_RMENU, VK_MENU, VK_LSHIFT, VK_RSHIFT, VK_SHIFT };
+            for (size_t pressed = 0; pressed < (size_t(1) << modifiers.size()); pressed++)
+            {
+                std::vector<DWORD> pressedKeys;
+                for (size_t i = 0; i < modifiers.size(); i++)
+                {
+                    if (pressed & (size_t(1) << i))
+                    {
+                        pressedKeys.push_back(modifiers[i]);
+                    }
+                }
+                mockedInputHandler.ResetKeyboardState();
+                SendKeys(pressedKeys, false);
+
+                const uint16_t modifierState = ShortcutRemapLookup::GetModifierState(mockedInputHandler);
+                for (const auto& candidate : lookup.GetByActionKey(0x41))
+                {
+                    Assert::AreEqual(candidate.remap->first.CheckModifiersKeyboardState(mockedInputHandler), candidate.CheckModifiers(modifierState));
+                }
+            }
+        }
+
+        // Test the number of key events per second the shortcut remapping hook handles with many remaps
+        BEGIN_TEST_METHOD_ATTRIBUTE(HandleOSLevelShortcutRemapEvent_Benchmark)
+            TEST_METHOD_ATTRIBUTE(L"TestCategory", L"Benchmark")
+            TEST_METHOD_ATTRIBUTE(L"Ignore", L"true")
+        END_TEST_METHOD_ATTRIBUTE()
+        TEST_METHOD (HandleOSLevelShortcutRemapEvent_Benchmark)
+        {
+            std::function<intptr_t(LowlevelKeyboardEvent*)> currentHookProc = std::bind(&KeyboardEventHandlers::HandleOSLevelShortcutRemapEvent, std::ref(mockedInputHandler), std::placeholders::_1, std::ref(testState));
+            mockedInputHandler.SetHookProc([currentHookProc](LowlevelKeyboardEvent* data) {
+                if (data->lParam->dwExtraInfo != KeyboardManagerConstants::KEYBOARDMANAGER_SUPPRESS_FLAG)
+                {
+                    return currentHookProc(data);
+                }
+                else
+                {
+                    return (intptr_t)1;
+                }
+            });
+
+            // Remap Ctrl, Alt, Ctrl+Shift, Ctrl+Alt and Alt+Shift with the keys F1 to F24 and 0 to Z to Win+V
+            Shortcut dest;
+            dest.SetKey(CommonSharedConstants::VK_WIN_BOTH);
+            dest.SetKey(0x56);
+            int remapCount = 0;
+            for (const std::vector<DWORD>& modifiers : std::vector<std::vector<DWORD>>{ { VK_CONTROL }, { VK_MENU }, { VK_CONTROL, VK_SHIFT }, { VK_CONTROL, VK_MENU }, { VK_MENU, VK_SHIFT } })
+            {
+                for (DWORD key = VK_F1; key <= VK_F24; key++)
+                {
+                    Shortcut src;
+                    for (DWORD modifier : modifiers)
+                    {
+                        src.SetKey(modifier);
+                    }
+                    src.SetKey(key);
+                    remapCount += testState.AddOSLevelShortcut(src, dest) ? 1 : 0;
+                }
+                for (DWORD key = 0x30; key <= 0x5A; key++)
+                {
+                    Shortcut src;
+                    for (DWORD modifier : modifiers)
+                    {
+                        src.SetKey(modifier);
+                    }
+                    src.SetKey(key);
+                    remapCount += testState.AddOSLevelShortcut(src, dest) ? 1 : 0;
+                }
+            }
+            Assert::IsTrue(remapCount >= 300);
+
+            // Type text with Shift, which does not invoke any remap, and invoke a remap now and then
+            constexpr int rounds = 2000;
+            const std::vector<DWORD> text = { VK_SHIFT, 0x48, VK_SHIFT, 0x45, 0x4C, 0x4C, 0x4F, VK_SPACE, 0x57, 0x4F, 0x52, 0x4C, 0x44 };
+            size_t events = 0;
+            const auto start = std::chrono::steady_clock::now();
+            for (int round = 0; round < rounds; round++)
+            {
+                for (DWORD key : text)
+                {
+                    SendKeys({ key }, false);
+                    SendKeys({ key }, true);
+                    events += 2;
+                }
+
+                SendKeys({ VK_CONTROL, 0x41 }, false);
+                SendKeys({ 0x41, VK_CONTROL }, true);
+                events += 4;
+            }
+            const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            // All the keys should be released
+            Assert::AreEqual(mockedInputHandler.GetVirtualKeyState(VK_CONTROL), false);
+            Assert::AreEqual(mockedInputHandler.GetVirtualKeyState(VK_LWIN), false);
+            Assert::AreEqual(mockedInputHandler.GetVirtualKeyState(0x56), false);
+
+            Logger::WriteMessage((std::to_wstring(remapCount) + L" remaps: " + std::to_wstring(events) + L" events in " + std::to_wstring(elapsed * 1000) +
+                                  L" ms, " + std::to_wstring(static_cast<size_t>(events / elapsed)) + L" events/s\n")
+                                     .c_str());
+        }
+    };
+}
@@ -5,6 +5,7 @@
 #include <keyboardmanager/dll/KeyboardEventHandlers.h>
 #include "TestHelpers.h"
 #include <common/interop/shared_constants.h>
+#include <chrono>
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 
@@ -314,5 +315,81 @@ namespace RemappingLogicTests
             Assert::AreEqual(mockedInputHandler.GetVirtualKeyState(VK_LCONTROL), false);
             Assert::AreEqual(mockedInputHandler.GetVirtualKeyState(0x56), false);
         }
+
+        // Test if the new target key is sent when a key is remapped again after the remaps are cleared
+        TEST_METHOD (RemappedKeyAfterClear_ShouldSetNewTargetKeyState_OnKeyEvent)
+        {
+            // Remap A to Ctrl+V, then clear the remaps and remap A to C
+            Shortcut dest;
+            dest.SetKey(VK_CONTROL);
+            dest.SetKey(0x56);
+            testState.AddSingleKeyRemap(0x41, dest);
+            testState.ClearSingleKeyRemaps();
+            testState.AddSingleKeyRemap(0x41, 0x43);
+            const int nInputs = 1;
+
+            INPUT input[nInputs] = {};
+            input[0].type = INPUT_KEYBOARD;
+            input[0].ki.wVk = 0x41;
+
+            // Send A keydown
+            mockedInputHandler.SendVirtualInput(nInputs, input, sizeof(INPUT));
+
+            // C key state should be true, and Ctrl, V key states should be false
+            Assert::AreEqual(mockedInputHandler.GetVirtualKeyState(0x43), true);
+            Assert::AreEqual(mockedInputHandler.GetVirtualKeyState(VK_CONTROL), false);
+            Assert::AreEqual(mockedInputHandler.GetVirtualKeyState(0x56), false);
+            input[0].ki.dwFlags = KEYEVENTF_KEYUP;
+
+            // Send A keyup
+            mockedInputHandler.SendVirtualInput(nInputs, input, sizeof(INPUT));
+
+            // C key state should be false
+            Assert::AreEqual(mockedInputHandler.GetVirtualKeyState(0x43), false);
+        }
+
+        // Test the time the single key remapping hook takes per key event
+        BEGIN_TEST_METHOD_ATTRIBUTE(HandleSingleKeyRemapEvent_Benchmark)
+            TEST_METHOD_ATTRIBUTE(L"TestCategory", L"Benchmark")
+            TEST_METHOD_ATTRIBUTE(L"Ignore", L"true")
+        END_TEST_METHOD_ATTRIBUTE()
+        TEST_METHOD (HandleSingleKeyRemapEvent_Benchmark)
+        {
+            // Remap A to B, and Caps Lock to Ctrl+Shift+V
+            Shortcut dest;
+            dest.SetKey(VK_CONTROL);
+            dest.SetKey(VK_SHIFT);
+            dest.SetKey(0x56);
+            testState.AddSingleKeyRemap(0x41, 0x42);
+            testState.AddSingleKeyRemap(VK_CAPITAL, dest);
+            const int nInputs = 1;
+
+            INPUT input[nInputs] = {};
+            input[0].type = INPUT_KEYBOARD;
+
+            constexpr int rounds = 20000;
+            const auto start = std::chrono::steady_clock::now();
+            for (int round = 0; round < rounds; round++)
+            {
+                for (DWORD key : { 0x41, VK_CAPITAL })
+                {
+                    input[0].ki.wVk = static_cast<WORD>(key);
+                    input[0].ki.dwFlags = 0;
+                    mockedInputHandler.SendVirtualInput(nInputs, input, sizeof(INPUT));
+                    input[0].ki.dwFlags = KEYEVENTF_KEYUP;
+                    mockedInputHandler.SendVirtualInput(nInputs, input, sizeof(INPUT));
+                }
+            }
+            const auto elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+            // All the keys should be released
+            Assert::AreEqual(mockedInputHandler.GetVirtualKeyState(0x42), false);
+            Assert::AreEqual(mockedInputHandler.GetVirtualKeyState(VK_CONTROL), false);
+            Assert::AreEqual(mockedInputHandler.GetVirtualKeyState(VK_SHIFT), false);
+            Assert::AreEqual(mockedInputHandler.GetVirtualKeyState(0x56), false);
+
+            const int events = rounds * 4;
+            Logger::WriteMessage((std::to_wstring(events) + L" events in " + std::to_wstring(elapsed / 1000) + L" ms, " + std::to_wstring(elapsed / events) + L" us per event\n").c_str());
+        }
     };
 }
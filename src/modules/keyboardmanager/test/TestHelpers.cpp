@@ -15,11 +15,6 @@ namespace TestHelpers
         state.ClearSingleKeyRemaps();
         state.ClearOSLevelShortcuts();
         state.ClearAppSpecificShortcuts();
-
-        // Allocate memory for the keyboardManagerState activatedApp member to avoid CRT assert errors
-        std::wstring maxLengthString;
-        maxLengthString.resize(MAX_PATH);
-        state.SetActivatedApp(maxLengthString);
-        state.SetActivatedApp(KeyboardManagerConstants::NoActivatedApp);
+        state.SetActivatedAppId(KeyboardManagerConstants::NoActivatedAppId);
     }
 }
@@ -200,7 +200,8 @@ void createEditShortcutsWindow(HINSTANCE hInst, KeyboardManagerState& keyboardMa
 
     // Load existing os level shortcuts into UI
     // Create copy of the remaps to avoid concurrent access
-    ShortcutRemapTable osLevelShortcutReMapCopy = keyboardManagerState.osLevelShortcutReMap;
+    const auto remapSnapshot = keyboardManagerState.GetRemapSnapshot();
+    ShortcutRemapTable osLevelShortcutReMapCopy = remapSnapshot->osLevelShortcutReMap;
 
     for (const auto& it : osLevelShortcutReMapCopy)
     {
@@ -209,7 +210,7 @@ void createEditShortcutsWindow(HINSTANCE hInst, KeyboardManagerState& keyboardMa
 
     // Load existing app-specific shortcuts into UI
     // Create copy of the remaps to avoid concurrent access
-    AppSpecificShortcutRemapTable appSpecificShortcutReMapCopy = keyboardManagerState.appSpecificShortcutReMap;
+    AppSpecificShortcutRemapTable appSpecificShortcutReMapCopy = remapSnapshot->appSpecificShortcutReMap;
 
     // Iterate through all the apps
     for (const auto& itApp : appSpecificShortcutReMapCopy)
@@ -231,13 +232,10 @@ void createEditShortcutsWindow(HINSTANCE hInst, KeyboardManagerState& keyboardMa
     header.SetLeftOf(applyButton, cancelButton);
 
     auto ApplyRemappings = [&keyboardManagerState, _hWndEditShortcutsWindow]() {
-        // Disable the remappings while the remapping table is updated
-        keyboardManagerState.RemappingsDisabledWrapper(
-            [&keyboardManagerState]() {
-                LoadingAndSavingRemappingHelper::ApplyShortcutRemappings(keyboardManagerState, ShortcutControl::shortcutRemapBuffer, true);
-                // Save the updated key remaps to file.
-                bool saveResult = keyboardManagerState.SaveConfigToFile();
-            });
+        // The remappings are kept until the updated remapping table replaces them
+        LoadingAndSavingRemappingHelper::ApplyShortcutRemappings(keyboardManagerState, ShortcutControl::shortcutRemapBuffer, true);
+        // Save the updated key remaps to file.
+        bool saveResult = keyboardManagerState.SaveConfigToFile();
         PostMessage(_hWndEditShortcutsWindow, WM_CLOSE, 0, 0);
     };
 
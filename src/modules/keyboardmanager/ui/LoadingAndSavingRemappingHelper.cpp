@@ -101,9 +101,18 @@ namespace LoadingAndSavingRemappingHelper
 
     // Function to apply the single key remappings from the buffer to the KeyboardManagerState variable
     void ApplySingleKeyRemappings(KeyboardManagerState& keyboardManagerState, const RemapBuffer& remappings, bool isTelemetryRequired)
+    {
+        // The remappings replace the remaps used by the hook at once, after all of them are applied
+        keyboardManagerState.RemapSnapshotUpdateWrapper([&remappings, isTelemetryRequired](RemapSnapshot& remapSnapshot) {
+            ApplySingleKeyRemappings(remapSnapshot, remappings, isTelemetryRequired);
+        });
+    }
+
+    // Function to apply the single key remappings from the buffer to a remap snapshot
+    void ApplySingleKeyRemappings(RemapSnapshot& remapSnapshot, const RemapBuffer& remappings, bool isTelemetryRequired)
     {
         // Clear existing Key Remaps
-        keyboardManagerState.ClearSingleKeyRemaps();
+        remapSnapshot.ClearSingleKeyRemaps();
         DWORD successfulKeyToKeyRemapCount = 0;
         DWORD successfulKeyToShortcutRemapCount = 0;
         for (int i = 0; i < remappings.size(); i++)
@@ -119,27 +128,27 @@ namespace LoadingAndSavingRemappingHelper
                 switch (originalKey)
                 {
                 case VK_CONTROL:
-                    res1 = keyboardManagerState.AddSingleKeyRemap(VK_LCONTROL, newKey);
-                    res2 = keyboardManagerState.AddSingleKeyRemap(VK_RCONTROL, newKey);
+                    res1 = remapSnapshot.AddSingleKeyRemap(VK_LCONTROL, newKey);
+                    res2 = remapSnapshot.AddSingleKeyRemap(VK_RCONTROL, newKey);
                     result = res1 && res2;
                     break;
                 case VK_MENU:
-                    res1 = keyboardManagerState.AddSingleKeyRemap(VK_LMENU, newKey);
-                    res2 = keyboardManagerState.AddSingleKeyRemap(VK_RMENU, newKey);
+                    res1 = remapSnapshot.AddSingleKeyRemap(VK_LMENU, newKey);
+                    res2 = remapSnapshot.AddSingleKeyRemap(VK_RMENU, newKey);
                     result = res1 && res2;
                     break;
                 case VK_SHIFT:
-                    res1 = keyboardManagerState.AddSingleKeyRemap(VK_LSHIFT, newKey);
-                    res2 = keyboardManagerState.AddSingleKeyRemap(VK_RSHIFT, newKey);
+                    res1 = remapSnapshot.AddSingleKeyRemap(VK_LSHIFT, newKey);
+                    res2 = remapSnapshot.AddSingleKeyRemap(VK_RSHIFT, newKey);
                     result = res1 && res2;
                     break;
                 case CommonSharedConstants::VK_WIN_BOTH:
-                    res1 = keyboardManagerState.AddSingleKeyRemap(VK_LWIN, newKey);
-                    res2 = keyboardManagerState.AddSingleKeyRemap(VK_RWIN, newKey);
+                    res1 = remapSnapshot.AddSingleKeyRemap(VK_LWIN, newKey);
+                    res2 = remapSnapshot.AddSingleKeyRemap(VK_RWIN, newKey);
                     result = res1 && res2;
                     break;
                 default:
-                    result = keyboardManagerState.AddSingleKeyRemap(originalKey, newKey);
+                    result = remapSnapshot.AddSingleKeyRemap(originalKey, newKey);
                 }
 
                 if (result)
@@ -165,10 +174,19 @@ namespace LoadingAndSavingRemappingHelper
 
     // Function to apply the shortcut remappings from the buffer to the KeyboardManagerState variable
     void ApplyShortcutRemappings(KeyboardManagerState& keyboardManagerState, const RemapBuffer& remappings, bool isTelemetryRequired)
+    {
+        // The remappings replace the remaps used by the hook at once, after all of them are applied
+        keyboardManagerState.RemapSnapshotUpdateWrapper([&remappings, isTelemetryRequired](RemapSnapshot& remapSnapshot) {
+            ApplyShortcutRemappings(remapSnapshot, remappings, isTelemetryRequired);
+        });
+    }
+
+    // Function to apply the shortcut remappings from the buffer to a remap snapshot
+    void ApplyShortcutRemappings(RemapSnapshot& remapSnapshot, const RemapBuffer& remappings, bool isTelemetryRequired)
     {
         // Clear existing shortcuts
-        keyboardManagerState.ClearOSLevelShortcuts();
-        keyboardManagerState.ClearAppSpecificShortcuts();
+        remapSnapshot.ClearOSLevelShortcuts();
+        remapSnapshot.ClearAppSpecificShortcuts();
         DWORD successfulOSLevelShortcutToShortcutRemapCount = 0;
         DWORD successfulOSLevelShortcutToKeyRemapCount = 0;
         DWORD successfulAppSpecificShortcutToShortcutRemapCount = 0;
@@ -183,7 +201,7 @@ namespace LoadingAndSavingRemappingHelper
             {
                 if (remappings[i].second == L"")
                 {
-                    bool result = keyboardManagerState.AddOSLevelShortcut(originalShortcut, newShortcut);
+                    bool result = remapSnapshot.AddOSLevelShortcut(originalShortcut, newShortcut);
                     if (result)
                     {
                         if (newShortcut.index() == 0)
@@ -198,7 +216,7 @@ namespace LoadingAndSavingRemappingHelper
                 }
                 else
                 {
-                    bool result = keyboardManagerState.AddAppSpecificShortcut(remappings[i].second, originalShortcut, newShortcut);
+                    bool result = remapSnapshot.AddAppSpecificShortcut(remappings[i].second, originalShortcut, newShortcut);
                     if (result)
                     {
                         if (newShortcut.index() == 0)
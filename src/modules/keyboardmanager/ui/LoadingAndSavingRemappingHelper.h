@@ -4,6 +4,7 @@
 #include <variant>
 
 class KeyboardManagerState;
+class RemapSnapshot;
 
 namespace LoadingAndSavingRemappingHelper
 {
@@ -22,6 +23,12 @@ namespace LoadingAndSavingRemappingHelper
     // Function to apply the single key remappings from the buffer to the KeyboardManagerState variable
     void ApplySingleKeyRemappings(KeyboardManagerState& keyboardManagerState, const RemapBuffer& remappings, bool isTelemetryRequired);
 
+    // Function to apply the single key remappings from the buffer to a remap snapshot
+    void ApplySingleKeyRemappings(RemapSnapshot& remapSnapshot, const RemapBuffer& remappings, bool isTelemetryRequired);
+
     // Function to apply the shortcut remappings from the buffer to the KeyboardManagerState variable
     void ApplyShortcutRemappings(KeyboardManagerState& keyboardManagerState, const RemapBuffer& remappings, bool isTelemetryRequired);
+
+    // Function to apply the shortcut remappings from the buffer to a remap snapshot
+    void ApplyShortcutRemappings(RemapSnapshot& remapSnapshot, const RemapBuffer& remappings, bool isTelemetryRequired);
 }
@@ -0,0 +1,199 @@
+#include "pch.h"
+#include "DateTimeTemplate.h"
+
+namespace
+{
+    void AppendNumber(_Inout_ std::wstring& result, _In_ int value, _In_ int minDigits)
+    {
+        wchar_t buffer[16] = { 0 };
+        swprintf_s(buffer, ARRAYSIZE(buffer), L"%0*d", minDigits, value);
+        result.append(buffer);
+    }
+
+    void AppendDateFormat(_Inout_ std::wstring& result, _In_ PCWSTR localeName, _In_ const SYSTEMTIME& fileTime, _In_ PCWSTR format)
+    {
+        wchar_t formattedDate[MAX_PATH] = { 0 };
+        if (GetDateFormatEx(localeName, NULL, &fileTime, format, formattedDate, ARRAYSIZE(formattedDate), NULL) > 1)
+        {
+            // Month and day names are capitalized
+            LCMapStringEx(localeName, LCMAP_UPPERCASE, formattedDate, 1, formattedDate, 1, nullptr, nullptr, 0);
+        }
+        result.append(formattedDate);
+    }
+}
+
+CDateTimeTemplate::CDateTimeTemplate(_In_opt_ PCWSTR source)
+{
+    struct TokenPattern
+    {
+        PCWSTR text;
+        size_t length;
+        TokenType type;
+    };
+
+    // Longest patterns first so that $YYYY is not parsed as $Y followed by "YYY"
+    static const TokenPattern patterns[] = {
+        { L"YYYY", 4, TokenType::YearFourDigits },
+        { L"YY", 2, TokenType::YearTwoDigits },
+        { L"Y", 1, TokenType::YearLastDigit },
+        { L"MMMM", 4, TokenType::MonthName },
+        { L"MMM", 3, TokenType::MonthAbbreviation },
+        { L"MM", 2, TokenType::MonthTwoDigits },
+        { L"M", 1, TokenType::Month },
+        { L"DDDD", 4, TokenType::DayName },
+        { L"DDD", 3, TokenType::DayAbbreviation },
+        { L"DD", 2, TokenType::DayTwoDigits },
+        { L"D", 1, TokenType::Day },
+        { L"hh", 2, TokenType::HoursTwoDigits },
+        { L"h", 1, TokenType::Hours },
+        { L"mm", 2, TokenType::MinutesTwoDigits },
+        { L"m", 1, TokenType::Minutes },
+        { L"ss", 2, TokenType::SecondsTwoDigits },
+        { L"s", 1, TokenType::Seconds },
+        { L"fff", 3, TokenType::MillisecondsThreeDigits },
+        { L"ff", 2, TokenType::MillisecondsTwoDigits },
+        { L"f", 1, TokenType::MillisecondsOneDigit },
+    };
+
+    if (source)
+    {
+        m_source = source;
+    }
+
+    const size_t length = m_source.length();
+    size_t literalStart = 0;
+    size_t i = 0;
+    while (i < length)
+    {
+        if (m_source[i] != L'$')
+        {
+            i++;
+            continue;
+        }
+
+        if (i + 1 < length && m_source[i + 1] == L'$')
+        {
+            // Escaped $, kept as part of the literal
+            i += 2;
+            continue;
+        }
+
+        const TokenPattern* match = nullptr;
+        for (const auto& pattern : patterns)
+        {
+            if (m_source.compare(i + 1, pattern.length, pattern.text) == 0)
+            {
+                match = &pattern;
+                break;
+            }
+        }
+
+        if (match == nullptr)
+        {
+            i++;
+            continue;
+        }
+
+        if (i > literalStart)
+        {
+            m_tokens.push_back({ TokenType::Literal, literalStart, i - literalStart });
+        }
+        m_tokens.push_back({ match->type, 0, 0 });
+        m_usesFileTime = true;
+
+        i += 1 + match->length;
+        literalStart = i;
+    }
+
+    if (length > literalStart)
+    {
+        m_tokens.push_back({ TokenType::Literal, literalStart, length - literalStart });
+    }
+
+    if (m_usesFileTime && GetUserDefaultLocaleName(m_localeName, ARRAYSIZE(m_localeName)) == 0)
+    {
+        StringCchCopy(m_localeName, ARRAYSIZE(m_localeName), L"en_US");
+    }
+}
+
+void CDateTimeTemplate::Expand(_In_ const SYSTEMTIME& fileTime, _Inout_ std::wstring& result) const
+{
+    result.clear();
+    for (const auto& token : m_tokens)
+    {
+        switch (token.type)
+        {
+        case TokenType::Literal:
+            result.append(m_source, token.offset, token.length);
+            break;
+        case TokenType::YearFourDigits:
+            AppendNumber(result, fileTime.wYear, 4);
+            break;
+        case TokenType::YearTwoDigits:
+            AppendNumber(result, fileTime.wYear % 100, 2);
+            break;
+        case TokenType::YearLastDigit:
+            AppendNumber(result, fileTime.wYear % 10, 1);
+            break;
+        case TokenType::MonthName:
+            AppendDateFormat(result, m_localeName, fileTime, L"MMMM");
+            break;
+        case TokenType::MonthAbbreviation:
+            AppendDateFormat(result, m_localeName, fileTime, L"MMM");
+            break;
+        case TokenType::MonthTwoDigits:
+            AppendNumber(result, fileTime.wMonth, 2);
+            break;
+        case TokenType::Month:
+            AppendNumber(result, fileTime.wMonth, 1);
+            break;
+        case TokenType::DayName:
+            AppendDateFormat(result, m_localeName, fileTime, L"dddd");
+            break;
+        case TokenType::DayAbbreviation:
+            AppendDateFormat(result, m_localeName, fileTime, L"ddd");
+            break;
+        case TokenType::DayTwoDigits:
+            AppendNumber(result, fileTime.wDay, 2);
+            break;
+        case TokenType::Day:
+            AppendNumber(result, fileTime.wDay, 1);
+            break;
+        case TokenType::HoursTwoDigits:
+            AppendNumber(result, fileTime.wHour, 2);
+            break;
+        case TokenType::Hours:
+            AppendNumber(result, fileTime.wHour, 1);
+            break;
+        case TokenType::MinutesTwoDigits:
+            AppendNumber(result, fileTime.wMinute, 2);
+            break;
+        case TokenType::Minutes:
+            AppendNumber(result, fileTime.wMinute, 1);
+            break;
+        case TokenType::SecondsTwoDigits:
+            AppendNumber(result, fileTime.wSecond, 2);
+            break;
+        case TokenType::Seconds:
+            AppendNumber(result, fileTime.wSecond, 1);
+            break;
+        case TokenType::MillisecondsThreeDigits:
+            AppendNumber(result, fileTime.wMilliseconds, 3);
+            break;
+        case TokenType::MillisecondsTwoDigits:
+            AppendNumber(result, fileTime.wMilliseconds / 10, 2);
+            break;
+        case TokenType::MillisecondsOneDigit:
+            AppendNumber(result, fileTime.wMilliseconds / 100, 1);
+            break;
+        }
+    }
+}
+
+HRESULT CDateTimeTemplate::Expand(_Out_ PWSTR result, UINT cchMax, _In_ const SYSTEMTIME& fileTime) const
+{
+    std::wstring expanded;
+    expanded.reserve(MAX_PATH);
+    Expand(fileTime, expanded);
+    return StringCchCopy(result, cchMax, expanded.c_str());
+}
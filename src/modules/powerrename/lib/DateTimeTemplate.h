@@ -0,0 +1,59 @@
+#pragma once
+#include "pch.h"
+#include <string>
+#include <vector>
+
+// A replace term parsed once into literal text and file time tokens such as $YYYY or $hh.
+// A $ preceded by an odd number of $ starts a token, "$$" is kept as is.
+// Expanding the template for a given SYSTEMTIME is a single walk over the tokens.
+class CDateTimeTemplate
+{
+public:
+    CDateTimeTemplate() = default;
+    explicit CDateTimeTemplate(_In_opt_ PCWSTR source);
+
+    bool UsesFileTime() const { return m_usesFileTime; }
+    bool IsEmpty() const { return m_source.empty(); }
+
+    void Expand(_In_ const SYSTEMTIME& fileTime, _Inout_ std::wstring& result) const;
+    HRESULT Expand(_Out_ PWSTR result, UINT cchMax, _In_ const SYSTEMTIME& fileTime) const;
+
+private:
+    enum class TokenType : BYTE
+    {
+        Literal,
+        YearFourDigits, // $YYYY
+        YearTwoDigits, // $YY
+        YearLastDigit, // $Y
+        MonthName, // $MMMM
+        MonthAbbreviation, // $MMM
+        MonthTwoDigits, // $MM
+        Month, // $M
+        DayName, // $DDDD
+        DayAbbreviation, // $DDD
+        DayTwoDigits, // $DD
+        Day, // $D
+        HoursTwoDigits, // $hh
+        Hours, // $h
+        MinutesTwoDigits, // $mm
+        Minutes, // $m
+        SecondsTwoDigits, // $ss
+        Seconds, // $s
+        MillisecondsThreeDigits, // $fff
+        MillisecondsTwoDigits, // $ff
+        MillisecondsOneDigit, // $f
+    };
+
+    struct Token
+    {
+        TokenType type;
+        // Range of m_source, only used by literals
+        size_t offset;
+        size_t length;
+    };
+
+    std::wstring m_source;
+    std::vector<Token> m_tokens;
+    bool m_usesFileTime = false;
+    wchar_t m_localeName[LOCALE_NAME_MAX_LENGTH] = { 0 };
+};
@@ -1,6 +1,8 @@
 #include "pch.h"
 #include "Helpers.h"
-#include <regex>
+#include "DateTimeTemplate.h"
+#include <algorithm>
+#include <vector>
 #include <ShlGuid.h>
 #include <cstring>
 #include <filesystem>
@@ -169,126 +171,131 @@ HRESULT GetTransformedFileName(_Out_ PWSTR result, UINT cchMax, _In_ PCWSTR sour
     return hr;
 }
 
-bool isFileTimeUsed(_In_ PCWSTR source) 
+bool isFileTimeUsed(_In_ PCWSTR source)
 {
-    bool used = false;
-    std::wstring patterns[] = { L"(([^\\$]|^)(\\$\\$)*)\\$Y", L"(([^\\$]|^)(\\$\\$)*)\\$M", L"(([^\\$]|^)(\\$\\$)*)\\$D", 
-        L"(([^\\$]|^)(\\$\\$)*)\\$h", L"(([^\\$]|^)(\\$\\$)*)\\$m", L"(([^\\$]|^)(\\$\\$)*)\\$s", L"(([^\\$]|^)(\\$\\$)*)\\$f" };
-    size_t patternsLength = ARRAYSIZE(patterns);
-    for (size_t i = 0; !used && i < patternsLength; i++)
-    {
-        if (std::regex_search(source, std::wregex(patterns[i])))
-        {
-            used = true;
-        }
-    }
-    return used;
+    return CDateTimeTemplate(source).UsesFileTime();
 }
 
 HRESULT GetDatedFileName(_Out_ PWSTR result, UINT cchMax, _In_ PCWSTR source, SYSTEMTIME fileTime)
 {
-    std::locale::global(std::locale(""));
-    HRESULT hr = E_INVALIDARG;     
+    HRESULT hr = E_INVALIDARG;
     if (source && wcslen(source) > 0)
     {
-        std::wstring res(source);
-        wchar_t replaceTerm[MAX_PATH] = { 0 };
-        wchar_t formattedDate[MAX_PATH] = { 0 };
-
-        wchar_t localeName[LOCALE_NAME_MAX_LENGTH];
-        if (GetUserDefaultLocaleName(localeName, LOCALE_NAME_MAX_LENGTH) == 0)
-        {
-            StringCchCopy(localeName, LOCALE_NAME_MAX_LENGTH, L"en_US");
-        }
-
-        StringCchPrintf(replaceTerm, MAX_PATH, TEXT("%s%04d"), L"$01", fileTime.wYear);
-        res = regex_replace(res, std::wregex(L"(([^\\$]|^)(\\$\\$)*)\\$YYYY"), replaceTerm);
-
-        StringCchPrintf(replaceTerm, MAX_PATH, TEXT("%s%02d"), L"$01", (fileTime.wYear % 100));
-        res = regex_replace(res, std::wregex(L"(([^\\$]|^)(\\$\\$)*)\\$YY"), replaceTerm);
-
-        StringCchPrintf(replaceTerm, MAX_PATH, TEXT("%s%d"), L"$01", (fileTime.wYear % 10));
-        res = regex_replace(res, std::wregex(L"(([^\\$]|^)(\\$\\$)*)\\$Y"), replaceTerm);
-        
-        GetDateFormatEx(localeName, NULL, &fileTime, L"MMMM", formattedDate, MAX_PATH, NULL);
-        formattedDate[0] = towupper(formattedDate[0]);
-        StringCchPrintf(replaceTerm, MAX_PATH, TEXT("%s%s"), L"$01", formattedDate);
-        res = regex_replace(res, std::wregex(L"(([^\\$]|^)(\\$\\$)*)\\$MMMM"), replaceTerm);
-        
-        GetDateFormatEx(localeName, NULL, &fileTime, L"MMM", formattedDate, MAX_PATH, NULL);
-        formattedDate[0] = towupper(formattedDate[0]);
-        StringCchPrintf(replaceTerm, MAX_PATH, TEXT("%s%s"), L"$01", formattedDate);
-        res = regex_replace(res, std::wregex(L"(([^\\$]|^)(\\$\\$)*)\\$MMM"), replaceTerm);
-                
-        StringCchPrintf(replaceTerm, MAX_PATH, TEXT("%s%02d"), L"$01", fileTime.wMonth);
-        res = regex_replace(res, std::wregex(L"(([^\\$]|^)(\\$\\$)*)\\$MM"), replaceTerm);
-
-        StringCchPrintf(replaceTerm, MAX_PATH, TEXT("%s%d"), L"$01", fileTime.wMonth);
-        res = regex_replace(res, std::wregex(L"(([^\\$]|^)(\\$\\$)*)\\$M"), replaceTerm);
+        hr = CDateTimeTemplate(source).Expand(result, cchMax, fileTime);
+    }
 
-        GetDateFormatEx(localeName, NULL, &fileTime, L"dddd", formattedDate, MAX_PATH, NULL);
-        formattedDate[0] = towupper(formattedDate[0]);
-        StringCchPrintf(replaceTerm, MAX_PATH, TEXT("%s%s"), L"$01", formattedDate);
-        res = regex_replace(res, std::wregex(L"(([^\\$]|^)(\\$\\$)*)\\$DDDD"), replaceTerm);
-        
-        GetDateFormatEx(localeName, NULL, &fileTime, L"ddd", formattedDate, MAX_PATH, NULL);
-        formattedDate[0] = towupper(formattedDate[0]);
-        StringCchPrintf(replaceTerm, MAX_PATH, TEXT("%s%s"), L"$01", formattedDate);
-        res = regex_replace(res, std::wregex(L"(([^\\$]|^)(\\$\\$)*)\\$DDD"), replaceTerm);
+    return hr;
+}
 
-        StringCchPrintf(replaceTerm, MAX_PATH, TEXT("%s%02d"), L"$01", fileTime.wDay);
-        res = regex_replace(res, std::wregex(L"(([^\\$]|^)(\\$\\$)*)\\$DD"), replaceTerm);
+HRESULT GetShellItemArrayFromDataObject(_In_ IUnknown* dataSource, _COM_Outptr_ IShellItemArray** items)
+{
+    *items = nullptr;
+    CComPtr<IDataObject> dataObj;
+    HRESULT hr;
+    if (SUCCEEDED(dataSource->QueryInterface(IID_PPV_ARGS(&dataObj))))
+    {
+        hr = SHCreateShellItemArrayFromDataObject(dataObj, IID_PPV_ARGS(items));
+    }
+    else
+    {
+        hr = dataSource->QueryInterface(IID_PPV_ARGS(items));
+    }
 
-        StringCchPrintf(replaceTerm, MAX_PATH, TEXT("%s%d"), L"$01", fileTime.wDay);
-        res = regex_replace(res, std::wregex(L"(([^\\$]|^)(\\$\\$)*)\\$D"), replaceTerm);
+    return hr;
+}
 
-        StringCchPrintf(replaceTerm, MAX_PATH, TEXT("%s%02d"), L"$01", fileTime.wHour);
-        res = regex_replace(res, std::wregex(L"(([^\\$]|^)(\\$\\$)*)\\$hh"), replaceTerm);
+HRESULT ParseEnumeratedFileNameTemplate(_In_ PCWSTR pszTemplate, UINT cchMax, int cchDir, _Out_ EnumeratedFileNameTemplate& parsed)
+{
+    parsed = EnumeratedFileNameTemplate();
+    if (!pszTemplate)
+    {
+        return E_INVALIDARG;
+    }
 
-        StringCchPrintf(replaceTerm, MAX_PATH, TEXT("%s%d"), L"$01", fileTime.wHour);
-        res = regex_replace(res, std::wregex(L"(([^\\$]|^)(\\$\\$)*)\\$h"), replaceTerm);
+    int cchStem = 0;
+    PCWSTR pszRest = StrChr(pszTemplate, L'(');
+    while (pszRest)
+    {
+        PCWSTR pszEndUniq = CharNext(pszRest);
+        while (*pszEndUniq && *pszEndUniq >= L'0' && *pszEndUniq <= L'9')
+        {
+            pszEndUniq++;
+        }
 
-        StringCchPrintf(replaceTerm, MAX_PATH, TEXT("%s%02d"), L"$01", fileTime.wMinute);
-        res = regex_replace(res, std::wregex(L"(([^\\$]|^)(\\$\\$)*)\\$mm"), replaceTerm);
+        if (*pszEndUniq == L')')
+        {
+            break;
+        }
 
-        StringCchPrintf(replaceTerm, MAX_PATH, TEXT("%s%d"), L"$01", fileTime.wMinute);
-        res = regex_replace(res, std::wregex(L"(([^\\$]|^)(\\$\\$)*)\\$m"), replaceTerm);
+        pszRest = StrChr(CharNext(pszRest), L'(');
+    }
 
-        StringCchPrintf(replaceTerm, MAX_PATH, TEXT("%s%02d"), L"$01", fileTime.wSecond);
-        res = regex_replace(res, std::wregex(L"(([^\\$]|^)(\\$\\$)*)\\$ss"), replaceTerm);
+    if (!pszRest)
+    {
+        pszRest = PathFindExtension(pszTemplate);
+        cchStem = (int)(pszRest - pszTemplate);
+        parsed.format = L" (%lu)";
+    }
+    else
+    {
+        pszRest++;
 
-        StringCchPrintf(replaceTerm, MAX_PATH, TEXT("%s%d"), L"$01", fileTime.wSecond);
-        res = regex_replace(res, std::wregex(L"(([^\\$]|^)(\\$\\$)*)\\$s"), replaceTerm);
+        cchStem = (int)(pszRest - pszTemplate);
 
-        StringCchPrintf(replaceTerm, MAX_PATH, TEXT("%s%03d"), L"$01", fileTime.wMilliseconds);
-        res = regex_replace(res, std::wregex(L"(([^\\$]|^)(\\$\\$)*)\\$fff"), replaceTerm);
+        while (*pszRest && *pszRest >= L'0' && *pszRest <= L'9')
+        {
+            pszRest++;
+        }
 
-        StringCchPrintf(replaceTerm, MAX_PATH, TEXT("%s%02d"), L"$01", fileTime.wMilliseconds/10);
-        res = regex_replace(res, std::wregex(L"(([^\\$]|^)(\\$\\$)*)\\$ff"), replaceTerm);
+        parsed.format = L"%lu";
+    }
 
-        StringCchPrintf(replaceTerm, MAX_PATH, TEXT("%s%d"), L"$01", fileTime.wMilliseconds/100);
-        res = regex_replace(res, std::wregex(L"(([^\\$]|^)(\\$\\$)*)\\$f"), replaceTerm);
+    parsed.stem.assign(pszTemplate, cchStem);
+    parsed.rest = pszRest;
 
-        hr = StringCchCopy(result, cchMax, res.c_str());
+    int cchFormat = lstrlen(parsed.format);
+    int cchTmp = cchMax - cchDir - cchStem - (cchFormat - 3);
+    switch (cchTmp)
+    {
+    case 1:
+        parsed.maxNumber = 10;
+        break;
+    case 2:
+        parsed.maxNumber = 100;
+        break;
+    case 3:
+        parsed.maxNumber = 1000;
+        break;
+    case 4:
+        parsed.maxNumber = 10000;
+        break;
+    case 5:
+        parsed.maxNumber = 100000;
+        break;
+    default:
+        parsed.maxNumber = (cchTmp <= 0) ? 0 : 1000000;
+        break;
     }
 
-    return hr;
+    return S_OK;
 }
 
-HRESULT GetShellItemArrayFromDataObject(_In_ IUnknown* dataSource, _COM_Outptr_ IShellItemArray** items)
+HRESULT FormatEnumeratedFileName(_Out_ PWSTR result, UINT cchMax, _In_ const EnumeratedFileNameTemplate& parsed, unsigned long number)
 {
-    *items = nullptr;
-    CComPtr<IDataObject> dataObj;
-    HRESULT hr;
-    if (SUCCEEDED(dataSource->QueryInterface(IID_PPV_ARGS(&dataObj))))
-    {
-        hr = SHCreateShellItemArrayFromDataObject(dataObj, IID_PPV_ARGS(items));
-    }
-    else
+    wchar_t szNumber[MAX_PATH] = { 0 };
+    HRESULT hr = StringCchPrintf(szNumber, ARRAYSIZE(szNumber), parsed.format, number);
+    if (SUCCEEDED(hr))
     {
-        hr = dataSource->QueryInterface(IID_PPV_ARGS(items));
+        hr = StringCchCopy(result, cchMax, parsed.stem.c_str());
+        if (SUCCEEDED(hr))
+        {
+            hr = StringCchCat(result, cchMax, szNumber);
+            if (SUCCEEDED(hr))
+            {
+                hr = StringCchCat(result, cchMax, parsed.rest.c_str());
+            }
+        }
     }
-
     return hr;
 }
 
@@ -325,124 +332,24 @@ BOOL GetEnumeratedFileName(__out_ecount(cchMax) PWSTR pszUniqueName, UINT cchMax
         hr = E_INVALIDARG;
     }
 
-    int cchTmp = 0;
-    int cchStem = 0;
-    PCWSTR pszStem = nullptr;
-    PCWSTR pszRest = nullptr;
-    wchar_t szFormat[MAX_PATH] = { 0 };
-
+    EnumeratedFileNameTemplate parsed;
     if (SUCCEEDED(hr))
     {
-        pszStem = pszTemplate;
-
-        pszRest = StrChr(pszTemplate, L'(');
-        while (pszRest)
-        {
-            PCWSTR pszEndUniq = CharNext(pszRest);
-            while (*pszEndUniq && *pszEndUniq >= L'0' && *pszEndUniq <= L'9')
-            {
-                pszEndUniq++;
-            }
-
-            if (*pszEndUniq == L')')
-            {
-                break;
-            }
-
-            pszRest = StrChr(CharNext(pszRest), L'(');
-        }
-
-        if (!pszRest)
-        {
-            pszRest = PathFindExtension(pszTemplate);
-            cchStem = (int)(pszRest - pszTemplate);
-
-            hr = StringCchCopy(szFormat, ARRAYSIZE(szFormat), L" (%lu)");
-        }
-        else
-        {
-            pszRest++;
-
-            cchStem = (int)(pszRest - pszTemplate);
-
-            while (*pszRest && *pszRest >= L'0' && *pszRest <= L'9')
-            {
-                pszRest++;
-            }
-
-            hr = StringCchCopy(szFormat, ARRAYSIZE(szFormat), L"%lu");
-        }
-    }
-
-    unsigned long ulMax = 0;
-    unsigned long ulMin = 0;
-    if (SUCCEEDED(hr))
-    {
-        int cchFormat = lstrlen(szFormat);
-        if (cchFormat < 3)
-        {
-            *pszUniqueName = L'\0';
-            return FALSE;
-        }
-        ulMin = ulMinLong;
-        cchTmp = cchMax - cchDir - cchStem - (cchFormat - 3);
-        switch (cchTmp)
-        {
-        case 1:
-            ulMax = 10;
-            break;
-        case 2:
-            ulMax = 100;
-            break;
-        case 3:
-            ulMax = 1000;
-            break;
-        case 4:
-            ulMax = 10000;
-            break;
-        case 5:
-            ulMax = 100000;
-            break;
-        default:
-            if (cchTmp <= 0)
-            {
-                ulMax = ulMin;
-            }
-            else
-            {
-                ulMax = 1000000;
-            }
-            break;
-        }
+        hr = ParseEnumeratedFileNameTemplate(pszTemplate, cchMax, cchDir, parsed);
     }
 
     if (SUCCEEDED(hr))
     {
-        hr = StringCchCopyN(pszName, pszUniqueName + cchMax - pszName, pszStem, cchStem);
-        if (SUCCEEDED(hr))
+        const UINT cchName = static_cast<UINT>(pszUniqueName + cchMax - pszName);
+        for (unsigned long ul = ulMinLong; ((ul < parsed.maxNumber) && (!fRet)); ul++)
         {
-            PWSTR pszDigit = pszName + cchStem;
-
-            for (unsigned long ul = ulMin; ((ul < ulMax) && (!fRet)); ul++)
+            hr = FormatEnumeratedFileName(pszName, cchName, parsed, ul);
+            // Without a folder there is nothing to check the name against. Probing it relative
+            // to the current directory would only find unrelated files.
+            if (SUCCEEDED(hr) && (!pszDir || !PathFileExists(pszUniqueName)))
             {
-                wchar_t szTemp[MAX_PATH] = { 0 };
-                hr = StringCchPrintf(szTemp, ARRAYSIZE(szTemp), szFormat, ul);
-                if (SUCCEEDED(hr))
-                {
-                    hr = StringCchCat(szTemp, ARRAYSIZE(szTemp), pszRest);
-                    if (SUCCEEDED(hr))
-                    {
-                        hr = StringCchCopy(pszDigit, pszUniqueName + cchMax - pszDigit, szTemp);
-                        if (SUCCEEDED(hr))
-                        {
-                            if (!PathFileExists(pszUniqueName))
-                            {
-                                (*pulNumUsed) = ul;
-                                fRet = TRUE;
-                            }
-                        }
-                    }
-                }
+                (*pulNumUsed) = ul;
+                fRet = TRUE;
             }
         }
     }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <lib/PowerRenameInterfaces.h>
+#include <string>
 
 HRESULT GetTrimmedFileName(_Out_ PWSTR result, UINT cchMax, _In_ PCWSTR source);
 HRESULT GetTransformedFileName(_Out_ PWSTR result, UINT cchMax, _In_ PCWSTR source, DWORD flags);
@@ -15,4 +16,16 @@ BOOL GetEnumeratedFileName(
     __in_opt PCWSTR pszDir,
     unsigned long ulMinLong,
     __inout unsigned long* pulNumUsed);
+// Template of GetEnumeratedFileName split around the number
+struct EnumeratedFileNameTemplate
+{
+    std::wstring stem;
+    PCWSTR format = nullptr;
+    std::wstring rest;
+    // Numbers from this one on do not fit in the name
+    unsigned long maxNumber = 0;
+};
+
+HRESULT ParseEnumeratedFileNameTemplate(_In_ PCWSTR pszTemplate, UINT cchMax, int cchDir, _Out_ EnumeratedFileNameTemplate& parsed);
+HRESULT FormatEnumeratedFileName(_Out_ PWSTR result, UINT cchMax, _In_ const EnumeratedFileNameTemplate& parsed, unsigned long number);
 HWND CreateMsgWindow(_In_ HINSTANCE hInst, _In_ WNDPROC pfnWndProc, _In_ void* p);
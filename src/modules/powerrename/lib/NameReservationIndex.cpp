@@ -0,0 +1,113 @@
+#include "pch.h"
+#include "NameReservationIndex.h"
+#include "Helpers.h"
+#include <filesystem>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    // Key under which a name is stored, equal for names differing only in case
+    std::wstring GetNameKey(_In_ PCWSTR name)
+    {
+        std::wstring key(name);
+        if (!key.empty())
+        {
+            int length = LCMapStringEx(LOCALE_NAME_INVARIANT, LCMAP_UPPERCASE, key.c_str(), static_cast<int>(key.length()), key.data(), static_cast<int>(key.length()), nullptr, nullptr, 0);
+            if (length == 0)
+            {
+                key = name;
+            }
+        }
+        return key;
+    }
+}
+
+bool CNameReservationIndex::IsAvailable(_In_ PCWSTR folder, _In_ PCWSTR name)
+{
+    const Folder& entry = _GetFolder(folder);
+    return entry.names.find(GetNameKey(name)) == entry.names.end();
+}
+
+bool CNameReservationIndex::Reserve(_In_ PCWSTR folder, _In_ PCWSTR name)
+{
+    return _GetFolder(folder).names.insert(GetNameKey(name)).second;
+}
+
+BOOL CNameReservationIndex::GetEnumeratedFileName(__out_ecount(cchMax) PWSTR pszUniqueName, UINT cchMax, __in PCWSTR pszTemplate, __in PCWSTR pszDir, unsigned long ulMin, __inout unsigned long* pulNumUsed)
+{
+    if (0 == cchMax || !pszUniqueName || !pszDir)
+    {
+        return FALSE;
+    }
+
+    *pszUniqueName = L'\0';
+
+    EnumeratedFileNameTemplate parsed;
+    if (FAILED(ParseEnumeratedFileNameTemplate(pszTemplate, cchMax, 0, parsed)))
+    {
+        return FALSE;
+    }
+
+    Folder& folder = _GetFolder(pszDir);
+    auto& nextNumbers = folder.nextNumbers[GetNameKey(pszTemplate)];
+
+    // Follow the links past the numbers already known to be taken. Every number checked here is
+    // either taken or reserved below, so the links stay valid for later calls.
+    BOOL fRet = FALSE;
+    std::vector<unsigned long> visited;
+    unsigned long ul = ulMin;
+    while (ul < parsed.maxNumber)
+    {
+        auto it = nextNumbers.find(ul);
+        if (it == nextNumbers.end())
+        {
+            nextNumbers[ul] = ul + 1;
+            if (SUCCEEDED(FormatEnumeratedFileName(pszUniqueName, cchMax, parsed, ul)) &&
+                folder.names.insert(GetNameKey(pszUniqueName)).second)
+            {
+                (*pulNumUsed) = ul;
+                fRet = TRUE;
+                break;
+            }
+            visited.push_back(ul);
+            ul++;
+        }
+        else
+        {
+            visited.push_back(ul);
+            ul = it->second;
+        }
+    }
+
+    // Point every number passed on the way straight at the end of the run
+    for (unsigned long number : visited)
+    {
+        nextNumbers[number] = ul;
+    }
+
+    if (!fRet)
+    {
+        *pszUniqueName = L'\0';
+    }
+
+    return fRet;
+}
+
+CNameReservationIndex::Folder& CNameReservationIndex::_GetFolder(_In_ PCWSTR folder)
+{
+    auto [it, inserted] = m_folders.try_emplace(GetNameKey(folder));
+    if (inserted)
+    {
+        // A folder that cannot be listed is treated as empty, the file operation still
+        // resolves any collision left
+        std::error_code error;
+        for (fs::directory_iterator entry(folder, error), end; !error && entry != end; entry.increment(error))
+        {
+            it->second.names.insert(GetNameKey(entry->path().filename().c_str()));
+        }
+        m_listingCount++;
+    }
+    return it->second;
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include "pch.h"
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+// Names in use in a set of folders: the items already in a folder, listed once when the folder is
+// first used, plus the names reserved in it so far. Names are compared without case, like the
+// file system does. Items of the batch being renamed still hold their current names, since the
+// order in which the renames run is not known here.
+// Not thread safe.
+class CNameReservationIndex
+{
+public:
+    // Whether name is neither an item of folder nor reserved in it
+    bool IsAvailable(_In_ PCWSTR folder, _In_ PCWSTR name);
+
+    // Reserves name in folder. Returns false if the name is already taken.
+    bool Reserve(_In_ PCWSTR folder, _In_ PCWSTR name);
+
+    // Same as GetEnumeratedFileName, but checks the names against the index instead of the file
+    // system and reserves the name it returns. pszUniqueName receives the name without the folder.
+    // Numbers found taken are remembered per template, so the next call for the same template
+    // skips them. Assigning n names for one template costs O(n) in total rather than O(n^2).
+    BOOL GetEnumeratedFileName(__out_ecount(cchMax) PWSTR pszUniqueName, UINT cchMax, __in PCWSTR pszTemplate, __in PCWSTR pszDir, unsigned long ulMin, __inout unsigned long* pulNumUsed);
+
+    // Number of folders listed so far
+    UINT GetListingCount() const { return m_listingCount; }
+
+private:
+    struct Folder
+    {
+        std::unordered_set<std::wstring> names;
+        // For each template, links from a number known to be taken to a greater number that
+        // may be free. Numbers without a link have not been checked yet.
+        std::unordered_map<std::wstring, std::unordered_map<unsigned long, unsigned long>> nextNumbers;
+    };
+
+    Folder& _GetFolder(_In_ PCWSTR folder);
+
+    std::unordered_map<std::wstring, Folder> m_folders;
+    UINT m_listingCount = 0;
+};
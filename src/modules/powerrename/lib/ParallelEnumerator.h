@@ -0,0 +1,374 @@
+#pragma once
+#include "pch.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Folders deeper than this are not enumerated and fail the enumeration.
+// We shouldn't get this deep since we only enum the contents of regular folders.
+#define MAX_ENUM_DEPTH (MAX_PATH / 2)
+
+// Number of entries backends request from a folder at a time
+#define ENUM_FETCH_SIZE 256
+
+// Walks folder trees on a pool of threads. Each worker takes folders from its own queue and
+// steals from the others when it runs dry. The calling thread receives the entries in the same
+// depth-first order as a recursive walk, as soon as the folders leading up to them are
+// enumerated, so it can publish partial results while the workers carry on. When it reaches a
+// folder no worker has started yet, it enumerates that folder itself instead of waiting.
+//
+// Backend requirements:
+//   typename Backend::Entry   Handle to an item, for example a path. Entries are created on one
+//                             thread and used on another, so they must not be tied to an apartment
+//                             the way shell items are. They only need to be movable.
+//   HRESULT InitializeThread(), void UninitializeThread()
+//                             Called on each worker thread before and after its work
+//   HRESULT GetChildren(const Entry& folder, std::vector<Entry>& children, std::vector<char>& isFolder)
+//                             Lists a folder. Called concurrently for different folders.
+template<typename Backend>
+class CParallelEnumerator
+{
+public:
+    using Entry = typename Backend::Entry;
+
+    explicit CParallelEnumerator(_In_ Backend& backend, _In_ UINT threadCount = 0) :
+        m_backend(backend),
+        m_threadCount(threadCount ? threadCount : (std::max)(std::thread::hardware_concurrency(), 1u))
+    {
+    }
+
+    // Enumerates roots and the contents of the roots that are folders.
+    //
+    // onEntry(const Entry& entry, UINT depth, bool isFolder) is called on the calling thread for
+    // every entry in depth-first order. It returns S_OK to continue into the contents of a folder,
+    // S_FALSE to skip them, or a failure to stop the enumeration.
+    // onFlush() is called before the calling thread waits for a worker and once at the end, so
+    // entries collected by onEntry can be published. A failure stops the enumeration.
+    //
+    // canceled is checked between entries. Returns E_ABORT if it was set, otherwise the first
+    // failure in depth-first order, which includes failing to list a folder.
+    template<typename OnEntry, typename OnFlush>
+    HRESULT Run(_In_ std::vector<Entry> roots, _In_ const std::vector<char>& rootIsFolder, _In_ const std::atomic<bool>& canceled, OnEntry onEntry, OnFlush onFlush)
+    {
+        Node root;
+        root.depth = 0;
+        root.isFolder = true;
+        root.state = NodeState::Ready;
+        _AddChildren(root, roots, rootIsFolder, 0);
+
+        m_queues = std::vector<WorkQueue>(m_threadCount);
+        m_queuedCount = 0;
+        m_pendingCount = 0;
+        m_stop = false;
+        _Push(0, root);
+
+        std::vector<std::thread> threads;
+        for (UINT i = 0; i < m_threadCount; i++)
+        {
+            threads.emplace_back([this, i]() { _WorkerThread(i); });
+        }
+
+        HRESULT hr = _Walk(root, canceled, onEntry, onFlush);
+
+        {
+            std::scoped_lock lock(m_waitLock);
+            m_stop = true;
+        }
+        m_workAvailable.notify_all();
+
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+
+        m_queues.clear();
+        return hr;
+    }
+
+private:
+    enum class NodeState : BYTE
+    {
+        Queued,
+        Claimed,
+        Ready,
+    };
+
+    struct Node
+    {
+        Entry entry{};
+        UINT depth = 0;
+        bool isFolder = false;
+        HRESULT hr = S_OK;
+        std::vector<std::shared_ptr<Node>> children;
+        std::atomic<NodeState> state = NodeState::Queued;
+    };
+
+    struct WorkQueue
+    {
+        std::mutex lock;
+        std::deque<std::shared_ptr<Node>> nodes;
+    };
+
+    void _AddChildren(_In_ Node& node, _Inout_ std::vector<Entry>& children, _In_ const std::vector<char>& isFolder, _In_ UINT depth)
+    {
+        node.children.reserve(children.size());
+        for (size_t i = 0; i < children.size(); i++)
+        {
+            auto child = std::make_shared<Node>();
+            child->entry = std::move(children[i]);
+            child->depth = depth;
+            child->isFolder = isFolder[i] != 0;
+            child->state = child->isFolder ? NodeState::Queued : NodeState::Ready;
+            node.children.push_back(std::move(child));
+        }
+    }
+
+    // Queues the child folders of node on the queue of the given worker
+    void _Push(_In_ UINT queueIndex, _In_ Node& node)
+    {
+        UINT count = 0;
+        {
+            WorkQueue& queue = m_queues[queueIndex % m_queues.size()];
+            std::scoped_lock lock(queue.lock);
+            for (auto& child : node.children)
+            {
+                if (child->isFolder)
+                {
+                    queue.nodes.push_back(child);
+                    count++;
+                }
+            }
+        }
+
+        if (count > 0)
+        {
+            {
+                std::scoped_lock lock(m_waitLock);
+                m_queuedCount += count;
+                m_pendingCount += count;
+            }
+            m_workAvailable.notify_all();
+        }
+    }
+
+    // Takes the most recent folder from the worker's own queue, or the oldest one of another queue
+    std::shared_ptr<Node> _Pop(_In_ UINT queueIndex)
+    {
+        std::shared_ptr<Node> node;
+        for (UINT i = 0; i < m_queues.size() && !node; i++)
+        {
+            WorkQueue& queue = m_queues[(queueIndex + i) % m_queues.size()];
+            std::scoped_lock lock(queue.lock);
+            if (!queue.nodes.empty())
+            {
+                if (i == 0)
+                {
+                    node = std::move(queue.nodes.back());
+                    queue.nodes.pop_back();
+                }
+                else
+                {
+                    node = std::move(queue.nodes.front());
+                    queue.nodes.pop_front();
+                }
+            }
+        }
+
+        if (node)
+        {
+            std::scoped_lock lock(m_waitLock);
+            m_queuedCount--;
+        }
+        return node;
+    }
+
+    // Lists the folder, caller must have claimed it
+    void _Process(_In_ UINT queueIndex, _In_ Node& node)
+    {
+        if (node.depth + 1 >= MAX_ENUM_DEPTH)
+        {
+            node.hr = E_INVALIDARG;
+        }
+        else
+        {
+            std::vector<Entry> children;
+            std::vector<char> isFolder;
+            node.hr = m_backend.GetChildren(node.entry, children, isFolder);
+            if (SUCCEEDED(node.hr))
+            {
+                _AddChildren(node, children, isFolder, node.depth + 1);
+                _Push(queueIndex, node);
+            }
+        }
+
+        _Complete(node);
+    }
+
+    void _Complete(_In_ Node& node)
+    {
+        {
+            std::scoped_lock lock(m_waitLock);
+            node.state = NodeState::Ready;
+            m_pendingCount--;
+        }
+        m_workAvailable.notify_all();
+    }
+
+    void _WorkerThread(_In_ UINT queueIndex)
+    {
+        if (FAILED(m_backend.InitializeThread()))
+        {
+            return;
+        }
+
+        while (true)
+        {
+            std::shared_ptr<Node> node = _Pop(queueIndex);
+            if (node)
+            {
+                NodeState expected = NodeState::Queued;
+                if (node->state.compare_exchange_strong(expected, NodeState::Claimed))
+                {
+                    _Process(queueIndex, *node);
+                }
+                continue;
+            }
+
+            std::unique_lock lock(m_waitLock);
+            m_workAvailable.wait(lock, [this]() { return m_stop || m_queuedCount > 0 || m_pendingCount == 0; });
+            if (m_stop || (m_queuedCount == 0 && m_pendingCount == 0))
+            {
+                break;
+            }
+        }
+
+        m_backend.UninitializeThread();
+    }
+
+    template<typename OnEntry, typename OnFlush>
+    HRESULT _Walk(_In_ Node& root, _In_ const std::atomic<bool>& canceled, OnEntry& onEntry, OnFlush& onFlush)
+    {
+        struct Frame
+        {
+            Node* node;
+            size_t nextChild;
+        };
+
+        std::vector<Frame> stack;
+        stack.push_back({ &root, 0 });
+        while (!stack.empty())
+        {
+            Frame& frame = stack.back();
+            if (frame.nextChild == frame.node->children.size())
+            {
+                // The whole subtree was delivered
+                frame.node->children.clear();
+                stack.pop_back();
+                continue;
+            }
+
+            if (canceled)
+            {
+                return E_ABORT;
+            }
+
+            Node* child = frame.node->children[frame.nextChild++].get();
+            HRESULT hr = onEntry(child->entry, child->depth, child->isFolder);
+            if (FAILED(hr))
+            {
+                return hr;
+            }
+
+            if (!child->isFolder)
+            {
+                continue;
+            }
+
+            NodeState expected = NodeState::Queued;
+            if (hr == S_FALSE)
+            {
+                // Keep the workers from enumerating contents that are not wanted
+                if (child->state.compare_exchange_strong(expected, NodeState::Claimed))
+                {
+                    _Complete(*child);
+                }
+                continue;
+            }
+
+            if (child->state.compare_exchange_strong(expected, NodeState::Claimed))
+            {
+                _Process(0, *child);
+            }
+            else if (child->state != NodeState::Ready)
+            {
+                hr = onFlush();
+                if (FAILED(hr))
+                {
+                    return hr;
+                }
+
+                std::unique_lock lock(m_waitLock);
+                while (child->state != NodeState::Ready && !canceled)
+                {
+                    m_workAvailable.wait_for(lock, std::chrono::milliseconds(50));
+                }
+
+                if (child->state != NodeState::Ready)
+                {
+                    return E_ABORT;
+                }
+            }
+
+            if (FAILED(child->hr))
+            {
+                onFlush();
+                return child->hr;
+            }
+
+            stack.push_back({ child, 0 });
+        }
+
+        return onFlush();
+    }
+
+    Backend& m_backend;
+    const UINT m_threadCount;
+    std::vector<WorkQueue> m_queues;
+
+    std::mutex m_waitLock;
+    std::condition_variable m_workAvailable;
+    // Folders waiting in a queue
+    UINT m_queuedCount = 0;
+    // Folders queued or being enumerated
+    UINT m_pendingCount = 0;
+    bool m_stop = false;
+};
+
+// Lists folders through std::filesystem, to test and benchmark the enumerator on a synthetic tree
+class CFileSystemEnumerationBackend
+{
+public:
+    using Entry = std::filesystem::path;
+
+    HRESULT InitializeThread() { return S_OK; }
+    void UninitializeThread() {}
+
+    HRESULT GetChildren(_In_ const Entry& folder, _Out_ std::vector<Entry>& children, _Out_ std::vector<char>& isFolder)
+    {
+        std::error_code error;
+        for (std::filesystem::directory_iterator it(folder, error), end; !error && it != end; it.increment(error))
+        {
+            std::error_code statusError;
+            children.push_back(it->path());
+            isFolder.push_back(it->is_directory(statusError));
+        }
+        return error ? HRESULT_FROM_WIN32(error.value()) : S_OK;
+    }
+};
@@ -1,7 +1,85 @@
 #include "pch.h"
 #include "PowerRenameEnum.h"
+#include "ParallelEnumerator.h"
 #include <ShlGuid.h>
 #include <helpers.h>
+#include <chrono>
+#include <memory>
+
+// Number of items handed to the manager at a time
+#define ADD_ITEMS_BATCH_SIZE 512
+
+// Longest time created items wait before being handed to the manager. The progress dialog
+// checks for cancel when items are added, so this bounds how long a cancel goes unnoticed
+// when items are slow to come in.
+#define ADD_ITEMS_INTERVAL std::chrono::milliseconds(100)
+
+namespace
+{
+    struct CIDListDeleter
+    {
+        void operator()(_In_ PIDLIST_ABSOLUTE pidl) const { CoTaskMemFree(pidl); }
+    };
+
+    // Lists folders through the shell for CParallelEnumerator. Shell items belong to the apartment
+    // of the thread that created them, so the entries passed between threads are absolute ID lists.
+    // Each thread creates the shell items it needs from them and releases them before returning.
+    class CShellEnumerationBackend
+    {
+    public:
+        using Entry = std::unique_ptr<ITEMIDLIST_ABSOLUTE, CIDListDeleter>;
+
+        HRESULT InitializeThread() { return CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED | COINIT_DISABLE_OLE1DDE); }
+        void UninitializeThread() { CoUninitialize(); }
+
+        HRESULT GetChildren(_In_ const Entry& folder, _Out_ std::vector<Entry>& children, _Out_ std::vector<char>& isFolder)
+        {
+            CComPtr<IShellItem> spsi;
+            HRESULT hr = SHCreateItemFromIDList(folder.get(), IID_PPV_ARGS(&spsi));
+            if (SUCCEEDED(hr))
+            {
+                // Bind to the IShellItem for the IEnumShellItems interface
+                CComPtr<IEnumShellItems> spesi;
+                hr = spsi->BindToHandler(nullptr, BHID_EnumItems, IID_PPV_ARGS(&spesi));
+                if (SUCCEEDED(hr))
+                {
+                    hr = GetEntries(spesi, children, isFolder);
+                }
+            }
+            return hr;
+        }
+
+        static HRESULT GetEntries(_In_ IEnumShellItems* pesi, _Out_ std::vector<Entry>& entries, _Out_ std::vector<char>& isFolder)
+        {
+            IShellItem* fetched[ENUM_FETCH_SIZE] = { 0 };
+            ULONG celtFetched = 0;
+            HRESULT hr = S_OK;
+            do
+            {
+                hr = pesi->Next(ARRAYSIZE(fetched), fetched, &celtFetched);
+                for (ULONG i = 0; i < celtFetched; i++)
+                {
+                    CComPtr<IShellItem> spsi;
+                    spsi.Attach(fetched[i]);
+
+                    // Same test as CPowerRenameItem, some items can be both folders and streams (ex: zip folders).
+                    SFGAOF att = 0;
+                    bool folder = SUCCEEDED(spsi->GetAttributes(SFGAO_STREAM | SFGAO_FOLDER, &att)) && (att & SFGAO_FOLDER) && !(att & SFGAO_STREAM);
+
+                    // Items without an ID list could not be turned into rename items either, skip them
+                    PIDLIST_ABSOLUTE pidl = nullptr;
+                    if (SUCCEEDED(SHGetIDListFromObject(spsi, &pidl)))
+                    {
+                        entries.emplace_back(pidl);
+                        isFolder.push_back(folder);
+                    }
+                }
+            } while (hr == S_OK);
+
+            return SUCCEEDED(hr) ? S_OK : hr;
+        }
+    };
+}
 
 IFACEMETHODIMP_(ULONG) CPowerRenameEnum::AddRef()
 {
@@ -87,58 +165,63 @@ HRESULT CPowerRenameEnum::_Init(_In_ IUnknown* pdo, _In_ IPowerRenameManager* pM
     return S_OK;
 }
 
-HRESULT CPowerRenameEnum::_ParseEnumItems(_In_ IEnumShellItems* pesi, _In_ int depth)
+// Folders are enumerated in parallel while the items are created and added to the manager on
+// this thread, in batches and in the same order as a recursive walk. Items get their id when
+// created, so the manager keeps listing every folder right before its contents.
+HRESULT CPowerRenameEnum::_ParseEnumItems(_In_ IEnumShellItems* pesi)
 {
-    HRESULT hr = E_INVALIDARG;
+    CComPtr<IPowerRenameItemFactory> spFactory;
+    HRESULT hr = m_spsrm->GetRenameItemFactory(&spFactory);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
 
-    // We shouldn't get this deep since we only enum the contents of
-    // regular folders but adding just in case
-    if ((pesi) && (depth < (MAX_PATH / 2)))
+    CShellEnumerationBackend backend;
+    std::vector<CShellEnumerationBackend::Entry> roots;
+    std::vector<char> rootIsFolder;
+    hr = backend.GetEntries(pesi, roots, rootIsFolder);
+    if (FAILED(hr))
     {
-        hr = S_OK;
+        return hr;
+    }
 
-        ULONG celtFetched;
-        CComPtr<IShellItem> spsi;
-        while ((S_OK == pesi->Next(1, &spsi, &celtFetched)) && (SUCCEEDED(hr)))
+    std::vector<CComPtr<IPowerRenameItem>> batch;
+    std::vector<IPowerRenameItem*> batchItems;
+    auto lastAddTime = std::chrono::steady_clock::now();
+    auto addBatch = [&]() {
+        HRESULT hrAdd = S_OK;
+        if (!batch.empty())
         {
-            if (m_canceled)
-            {
-                return E_ABORT;
-            }
+            batchItems.assign(batch.begin(), batch.end());
+            hrAdd = m_spsrm->AddItems(batchItems.data(), static_cast<UINT>(batchItems.size()));
+            batch.clear();
+        }
+        lastAddTime = std::chrono::steady_clock::now();
+        return hrAdd;
+    };
 
-            CComPtr<IPowerRenameItemFactory> spFactory;
-            hr = m_spsrm->GetRenameItemFactory(&spFactory);
-            if (SUCCEEDED(hr))
-            {
-                CComPtr<IPowerRenameItem> spNewItem;
-                // Failure may be valid if we come across a shell item that does
-                // not support a file system path.  In that case we simply ignore
-                // the item.
-                if (SUCCEEDED(spFactory->Create(spsi, &spNewItem)))
-                {
-                    spNewItem->PutDepth(depth);
-                    hr = m_spsrm->AddItem(spNewItem);
-                    if (SUCCEEDED(hr))
-                    {
-                        bool isFolder = false;
-                        if (SUCCEEDED(spNewItem->GetIsFolder(&isFolder)) && isFolder)
-                        {
-                            // Bind to the IShellItem for the IEnumShellItems interface
-                            CComPtr<IEnumShellItems> spesiNext;
-                            hr = spsi->BindToHandler(nullptr, BHID_EnumItems, IID_PPV_ARGS(&spesiNext));
-                            if (SUCCEEDED(hr))
-                            {
-                                // Parse the folder contents recursively
-                                hr = _ParseEnumItems(spesiNext, depth + 1);
-                            }
-                        }
-                    }
-                }
-            }
+    auto addEntry = [&](const CShellEnumerationBackend::Entry& pidl, UINT depth, bool /*isFolder*/) {
+        // The shell item is created on this thread, which owns the rename items
+        CComPtr<IShellItem> spsi;
+        CComPtr<IPowerRenameItem> spNewItem;
+        // Failure may be valid if we come across a shell item that does
+        // not support a file system path.  In that case we simply ignore
+        // the item and its contents.
+        if (FAILED(SHCreateItemFromIDList(pidl.get(), IID_PPV_ARGS(&spsi))) || FAILED(spFactory->Create(spsi, &spNewItem)))
+        {
+            return S_FALSE;
+        }
 
-            spsi = nullptr;
+        spNewItem->PutDepth(depth);
+        batch.push_back(spNewItem);
+        if (batch.size() >= ADD_ITEMS_BATCH_SIZE || std::chrono::steady_clock::now() - lastAddTime >= ADD_ITEMS_INTERVAL)
+        {
+            return addBatch();
         }
-    }
+        return S_OK;
+    };
 
-    return hr;
+    CParallelEnumerator<CShellEnumerationBackend> enumerator(backend);
+    return enumerator.Run(std::move(roots), rootIsFolder, m_canceled, addEntry, addBatch);
 }
@@ -1,6 +1,7 @@
 #pragma once
 #include "pch.h"
 #include "PowerRenameInterfaces.h"
+#include <atomic>
 #include <vector>
 #include "srwlock.h"
 
@@ -25,10 +26,10 @@ protected:
     virtual ~CPowerRenameEnum();
 
     HRESULT _Init(_In_ IUnknown* pdo, _In_ IPowerRenameManager* pManager);
-    HRESULT _ParseEnumItems(_In_ IEnumShellItems* pesi, _In_ int depth = 0);
+    HRESULT _ParseEnumItems(_In_ IEnumShellItems* pesi);
 
     CComPtr<IPowerRenameManager> m_spsrm;
     CComPtr<IUnknown> m_spdo;
-    bool m_canceled = false;
+    std::atomic<bool> m_canceled = false;
     long m_refCount = 0;
 };
\ No newline at end of file
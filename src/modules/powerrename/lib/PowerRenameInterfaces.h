@@ -48,6 +48,7 @@ public:
     IFACEMETHOD(PutFileTime)(_In_ SYSTEMTIME fileTime) = 0;
     IFACEMETHOD(ResetFileTime)() = 0;
     IFACEMETHOD(Replace)(_In_ PCWSTR source, _Outptr_ PWSTR* result) = 0;
+    IFACEMETHOD(ReplaceWithFileTime)(_In_ PCWSTR source, _In_ SYSTEMTIME fileTime, _Outptr_ PWSTR* result) = 0;
 };
 
 interface __declspec(uuid("C7F59201-4DE1-4855-A3A2-26FC3279C8A5")) IPowerRenameItem : public IUnknown
@@ -88,6 +89,7 @@ public:
     IFACEMETHOD(OnRegExCanceled)(_In_ DWORD threadId) = 0;
     IFACEMETHOD(OnRegExCompleted)(_In_ DWORD threadId) = 0;
     IFACEMETHOD(OnRenameStarted)() = 0;
+    IFACEMETHOD(OnRenameProgress)(_In_ UINT processedCount, _In_ UINT totalCount) = 0;
     IFACEMETHOD(OnRenameCompleted)() = 0;
 };
 
@@ -102,6 +104,7 @@ public:
     IFACEMETHOD(Shutdown)() = 0;
     IFACEMETHOD(Rename)(_In_ HWND hwndParent) = 0;
     IFACEMETHOD(AddItem)(_In_ IPowerRenameItem* pItem) = 0;
+    IFACEMETHOD(AddItems)(_In_reads_(count) IPowerRenameItem** items, _In_ UINT count) = 0;
     IFACEMETHOD(GetItemByIndex)(_In_ UINT index, _COM_Outptr_ IPowerRenameItem** ppItem) = 0;
     IFACEMETHOD(GetVisibleItemByIndex)(_In_ UINT index, _COM_Outptr_ IPowerRenameItem ** ppItem) = 0;
     IFACEMETHOD(SetVisible)() = 0;
@@ -0,0 +1,183 @@
+#include "pch.h"
+#include "PowerRenameItemTable.h"
+#include <algorithm>
+
+namespace
+{
+    template<typename T>
+    void ReorderVector(_Inout_ std::vector<T>& values, _In_ const std::vector<UINT>& order)
+    {
+        std::vector<T> reordered;
+        reordered.reserve(values.size());
+        for (UINT from : order)
+        {
+            reordered.push_back(std::move(values[from]));
+        }
+        values.swap(reordered);
+    }
+}
+
+HRESULT CPowerRenameItemTable::Insert(_In_ UINT index, _In_ IPowerRenameItem* item)
+{
+    int id = 0;
+    UINT depth = 0;
+    bool isFolder = false;
+    PWSTR originalName = nullptr;
+    HRESULT hr = item->GetId(&id);
+    if (SUCCEEDED(hr))
+    {
+        hr = item->GetDepth(&depth);
+    }
+    if (SUCCEEDED(hr))
+    {
+        hr = item->GetIsFolder(&isFolder);
+    }
+    if (SUCCEEDED(hr))
+    {
+        hr = item->GetOriginalName(&originalName);
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        size_t nameOffset = m_nameBuffer.size();
+        m_nameBuffer.insert(m_nameBuffer.end(), originalName, originalName + wcslen(originalName) + 1);
+
+        m_ids.insert(m_ids.begin() + index, id);
+        m_depths.insert(m_depths.begin() + index, depth);
+        m_attributes.insert(m_attributes.begin() + index, isFolder ? IsFolder : 0);
+        m_times.insert(m_times.begin() + index, SYSTEMTIME{ 0 });
+        m_nameOffsets.insert(m_nameOffsets.begin() + index, nameOffset);
+        m_newNames.insert(m_newNames.begin() + index, std::wstring());
+        m_substitutedGenerations.insert(m_substitutedGenerations.begin() + index, 0);
+        m_substitutedNames.insert(m_substitutedNames.begin() + index, std::wstring());
+    }
+
+    CoTaskMemFree(originalName);
+    return hr;
+}
+
+void CPowerRenameItemTable::Reorder(_In_ const std::vector<UINT>& order)
+{
+    // The names stay where they are in the buffer, only their offsets move
+    ReorderVector(m_ids, order);
+    ReorderVector(m_depths, order);
+    ReorderVector(m_attributes, order);
+    ReorderVector(m_times, order);
+    ReorderVector(m_nameOffsets, order);
+    ReorderVector(m_newNames, order);
+    ReorderVector(m_substitutedGenerations, order);
+    ReorderVector(m_substitutedNames, order);
+}
+
+bool CPowerRenameItemTable::FindId(_In_ int id, _In_ UINT count, _Out_ UINT* index) const
+{
+    auto end = m_ids.begin() + count;
+    auto it = std::lower_bound(m_ids.begin(), end, id);
+    *index = static_cast<UINT>(it - m_ids.begin());
+    return it != end && *it == id;
+}
+
+bool CPowerRenameItemTable::FindRow(_In_ int id, _In_ UINT hint, _Out_ UINT* index) const
+{
+    if (hint < m_ids.size() && m_ids[hint] == id)
+    {
+        *index = hint;
+        return true;
+    }
+    return FindId(id, GetCount(), index);
+}
+
+void CPowerRenameItemTable::Clear()
+{
+    m_ids.clear();
+    m_depths.clear();
+    m_attributes.clear();
+    m_times.clear();
+    m_nameOffsets.clear();
+    m_nameBuffer.clear();
+    m_newNames.clear();
+    m_substitutedGenerations.clear();
+    m_substitutedNames.clear();
+}
+
+HRESULT CPowerRenameItemTable::ReadTime(_In_ UINT index, _In_ IPowerRenameItem* item)
+{
+    HRESULT hr = S_OK;
+    if (!(m_attributes[index] & HasTime))
+    {
+        hr = item->GetTime(&m_times[index]);
+        if (SUCCEEDED(hr))
+        {
+            m_attributes[index] |= HasTime;
+        }
+    }
+    return hr;
+}
+
+bool CPowerRenameItemTable::UpdateNewName(_In_ UINT index, _In_opt_ PCWSTR newName)
+{
+    const bool hadNewName = (m_attributes[index] & HasNewName) != 0;
+    if (newName == nullptr)
+    {
+        if (!hadNewName)
+        {
+            return false;
+        }
+
+        m_attributes[index] &= ~HasNewName;
+        m_newNames[index].clear();
+        return true;
+    }
+
+    if (hadNewName && m_newNames[index] == newName)
+    {
+        return false;
+    }
+
+    m_attributes[index] |= HasNewName;
+    m_newNames[index] = newName;
+    return true;
+}
+
+bool CPowerRenameItemTable::GetSubstitutedName(_In_ UINT index, _In_ UINT generation, _Out_ PCWSTR* name) const
+{
+    *name = nullptr;
+    if (m_substitutedGenerations[index] != generation)
+    {
+        return false;
+    }
+
+    if (m_attributes[index] & HasSubstitutedName)
+    {
+        *name = m_substitutedNames[index].c_str();
+    }
+    return true;
+}
+
+void CPowerRenameItemTable::PutSubstitutedName(_In_ UINT index, _In_ UINT generation, _In_opt_ PCWSTR name)
+{
+    if (name)
+    {
+        m_attributes[index] |= HasSubstitutedName;
+        m_substitutedNames[index] = name;
+    }
+    else
+    {
+        m_attributes[index] &= ~HasSubstitutedName;
+        m_substitutedNames[index].clear();
+    }
+    m_substitutedGenerations[index] = generation;
+}
+
+size_t CPowerRenameItemTable::GetMemoryUsage() const
+{
+    return m_ids.capacity() * sizeof(int) +
+           m_depths.capacity() * sizeof(UINT) +
+           m_attributes.capacity() * sizeof(BYTE) +
+           m_times.capacity() * sizeof(SYSTEMTIME) +
+           m_nameOffsets.capacity() * sizeof(size_t) +
+           m_nameBuffer.capacity() * sizeof(wchar_t) +
+           m_newNames.capacity() * sizeof(std::wstring) +
+           m_substitutedGenerations.capacity() * sizeof(UINT) +
+           m_substitutedNames.capacity() * sizeof(std::wstring);
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include "pch.h"
+#include "PowerRenameInterfaces.h"
+#include <string>
+#include <vector>
+
+// Packed copy of the per item data used by the rename pipeline, indexed like the
+// manager item list. Worker threads read it directly instead of going through an
+// IPowerRenameItem call (lock + string copy) per property per item.
+//
+// Original names are stored back to back in a single buffer. Pointers returned by
+// GetOriginalName stay valid until the next Insert/Clear, so callers must hold the
+// lock that guards the table.
+class CPowerRenameItemTable
+{
+public:
+    HRESULT Insert(_In_ UINT index, _In_ IPowerRenameItem* item);
+    void Clear();
+
+    // Moves the rows so that row i holds what row order[i] held before
+    void Reorder(_In_ const std::vector<UINT>& order);
+
+    // Finds the row of an item among the first count rows, which must be sorted by id
+    bool FindId(_In_ int id, _In_ UINT count, _Out_ UINT* index) const;
+
+    // Finds the current row of an item. Rows only move when items are added, so row hint,
+    // where the item was last seen, is checked before searching the table.
+    bool FindRow(_In_ int id, _In_ UINT hint, _Out_ UINT* index) const;
+
+    UINT GetCount() const { return static_cast<UINT>(m_ids.size()); }
+    int GetId(_In_ UINT index) const { return m_ids[index]; }
+    PCWSTR GetOriginalName(_In_ UINT index) const { return m_nameBuffer.data() + m_nameOffsets[index]; }
+    bool GetIsFolder(_In_ UINT index) const { return (m_attributes[index] & IsFolder) != 0; }
+    bool GetIsSubFolderContent(_In_ UINT index) const { return m_depths[index] > 0; }
+    UINT GetDepth(_In_ UINT index) const { return m_depths[index]; }
+
+    // File times are only read from the item on first use. ReadTime goes through the item, so it must
+    // be called on the thread that owns the items; GetTime then returns the time read.
+    HRESULT ReadTime(_In_ UINT index, _In_ IPowerRenameItem* item);
+    const SYSTEMTIME& GetTime(_In_ UINT index) const { return m_times[index]; }
+
+    // Records the new name last given to the item. Returns true if it differs from the previous one,
+    // in which case the caller must also update the item. Safe to call concurrently for different indices.
+    bool UpdateNewName(_In_ UINT index, _In_opt_ PCWSTR newName);
+
+    // Result of the match, substitute and trim stages of the preview, kept so that changes which only
+    // affect the later stages (case transform, enumeration) do not run the regex again. Entries are
+    // tagged with the generation they were computed for and ignored once the caller moves to a new one.
+    // A null name means the stages gave no result. Safe to call concurrently for different indices.
+    bool GetSubstitutedName(_In_ UINT index, _In_ UINT generation, _Out_ PCWSTR* name) const;
+    void PutSubstitutedName(_In_ UINT index, _In_ UINT generation, _In_opt_ PCWSTR name);
+
+    // Approximate memory used by the table, excluding the new names
+    size_t GetMemoryUsage() const;
+
+private:
+    enum Attributes : BYTE
+    {
+        IsFolder = 0x1,
+        HasTime = 0x2,
+        HasNewName = 0x4,
+        HasSubstitutedName = 0x8,
+    };
+
+    std::vector<int> m_ids;
+    std::vector<UINT> m_depths;
+    std::vector<BYTE> m_attributes;
+    std::vector<SYSTEMTIME> m_times;
+    std::vector<size_t> m_nameOffsets;
+    std::vector<wchar_t> m_nameBuffer;
+    std::vector<std::wstring> m_newNames;
+    std::vector<UINT> m_substitutedGenerations;
+    std::vector<std::wstring> m_substitutedNames;
+};
@@ -2,11 +2,19 @@
 #include "PowerRenameManager.h"
 #include "PowerRenameRegEx.h" // Default RegEx handler
 #include <algorithm>
+#include <atomic>
+#include <numeric>
+#include <unordered_set>
 #include <shlobj.h>
 #include <cstring>
 #include "helpers.h"
 #include <filesystem>
 #include "trace.h"
+#include "WorkerPool.h"
+#include "RenameExecutor.h"
+#include "NameReservationIndex.h"
+#include <common/SettingsAPI/settings_helpers.h>
+#include <dll/PowerRenameConstants.h>
 #include <winrt/base.h>
 
 namespace fs = std::filesystem;
@@ -16,6 +24,9 @@ extern HINSTANCE g_hInst;
 // The default FOF flags to use in the rename operations
 #define FOF_DEFAULTFLAGS (FOF_ALLOWUNDO | FOFX_ADDUNDORECORD | FOFX_SHOWELEVATIONPROMPT | FOF_RENAMEONCOLLISION)
 
+// Flags that only affect the stages after substitution (case transform, enumeration) or which items are processed
+#define POST_SUBSTITUTE_FLAGS (Uppercase | Lowercase | Titlecase | EnumerateItems | ExcludeFiles | ExcludeFolders | ExcludeSubfolders)
+
 IFACEMETHODIMP_(ULONG)
 CPowerRenameManager::AddRef()
 {
@@ -115,24 +126,102 @@ IFACEMETHODIMP CPowerRenameManager::Shutdown()
 IFACEMETHODIMP CPowerRenameManager::AddItem(_In_ IPowerRenameItem* pItem)
 {
     HRESULT hr = E_FAIL;
+    IPowerRenameItem* addedItem = nullptr;
     // Scope lock
     {
         CSRWExclusiveAutoLock lock(&m_lockItems);
+        hr = _AddItems(&pItem, 1, &addedItem);
+    }
+
+    if (addedItem)
+    {
+        _OnItemAdded(addedItem);
+    }
+
+    return hr;
+}
+
+// Adds the items under a single lock acquisition. OnItemAdded is raised once for the batch,
+// with its last added item. Stops at the first item that cannot be added.
+IFACEMETHODIMP CPowerRenameManager::AddItems(_In_reads_(count) IPowerRenameItem** items, _In_ UINT count)
+{
+    HRESULT hr = S_OK;
+    IPowerRenameItem* lastAddedItem = nullptr;
+    // Scope lock
+    {
+        CSRWExclusiveAutoLock lock(&m_lockItems);
+        hr = _AddItems(items, count, &lastAddedItem);
+    }
+
+    if (lastAddedItem)
+    {
+        _OnItemAdded(lastAddedItem);
+    }
+
+    return hr;
+}
+
+// Items are kept sorted by id. They are almost always added in the order they were created, so
+// the batch is appended and the list is only put back in order, once for the whole batch, when
+// an item was added out of order.
+HRESULT CPowerRenameManager::_AddItems(_In_reads_(count) IPowerRenameItem** items, _In_ UINT count, _Out_ IPowerRenameItem** lastAddedItem)
+{
+    *lastAddedItem = nullptr;
+    HRESULT hr = S_OK;
+    const UINT firstAddedIndex = m_itemTable.GetCount();
+    std::unordered_set<int> addedIds;
+    m_renameItems.reserve(m_renameItems.size() + count);
+    for (UINT i = 0; i < count && SUCCEEDED(hr); i++)
+    {
         int id = 0;
-        pItem->GetId(&id);
+        items[i]->GetId(&id);
         // Verify the item isn't already added
-        if (m_renameItems.find(id) == m_renameItems.end())
+        UINT existingIndex = 0;
+        if (m_itemTable.FindId(id, firstAddedIndex, &existingIndex) || !addedIds.insert(id).second)
         {
-            m_renameItems[id] = pItem;
+            hr = E_FAIL;
+            break;
+        }
+
+        const UINT index = m_itemTable.GetCount();
+        hr = m_itemTable.Insert(index, items[i]);
+        if (SUCCEEDED(hr))
+        {
+            m_renameItems.push_back(items[i]);
             m_isVisible.push_back(true);
-            pItem->AddRef();
-            hr = S_OK;
+            m_visibleItemIndices.push_back(index);
+            items[i]->AddRef();
+            *lastAddedItem = items[i];
         }
     }
 
-    if (SUCCEEDED(hr))
+    const UINT itemCount = m_itemTable.GetCount();
+    bool isSorted = true;
+    for (UINT i = (std::max)(firstAddedIndex, 1u); i < itemCount && isSorted; i++)
+    {
+        isSorted = m_itemTable.GetId(i - 1) < m_itemTable.GetId(i);
+    }
+
+    if (!isSorted)
     {
-        _OnItemAdded(pItem);
+        // The items before the batch are already sorted, so sorting the batch and merging is enough
+        std::vector<UINT> order(itemCount);
+        std::iota(order.begin(), order.end(), 0);
+        auto byId = [this](UINT a, UINT b) { return m_itemTable.GetId(a) < m_itemTable.GetId(b); };
+        std::sort(order.begin() + firstAddedIndex, order.end(), byId);
+        std::inplace_merge(order.begin(), order.begin() + firstAddedIndex, order.end(), byId);
+
+        m_itemTable.Reorder(order);
+        std::vector<IPowerRenameItem*> renameItems(itemCount);
+        std::vector<bool> isVisible(itemCount);
+        for (UINT i = 0; i < itemCount; i++)
+        {
+            renameItems[i] = m_renameItems[order[i]];
+            isVisible[i] = m_isVisible[order[i]];
+        }
+        m_renameItems.swap(renameItems);
+        m_isVisible.swap(isVisible);
+        _UpdateVisibleItemIndices();
     }
 
     return hr;
@@ -145,9 +234,7 @@ IFACEMETHODIMP CPowerRenameManager::GetItemByIndex(_In_ UINT index, _COM_Outptr_
     HRESULT hr = E_FAIL;
     if (index < m_renameItems.size())
     {
-        std::map<int, IPowerRenameItem*>::iterator it = m_renameItems.begin();
-        std::advance(it, index);
-        *ppItem = it->second;
+        *ppItem = m_renameItems[index];
         (*ppItem)->AddRef();
         hr = S_OK;
     }
@@ -159,29 +246,22 @@ IFACEMETHODIMP CPowerRenameManager::GetVisibleItemByIndex(_In_ UINT index, _COM_
 {
     *ppItem = nullptr;
     CSRWSharedAutoLock lock(&m_lockItems);
-    UINT count = 0;
     HRESULT hr = E_FAIL;
 
     if (m_filter == PowerRenameFilters::None)
     {
-        hr = GetItemByIndex(index, ppItem);
-    }
-    else if (SUCCEEDED(GetVisibleItemCount(&count)) && index < count)
-    {
-        UINT realIndex = 0, visibleIndex = 0;
-        for (size_t i = 0; i < m_isVisible.size(); i++)
+        if (index < m_renameItems.size())
         {
-            if (m_isVisible[i] && visibleIndex == index)
-            {
-                realIndex = static_cast<UINT>(i);
-                break;
-            }
-            if (m_isVisible[i])
-            {
-                visibleIndex++;
-            }
+            *ppItem = m_renameItems[index];
+            (*ppItem)->AddRef();
+            hr = S_OK;
         }
-        hr = GetItemByIndex(realIndex, ppItem);
+    }
+    else if (index < m_visibleItemIndices.size())
+    {
+        *ppItem = m_renameItems[m_visibleItemIndices[index]];
+        (*ppItem)->AddRef();
+        hr = S_OK;
     }
 
     return hr;
@@ -193,11 +273,10 @@ IFACEMETHODIMP CPowerRenameManager::GetItemById(_In_ int id, _COM_Outptr_ IPower
 
     CSRWSharedAutoLock lock(&m_lockItems);
     HRESULT hr = E_FAIL;
-    std::map<int, IPowerRenameItem*>::iterator it;
-    it = m_renameItems.find(id);
-    if (it != m_renameItems.end())
+    UINT index = 0;
+    if (m_itemTable.FindId(id, m_itemTable.GetCount(), &index))
     {
-        *ppItem = m_renameItems[id];
+        *ppItem = m_renameItems[index];
         (*ppItem)->AddRef();
         hr = S_OK;
     }
@@ -214,26 +293,32 @@ IFACEMETHODIMP CPowerRenameManager::GetItemCount(_Out_ UINT* count)
 
 IFACEMETHODIMP CPowerRenameManager::SetVisible()
 {
-    CSRWSharedAutoLock lock(&m_lockItems);
-    HRESULT hr = E_FAIL;
+    CSRWExclusiveAutoLock lock(&m_lockItems);
+    _SetVisible();
+    return m_renameItems.empty() ? E_FAIL : S_OK;
+}
+
+void CPowerRenameManager::_SetVisible()
+{
+    bool showAll = false;
+    if (m_filter == PowerRenameFilters::ShouldRename)
+    {
+        PWSTR searchTerm = nullptr;
+        showAll = FAILED(m_spRegEx->GetSearchTerm(&searchTerm)) || searchTerm && wcslen(searchTerm) == 0;
+        CoTaskMemFree(searchTerm);
+    }
+
     UINT lastVisibleDepth = 0;
-    size_t i = m_isVisible.size() - 1;
-    PWSTR searchTerm = nullptr;
-    for (auto rit = m_renameItems.rbegin(); rit != m_renameItems.rend(); ++rit, --i)
+    for (size_t i = m_renameItems.size(); i-- > 0;)
     {
-        bool isVisible = false;
-        if (m_filter == PowerRenameFilters::ShouldRename &&
-            (FAILED(m_spRegEx->GetSearchTerm(&searchTerm)) || searchTerm && wcslen(searchTerm) == 0))
+        bool isVisible = showAll;
+        if (!showAll)
         {
-            isVisible = true;
-        }
-        else
-        {
-            rit->second->IsItemVisible(m_filter, m_flags, &isVisible);
+            m_renameItems[i]->IsItemVisible(m_filter, m_flags, &isVisible);
         }
 
         UINT itemDepth = 0;
-        rit->second->GetDepth(&itemDepth);
+        m_renameItems[i]->GetDepth(&itemDepth);
 
         //Make an item visible if it has a least one visible subitem
         if (isVisible)
@@ -247,28 +332,32 @@ IFACEMETHODIMP CPowerRenameManager::SetVisible()
         }
 
         m_isVisible[i] = isVisible;
-        hr = S_OK;
     }
 
-    return hr;
+    _UpdateVisibleItemIndices();
+}
+
+void CPowerRenameManager::_UpdateVisibleItemIndices()
+{
+    m_visibleItemIndices.clear();
+    for (size_t i = 0; i < m_isVisible.size(); i++)
+    {
+        if (m_isVisible[i])
+        {
+            m_visibleItemIndices.push_back(static_cast<UINT>(i));
+        }
+    }
 }
 
 IFACEMETHODIMP CPowerRenameManager::GetVisibleItemCount(_Out_ UINT* count)
 {
     *count = 0;
-    CSRWSharedAutoLock lock(&m_lockItems);
 
     if (m_filter != PowerRenameFilters::None)
     {
-        SetVisible();
-
-        for (size_t i = 0; i < m_isVisible.size(); i++)
-        {
-            if (m_isVisible[i])
-            {
-                (*count)++;
-            }
-        }
+        CSRWExclusiveAutoLock lock(&m_lockItems);
+        _SetVisible();
+        *count = static_cast<UINT>(m_visibleItemIndices.size());
     }
     else
     {
@@ -283,9 +372,8 @@ IFACEMETHODIMP CPowerRenameManager::GetSelectedItemCount(_Out_ UINT* count)
     *count = 0;
     CSRWSharedAutoLock lock(&m_lockItems);
 
-    for (auto it : m_renameItems)
+    for (auto pItem : m_renameItems)
     {
-        IPowerRenameItem* pItem = it.second;
         bool selected = false;
         if (SUCCEEDED(pItem->GetSelected(&selected)) && selected)
         {
@@ -301,9 +389,8 @@ IFACEMETHODIMP CPowerRenameManager::GetRenameItemCount(_Out_ UINT* count)
     *count = 0;
     CSRWSharedAutoLock lock(&m_lockItems);
 
-    for (auto it : m_renameItems)
+    for (auto pItem : m_renameItems)
     {
-        IPowerRenameItem* pItem = it.second;
         bool shouldRename = false;
         if (SUCCEEDED(pItem->ShouldRenameItem(m_flags, &shouldRename)) && shouldRename)
         {
@@ -375,6 +462,7 @@ IFACEMETHODIMP CPowerRenameManager::PutRenameRegEx(_In_ IPowerRenameRegEx* pRegE
 {
     _ClearRegEx();
     m_spRegEx = pRegEx;
+    InterlockedIncrement(&m_regExVersion);
     return S_OK;
 }
 
@@ -419,6 +507,7 @@ IFACEMETHODIMP CPowerRenameManager::OnFlagsChanged(_In_ DWORD flags)
 
 IFACEMETHODIMP CPowerRenameManager::OnFileTimeChanged(_In_ SYSTEMTIME /*fileTime*/)
 {
+    InterlockedIncrement(&m_regExVersion);
     _PerformRegExRename();
     return S_OK;
 }
@@ -455,6 +544,7 @@ HRESULT CPowerRenameManager::_Init()
 {
     // Guaranteed to succeed
     m_startFileOpWorkerEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+    m_cancelFileOpWorkerEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
     m_startRegExWorkerEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
     m_cancelRegExWorkerEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
 
@@ -466,10 +556,11 @@ HRESULT CPowerRenameManager::_Init()
 // Custom messages for worker threads
 enum
 {
-    SRM_REGEX_ITEM_UPDATED = (WM_APP + 1), // Single rename item processed by regex worker thread
+    SRM_REGEX_ITEM_UPDATED = (WM_APP + 1), // Chunk of rename items processed by regex worker thread, lParam is the first updated item id
     SRM_REGEX_STARTED, // RegEx operation was started
     SRM_REGEX_CANCELED, // Regex operation was canceled
     SRM_REGEX_COMPLETE, // Regex worker thread completed
+    SRM_FILEOP_PROGRESS, // File Operation worker thread progress, wParam is the processed item count and lParam the total
     SRM_FILEOP_COMPLETE // File Operation worker thread completed
 };
 
@@ -535,6 +626,10 @@ LRESULT CPowerRenameManager::_WndProc(_In_ HWND hwnd, _In_ UINT msg, _In_ WPARAM
         _OnRegExCompleted(static_cast<DWORD>(wParam));
         break;
 
+    case SRM_FILEOP_PROGRESS:
+        _OnRenameProgress(static_cast<UINT>(wParam), static_cast<UINT>(lParam));
+        break;
+
     default:
         lRes = DefWindowProc(hwnd, msg, wParam, lParam);
         break;
@@ -609,6 +704,8 @@ HRESULT CPowerRenameManager::_PerformFileOperation()
     // Wait for existing regex thread to finish
     _WaitForRegExWorkerThread();
 
+    ResetEvent(m_cancelFileOpWorkerEvent);
+
     // Create worker thread which will perform the actual rename
     HRESULT hr = _CreateFileOpWorkerThread();
     if (SUCCEEDED(hr))
@@ -657,7 +754,7 @@ HRESULT CPowerRenameManager::_CreateFileOpWorkerThread()
     {
         pwtd->hwndManager = m_hwndMessage;
         pwtd->startEvent = m_startRegExWorkerEvent;
-        pwtd->cancelEvent = nullptr;
+        pwtd->cancelEvent = m_cancelFileOpWorkerEvent;
         pwtd->spsrm = this;
         m_fileOpWorkerThreadHandle = CreateThread(nullptr, 0, s_fileOpWorkerThread, pwtd, 0, nullptr);
         hr = E_FAIL;
@@ -694,67 +791,70 @@ DWORD WINAPI CPowerRenameManager::s_fileOpWorkerThread(_In_ void* pv)
                         DWORD flags = 0;
                         spRenameRegEx->GetFlags(&flags);
 
-                        UINT itemCount = 0;
-                        pwtd->spsrm->GetItemCount(&itemCount);
-
-                        // We add the items to the operation in depth-first order.  This allows child items to be
-                        // renamed before parent items.
-
-                        // Creating a vector of vectors of items of the same depth
-                        std::vector<std::vector<UINT>> matrix(itemCount);
-
-                        for (UINT u = 0; u < itemCount; u++)
-                        {
-                            CComPtr<IPowerRenameItem> spItem;
-                            if (SUCCEEDED(pwtd->spsrm->GetItemByIndex(u, &spItem)))
-                            {
-                                UINT depth = 0;
-                                spItem->GetDepth(&depth);
-                                matrix[depth].push_back(u);
-                            }
-                        }
-
-                        // From the greatest depth first, add all items of that depth to the operation
-                        for (LONG v = itemCount - 1; v >= 0; v--)
+                        std::vector<RenameRequest> requests;
                         {
-                            for (auto it : matrix[v])
+                            CPowerRenameManager* pManager = static_cast<CPowerRenameManager*>(pwtd->spsrm.p);
+                            CSRWSharedAutoLock lock(&pManager->m_lockItems);
+                            for (auto item : pManager->m_renameItems)
                             {
-                                CComPtr<IPowerRenameItem> spItem;
-                                if (SUCCEEDED(pwtd->spsrm->GetItemByIndex(it, &spItem)))
+                                bool shouldRename = false;
+                                if (SUCCEEDED(item->ShouldRenameItem(flags, &shouldRename)) && shouldRename)
                                 {
-                                    bool shouldRename = false;
-                                    if (SUCCEEDED(spItem->ShouldRenameItem(flags, &shouldRename)) && shouldRename)
+                                    PWSTR path = nullptr;
+                                    PWSTR newName = nullptr;
+                                    if (SUCCEEDED(item->GetPath(&path)) && SUCCEEDED(item->GetNewName(&newName)))
                                     {
-                                        PWSTR newName = nullptr;
-                                        if (SUCCEEDED(spItem->GetNewName(&newName)))
-                                        {
-                                            CComPtr<IShellItem> spShellItem;
-                                            if (SUCCEEDED(spItem->GetShellItem(&spShellItem)))
-                                            {
-                                                spFileOp->RenameItem(spShellItem, newName, nullptr);
-                                            }
-                                            CoTaskMemFree(newName);
-                                        }
+                                        requests.push_back({ path, newName });
                                     }
+                                    CoTaskMemFree(path);
+                                    CoTaskMemFree(newName);
                                 }
                             }
                         }
 
-                        // Set the operation flags
-                        if (SUCCEEDED(spFileOp->SetOperationFlags(FOF_DEFAULTFLAGS)))
-                        {
-                            // Set the parent window
-                            if (pwtd->hwndParent)
+                        // Renames are journaled as the file operation reports them. The journal of a batch
+                        // which was interrupted is kept, and its items are skipped when the batch is run again.
+                        std::wstring journalPath = PTSettingsHelper::get_module_save_folder_location(PowerRenameConstants::ModuleKey) + L"\\rename-journal";
+                        std::vector<CRenameJournal::Entry> completed;
+                        CRenameJournal::Load(journalPath.c_str(), completed);
+
+                        // Rename without a journal rather than not at all if it can't be opened
+                        CRenameJournal journal;
+                        CRenameJournal* pJournal = SUCCEEDED(journal.Open(journalPath.c_str())) ? &journal : nullptr;
+
+                        // The executor queues child items before their parent folders. All renames are
+                        // performed by a single IFileOperation so they can be undone as one operation.
+                        // We don't care about the return code here. We would rather
+                        // return control back to explorer so the user can cleanly
+                        // undo the operation if it failed halfway through.
+                        CFileOperationRenameBackend backend(spFileOp, FOF_DEFAULTFLAGS, pwtd->hwndParent, pJournal, pwtd->cancelEvent);
+                        CRenameExecutor executor(backend, pJournal);
+                        executor.SetCompleted(completed);
+
+                        // Only post when the percentage changes so large batches don't flood the manager
+                        std::atomic<UINT> lastPercent = 0;
+                        HWND hwndManager = pwtd->hwndManager;
+                        executor.SetProgressCallback([&lastPercent, hwndManager](UINT processedCount, UINT totalCount) {
+                            UINT percent = totalCount ? static_cast<UINT>(static_cast<ULONGLONG>(processedCount) * 100 / totalCount) : 100;
+                            if (lastPercent.exchange(percent) != percent)
                             {
-                                spFileOp->SetOwnerWindow(pwtd->hwndParent);
+                                PostMessage(hwndManager, SRM_FILEOP_PROGRESS, processedCount, totalCount);
                             }
+                        });
+
+                        RenameStats stats;
+                        HRESULT hr = executor.Execute(requests, pwtd->cancelEvent, stats);
 
-                            // Perform the operation
-                            // We don't care about the return code here. We would rather
-                            // return control back to explorer so the user can cleanly
-                            // undo the operation if it failed halfway through.
-                            spFileOp->PerformOperations();
+                        // A completed batch has nothing left to resume
+                        journal.Close();
+                        if (SUCCEEDED(hr))
+                        {
+                            DeleteFile(journalPath.c_str());
                         }
+
+                        // The counts are the items the file operation reported as renamed or failed,
+                        // so an aborted or failed operation does not report the queued items
+                        Trace::RenameCompleted(stats.renamedCount, stats.failedCount, stats.GetRenamesPerSecond());
                     }
                 }
             }
@@ -799,6 +899,26 @@ HRESULT CPowerRenameManager::_PerformRegExRename()
     return hr;
 }
 
+UINT CPowerRenameManager::_UpdatePreviewGeneration(_In_ PCWSTR searchTerm, _In_ PCWSTR replaceTerm, _In_ DWORD flags)
+{
+    const LONG regExVersion = InterlockedCompareExchange(&m_regExVersion, 0, 0);
+    const DWORD substituteFlags = flags & ~POST_SUBSTITUTE_FLAGS;
+    if (m_previewGeneration == 0 ||
+        m_previewSearchTerm != searchTerm ||
+        m_previewReplaceTerm != replaceTerm ||
+        m_previewFlags != substituteFlags ||
+        m_previewRegExVersion != regExVersion)
+    {
+        m_previewSearchTerm = searchTerm;
+        m_previewReplaceTerm = replaceTerm;
+        m_previewFlags = substituteFlags;
+        m_previewRegExVersion = regExVersion;
+        m_previewGeneration++;
+    }
+
+    return m_previewGeneration;
+}
+
 HRESULT CPowerRenameManager::_CreateRegExWorkerThread()
 {
     WorkerThreadData* pwtd = new WorkerThreadData;
@@ -825,208 +945,339 @@ HRESULT CPowerRenameManager::_CreateRegExWorkerThread()
     return hr;
 }
 
-DWORD WINAPI CPowerRenameManager::s_regexWorkerThread(_In_ void* pv)
+// Puts a substituted name part back together with the rest of the original name and trims it
+static void _ReassembleAndTrimName(_In_ PCWSTR originalName, _In_ PCWSTR newName, _In_ DWORD flags, _Out_ std::wstring& result)
 {
-    try
+    wchar_t resultName[MAX_PATH] = { 0 };
+    if (flags & NameOnly)
     {
-        winrt::check_hresult(CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED | COINIT_DISABLE_OLE1DDE));
-        WorkerThreadData* pwtd = reinterpret_cast<WorkerThreadData*>(pv);
-        if (pwtd)
+        StringCchPrintf(resultName, ARRAYSIZE(resultName), L"%s%s", newName, fs::path(originalName).extension().c_str());
+    }
+    else if (flags & ExtensionOnly)
+    {
+        std::wstring extension = fs::path(originalName).extension().wstring();
+        if (!extension.empty())
         {
-            PostMessage(pwtd->hwndManager, SRM_REGEX_STARTED, GetCurrentThreadId(), 0);
-
-            // Wait to be told we can begin
-            if (WaitForSingleObject(pwtd->startEvent, INFINITE) == WAIT_OBJECT_0)
-            {
-                CComPtr<IPowerRenameRegEx> spRenameRegEx;
-
-                winrt::check_hresult(pwtd->spsrm->GetRenameRegEx(&spRenameRegEx));
+            StringCchPrintf(resultName, ARRAYSIZE(resultName), L"%s.%s", fs::path(originalName).stem().c_str(), newName);
+        }
+        else
+        {
+            StringCchCopy(resultName, ARRAYSIZE(resultName), originalName);
+        }
+    }
+    else
+    {
+        StringCchCopy(resultName, ARRAYSIZE(resultName), newName);
+    }
 
-                DWORD flags = 0;
-                winrt::check_hresult(spRenameRegEx->GetFlags(&flags));
+    wchar_t trimmedName[MAX_PATH] = { 0 };
+    winrt::check_hresult(GetTrimmedFileName(trimmedName, ARRAYSIZE(trimmedName), resultName));
+    result = trimmedName;
+}
 
-                PWSTR replaceTerm = nullptr;
-                bool useFileTime = false;
+static void _GetSourceName(_In_ PCWSTR originalName, _In_ DWORD flags, _Out_writes_(cchMax) PWSTR sourceName, _In_ UINT cchMax)
+{
+    if (flags & NameOnly)
+    {
+        StringCchCopy(sourceName, cchMax, fs::path(originalName).stem().c_str());
+    }
+    else if (flags & ExtensionOnly)
+    {
+        std::wstring extension = fs::path(originalName).extension().wstring();
+        if (!extension.empty() && extension.front() == '.')
+        {
+            extension = extension.erase(0, 1);
+        }
+        StringCchCopy(sourceName, cchMax, extension.c_str());
+    }
+    else
+    {
+        StringCchCopy(sourceName, cchMax, originalName);
+    }
+}
 
-                winrt::check_hresult(spRenameRegEx->GetReplaceTerm(&replaceTerm));
+// Match, substitute and trim stages for a single item. The file time must have been read into
+// the item table beforehand.
+// Returns false if nothing was matched or there was nothing to match.
+static bool _SubstituteName(_In_ CPowerRenameItemTable& itemTable, _In_ UINT index, _In_ IPowerRenameRegEx* spRenameRegEx, _In_ DWORD flags, _In_ bool useFileTime, _Out_ std::wstring& result)
+{
+    PCWSTR originalName = itemTable.GetOriginalName(index);
+    wchar_t sourceName[MAX_PATH] = { 0 };
+    _GetSourceName(originalName, flags, sourceName, ARRAYSIZE(sourceName));
 
-                if (isFileTimeUsed(replaceTerm))
-                {
-                    useFileTime = true;
-                }
+    PWSTR newName = nullptr;
+    if (useFileTime)
+    {
+        winrt::check_hresult(spRenameRegEx->ReplaceWithFileTime(sourceName, itemTable.GetTime(index), &newName));
+    }
+    else
+    {
+        winrt::check_hresult(spRenameRegEx->Replace(sourceName, &newName));
+    }
 
-                UINT itemCount = 0;
-                unsigned long itemEnumIndex = 1;
-                winrt::check_hresult(pwtd->spsrm->GetItemCount(&itemCount));
-                for (UINT u = 0; u < itemCount; u++)
-                {
-                    // Check if cancel event is signaled
-                    if (WaitForSingleObject(pwtd->cancelEvent, 0) == WAIT_OBJECT_0)
-                    {
-                        // Canceled from manager
-                        // Send the manager thread the canceled message
-                        PostMessage(pwtd->hwndManager, SRM_REGEX_CANCELED, GetCurrentThreadId(), 0);
-                        break;
-                    }
+    if (newName == nullptr)
+    {
+        return false;
+    }
 
-                    CComPtr<IPowerRenameItem> spItem;
-                    winrt::check_hresult(pwtd->spsrm->GetItemByIndex(u, &spItem));
+    _ReassembleAndTrimName(originalName, newName, flags, result);
+    CoTaskMemFree(newName);
+    return true;
+}
 
-                    int id = -1;
-                    winrt::check_hresult(spItem->GetId(&id));
+// Computes the new name of a single item, before enumeration is applied. Only reads the item
+// table, so it can run on the worker pool.
+// The result of the substitute stage is reused from the item table when it was computed for the
+// same generation, so only the case transform runs again.
+// Returns false if the item should not get a new name.
+static bool _ComputeNewName(_In_ CPowerRenameItemTable& itemTable, _In_ UINT index, _In_ IPowerRenameRegEx* spRenameRegEx, _In_ DWORD flags, _In_ bool useFileTime, _In_ UINT generation, _Out_ std::wstring& result)
+{
+    const bool isFolder = itemTable.GetIsFolder(index);
+    const bool isSubFolderContent = itemTable.GetIsSubFolderContent(index);
+    PCWSTR originalName = itemTable.GetOriginalName(index);
+    if ((isFolder && (flags & PowerRenameFlags::ExcludeFolders)) ||
+        (!isFolder && (flags & PowerRenameFlags::ExcludeFiles)) ||
+        (isSubFolderContent && (flags & PowerRenameFlags::ExcludeSubfolders)))
+    {
+        // Exclude this item from renaming.
+        return false;
+    }
 
-                    bool isFolder = false;
-                    bool isSubFolderContent = false;
-                    winrt::check_hresult(spItem->GetIsFolder(&isFolder));
-                    winrt::check_hresult(spItem->GetIsSubFolderContent(&isSubFolderContent));
-                    if ((isFolder && (flags & PowerRenameFlags::ExcludeFolders)) ||
-                        (!isFolder && (flags & PowerRenameFlags::ExcludeFiles)) ||
-                        (isSubFolderContent && (flags & PowerRenameFlags::ExcludeSubfolders)))
-                    {
-                        // Exclude this item from renaming.  Ensure new name is cleared.
-                        winrt::check_hresult(spItem->PutNewName(nullptr));
+    PCWSTR substitutedName = nullptr;
+    if (!itemTable.GetSubstitutedName(index, generation, &substitutedName))
+    {
+        std::wstring name;
+        bool substituted = _SubstituteName(itemTable, index, spRenameRegEx, flags, useFileTime, name);
+        itemTable.PutSubstitutedName(index, generation, substituted ? name.c_str() : nullptr);
+        itemTable.GetSubstitutedName(index, generation, &substitutedName);
+    }
 
-                        // Send the manager thread the item processed message
-                        PostMessage(pwtd->hwndManager, SRM_REGEX_ITEM_UPDATED, GetCurrentThreadId(), id);
+    const bool transform = (flags & Uppercase || flags & Lowercase || flags & Titlecase);
 
-                        continue;
-                    }
+    // A null substituted name likely means we have an empty search string. We should leave the new name
+    // null so we clear the renamed column, except when a string transformation is selected.
+    std::wstring untransformedName;
+    if (substitutedName != nullptr)
+    {
+        untransformedName = substitutedName;
+    }
+    else if (transform)
+    {
+        wchar_t sourceName[MAX_PATH] = { 0 };
+        _GetSourceName(originalName, flags, sourceName, ARRAYSIZE(sourceName));
+        _ReassembleAndTrimName(originalName, sourceName, flags, untransformedName);
+    }
+    else
+    {
+        return false;
+    }
 
-                    PWSTR originalName = nullptr;
-                    winrt::check_hresult(spItem->GetOriginalName(&originalName));
+    PCWSTR newNameToUse = untransformedName.c_str();
+    wchar_t transformedName[MAX_PATH] = { 0 };
+    if (transform)
+    {
+        winrt::check_hresult(GetTransformedFileName(transformedName, ARRAYSIZE(transformedName), newNameToUse, flags));
+        newNameToUse = transformedName;
+    }
 
+    // No change from originalName so we clear it from our UI as well.
+    if (lstrcmp(originalName, newNameToUse) == 0)
+    {
+        return false;
+    }
 
-                    PWSTR currentNewName = nullptr;
-                    winrt::check_hresult(spItem->GetNewName(&currentNewName));
+    result = newNameToUse;
+    return true;
+}
 
-                    wchar_t sourceName[MAX_PATH] = { 0 };
-                    if (flags & NameOnly)
-                    {
-                        StringCchCopy(sourceName, ARRAYSIZE(sourceName), fs::path(originalName).stem().c_str());
-                    }
-                    else if (flags & ExtensionOnly)
-                    {
-                        std::wstring extension = fs::path(originalName).extension().wstring();
-                        if (!extension.empty() && extension.front() == '.')
-                        {
-                            extension = extension.erase(0, 1);
-                        }
-                        StringCchCopy(sourceName, ARRAYSIZE(sourceName), extension.c_str());
-                    }
-                    else
-                    {
-                        StringCchCopy(sourceName, ARRAYSIZE(sourceName), originalName);
-                    }
+// Appends the enumeration number to the new names, numbering the items in list order from 1.
+// Each number is checked against the items already in the folder of the item and the names given
+// to the items before it, so no two items of the batch end up with the same name.
+// Returns false if canceled.
+static bool _EnumerateNewNames(_In_ const std::vector<CComPtr<IPowerRenameItem>>& items, _In_ const std::vector<char>& hasNewName, _Inout_ std::vector<std::wstring>& newNames, _In_opt_ HANDLE cancelEvent)
+{
+    CNameReservationIndex reservations;
+    unsigned long itemEnumIndex = 1;
+    for (size_t u = 0; u < items.size(); u++)
+    {
+        if ((u % DEFAULT_CHUNK_SIZE) == 0 && cancelEvent && WaitForSingleObject(cancelEvent, 0) == WAIT_OBJECT_0)
+        {
+            return false;
+        }
 
-                    SYSTEMTIME fileTime = { 0 };
+        if (!hasNewName[u])
+        {
+            continue;
+        }
 
-                    if (useFileTime)
-                    {
-                        winrt::check_hresult(spItem->GetTime(&fileTime));
-                        winrt::check_hresult(spRenameRegEx->PutFileTime(fileTime));
-                    }
+        PWSTR path = nullptr;
+        winrt::check_hresult(items[u]->GetPath(&path));
+        std::wstring folder = fs::path(path).parent_path().wstring();
+        CoTaskMemFree(path);
 
-                    PWSTR newName = nullptr;
+        wchar_t uniqueName[MAX_PATH] = { 0 };
+        unsigned long countUsed = 0;
+        if (reservations.GetEnumeratedFileName(uniqueName, ARRAYSIZE(uniqueName), newNames[u].c_str(), folder.c_str(), itemEnumIndex, &countUsed))
+        {
+            newNames[u] = uniqueName;
+        }
+        itemEnumIndex++;
+    }
+    return true;
+}
 
-                    // Failure here means we didn't match anything or had nothing to match
-                    // Call put_newName with null in that case to reset it
-                    winrt::check_hresult(spRenameRegEx->Replace(sourceName, &newName));
+DWORD WINAPI CPowerRenameManager::s_regexWorkerThread(_In_ void* pv)
+{
+    try
+    {
+        winrt::check_hresult(CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED | COINIT_DISABLE_OLE1DDE));
+        WorkerThreadData* pwtd = reinterpret_cast<WorkerThreadData*>(pv);
+        if (pwtd)
+        {
+            PostMessage(pwtd->hwndManager, SRM_REGEX_STARTED, GetCurrentThreadId(), 0);
 
-                    if (useFileTime)
-                    {
-                        winrt::check_hresult(spRenameRegEx->ResetFileTime());
-                    }
+            // Wait to be told we can begin
+            if (WaitForSingleObject(pwtd->startEvent, INFINITE) == WAIT_OBJECT_0)
+            {
+                CComPtr<IPowerRenameRegEx> spRenameRegEx;
 
-                    wchar_t resultName[MAX_PATH] = { 0 };
+                winrt::check_hresult(pwtd->spsrm->GetRenameRegEx(&spRenameRegEx));
 
-                    PWSTR newNameToUse = nullptr;
+                DWORD flags = 0;
+                winrt::check_hresult(spRenameRegEx->GetFlags(&flags));
 
-                    // newName == nullptr likely means we have an empty search string.  We should leave newNameToUse
-                    // as nullptr so we clear the renamed column
-                    // Except string transformation is selected.
+                PWSTR searchTerm = nullptr;
+                winrt::check_hresult(spRenameRegEx->GetSearchTerm(&searchTerm));
+                PWSTR replaceTerm = nullptr;
+                winrt::check_hresult(spRenameRegEx->GetReplaceTerm(&replaceTerm));
+                const bool useFileTime = isFileTimeUsed(replaceTerm);
+
+                // Item properties are read from the manager's item table. Each chunk holds the
+                // items lock shared, which keeps the table from being modified underneath it.
+                // Items may be added between chunks, moving the rows, so each chunk looks up
+                // the current row of the items by id.
+                CPowerRenameManager* pManager = static_cast<CPowerRenameManager*>(pwtd->spsrm.p);
+                CPowerRenameItemTable& itemTable = pManager->m_itemTable;
+
+                // Substituted names cached in the item table stay valid as long as nothing but the
+                // post substitute flags changed since the previous run.
+                const UINT generation = pManager->_UpdatePreviewGeneration(searchTerm, replaceTerm, flags);
+                CoTaskMemFree(searchTerm);
+                CoTaskMemFree(replaceTerm);
 
-                    if (newName == nullptr && (flags & Uppercase || flags & Lowercase || flags & Titlecase))
+                std::vector<CComPtr<IPowerRenameItem>> items;
+                std::vector<int> ids;
+                {
+                    CSRWSharedAutoLock lock(&pManager->m_lockItems);
+                    items.assign(pManager->m_renameItems.begin(), pManager->m_renameItems.end());
+                    ids.reserve(items.size());
+                    for (UINT u = 0; u < items.size(); u++)
                     {
-                        SHStrDup(sourceName, &newName);
+                        ids.push_back(itemTable.GetId(u));
                     }
-
-                    if (newName != nullptr)
+                }
+                const UINT itemCount = static_cast<UINT>(items.size());
+
+                // New names are computed in two passes over the same chunks. The first pass runs
+                // the regex and the name transforms on the worker pool, the second one publishes
+                // the results. When items are enumerated, the numbers are assigned in between, in
+                // list order. The items are apartment threaded, so they are only called from this
+                // thread; the pool works on the item table and the free-threaded regex.
+                const UINT chunkSize = DEFAULT_CHUNK_SIZE;
+                std::vector<std::wstring> newNames(itemCount);
+                std::vector<char> hasNewName(itemCount);
+
+                bool completed = true;
+                if (useFileTime)
+                {
+                    CSRWSharedAutoLock lock(&pManager->m_lockItems);
+                    for (UINT u = 0; u < itemCount; u++)
                     {
-                        newNameToUse = resultName;
-                        if (flags & NameOnly)
+                        if ((u % chunkSize) == 0 && WaitForSingleObject(pwtd->cancelEvent, 0) == WAIT_OBJECT_0)
                         {
-                            StringCchPrintf(resultName, ARRAYSIZE(resultName), L"%s%s", newName, fs::path(originalName).extension().c_str());
+                            completed = false;
+                            break;
                         }
-                        else if (flags & ExtensionOnly)
+                        UINT row = 0;
+                        if (itemTable.FindRow(ids[u], u, &row))
                         {
-                            std::wstring extension = fs::path(originalName).extension().wstring();
-                            if (!extension.empty())
-                            {
-                                StringCchPrintf(resultName, ARRAYSIZE(resultName), L"%s.%s", fs::path(originalName).stem().c_str(), newName);
-                            }
-                            else
-                            {
-                                StringCchCopy(resultName, ARRAYSIZE(resultName), originalName);
-                            }
+                            winrt::check_hresult(itemTable.ReadTime(row, items[u]));
                         }
-                        else
+                    }
+                }
+
+                if (completed)
+                {
+                    completed = pManager->m_workerPool.ParallelForEachChunk(itemCount, chunkSize, pwtd->cancelEvent, [&](UINT /*chunk*/, UINT begin, UINT end) {
+                        CSRWSharedAutoLock lock(&pManager->m_lockItems);
+                        for (UINT u = begin; u < end; u++)
                         {
-                            StringCchCopy(resultName, ARRAYSIZE(resultName), newName);
+                            UINT row = 0;
+                            if (itemTable.FindRow(ids[u], u, &row))
+                            {
+                                hasNewName[u] = _ComputeNewName(itemTable, row, spRenameRegEx, flags, useFileTime, generation, newNames[u]);
+                            }
                         }
-                    }
+                        return true;
+                    });
+                }
 
-                    wchar_t trimmedName[MAX_PATH] = { 0 };
-                    if (newNameToUse != nullptr)
-                    {
-                        winrt::check_hresult(GetTrimmedFileName(trimmedName, ARRAYSIZE(trimmedName), newNameToUse));
-                        newNameToUse = trimmedName;
-                    }
+                if (completed && (flags & EnumerateItems))
+                {
+                    completed = _EnumerateNewNames(items, hasNewName, newNames, pwtd->cancelEvent);
+                }
 
-                    wchar_t transformedName[MAX_PATH] = { 0 };
-                    if (newNameToUse != nullptr && (flags & Uppercase || flags & Lowercase || flags & Titlecase))
+                for (UINT begin = 0; completed && begin < itemCount; begin += chunkSize)
+                {
+                    if (WaitForSingleObject(pwtd->cancelEvent, 0) == WAIT_OBJECT_0)
                     {
-                        winrt::check_hresult(GetTransformedFileName(transformedName, ARRAYSIZE(transformedName), newNameToUse, flags));
-                        newNameToUse = transformedName;
+                        completed = false;
+                        break;
                     }
 
-                    // No change from originalName so set newName to
-                    // null so we clear it from our UI as well.
-                    if (lstrcmp(originalName, newNameToUse) == 0)
+                    CSRWSharedAutoLock lock(&pManager->m_lockItems);
+                    const UINT end = (std::min)(begin + chunkSize, itemCount);
+                    int firstUpdatedId = -1;
+                    for (UINT u = begin; u < end; u++)
                     {
-                        newNameToUse = nullptr;
-                    }
+                        UINT row = 0;
+                        if (!itemTable.FindRow(ids[u], u, &row))
+                        {
+                            continue;
+                        }
 
-                    wchar_t uniqueName[MAX_PATH] = { 0 };
-                    if (newNameToUse != nullptr && (flags & EnumerateItems))
-                    {
-                        unsigned long countUsed = 0;
-                        if (GetEnumeratedFileName(uniqueName, ARRAYSIZE(uniqueName), newNameToUse, nullptr, itemEnumIndex, &countUsed))
+                        PCWSTR newNameToUse = hasNewName[u] ? newNames[u].c_str() : nullptr;
+
+                        // Was there a change?
+                        if (itemTable.UpdateNewName(row, newNameToUse))
                         {
-                            newNameToUse = uniqueName;
+                            winrt::check_hresult(items[u]->PutNewName(newNameToUse));
+                            if (firstUpdatedId == -1)
+                            {
+                                firstUpdatedId = ids[u];
+                            }
                         }
-                        itemEnumIndex++;
                     }
 
-                    winrt::check_hresult(spItem->PutNewName(newNameToUse));
-
-                    // Was there a change?
-                    if (lstrcmp(currentNewName, newNameToUse) != 0)
+                    // Send the manager thread one item processed message per chunk
+                    if (firstUpdatedId != -1)
                     {
-                        // Send the manager thread the item processed message
-                        PostMessage(pwtd->hwndManager, SRM_REGEX_ITEM_UPDATED, GetCurrentThreadId(), id);
+                        PostMessage(pwtd->hwndManager, SRM_REGEX_ITEM_UPDATED, GetCurrentThreadId(), firstUpdatedId);
                     }
-                    CoTaskMemFree(newName);
-                    CoTaskMemFree(currentNewName);
-                    CoTaskMemFree(originalName);
                 }
-                CoTaskMemFree(replaceTerm);
+
+                if (!completed)
+                {
+                    // Canceled from manager
+                    // Send the manager thread the canceled message
+                    PostMessage(pwtd->hwndManager, SRM_REGEX_CANCELED, GetCurrentThreadId(), 0);
+                }
             }
 
             // Send the manager thread the completion message
             PostMessage(pwtd->hwndManager, SRM_REGEX_COMPLETE, GetCurrentThreadId(), 0);
 
             delete pwtd;
-            
         }
         CoUninitialize();
     }
@@ -1068,6 +1319,7 @@ void CPowerRenameManager::_WaitForRegExWorkerThread()
 void CPowerRenameManager::_Cancel()
 {
     SetEvent(m_startFileOpWorkerEvent);
+    SetEvent(m_cancelFileOpWorkerEvent);
     _CancelRegExWorkerThread();
 }
 
@@ -1202,6 +1454,19 @@ void CPowerRenameManager::_OnRenameStarted()
     }
 }
 
+void CPowerRenameManager::_OnRenameProgress(_In_ UINT processedCount, _In_ UINT totalCount)
+{
+    CSRWSharedAutoLock lock(&m_lockEvents);
+
+    for (auto it : m_powerRenameManagerEvents)
+    {
+        if (it.pEvents)
+        {
+            it.pEvents->OnRenameProgress(processedCount, totalCount);
+        }
+    }
+}
+
 void CPowerRenameManager::_OnRenameCompleted()
 {
     CSRWSharedAutoLock lock(&m_lockEvents);
@@ -1238,17 +1503,19 @@ void CPowerRenameManager::_ClearPowerRenameItems()
     CSRWExclusiveAutoLock lock(&m_lockItems);
 
     // Cleanup rename items
-    for (std::map<int, IPowerRenameItem*>::iterator it = m_renameItems.begin(); it != m_renameItems.end(); ++it)
+    for (auto& pItem : m_renameItems)
     {
-        IPowerRenameItem* pItem = it->second;
         if (pItem)
         {
             pItem->Release();
-            it->second = nullptr;
+            pItem = nullptr;
         }
     }
 
     m_renameItems.clear();
+    m_itemTable.Clear();
+    m_isVisible.clear();
+    m_visibleItemIndices.clear();
 }
 
 void CPowerRenameManager::_Cleanup()
@@ -1262,6 +1529,9 @@ void CPowerRenameManager::_Cleanup()
     CloseHandle(m_startFileOpWorkerEvent);
     m_startFileOpWorkerEvent = nullptr;
 
+    CloseHandle(m_cancelFileOpWorkerEvent);
+    m_cancelFileOpWorkerEvent = nullptr;
+
     CloseHandle(m_startRegExWorkerEvent);
     m_startRegExWorkerEvent = nullptr;
 
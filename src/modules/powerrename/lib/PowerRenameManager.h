@@ -1,7 +1,10 @@
 #pragma once
 #include <vector>
 #include <map>
+#include <unordered_map>
 #include "srwlock.h"
+#include "PowerRenameItemTable.h"
+#include "WorkerPool.h"
 
 #include <lib/PowerRenameManager.h>
 #include <lib/PowerRenameInterfaces.h>
@@ -25,6 +28,7 @@ public:
     IFACEMETHODIMP Shutdown();
     IFACEMETHODIMP Rename(_In_ HWND hwndParent);
     IFACEMETHODIMP AddItem(_In_ IPowerRenameItem* pItem);
+    IFACEMETHODIMP AddItems(_In_reads_(count) IPowerRenameItem** items, _In_ UINT count);
     IFACEMETHODIMP GetItemByIndex(_In_ UINT index, _COM_Outptr_ IPowerRenameItem** ppItem);
     IFACEMETHODIMP GetVisibleItemByIndex(_In_ UINT index, _COM_Outptr_ IPowerRenameItem** ppItem);
     IFACEMETHODIMP GetItemById(_In_ int id, _COM_Outptr_ IPowerRenameItem** ppItem);
@@ -66,14 +70,24 @@ protected:
     void _OnRegExCanceled(_In_ DWORD threadId);
     void _OnRegExCompleted(_In_ DWORD threadId);
     void _OnRenameStarted();
+    void _OnRenameProgress(_In_ UINT processedCount, _In_ UINT totalCount);
     void _OnRenameCompleted();
 
+    // Caller must hold m_lockItems exclusively
+    void _SetVisible();
+    void _UpdateVisibleItemIndices();
+    HRESULT _AddItems(_In_reads_(count) IPowerRenameItem** items, _In_ UINT count, _Out_ IPowerRenameItem** lastAddedItem);
+
     void _ClearEventHandlers();
     void _ClearPowerRenameItems();
 
     HRESULT _PerformRegExRename();
     HRESULT _PerformFileOperation();
 
+    // Returns the generation of the substituted names cached in the item table for the given regex state.
+    // Only called by the regex worker thread.
+    UINT _UpdatePreviewGeneration(_In_ PCWSTR searchTerm, _In_ PCWSTR replaceTerm, _In_ DWORD flags);
+
     HRESULT _CreateRegExWorkerThread();
     void _CancelRegExWorkerThread();
     void _WaitForRegExWorkerThread();
@@ -99,6 +113,7 @@ protected:
 
     HANDLE m_fileOpWorkerThreadHandle = nullptr;
     HANDLE m_startFileOpWorkerEvent = nullptr;
+    HANDLE m_cancelFileOpWorkerEvent = nullptr;
 
     CSRWLock m_lockEvents;
     CSRWLock m_lockItems;
@@ -120,14 +135,33 @@ protected:
     CComPtr<IPowerRenameRegEx> m_spRegEx;
 
     _Guarded_by_(m_lockEvents) std::vector<RENAME_MGR_EVENT> m_powerRenameManagerEvents;
-    _Guarded_by_(m_lockItems) std::map<int, IPowerRenameItem*> m_renameItems;
+    // Items are kept sorted by id, which is also the order they were enumerated in
+    _Guarded_by_(m_lockItems) std::vector<IPowerRenameItem*> m_renameItems;
+    // Packed item properties used by the worker threads, same order as m_renameItems.
+    // Items are looked up by id through a binary search of its sorted ids.
+    _Guarded_by_(m_lockItems) CPowerRenameItemTable m_itemTable;
     _Guarded_by_(m_lockItems) std::vector<bool> m_isVisible;
+    // Index in m_renameItems of each visible item, as of the last visibility update
+    _Guarded_by_(m_lockItems) std::vector<UINT> m_visibleItemIndices;
+
+    // Regex state the current preview generation was computed for. Only accessed by the regex
+    // worker thread, of which at most one runs at a time.
+    std::wstring m_previewSearchTerm;
+    std::wstring m_previewReplaceTerm;
+    DWORD m_previewFlags = 0;
+    LONG m_previewRegExVersion = 0;
+    UINT m_previewGeneration = 0;
+    // Incremented when the regex changes in a way the terms and flags do not show
+    volatile LONG m_regExVersion = 0;
 
     // Parent HWND used by IFileOperation
     HWND m_hwndParent = nullptr;
 
     HWND m_hwndMessage = nullptr;
 
+    // Computes the preview of the regex worker thread
+    CWorkerPool m_workerPool;
+
     CRITICAL_SECTION m_critsecReentrancy;
 
     long m_refCount;
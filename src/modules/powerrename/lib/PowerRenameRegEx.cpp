@@ -4,12 +4,27 @@
 #include <regex>
 #include <string>
 #include <algorithm>
+#include <iterator>
 #include <boost/regex.hpp>
 #include <helpers.h>
 
 using namespace std;
 using std::regex_error;
 
+namespace
+{
+    // Converts the user facing $0 / $1..$9 syntax to the format syntax expected by regex_replace.
+    // The escaping patterns are compiled only once.
+    std::wstring FormatReplaceTerm(const std::wstring& replaceTerm)
+    {
+        static const std::wregex zeroGroupPattern(L"(([^\\$]|^)(\\$\\$)*)\\$[0]");
+        static const std::wregex numberedGroupPattern(L"(([^\\$]|^)(\\$\\$)*)\\$([1-9])");
+
+        std::wstring result = regex_replace(replaceTerm, zeroGroupPattern, L"$1$$$0");
+        return regex_replace(result, numberedGroupPattern, L"$1$0$4");
+    }
+}
+
 IFACEMETHODIMP_(ULONG) CPowerRenameRegEx::AddRef()
 {
     return InterlockedIncrement(&m_refCount);
@@ -32,7 +47,12 @@ IFACEMETHODIMP CPowerRenameRegEx::QueryInterface(_In_ REFIID riid, _Outptr_ void
         QITABENT(CPowerRenameRegEx, IPowerRenameRegEx),
         { 0 }
     };
-    return QISearch(this, qit, riid, ppv);
+    HRESULT hr = QISearch(this, qit, riid, ppv);
+    if (hr == E_NOINTERFACE && riid == IID_IMarshal && m_spFreeThreadedMarshaler)
+    {
+        hr = m_spFreeThreadedMarshaler->QueryInterface(riid, ppv);
+    }
+    return hr;
 }
 
 IFACEMETHODIMP CPowerRenameRegEx::Advise(_In_ IPowerRenameRegExEvents* regExEvents, _Out_ DWORD* cookie)
@@ -97,6 +117,7 @@ IFACEMETHODIMP CPowerRenameRegEx::PutSearchTerm(_In_ PCWSTR searchTerm)
             changed = true;
             CoTaskMemFree(m_searchTerm);
             hr = SHStrDup(searchTerm, &m_searchTerm);
+            _CompilePattern();
         }
     }
 
@@ -132,6 +153,7 @@ IFACEMETHODIMP CPowerRenameRegEx::PutReplaceTerm(_In_ PCWSTR replaceTerm)
             changed = true;
             CoTaskMemFree(m_replaceTerm);
             hr = SHStrDup(replaceTerm, &m_replaceTerm);
+            _CompilePattern();
         }
     }
 
@@ -151,9 +173,19 @@ IFACEMETHODIMP CPowerRenameRegEx::GetFlags(_Out_ DWORD* flags)
 
 IFACEMETHODIMP CPowerRenameRegEx::PutFlags(_In_ DWORD flags)
 {
-    if (m_flags != flags)
+    bool changed = false;
+    {
+        CSRWExclusiveAutoLock lock(&m_lock);
+        if (m_flags != flags)
+        {
+            changed = true;
+            m_flags = flags;
+            _CompilePattern();
+        }
+    }
+
+    if (changed)
     {
-        m_flags = flags;
         _OnFlagsChanged();
     }
     return S_OK;
@@ -213,6 +245,12 @@ CPowerRenameRegEx::CPowerRenameRegEx() :
     SHStrDup(L"", &m_replaceTerm);
 
     _useBoostLib = CSettingsInstance().GetUseBoostLib();
+
+    // Replace is called from the preview worker pool, so the object is usable from any apartment
+    CoCreateFreeThreadedMarshaler(static_cast<IPowerRenameRegEx*>(this), &m_spFreeThreadedMarshaler);
+
+    CSRWExclusiveAutoLock lock(&m_lock);
+    _CompilePattern();
 }
 
 CPowerRenameRegEx::~CPowerRenameRegEx()
@@ -221,110 +259,313 @@ CPowerRenameRegEx::~CPowerRenameRegEx()
     CoTaskMemFree(m_replaceTerm);
 }
 
+void CPowerRenameRegEx::_CompilePattern()
+{
+    auto compiled = std::make_shared<CompiledPattern>();
+    compiled->flags = m_flags;
+    compiled->searchTerm = m_searchTerm ? m_searchTerm : L"";
+    compiled->replaceTerm = m_replaceTerm ? m_replaceTerm : L"";
+
+    std::shared_ptr<const CompiledPattern> previous = m_compiledPattern;
+    const bool sameMatches = previous && previous->isValid &&
+                             previous->searchTerm == compiled->searchTerm &&
+                             (previous->flags & MATCH_FLAGS) == (m_flags & MATCH_FLAGS);
+
+    try
+    {
+        // The group references are escaped before the file time tokens are expanded rather than
+        // after, so no regex runs per item. The result is the same: the escaping only touches $
+        // followed by a digit and the expanded values never contain a $.
+        compiled->formatTerm = FormatReplaceTerm(compiled->replaceTerm);
+        compiled->dateTimeTemplate = CDateTimeTemplate(compiled->formatTerm.c_str());
+
+        if (sameMatches)
+        {
+            // Only the replace term or flags not affecting the matches changed
+            compiled->stdPattern = previous->stdPattern;
+            compiled->boostPattern = previous->boostPattern;
+            compiled->matchCache = previous->matchCache;
+        }
+        else
+        {
+            if ((m_flags & UseRegularExpressions) && !compiled->searchTerm.empty())
+            {
+                if (_useBoostLib)
+                {
+                    compiled->boostPattern = std::make_shared<const boost::wregex>(compiled->searchTerm, (!(m_flags & CaseSensitive)) ? boost::regex::icase | boost::regex::ECMAScript : boost::regex::ECMAScript);
+                }
+                else
+                {
+                    compiled->stdPattern = std::make_shared<const std::wregex>(compiled->searchTerm, (!(m_flags & CaseSensitive)) ? regex_constants::icase | regex_constants::ECMAScript : regex_constants::ECMAScript);
+                }
+            }
+            compiled->matchCache = std::make_shared<CMatchCache>();
+        }
+    }
+    catch (regex_error e)
+    {
+        // Typically an incomplete expression while the user is still typing
+        compiled->isValid = false;
+    }
+    catch (boost::regex_error e)
+    {
+        compiled->isValid = false;
+    }
+
+    m_compiledPattern = compiled;
+}
+
 HRESULT CPowerRenameRegEx::Replace(_In_ PCWSTR source, _Outptr_ PWSTR* result)
+{
+    bool useFileTime = false;
+    SYSTEMTIME fileTime = { 0 };
+    {
+        CSRWSharedAutoLock lock(&m_lock);
+        useFileTime = m_useFileTime;
+        fileTime = m_fileTime;
+    }
+
+    return _Replace(source, useFileTime ? &fileTime : nullptr, result);
+}
+
+// Unlike PutFileTime + Replace this does not modify any state, so it is safe
+// to call concurrently for different items.
+HRESULT CPowerRenameRegEx::ReplaceWithFileTime(_In_ PCWSTR source, _In_ SYSTEMTIME fileTime, _Outptr_ PWSTR* result)
+{
+    return _Replace(source, &fileTime, result);
+}
+
+HRESULT CPowerRenameRegEx::_Replace(_In_ PCWSTR source, _In_opt_ const SYSTEMTIME* fileTime, _Outptr_ PWSTR* result)
 {
     *result = nullptr;
 
-    CSRWSharedAutoLock lock(&m_lock);
+    std::shared_ptr<const CompiledPattern> compiled;
+    {
+        CSRWSharedAutoLock lock(&m_lock);
+        compiled = m_compiledPattern;
+    }
+
     HRESULT hr = S_OK;
-    if (!(m_searchTerm && wcslen(m_searchTerm) > 0 && source && wcslen(source) > 0))
+    if (!(compiled && !compiled->searchTerm.empty() && source && wcslen(source) > 0))
     {
         return hr;
     }
-    wstring res = source;
+
+    if (!compiled->isValid)
+    {
+        return E_FAIL;
+    }
+
     try
     {
-        // TODO: creating the regex could be costly.  May want to cache this.
-        wchar_t newReplaceTerm[MAX_PATH] = { 0 };
-        bool fileTimeErrorOccurred = false;
-        if (m_useFileTime)
+        // Only the file time tokens are filled in per item, the rest of the term is formatted up front
+        std::wstring datedReplaceTerm;
+        const bool useFileTime = fileTime && compiled->dateTimeTemplate.UsesFileTime();
+        if (useFileTime)
         {
-            if (FAILED(GetDatedFileName(newReplaceTerm, ARRAYSIZE(newReplaceTerm), m_replaceTerm, m_fileTime)))
-                fileTimeErrorOccurred = true;
+            compiled->dateTimeTemplate.Expand(*fileTime, datedReplaceTerm);
         }
+        const std::wstring& replaceTerm = useFileTime ? datedReplaceTerm : compiled->formatTerm;
 
-        std::wstring sourceToUse(source);
-        std::wstring searchTerm(m_searchTerm);
-        std::wstring replaceTerm(L"");
-        if (m_useFileTime && !fileTimeErrorOccurred)
+        std::shared_ptr<const MatchList> matchList = compiled->matchCache->Find(source);
+        if (!matchList)
         {
-            replaceTerm = wstring(newReplaceTerm);
-        }
-        else if (m_replaceTerm)
-        {
-            replaceTerm = wstring(m_replaceTerm);
+            matchList = _FindMatches(*compiled, source);
+            compiled->matchCache->Add(matchList);
         }
 
-        replaceTerm = regex_replace(replaceTerm, std::wregex(L"(([^\\$]|^)(\\$\\$)*)\\$[0]"), L"$1$$$0");
-        replaceTerm = regex_replace(replaceTerm, std::wregex(L"(([^\\$]|^)(\\$\\$)*)\\$([1-9])"), L"$1$0$4");
+        wstring res = _Substitute(*compiled, *matchList, replaceTerm);
+        hr = SHStrDup(res.c_str(), result);
+    }
+    catch (regex_error e)
+    {
+        hr = E_FAIL;
+    }
+    catch (boost::regex_error e)
+    {
+        hr = E_FAIL;
+    }
+    return hr;
+}
 
-        if (m_flags & UseRegularExpressions)
+std::shared_ptr<const CPowerRenameRegEx::MatchList> CPowerRenameRegEx::_FindMatches(_In_ const CompiledPattern& compiled, _In_ PCWSTR source)
+{
+    auto matchList = std::make_shared<MatchList>();
+    matchList->source = source;
+    const std::wstring& data = matchList->source;
+    const bool matchAll = (compiled.flags & MatchAllOccurences) != 0;
+
+    // Same iteration as regex_replace, which is what the substitution below mirrors
+    if (compiled.boostPattern)
+    {
+        for (boost::wsregex_iterator it(data.begin(), data.end(), *compiled.boostPattern), end; it != end; ++it)
         {
-            if (_useBoostLib)
+            matchList->boostMatches.push_back(*it);
+            if (!matchAll)
             {
-                boost::wregex pattern(m_searchTerm, (!(m_flags & CaseSensitive)) ? boost::regex::icase | boost::regex::ECMAScript : boost::regex::ECMAScript);
-                if (m_flags & MatchAllOccurences)
-                {
-                    res = boost::regex_replace(wstring(source), pattern, replaceTerm);
-                }
-                else
-                {
-                    res = boost::regex_replace(wstring(source), pattern, replaceTerm, boost::regex_constants::format_first_only);
-                }
+                break;
             }
-            else
+        }
+    }
+    else if (compiled.stdPattern)
+    {
+        for (std::wsregex_iterator it(data.begin(), data.end(), *compiled.stdPattern), end; it != end; ++it)
+        {
+            matchList->stdMatches.push_back(*it);
+            if (!matchAll)
             {
-                std::wregex pattern(m_searchTerm, (!(m_flags & CaseSensitive)) ? regex_constants::icase | regex_constants::ECMAScript : regex_constants::ECMAScript);
-                if (m_flags & MatchAllOccurences)
-                {
-                    res = regex_replace(wstring(source), pattern, replaceTerm);
-                }
-                else
-                {
-                    res = regex_replace(wstring(source), pattern, replaceTerm, regex_constants::format_first_only);
-                }
+                break;
             }
         }
-        else
+    }
+    else
+    {
+        // Simple search, matches do not overlap
+        std::wstring dataToSearch(data);
+        std::wstring searchTerm(compiled.searchTerm);
+        if (!(compiled.flags & CaseSensitive))
         {
-            // Simple search and replace
-            size_t pos = 0;
-            do
+            std::transform(dataToSearch.begin(), dataToSearch.end(), dataToSearch.begin(), ::towlower);
+            std::transform(searchTerm.begin(), searchTerm.end(), searchTerm.begin(), ::towlower);
+        }
+
+        size_t pos = dataToSearch.find(searchTerm);
+        while (pos != std::string::npos)
+        {
+            matchList->positions.push_back(pos);
+            if (!matchAll)
             {
-                pos = _Find(sourceToUse, searchTerm, (!(m_flags & CaseSensitive)), pos);
-                if (pos != std::string::npos)
-                {
-                    res = sourceToUse.replace(pos, searchTerm.length(), replaceTerm);
-                    pos += replaceTerm.length();
-                }
+                break;
+            }
+            pos = dataToSearch.find(searchTerm, pos + searchTerm.length());
+        }
+    }
 
-                if (!(m_flags & MatchAllOccurences))
-                {
-                    break;
-                }
-            } while (pos != std::string::npos);
+    return matchList;
+}
+
+std::wstring CPowerRenameRegEx::_Substitute(_In_ const CompiledPattern& compiled, _In_ const MatchList& matchList, _In_ const std::wstring& replaceTerm)
+{
+    const std::wstring& source = matchList.source;
+    std::wstring res;
+    res.reserve(source.length() + replaceTerm.length());
+
+    if (!matchList.boostMatches.empty())
+    {
+        for (const auto& match : matchList.boostMatches)
+        {
+            res.append(match.prefix().first, match.prefix().second);
+            match.format(std::back_inserter(res), replaceTerm);
+        }
+        res.append(matchList.boostMatches.back()[0].second, source.end());
+    }
+    else if (!matchList.stdMatches.empty())
+    {
+        for (const auto& match : matchList.stdMatches)
+        {
+            res.append(match.prefix().first, match.prefix().second);
+            match.format(std::back_inserter(res), replaceTerm);
         }
+        res.append(matchList.stdMatches.back()[0].second, source.end());
+    }
+    else if (!matchList.positions.empty())
+    {
+        size_t last = 0;
+        for (size_t pos : matchList.positions)
+        {
+            res.append(source, last, pos - last);
+            res.append(replaceTerm);
+            last = pos + compiled.searchTerm.length();
+        }
+        res.append(source, last, std::wstring::npos);
+    }
+    else
+    {
+        res = source;
+    }
 
-        hr = SHStrDup(res.c_str(), result);
+    return res;
+}
+
+std::shared_ptr<const CPowerRenameRegEx::MatchList> CPowerRenameRegEx::CMatchCache::Find(_In_ const std::wstring& source)
+{
+    CSRWSharedAutoLock lock(&m_lock);
+    auto it = m_matchLists.find(source);
+    if (it == m_matchLists.end())
+    {
+        return nullptr;
     }
-    catch (regex_error e)
+
+    it->second.referenced.store(true, std::memory_order_relaxed);
+    return it->second.matchList;
+}
+
+void CPowerRenameRegEx::CMatchCache::Add(_In_ const std::shared_ptr<const MatchList>& matchList)
+{
+    const size_t size = _GetSize(*matchList);
+    if (size > MAX_MATCH_CACHE_BYTES)
     {
-        hr = E_FAIL;
+        return;
     }
-    return hr;
+
+    CSRWExclusiveAutoLock lock(&m_lock);
+    if (m_matchLists.find(matchList->source) != m_matchLists.end())
+    {
+        // Added by another thread in the meantime
+        return;
+    }
+
+    while (m_byteCount + size > MAX_MATCH_CACHE_BYTES && !m_clock.empty())
+    {
+        _EvictOne();
+    }
+
+    m_matchLists.emplace(std::piecewise_construct, std::forward_as_tuple(matchList->source), std::forward_as_tuple(matchList));
+    m_clock.push_back(matchList->source);
+    m_byteCount += size;
 }
 
-size_t CPowerRenameRegEx::_Find(std::wstring data, std::wstring toSearch, bool caseInsensitive, size_t pos)
+size_t CPowerRenameRegEx::CMatchCache::_GetSize(_In_ const MatchList& matchList)
 {
-    if (caseInsensitive)
+    // Approximation including the map entry and clock slot
+    size_t size = sizeof(MatchList) + sizeof(Entry) + sizeof(std::wstring_view) + 4 * sizeof(void*) +
+                  matchList.source.capacity() * sizeof(wchar_t) +
+                  matchList.positions.capacity() * sizeof(size_t);
+    for (const auto& match : matchList.stdMatches)
     {
-        // Convert to lower
-        std::transform(data.begin(), data.end(), data.begin(), ::towlower);
-        std::transform(toSearch.begin(), toSearch.end(), toSearch.begin(), ::towlower);
+        size += sizeof(match) + match.size() * sizeof(std::wssub_match);
     }
+    for (const auto& match : matchList.boostMatches)
+    {
+        size += sizeof(match) + match.size() * sizeof(boost::wssub_match);
+    }
+    return size;
+}
 
-    // Find sub string position in given string starting at position pos
-    return data.find(toSearch, pos);
+void CPowerRenameRegEx::CMatchCache::_EvictOne()
+{
+    for (;;)
+    {
+        if (m_hand >= m_clock.size())
+        {
+            m_hand = 0;
+        }
+
+        auto it = m_matchLists.find(m_clock[m_hand]);
+        if (it->second.referenced.exchange(false, std::memory_order_relaxed))
+        {
+            // Found since the last pass, gets another round
+            m_hand++;
+            continue;
+        }
+
+        m_byteCount -= _GetSize(*it->second.matchList);
+        // The last key takes the free slot, which keeps the clock dense
+        m_clock[m_hand] = m_clock.back();
+        m_clock.pop_back();
+        m_matchLists.erase(it);
+        return;
+    }
 }
 
 void CPowerRenameRegEx::_OnSearchTermChanged()
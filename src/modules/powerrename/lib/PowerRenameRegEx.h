@@ -2,12 +2,26 @@
 #include "pch.h"
 #include <vector>
 #include <string>
+#include <memory>
+#include <atomic>
+#include <regex>
+#include <string_view>
+#include <unordered_map>
+#include <boost/regex.hpp>
 #include "srwlock.h"
+#include "DateTimeTemplate.h"
 
 #include "PowerRenameInterfaces.h"
 
 #define DEFAULT_FLAGS MatchAllOccurences
 
+// Flags that change where the search term matches, as opposed to what a match is replaced with
+#define MATCH_FLAGS (CaseSensitive | MatchAllOccurences | UseRegularExpressions)
+
+// Upper bound on the memory used by the cached matches of one search term, which is enough
+// for the matches of a few 100k typical file names
+#define MAX_MATCH_CACHE_BYTES (64 * 1024 * 1024)
+
 class CPowerRenameRegEx : public IPowerRenameRegEx
 {
 public:
@@ -28,6 +42,7 @@ public:
     IFACEMETHODIMP PutFileTime(_In_ SYSTEMTIME fileTime);
     IFACEMETHODIMP ResetFileTime();
     IFACEMETHODIMP Replace(_In_ PCWSTR source, _Outptr_ PWSTR* result);
+    IFACEMETHODIMP ReplaceWithFileTime(_In_ PCWSTR source, _In_ SYSTEMTIME fileTime, _Outptr_ PWSTR* result);
 
     static HRESULT s_CreateInstance(_Outptr_ IPowerRenameRegEx **renameRegEx);
 
@@ -40,13 +55,83 @@ protected:
     void _OnFlagsChanged();
     void _OnFileTimeChanged();
 
-    size_t _Find(std::wstring data, std::wstring toSearch, bool caseInsensitive, size_t pos);
+    HRESULT _Replace(_In_ PCWSTR source, _In_opt_ const SYSTEMTIME* fileTime, _Outptr_ PWSTR* result);
+
+    // Matches of the search term in one source string. Match positions do not depend on the
+    // replace term, so they are kept while the user edits it and only the substitution runs again.
+    // The match results point into source, so a list is never copied once built.
+    struct MatchList
+    {
+        std::wstring source;
+        std::vector<std::wsmatch> stdMatches;
+        std::vector<boost::wsmatch> boostMatches;
+        // Simple search
+        std::vector<size_t> positions;
+    };
+
+    // Match lists by source string. Safe to use from several threads. The size of the lists kept
+    // is bounded by MAX_MATCH_CACHE_BYTES; once full, lists are evicted in clock order, skipping
+    // the ones found since the hand last passed them. A new cache is used when the search term
+    // or the MATCH_FLAGS change, so lists of a previous search term are never kept.
+    class CMatchCache
+    {
+    public:
+        std::shared_ptr<const MatchList> Find(_In_ const std::wstring& source);
+        void Add(_In_ const std::shared_ptr<const MatchList>& matchList);
+
+    private:
+        struct Entry
+        {
+            explicit Entry(_In_ const std::shared_ptr<const MatchList>& list) :
+                matchList(list) {}
+
+            std::shared_ptr<const MatchList> matchList;
+            // Set by Find under the shared lock, cleared by the clock hand
+            mutable std::atomic<bool> referenced = false;
+        };
+
+        static size_t _GetSize(_In_ const MatchList& matchList);
+        void _EvictOne();
+
+        CSRWLock m_lock;
+        // Keys point into the source of the list they map to
+        _Guarded_by_(m_lock) std::unordered_map<std::wstring_view, Entry> m_matchLists;
+        // Keys of m_matchLists in the order the clock hand visits them
+        _Guarded_by_(m_lock) std::vector<std::wstring_view> m_clock;
+        _Guarded_by_(m_lock) size_t m_hand = 0;
+        _Guarded_by_(m_lock) size_t m_byteCount = 0;
+    };
+
+    // Search pattern and replace term prepared once per search term, replace term or flags change.
+    // Replace takes a reference to the current instance under the lock and then uses it read-only,
+    // so the regex is not rebuilt for every item. When only the replace term or flags outside of
+    // MATCH_FLAGS change, the new instance shares the pattern and match cache of the previous one.
+    struct CompiledPattern
+    {
+        DWORD flags = 0;
+        bool isValid = true;
+        std::wstring searchTerm;
+        std::wstring replaceTerm;
+        std::wstring formatTerm;
+        CDateTimeTemplate dateTimeTemplate;
+        std::shared_ptr<const std::wregex> stdPattern;
+        std::shared_ptr<const boost::wregex> boostPattern;
+        std::shared_ptr<CMatchCache> matchCache;
+    };
+
+    static std::shared_ptr<const MatchList> _FindMatches(_In_ const CompiledPattern& compiled, _In_ PCWSTR source);
+    static std::wstring _Substitute(_In_ const CompiledPattern& compiled, _In_ const MatchList& matchList, _In_ const std::wstring& replaceTerm);
+
+    // Caller must hold m_lock exclusively
+    void _CompilePattern();
 
     bool _useBoostLib = false;
     DWORD m_flags = DEFAULT_FLAGS;
     PWSTR m_searchTerm = nullptr;
     PWSTR m_replaceTerm = nullptr;
 
+    _Guarded_by_(m_lock) std::shared_ptr<const CompiledPattern> m_compiledPattern;
+
     SYSTEMTIME m_fileTime = {0};
     bool m_useFileTime = false;
 
@@ -55,6 +140,11 @@ protected:
 
     DWORD m_cookie = 0;
 
+    // Aggregated so that Replace can be called from the worker pool threads without marshaling.
+    // The pattern state is guarded by m_lock. The event sinks are only called from the setters,
+    // which must stay on the thread the sinks were advised from.
+    CComPtr<IUnknown> m_spFreeThreadedMarshaler;
+
     struct RENAME_REGEX_EVENT
     {
         IPowerRenameRegExEvents* pEvents;
@@ -0,0 +1,473 @@
+#include "pch.h"
+#include "RenameExecutor.h"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <string_view>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    bool IsPathSeparator(wchar_t c)
+    {
+        return c == L'\\' || c == L'/';
+    }
+
+    // Number of path components, which is always greater for an item than for any of its parent folders
+    UINT GetPathDepth(_In_ const std::wstring& path)
+    {
+        UINT depth = 0;
+        for (size_t i = 0; i < path.length(); i++)
+        {
+            if (IsPathSeparator(path[i]) && i + 1 < path.length() && !IsPathSeparator(path[i + 1]))
+            {
+                depth++;
+            }
+        }
+        return depth;
+    }
+
+    std::wstring_view GetParentPath(_In_ const std::wstring& path)
+    {
+        size_t end = path.length();
+        while (end > 0 && IsPathSeparator(path[end - 1]))
+        {
+            end--;
+        }
+        while (end > 0 && !IsPathSeparator(path[end - 1]))
+        {
+            end--;
+        }
+        return std::wstring_view(path.data(), end);
+    }
+
+    bool WriteString(_In_ std::ofstream& file, _In_ const std::wstring& value)
+    {
+        const UINT32 length = static_cast<UINT32>(value.length());
+        file.write(reinterpret_cast<const char*>(&length), sizeof(length));
+        file.write(reinterpret_cast<const char*>(value.data()), length * sizeof(wchar_t));
+        return file.good();
+    }
+
+    bool ReadString(_In_ std::ifstream& file, _Out_ std::wstring& value)
+    {
+        UINT32 length = 0;
+        if (!file.read(reinterpret_cast<char*>(&length), sizeof(length)) || length > PATHCCH_MAX_CCH)
+        {
+            return false;
+        }
+
+        value.resize(length);
+        return static_cast<bool>(file.read(reinterpret_cast<char*>(value.data()), length * sizeof(wchar_t)));
+    }
+
+    // Counts the results of the renames performed by an IFileOperation and journals the completed ones.
+    // A failure returned from the sink stops the remaining renames of the operation.
+    class CRenameProgressSink : public IFileOperationProgressSink
+    {
+    public:
+        CRenameProgressSink(_Inout_ UINT& renamedCount, _Inout_ UINT& failedCount, _In_opt_ CRenameJournal* journal, _In_opt_ HANDLE cancelEvent, _Inout_ HRESULT& journalResult) :
+            m_renamedCount(renamedCount),
+            m_failedCount(failedCount),
+            m_journal(journal),
+            m_cancelEvent(cancelEvent),
+            m_journalResult(journalResult)
+        {
+        }
+
+        // IUnknown
+        IFACEMETHODIMP QueryInterface(_In_ REFIID riid, _Outptr_ void** ppv)
+        {
+            static const QITAB qit[] = {
+                QITABENT(CRenameProgressSink, IFileOperationProgressSink),
+                { 0 },
+            };
+            return QISearch(this, qit, riid, ppv);
+        }
+
+        IFACEMETHODIMP_(ULONG) AddRef() { return InterlockedIncrement(&m_refCount); }
+
+        IFACEMETHODIMP_(ULONG) Release()
+        {
+            long refCount = InterlockedDecrement(&m_refCount);
+            if (refCount == 0)
+            {
+                delete this;
+            }
+            return refCount;
+        }
+
+        // IFileOperationProgressSink
+        IFACEMETHODIMP PreRenameItem(DWORD, IShellItem*, PCWSTR)
+        {
+            if (m_cancelEvent && WaitForSingleObject(m_cancelEvent, 0) == WAIT_OBJECT_0)
+            {
+                return HRESULT_FROM_WIN32(ERROR_CANCELLED);
+            }
+            return S_OK;
+        }
+
+        IFACEMETHODIMP PostRenameItem(DWORD, IShellItem* psiItem, PCWSTR, HRESULT hrRename, IShellItem* psiNewlyCreated)
+        {
+            if (FAILED(hrRename))
+            {
+                m_failedCount++;
+                return S_OK;
+            }
+
+            m_renamedCount++;
+            if (m_journal && psiNewlyCreated)
+            {
+                // The source item still refers to the old path
+                PWSTR oldPath = nullptr;
+                PWSTR newPath = nullptr;
+                HRESULT hr = psiItem->GetDisplayName(SIGDN_FILESYSPATH, &oldPath);
+                if (SUCCEEDED(hr))
+                {
+                    hr = psiNewlyCreated->GetDisplayName(SIGDN_FILESYSPATH, &newPath);
+                }
+                if (SUCCEEDED(hr))
+                {
+                    hr = m_journal->Append(oldPath, newPath);
+                }
+                CoTaskMemFree(oldPath);
+                CoTaskMemFree(newPath);
+
+                if (FAILED(hr))
+                {
+                    m_journalResult = hr;
+                    return hr;
+                }
+            }
+            return S_OK;
+        }
+
+        IFACEMETHODIMP StartOperations() { return S_OK; }
+        IFACEMETHODIMP FinishOperations(HRESULT) { return S_OK; }
+        IFACEMETHODIMP PreMoveItem(DWORD, IShellItem*, IShellItem*, PCWSTR) { return S_OK; }
+        IFACEMETHODIMP PostMoveItem(DWORD, IShellItem*, IShellItem*, PCWSTR, HRESULT, IShellItem*) { return S_OK; }
+        IFACEMETHODIMP PreCopyItem(DWORD, IShellItem*, IShellItem*, PCWSTR) { return S_OK; }
+        IFACEMETHODIMP PostCopyItem(DWORD, IShellItem*, IShellItem*, PCWSTR, HRESULT, IShellItem*) { return S_OK; }
+        IFACEMETHODIMP PreDeleteItem(DWORD, IShellItem*) { return S_OK; }
+        IFACEMETHODIMP PostDeleteItem(DWORD, IShellItem*, HRESULT, IShellItem*) { return S_OK; }
+        IFACEMETHODIMP PreNewItem(DWORD, IShellItem*, PCWSTR) { return S_OK; }
+        IFACEMETHODIMP PostNewItem(DWORD, IShellItem*, PCWSTR, PCWSTR, DWORD, HRESULT, IShellItem*) { return S_OK; }
+        IFACEMETHODIMP UpdateProgress(UINT, UINT) { return S_OK; }
+        IFACEMETHODIMP ResetTimer() { return S_OK; }
+        IFACEMETHODIMP PauseTimer() { return S_OK; }
+        IFACEMETHODIMP ResumeTimer() { return S_OK; }
+
+    private:
+        long m_refCount = 1;
+        UINT& m_renamedCount;
+        UINT& m_failedCount;
+        CRenameJournal* m_journal;
+        HANDLE m_cancelEvent;
+        HRESULT& m_journalResult;
+    };
+}
+
+HRESULT CFileSystemRenameBackend::Rename(_In_ const std::wstring& path, _In_ const std::wstring& newName, _Out_ std::wstring& newPath)
+{
+    newPath.clear();
+
+    fs::path source(path);
+    fs::path target = source.parent_path() / newName;
+
+    // Without MOVEFILE_REPLACE_EXISTING the rename fails if the target exists, other than for a
+    // change of case of the same item
+    if (!MoveFileExW(source.c_str(), target.c_str(), 0))
+    {
+        DWORD error = GetLastError();
+        return HRESULT_FROM_WIN32(error == ERROR_FILE_EXISTS ? ERROR_ALREADY_EXISTS : error);
+    }
+
+    newPath = target.wstring();
+    return S_OK;
+}
+
+CFileOperationRenameBackend::CFileOperationRenameBackend(_In_ IFileOperation* fileOperation, _In_ DWORD operationFlags, _In_opt_ HWND hwndParent, _In_opt_ CRenameJournal* journal, _In_opt_ HANDLE cancelEvent) :
+    m_spFileOp(fileOperation),
+    m_operationFlags(operationFlags),
+    m_hwndParent(hwndParent),
+    m_journal(journal),
+    m_cancelEvent(cancelEvent)
+{
+}
+
+HRESULT CFileOperationRenameBackend::Rename(_In_ const std::wstring& path, _In_ const std::wstring& newName, _Out_ std::wstring& newPath)
+{
+    newPath.clear();
+
+    CComPtr<IShellItem> spShellItem;
+    HRESULT hr = SHCreateItemFromParsingName(path.c_str(), nullptr, IID_PPV_ARGS(&spShellItem));
+    if (SUCCEEDED(hr))
+    {
+        hr = m_spFileOp->RenameItem(spShellItem, newName.c_str(), nullptr);
+    }
+    return hr;
+}
+
+HRESULT CFileOperationRenameBackend::Commit()
+{
+    m_renamedCount = 0;
+    m_failedCount = 0;
+    m_journalResult = S_OK;
+
+    HRESULT hr = m_spFileOp->SetOperationFlags(m_operationFlags);
+    if (SUCCEEDED(hr))
+    {
+        if (m_hwndParent)
+        {
+            m_spFileOp->SetOwnerWindow(m_hwndParent);
+        }
+
+        CComPtr<IFileOperationProgressSink> spSink;
+        spSink.Attach(new CRenameProgressSink(m_renamedCount, m_failedCount, m_journal, m_cancelEvent, m_journalResult));
+        DWORD cookie = 0;
+        hr = m_spFileOp->Advise(spSink, &cookie);
+        if (SUCCEEDED(hr))
+        {
+            hr = m_spFileOp->PerformOperations();
+            m_spFileOp->Unadvise(cookie);
+        }
+    }
+
+    // A rename which could not be journaled stopped the operation
+    if (FAILED(m_journalResult))
+    {
+        return m_journalResult;
+    }
+
+    // Items the user skipped or canceled, or which were canceled through the cancel event, are not
+    // reported to the sink
+    BOOL aborted = FALSE;
+    if (SUCCEEDED(hr) && SUCCEEDED(m_spFileOp->GetAnyOperationsAborted(&aborted)) && aborted)
+    {
+        hr = HRESULT_FROM_WIN32(ERROR_CANCELLED);
+    }
+    return hr;
+}
+
+bool CFileOperationRenameBackend::GetCommittedCounts(_Out_ UINT& renamedCount, _Out_ UINT& failedCount) const
+{
+    renamedCount = m_renamedCount;
+    failedCount = m_failedCount;
+    return true;
+}
+
+HRESULT CRenameJournal::Open(_In_ PCWSTR path)
+{
+    CSRWExclusiveAutoLock lock(&m_lock);
+    m_file.open(fs::path(path), std::ios::binary | std::ios::app);
+    return m_file.is_open() ? S_OK : E_FAIL;
+}
+
+void CRenameJournal::Close()
+{
+    CSRWExclusiveAutoLock lock(&m_lock);
+    m_file.close();
+}
+
+HRESULT CRenameJournal::Append(_In_ const std::wstring& oldPath, _In_ const std::wstring& newPath)
+{
+    CSRWExclusiveAutoLock lock(&m_lock);
+    if (!m_file.is_open())
+    {
+        return E_UNEXPECTED;
+    }
+
+    if (!WriteString(m_file, oldPath) || !WriteString(m_file, newPath) || !m_file.flush())
+    {
+        return E_FAIL;
+    }
+    return S_OK;
+}
+
+HRESULT CRenameJournal::Load(_In_ PCWSTR path, _Out_ std::vector<Entry>& entries)
+{
+    entries.clear();
+
+    std::ifstream file(fs::path(path), std::ios::binary);
+    if (!file.is_open())
+    {
+        return E_FAIL;
+    }
+
+    Entry entry;
+    while (ReadString(file, entry.oldPath) && ReadString(file, entry.newPath))
+    {
+        entries.push_back(entry);
+    }
+    return S_OK;
+}
+
+HRESULT CRenameJournal::Rollback(_In_ const std::vector<Entry>& entries, _In_ IRenameBackend& backend)
+{
+    HRESULT hr = S_OK;
+    for (auto it = entries.rbegin(); it != entries.rend(); ++it)
+    {
+        std::wstring restoredPath;
+        HRESULT hrRename = backend.Rename(it->newPath, fs::path(it->oldPath).filename().wstring(), restoredPath);
+        if (FAILED(hrRename) && SUCCEEDED(hr))
+        {
+            // Keep going, the remaining items can still be restored
+            hr = hrRename;
+        }
+    }
+
+    HRESULT hrCommit = backend.Commit();
+    return SUCCEEDED(hr) ? hrCommit : hr;
+}
+
+CRenameExecutor::CRenameExecutor(_In_ IRenameBackend& backend, _In_opt_ CRenameJournal* journal) :
+    m_backend(backend),
+    m_journal(journal)
+{
+}
+
+void CRenameExecutor::SetCompleted(_In_ const std::vector<CRenameJournal::Entry>& completed)
+{
+    m_completedPaths.clear();
+    for (const auto& entry : completed)
+    {
+        m_completedPaths.push_back(entry.oldPath);
+    }
+    std::sort(m_completedPaths.begin(), m_completedPaths.end());
+}
+
+HRESULT CRenameExecutor::Execute(_In_ const std::vector<RenameRequest>& requests, _In_opt_ HANDLE cancelEvent, _Out_ RenameStats& stats)
+{
+    stats = RenameStats();
+    const auto startTime = std::chrono::steady_clock::now();
+
+    // Single pass over the requests to bucket them by depth
+    std::vector<std::vector<UINT>> buckets;
+    for (UINT i = 0; i < static_cast<UINT>(requests.size()); i++)
+    {
+        if (std::binary_search(m_completedPaths.begin(), m_completedPaths.end(), requests[i].path))
+        {
+            stats.skippedCount++;
+            continue;
+        }
+
+        UINT depth = GetPathDepth(requests[i].path);
+        if (depth >= buckets.size())
+        {
+            buckets.resize(depth + 1);
+        }
+        buckets[depth].push_back(i);
+    }
+
+    const UINT totalCount = static_cast<UINT>(requests.size()) - stats.skippedCount;
+    std::atomic<UINT> renamedCount = 0;
+    std::atomic<UINT> failedCount = 0;
+    std::atomic<UINT> processedCount = 0;
+    std::atomic<HRESULT> journalResult = S_OK;
+    bool completed = true;
+
+    for (size_t depth = buckets.size(); depth-- > 0 && completed;)
+    {
+        std::vector<UINT>& bucket = buckets[depth];
+        if (bucket.empty())
+        {
+            continue;
+        }
+
+        // Group the bucket by folder, keeping the request order within a folder
+        std::stable_sort(bucket.begin(), bucket.end(), [&](UINT a, UINT b) {
+            return GetParentPath(requests[a].path) < GetParentPath(requests[b].path);
+        });
+
+        std::vector<UINT> groupStarts;
+        for (UINT k = 0; k < static_cast<UINT>(bucket.size()); k++)
+        {
+            if (k == 0 || GetParentPath(requests[bucket[k]].path) != GetParentPath(requests[bucket[k - 1]].path))
+            {
+                groupStarts.push_back(k);
+            }
+        }
+        const UINT groupCount = static_cast<UINT>(groupStarts.size());
+        groupStarts.push_back(static_cast<UINT>(bucket.size()));
+
+        // Returns false if the batch must stop because a rename could not be journaled
+        auto renameGroup = [&](UINT group) {
+            for (UINT k = groupStarts[group]; k < groupStarts[group + 1]; k++)
+            {
+                const RenameRequest& request = requests[bucket[k]];
+                std::wstring newPath;
+                if (FAILED(m_backend.Rename(request.path, request.newName, newPath)))
+                {
+                    failedCount++;
+                    continue;
+                }
+
+                renamedCount++;
+                if (m_journal && !newPath.empty())
+                {
+                    HRESULT hr = m_journal->Append(request.path, newPath);
+                    if (FAILED(hr))
+                    {
+                        journalResult = hr;
+                        return false;
+                    }
+                }
+            }
+
+            UINT processed = processedCount += groupStarts[group + 1] - groupStarts[group];
+            if (m_progressCallback)
+            {
+                m_progressCallback(processed, totalCount);
+            }
+            return true;
+        };
+
+        if (m_backend.SupportsConcurrentRename())
+        {
+            completed = m_workerPool.ParallelForEachChunk(groupCount, 1, cancelEvent, [&](UINT group, UINT /*begin*/, UINT /*end*/) {
+                return renameGroup(group);
+            });
+        }
+        else
+        {
+            for (UINT group = 0; group < groupCount && completed; group++)
+            {
+                if (cancelEvent && WaitForSingleObject(cancelEvent, 0) == WAIT_OBJECT_0)
+                {
+                    completed = false;
+                    break;
+                }
+                completed = renameGroup(group);
+            }
+        }
+    }
+
+    HRESULT hr = S_OK;
+    if (FAILED(journalResult))
+    {
+        hr = journalResult;
+    }
+    else if (!completed)
+    {
+        hr = HRESULT_FROM_WIN32(ERROR_CANCELLED);
+    }
+    else
+    {
+        hr = m_backend.Commit();
+    }
+
+    stats.renamedCount = renamedCount;
+    stats.failedCount = failedCount;
+
+    // Rename only queued the items, so the counts reported by Commit replace the queued ones
+    UINT committedRenamedCount = 0;
+    UINT committedFailedCount = 0;
+    if (m_backend.GetCommittedCounts(committedRenamedCount, committedFailedCount))
+    {
+        stats.renamedCount = committedRenamedCount;
+        stats.failedCount += committedFailedCount;
+    }
+    stats.elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    return hr;
+}
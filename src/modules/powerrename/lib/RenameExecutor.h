@@ -0,0 +1,153 @@
+#pragma once
+#include "pch.h"
+#include <atomic>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+#include "srwlock.h"
+#include "WorkerPool.h"
+
+// A single rename of the item at path to newName, in the same folder
+struct RenameRequest
+{
+    std::wstring path;
+    std::wstring newName;
+};
+
+class CRenameJournal;
+
+// Filesystem operations used by CRenameExecutor
+class IRenameBackend
+{
+public:
+    virtual ~IRenameBackend() = default;
+
+    // Renames the item at path. On success newPath receives the new full path of the item,
+    // or is left empty if the backend only queued the rename until Commit.
+    virtual HRESULT Rename(_In_ const std::wstring& path, _In_ const std::wstring& newName, _Out_ std::wstring& newPath) = 0;
+
+    // Whether Rename may be called from several threads at once for items in different folders
+    virtual bool SupportsConcurrentRename() const = 0;
+
+    // Called once after every rename was issued
+    virtual HRESULT Commit() = 0;
+
+    // Backends which only queue the renames until Commit return the number of items Commit
+    // renamed and failed to rename. Returns false for backends renaming immediately, for which
+    // the results of Rename are final.
+    virtual bool GetCommittedCounts(_Out_ UINT& renamedCount, _Out_ UINT& failedCount) const
+    {
+        renamedCount = 0;
+        failedCount = 0;
+        return false;
+    }
+};
+
+// Renames items immediately through MoveFileEx. Existing items are never overwritten: the
+// check is part of the rename, so an item created at the target in the meantime is kept too.
+class CFileSystemRenameBackend : public IRenameBackend
+{
+public:
+    HRESULT Rename(_In_ const std::wstring& path, _In_ const std::wstring& newName, _Out_ std::wstring& newPath) override;
+    bool SupportsConcurrentRename() const override { return true; }
+    HRESULT Commit() override { return S_OK; }
+};
+
+// Queues the renames in an IFileOperation which performs them all on Commit. This keeps the shell
+// behavior (undo record, elevation prompt, rename on collision) at the cost of per item results.
+// Rename returns no new path, so completed renames are appended to journal (optional) as the file
+// operation reports them instead. The file operation stops if the journal cannot be written, or
+// before the next item once cancelEvent (optional) is signaled.
+class CFileOperationRenameBackend : public IRenameBackend
+{
+public:
+    CFileOperationRenameBackend(_In_ IFileOperation* fileOperation, _In_ DWORD operationFlags, _In_opt_ HWND hwndParent, _In_opt_ CRenameJournal* journal = nullptr, _In_opt_ HANDLE cancelEvent = nullptr);
+
+    HRESULT Rename(_In_ const std::wstring& path, _In_ const std::wstring& newName, _Out_ std::wstring& newPath) override;
+    bool SupportsConcurrentRename() const override { return false; }
+    HRESULT Commit() override;
+    bool GetCommittedCounts(_Out_ UINT& renamedCount, _Out_ UINT& failedCount) const override;
+
+private:
+    CComPtr<IFileOperation> m_spFileOp;
+    DWORD m_operationFlags;
+    HWND m_hwndParent;
+    CRenameJournal* m_journal;
+    HANDLE m_cancelEvent;
+    // Results of the renames reported by the file operation during Commit
+    UINT m_renamedCount = 0;
+    UINT m_failedCount = 0;
+    HRESULT m_journalResult = S_OK;
+};
+
+// Append-only log of completed renames. Each rename is flushed to disk once done, so after an
+// interruption the log tells which items of the batch were already renamed, to either roll
+// them back or to resume the batch without them.
+class CRenameJournal
+{
+public:
+    struct Entry
+    {
+        std::wstring oldPath;
+        std::wstring newPath;
+    };
+
+    HRESULT Open(_In_ PCWSTR path);
+    void Close();
+
+    // Safe to call from several threads
+    HRESULT Append(_In_ const std::wstring& oldPath, _In_ const std::wstring& newPath);
+
+    // Reads the complete entries of a journal. A partially written last entry is ignored.
+    static HRESULT Load(_In_ PCWSTR path, _Out_ std::vector<Entry>& entries);
+
+    // Renames journaled items back to their old name, most recent first
+    static HRESULT Rollback(_In_ const std::vector<Entry>& entries, _In_ IRenameBackend& backend);
+
+private:
+    CSRWLock m_lock;
+    _Guarded_by_(m_lock) std::ofstream m_file;
+};
+
+struct RenameStats
+{
+    // Items actually renamed and failed, including the ones a deferring backend failed on Commit
+    UINT renamedCount = 0;
+    UINT failedCount = 0;
+    // Items already renamed according to the journal of a previous run
+    UINT skippedCount = 0;
+    double elapsedSeconds = 0;
+
+    double GetRenamesPerSecond() const { return elapsedSeconds > 0 ? renamedCount / elapsedSeconds : 0; }
+};
+
+// Runs a batch of renames. Items are bucketed by the depth of their path and the buckets run
+// deepest first, so that children are renamed before the folders containing them. Within a
+// bucket the items of each folder are renamed in order, and different folders run in parallel
+// when the backend allows it.
+class CRenameExecutor
+{
+public:
+    explicit CRenameExecutor(_In_ IRenameBackend& backend, _In_opt_ CRenameJournal* journal = nullptr);
+
+    // Skips items the given journal entries show as already renamed, to resume an interrupted batch
+    void SetCompleted(_In_ const std::vector<CRenameJournal::Entry>& completed);
+
+    // Called with the number of processed items and the total after each folder is done. For
+    // backends queuing the renames until Commit, this is the progress of queuing them.
+    // May be called from several threads at once.
+    void SetProgressCallback(_In_ std::function<void(UINT, UINT)> progressCallback) { m_progressCallback = std::move(progressCallback); }
+
+    // Failures of individual items are counted in stats and do not stop the batch.
+    // Returns HRESULT_FROM_WIN32(ERROR_CANCELLED) if cancelEvent was signaled.
+    HRESULT Execute(_In_ const std::vector<RenameRequest>& requests, _In_opt_ HANDLE cancelEvent, _Out_ RenameStats& stats);
+
+private:
+    IRenameBackend& m_backend;
+    CRenameJournal* m_journal;
+    std::vector<std::wstring> m_completedPaths;
+    std::function<void(UINT, UINT)> m_progressCallback;
+    // Renames the folders of a bucket in parallel. Only started for backends supporting it.
+    CWorkerPool m_workerPool;
+};
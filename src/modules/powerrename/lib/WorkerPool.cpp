@@ -0,0 +1,81 @@
+#include "pch.h"
+#include "WorkerPool.h"
+
+CWorkerPool::CWorkerPool(_In_ UINT threadCount) :
+    m_threadCount(threadCount ? threadCount : (std::max)(std::thread::hardware_concurrency(), 2u) - 1)
+{
+}
+
+CWorkerPool::~CWorkerPool()
+{
+    {
+        std::scoped_lock lock(m_lock);
+        m_stop = true;
+    }
+    m_workAvailable.notify_all();
+
+    for (auto& thread : m_threads)
+    {
+        thread.join();
+    }
+}
+
+void CWorkerPool::_RunOnAllThreads(_In_ const std::function<void()>& work)
+{
+    std::scoped_lock runLock(m_runLock);
+
+    {
+        std::scoped_lock lock(m_lock);
+        if (m_threads.empty())
+        {
+            for (UINT i = 0; i < m_threadCount; i++)
+            {
+                m_threads.emplace_back(&CWorkerPool::_ThreadProc, this, m_generation);
+            }
+        }
+
+        m_work = &work;
+        m_pendingCount = static_cast<UINT>(m_threads.size());
+        m_generation++;
+    }
+    m_workAvailable.notify_all();
+
+    work();
+
+    std::unique_lock lock(m_lock);
+    m_workDone.wait(lock, [this] { return m_pendingCount == 0; });
+    m_work = nullptr;
+}
+
+void CWorkerPool::_ThreadProc(_In_ UINT generation)
+{
+    HRESULT hrInit = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+
+    std::unique_lock lock(m_lock);
+    for (;;)
+    {
+        m_workAvailable.wait(lock, [&] { return m_stop || m_generation != generation; });
+        if (m_stop)
+        {
+            break;
+        }
+
+        generation = m_generation;
+        const std::function<void()>* work = m_work;
+        lock.unlock();
+
+        (*work)();
+
+        lock.lock();
+        if (--m_pendingCount == 0)
+        {
+            m_workDone.notify_one();
+        }
+    }
+    lock.unlock();
+
+    if (SUCCEEDED(hrInit))
+    {
+        CoUninitialize();
+    }
+}
@@ -0,0 +1,126 @@
+#pragma once
+#include "pch.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Default number of items handed to a worker at a time. Big enough to keep the
+// per chunk overhead (one notification, one atomic increment) negligible and
+// small enough to keep all cores busy on a few thousand items.
+#define DEFAULT_CHUNK_SIZE 512
+
+inline UINT GetChunkCount(_In_ UINT itemCount, _In_ UINT chunkSize)
+{
+    return (itemCount + chunkSize - 1) / chunkSize;
+}
+
+// Persistent pool of threads for ParallelForEachChunk. The threads are started on first
+// use and kept until the pool is destroyed. They join the multithreaded apartment, so the
+// chunk callbacks must only call COM objects which are free-threaded; apartment threaded
+// objects such as the rename items have to be used from the thread that owns them.
+class CWorkerPool
+{
+public:
+    // threadCount is the number of threads besides the calling one, 0 uses one per core
+    explicit CWorkerPool(_In_ UINT threadCount = 0);
+    ~CWorkerPool();
+
+    CWorkerPool(const CWorkerPool&) = delete;
+    CWorkerPool& operator=(const CWorkerPool&) = delete;
+
+    UINT GetThreadCount() const { return m_threadCount; }
+
+    // Splits [0, itemCount) into chunks of chunkSize items and calls
+    // fn(chunkIndex, begin, end) once per chunk on the pool threads. The calling
+    // thread takes part in the work. Chunks are handed out in increasing order but
+    // may complete in any order. Calls from several threads run one after the other.
+    //
+    // fn returns false to request cancellation. cancelEvent (optional) is checked
+    // before every chunk. Returns false if the work was canceled. An exception thrown
+    // by fn stops the remaining chunks and is rethrown on the calling thread.
+    template<typename Fn>
+    bool ParallelForEachChunk(_In_ UINT itemCount, _In_ UINT chunkSize, _In_opt_ HANDLE cancelEvent, Fn fn)
+    {
+        const UINT chunkCount = GetChunkCount(itemCount, chunkSize);
+        std::atomic<UINT> nextChunk = 0;
+        std::atomic<bool> canceled = false;
+        std::exception_ptr error;
+        std::mutex errorLock;
+
+        auto worker = [&]() {
+            try
+            {
+                while (!canceled)
+                {
+                    UINT chunk = nextChunk++;
+                    if (chunk >= chunkCount)
+                    {
+                        break;
+                    }
+
+                    if (cancelEvent && WaitForSingleObject(cancelEvent, 0) == WAIT_OBJECT_0)
+                    {
+                        canceled = true;
+                        break;
+                    }
+
+                    UINT begin = chunk * chunkSize;
+                    UINT end = (std::min)(begin + chunkSize, itemCount);
+                    if (!fn(chunk, begin, end))
+                    {
+                        canceled = true;
+                    }
+                }
+            }
+            catch (...)
+            {
+                std::scoped_lock lock(errorLock);
+                if (!error)
+                {
+                    error = std::current_exception();
+                }
+                canceled = true;
+            }
+        };
+
+        if (chunkCount > 1)
+        {
+            _RunOnAllThreads(worker);
+        }
+        else
+        {
+            worker();
+        }
+
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+
+        return !canceled;
+    }
+
+private:
+    // Runs work on the calling thread and every pool thread, and returns once all of them are done
+    void _RunOnAllThreads(_In_ const std::function<void()>& work);
+    void _ThreadProc(_In_ UINT generation);
+
+    const UINT m_threadCount;
+
+    // Held for the duration of a run
+    std::mutex m_runLock;
+
+    std::mutex m_lock;
+    std::condition_variable m_workAvailable;
+    std::condition_variable m_workDone;
+    std::vector<std::thread> m_threads;
+    _Guarded_by_(m_lock) const std::function<void()>* m_work = nullptr;
+    _Guarded_by_(m_lock) UINT m_generation = 0;
+    _Guarded_by_(m_lock) UINT m_pendingCount = 0;
+    _Guarded_by_(m_lock) bool m_stop = false;
+};
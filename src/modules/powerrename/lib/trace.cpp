@@ -72,6 +72,18 @@ void Trace::RenameOperation(_In_ UINT totalItemCount, _In_ UINT selectedItemCoun
         TraceLoggingWideString(extensionList, "ExtensionList"));
 }
 
+void Trace::RenameCompleted(_In_ UINT renamedCount, _In_ UINT failedCount, _In_ double renamesPerSecond) noexcept
+{
+    TraceLoggingWrite(
+        g_hProvider,
+        "PowerRename_RenameCompleted",
+        ProjectTelemetryPrivacyDataTag(ProjectTelemetryTag_ProductAndServicePerformance),
+        TraceLoggingKeyword(PROJECT_KEYWORD_MEASURE),
+        TraceLoggingUInt32(renamedCount, "RenamedCount"),
+        TraceLoggingUInt32(failedCount, "FailedCount"),
+        TraceLoggingFloat64(renamesPerSecond, "RenamesPerSecond"));
+}
+
 void Trace::SettingsChanged() noexcept
 {
     TraceLoggingWrite(
@@ -14,5 +14,9 @@ public:
       _In_ UINT renameItemCount,
       _In_ DWORD flags,
       _In_ PCWSTR extensionList) noexcept;
+  static void RenameCompleted(
+      _In_ UINT renamedCount,
+      _In_ UINT failedCount,
+      _In_ double renamesPerSecond) noexcept;
   static void SettingsChanged() noexcept;
 };
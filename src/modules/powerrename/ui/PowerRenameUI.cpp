@@ -237,6 +237,12 @@ IFACEMETHODIMP CPowerRenameUI::OnRenameStarted()
     return S_OK;
 }
 
+IFACEMETHODIMP CPowerRenameUI::OnRenameProgress(_In_ UINT /*processedCount*/, _In_ UINT /*totalCount*/)
+{
+    // The file operation shows its own progress dialog while the controls are disabled
+    return S_OK;
+}
+
 IFACEMETHODIMP CPowerRenameUI::OnRenameCompleted()
 {
     // Enable controls
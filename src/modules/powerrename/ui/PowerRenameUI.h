@@ -102,6 +102,7 @@ public:
     IFACEMETHODIMP OnRegExCanceled(_In_ DWORD threadId);
     IFACEMETHODIMP OnRegExCompleted(_In_ DWORD threadId);
     IFACEMETHODIMP OnRenameStarted();
+    IFACEMETHODIMP OnRenameProgress(_In_ UINT processedCount, _In_ UINT totalCount);
     IFACEMETHODIMP OnRenameCompleted();
 
     // IDropTarget
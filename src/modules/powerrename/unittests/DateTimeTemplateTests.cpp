@@ -0,0 +1,143 @@
+#include "pch.h"
+#include "CppUnitTest.h"
+#include <DateTimeTemplate.h>
+#include <Helpers.h>
+#include <regex>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace DateTimeTemplateTests
+{
+    // The regex based implementation CDateTimeTemplate replaced, used as reference
+    std::wstring RegexDatedFileName(PCWSTR source, SYSTEMTIME fileTime)
+    {
+        std::wstring res(source);
+        wchar_t replaceTerm[MAX_PATH] = { 0 };
+        wchar_t formattedDate[MAX_PATH] = { 0 };
+
+        wchar_t localeName[LOCALE_NAME_MAX_LENGTH];
+        if (GetUserDefaultLocaleName(localeName, LOCALE_NAME_MAX_LENGTH) == 0)
+        {
+            StringCchCopy(localeName, LOCALE_NAME_MAX_LENGTH, L"en_US");
+        }
+
+        struct
+        {
+            PCWSTR pattern;
+            PCWSTR format;
+            int value;
+            PCWSTR dateFormat;
+        } steps[] = {
+            { L"(([^\\$]|^)(\\$\\$)*)\\$YYYY", L"%s%04d", fileTime.wYear, nullptr },
+            { L"(([^\\$]|^)(\\$\\$)*)\\$YY", L"%s%02d", fileTime.wYear % 100, nullptr },
+            { L"(([^\\$]|^)(\\$\\$)*)\\$Y", L"%s%d", fileTime.wYear % 10, nullptr },
+            { L"(([^\\$]|^)(\\$\\$)*)\\$MMMM", nullptr, 0, L"MMMM" },
+            { L"(([^\\$]|^)(\\$\\$)*)\\$MMM", nullptr, 0, L"MMM" },
+            { L"(([^\\$]|^)(\\$\\$)*)\\$MM", L"%s%02d", fileTime.wMonth, nullptr },
+            { L"(([^\\$]|^)(\\$\\$)*)\\$M", L"%s%d", fileTime.wMonth, nullptr },
+            { L"(([^\\$]|^)(\\$\\$)*)\\$DDDD", nullptr, 0, L"dddd" },
+            { L"(([^\\$]|^)(\\$\\$)*)\\$DDD", nullptr, 0, L"ddd" },
+            { L"(([^\\$]|^)(\\$\\$)*)\\$DD", L"%s%02d", fileTime.wDay, nullptr },
+            { L"(([^\\$]|^)(\\$\\$)*)\\$D", L"%s%d", fileTime.wDay, nullptr },
+            { L"(([^\\$]|^)(\\$\\$)*)\\$hh", L"%s%02d", fileTime.wHour, nullptr },
+            { L"(([^\\$]|^)(\\$\\$)*)\\$h", L"%s%d", fileTime.wHour, nullptr },
+            { L"(([^\\$]|^)(\\$\\$)*)\\$mm", L"%s%02d", fileTime.wMinute, nullptr },
+            { L"(([^\\$]|^)(\\$\\$)*)\\$m", L"%s%d", fileTime.wMinute, nullptr },
+            { L"(([^\\$]|^)(\\$\\$)*)\\$ss", L"%s%02d", fileTime.wSecond, nullptr },
+            { L"(([^\\$]|^)(\\$\\$)*)\\$s", L"%s%d", fileTime.wSecond, nullptr },
+            { L"(([^\\$]|^)(\\$\\$)*)\\$fff", L"%s%03d", fileTime.wMilliseconds, nullptr },
+            { L"(([^\\$]|^)(\\$\\$)*)\\$ff", L"%s%02d", fileTime.wMilliseconds / 10, nullptr },
+            { L"(([^\\$]|^)(\\$\\$)*)\\$f", L"%s%d", fileTime.wMilliseconds / 100, nullptr },
+        };
+
+        for (const auto& step : steps)
+        {
+            if (step.dateFormat)
+            {
+                GetDateFormatEx(localeName, NULL, &fileTime, step.dateFormat, formattedDate, MAX_PATH, NULL);
+                formattedDate[0] = towupper(formattedDate[0]);
+                StringCchPrintf(replaceTerm, MAX_PATH, TEXT("%s%s"), L"$01", formattedDate);
+            }
+            else
+            {
+                StringCchPrintf(replaceTerm, MAX_PATH, step.format, L"$01", step.value);
+            }
+            res = regex_replace(res, std::wregex(step.pattern), replaceTerm);
+        }
+
+        return res;
+    }
+
+    TEST_CLASS(DateTimeTemplateTests)
+    {
+    public:
+        TEST_METHOD(VerifyNoTokens)
+        {
+            CDateTimeTemplate dateTimeTemplate(L"foo$$Ybar$");
+            Assert::IsFalse(dateTimeTemplate.UsesFileTime());
+
+            std::wstring result;
+            dateTimeTemplate.Expand(SYSTEMTIME{ 2020, 7, 3, 22, 15, 6, 42, 453 }, result);
+            Assert::AreEqual(std::wstring(L"foo$$Ybar$"), result);
+        }
+
+        TEST_METHOD(VerifyEscapes)
+        {
+            SYSTEMTIME fileTime = { 2020, 7, 3, 22, 15, 6, 42, 453 };
+            std::wstring result;
+
+            CDateTimeTemplate(L"$$$YYYY").Expand(fileTime, result);
+            Assert::AreEqual(std::wstring(L"$$2020"), result);
+
+            CDateTimeTemplate(L"$$$$YYYY").Expand(fileTime, result);
+            Assert::AreEqual(std::wstring(L"$$$$YYYY"), result);
+
+            // Adjacent identical tokens are all expanded
+            CDateTimeTemplate(L"$D$D").Expand(fileTime, result);
+            Assert::AreEqual(std::wstring(L"2222"), result);
+        }
+
+        TEST_METHOD(VerifyIsFileTimeUsed)
+        {
+            Assert::IsTrue(isFileTimeUsed(L"$Y"));
+            Assert::IsTrue(isFileTimeUsed(L"a$$$f"));
+            Assert::IsFalse(isFileTimeUsed(L"a$$f"));
+            Assert::IsFalse(isFileTimeUsed(L"$0$1"));
+            Assert::IsFalse(isFileTimeUsed(L""));
+        }
+
+        TEST_METHOD(VerifyMatchesRegexImplementation)
+        {
+            PCWSTR templates[] = {
+                L"bar$YY-$M-$D-$h-$m-$s-$f",
+                L"bar$YYYY-$MM-$DD-$hh-$mm-$ss-$fff",
+                L"$YYYY$MM$DD_$hh$mm$ss$ff",
+                L"$MMM-$MMMM-$DDD-$DDDD",
+                L"$YYYYY $MMMMM $DDDDD $ffff",
+                L"$$YYYY $$$YYYY $$$$YYYY",
+                L"$Y.$M.$D $h:$m:$s",
+                L"no tokens $ at $$ all $x",
+                L"$",
+                L"$$",
+                L"Y$",
+            };
+
+            SYSTEMTIME fileTimes[] = {
+                { 2020, 7, 3, 22, 15, 6, 42, 453 },
+                { 1999, 1, 0, 1, 0, 0, 0, 0 },
+                { 2001, 12, 1, 31, 23, 59, 59, 999 },
+            };
+
+            for (auto source : templates)
+            {
+                CDateTimeTemplate dateTimeTemplate(source);
+                for (const auto& fileTime : fileTimes)
+                {
+                    std::wstring result;
+                    dateTimeTemplate.Expand(fileTime, result);
+                    Assert::AreEqual(RegexDatedFileName(source, fileTime), result, source);
+                }
+            }
+        }
+    };
+}
@@ -71,6 +71,13 @@ IFACEMETHODIMP CMockPowerRenameManagerEvents::OnRenameStarted()
     return S_OK;
 }
 
+IFACEMETHODIMP CMockPowerRenameManagerEvents::OnRenameProgress(_In_ UINT processedCount, _In_ UINT totalCount)
+{
+    m_renameProcessedCount = processedCount;
+    m_renameTotalCount = totalCount;
+    return S_OK;
+}
+
 IFACEMETHODIMP CMockPowerRenameManagerEvents::OnRenameCompleted()
 {
     m_renameCompleted = true;
@@ -25,6 +25,7 @@ public:
     IFACEMETHODIMP OnRegExCanceled(_In_ DWORD threadId);
     IFACEMETHODIMP OnRegExCompleted(_In_ DWORD threadId);
     IFACEMETHODIMP OnRenameStarted();
+    IFACEMETHODIMP OnRenameProgress(_In_ UINT processedCount, _In_ UINT totalCount);
     IFACEMETHODIMP OnRenameCompleted();
 
     static HRESULT s_CreateInstance(_In_ IPowerRenameManager* psrm, _Outptr_ IPowerRenameUI** ppsrui);
@@ -40,6 +41,8 @@ public:
     bool m_regExCanceled = false;
     bool m_regExCompleted = false;
     bool m_renameStarted = false;
+    UINT m_renameProcessedCount = 0;
+    UINT m_renameTotalCount = 0;
     bool m_renameCompleted = false;
     long m_refCount = 0;
 };
\ No newline at end of file
@@ -0,0 +1,100 @@
+#include "pch.h"
+#include "CppUnitTest.h"
+#include <NameReservationIndex.h>
+#include <Helpers.h>
+#include "TestFileHelper.h"
+#include <chrono>
+#include <unordered_set>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace NameReservationIndexTests
+{
+    TEST_CLASS(NameReservationIndexTests)
+    {
+    public:
+        TEST_METHOD(VerifyExistingItemsTaken)
+        {
+            CTestFileHelper helper;
+            Assert::IsTrue(helper.AddFile(L"foo (1).txt"));
+            Assert::IsTrue(helper.AddFile(L"foo (2).txt"));
+            std::wstring folder = helper.GetTempDirectory().wstring();
+
+            CNameReservationIndex index;
+            Assert::IsFalse(index.IsAvailable(folder.c_str(), L"FOO (1).TXT"));
+            Assert::IsTrue(index.IsAvailable(folder.c_str(), L"foo (3).txt"));
+
+            wchar_t uniqueName[MAX_PATH] = { 0 };
+            unsigned long numUsed = 0;
+            Assert::IsTrue(index.GetEnumeratedFileName(uniqueName, ARRAYSIZE(uniqueName), L"foo.txt", folder.c_str(), 1, &numUsed));
+            Assert::AreEqual(L"foo (3).txt", uniqueName);
+            Assert::AreEqual(3ul, numUsed);
+            Assert::IsFalse(index.IsAvailable(folder.c_str(), L"foo (3).txt"));
+            Assert::AreEqual(1u, index.GetListingCount());
+        }
+
+        TEST_METHOD(VerifyCollisionWithinBatch)
+        {
+            CTestFileHelper helper;
+            std::wstring folder = helper.GetTempDirectory().wstring();
+
+            // The second template already carries the number the first one is given
+            CNameReservationIndex index;
+            wchar_t uniqueName[MAX_PATH] = { 0 };
+            unsigned long numUsed = 0;
+            Assert::IsTrue(index.GetEnumeratedFileName(uniqueName, ARRAYSIZE(uniqueName), L"bar.txt", folder.c_str(), 1, &numUsed));
+            Assert::AreEqual(L"bar (1).txt", uniqueName);
+            Assert::IsTrue(index.GetEnumeratedFileName(uniqueName, ARRAYSIZE(uniqueName), L"bar (7).txt", folder.c_str(), 1, &numUsed));
+            Assert::AreEqual(L"bar (2).txt", uniqueName);
+
+            // Names are only reserved in their own folder
+            Assert::IsTrue(helper.AddFolder(L"sub"));
+            std::wstring subFolder = helper.GetFullPath(L"sub").wstring();
+            Assert::IsTrue(index.GetEnumeratedFileName(uniqueName, ARRAYSIZE(uniqueName), L"bar.txt", subFolder.c_str(), 1, &numUsed));
+            Assert::AreEqual(L"bar (1).txt", uniqueName);
+            Assert::AreEqual(2u, index.GetListingCount());
+        }
+
+        TEST_METHOD(VerifyNoFolderDoesNotProbe)
+        {
+            wchar_t uniqueName[MAX_PATH] = { 0 };
+            unsigned long numUsed = 0;
+            Assert::IsTrue(GetEnumeratedFileName(uniqueName, ARRAYSIZE(uniqueName), L"foo.txt", nullptr, 4, &numUsed));
+            Assert::AreEqual(L"foo (4).txt", uniqueName);
+            Assert::AreEqual(4ul, numUsed);
+        }
+
+        // 10k items that all collide on the same stem, in a folder already holding 10k items with
+        // the enumerated names. Probing each number on disk made this quadratic.
+        BEGIN_TEST_METHOD_ATTRIBUTE(VerifyCollidingStemBenchmark)
+            TEST_METHOD_ATTRIBUTE(L"TestCategory", L"Benchmark")
+            TEST_METHOD_ATTRIBUTE(L"Ignore", L"true")
+        END_TEST_METHOD_ATTRIBUTE()
+        TEST_METHOD(VerifyCollidingStemBenchmark)
+        {
+            const unsigned long count = 10000;
+            CTestFileHelper helper;
+            for (unsigned long i = 1; i <= count; i++)
+            {
+                Assert::IsTrue(helper.AddFile(L"photo (" + std::to_wstring(i) + L").jpg"));
+            }
+            std::wstring folder = helper.GetTempDirectory().wstring();
+
+            const auto startTime = std::chrono::steady_clock::now();
+            CNameReservationIndex index;
+            std::unordered_set<std::wstring> names;
+            for (unsigned long i = 1; i <= count; i++)
+            {
+                wchar_t uniqueName[MAX_PATH] = { 0 };
+                unsigned long numUsed = 0;
+                Assert::IsTrue(index.GetEnumeratedFileName(uniqueName, ARRAYSIZE(uniqueName), L"photo.jpg", folder.c_str(), i, &numUsed));
+                Assert::IsTrue(numUsed > count);
+                Assert::IsTrue(names.insert(uniqueName).second);
+            }
+            const double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+
+            Assert::AreEqual(1u, index.GetListingCount());
+            Logger::WriteMessage((L"Enumerated " + std::to_wstring(count) + L" colliding names in " + std::to_wstring(elapsedMs) + L" ms\n").c_str());
+        }
+    };
+}
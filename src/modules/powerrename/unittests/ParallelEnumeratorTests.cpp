@@ -0,0 +1,240 @@
+#include "pch.h"
+#include "CppUnitTest.h"
+#include <ParallelEnumerator.h>
+#include "TestFileHelper.h"
+#include <chrono>
+#include <memory>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace fs = std::filesystem;
+
+namespace ParallelEnumeratorTests
+{
+    struct EnumeratedEntry
+    {
+        fs::path path;
+        UINT depth;
+
+        bool operator==(const EnumeratedEntry& other) const { return path == other.path && depth == other.depth; }
+    };
+
+    TEST_CLASS(ParallelEnumeratorTests)
+    {
+    public:
+        // Synthetic tree of width^levels files plus the folders holding them
+        void AddTree(CTestFileHelper& helper, const std::wstring& folder, UINT width, UINT levels)
+        {
+            for (UINT i = 0; i < width; i++)
+            {
+                std::wstring path = folder + L"\\" + std::to_wstring(i);
+                if (levels > 1)
+                {
+                    Assert::IsTrue(helper.AddFolder(path));
+                    AddTree(helper, path, width, levels - 1);
+                }
+                else
+                {
+                    Assert::IsTrue(helper.AddFile(path + L".txt"));
+                }
+            }
+        }
+
+        void RecursiveWalk(CFileSystemEnumerationBackend& backend, const fs::path& folder, UINT depth, std::vector<EnumeratedEntry>& entries)
+        {
+            std::vector<fs::path> children;
+            std::vector<char> isFolder;
+            Assert::IsTrue(backend.GetChildren(folder, children, isFolder) == S_OK);
+            for (size_t i = 0; i < children.size(); i++)
+            {
+                entries.push_back({ children[i], depth });
+                if (isFolder[i])
+                {
+                    RecursiveWalk(backend, children[i], depth + 1, entries);
+                }
+            }
+        }
+
+        TEST_METHOD(VerifyDepthFirstOrder)
+        {
+            CTestFileHelper helper;
+            Assert::IsTrue(helper.AddFolder(L"root"));
+            AddTree(helper, L"root", 4, 4);
+
+            CFileSystemEnumerationBackend backend;
+            std::vector<EnumeratedEntry> expected = { { helper.GetFullPath(L"root"), 0 } };
+            RecursiveWalk(backend, helper.GetFullPath(L"root"), 1, expected);
+
+            for (UINT threadCount : { 1u, 2u, 8u })
+            {
+                CParallelEnumerator<CFileSystemEnumerationBackend> enumerator(backend, threadCount);
+                std::vector<EnumeratedEntry> entries;
+                std::atomic<bool> canceled = false;
+                UINT flushCount = 0;
+                HRESULT hr = enumerator.Run({ helper.GetFullPath(L"root") }, { true }, canceled, [&](const fs::path& path, UINT depth, bool) {
+                    entries.push_back({ path, depth });
+                    return S_OK;
+                }, [&]() {
+                    flushCount++;
+                    return S_OK;
+                });
+
+                Assert::IsTrue(hr == S_OK);
+                Assert::IsTrue(entries == expected);
+                Assert::IsTrue(flushCount > 0);
+            }
+        }
+
+        TEST_METHOD(VerifySkipFolderContents)
+        {
+            CTestFileHelper helper;
+            Assert::IsTrue(helper.AddFolder(L"root"));
+            AddTree(helper, L"root", 3, 3);
+
+            CFileSystemEnumerationBackend backend;
+            CParallelEnumerator<CFileSystemEnumerationBackend> enumerator(backend);
+            UINT count = 0;
+            std::atomic<bool> canceled = false;
+            HRESULT hr = enumerator.Run({ helper.GetFullPath(L"root") }, { true }, canceled, [&](const fs::path&, UINT depth, bool isFolder) {
+                count++;
+                Assert::IsTrue(depth <= 1);
+                return (isFolder && depth == 1) ? S_FALSE : S_OK;
+            }, []() { return S_OK; });
+
+            Assert::IsTrue(hr == S_OK);
+            // root and its 3 folders
+            Assert::AreEqual(4u, count);
+        }
+
+        TEST_METHOD(VerifyCancel)
+        {
+            CTestFileHelper helper;
+            Assert::IsTrue(helper.AddFolder(L"root"));
+            AddTree(helper, L"root", 4, 3);
+
+            CFileSystemEnumerationBackend backend;
+            CParallelEnumerator<CFileSystemEnumerationBackend> enumerator(backend);
+            UINT count = 0;
+            std::atomic<bool> canceled = false;
+            HRESULT hr = enumerator.Run({ helper.GetFullPath(L"root") }, { true }, canceled, [&](const fs::path&, UINT, bool) {
+                if (++count == 10)
+                {
+                    canceled = true;
+                }
+                return S_OK;
+            }, []() { return S_OK; });
+
+            Assert::IsTrue(hr == E_ABORT);
+            Assert::AreEqual(10u, count);
+        }
+
+        TEST_METHOD(VerifyMissingFolderFails)
+        {
+            CTestFileHelper helper;
+            CFileSystemEnumerationBackend backend;
+            CParallelEnumerator<CFileSystemEnumerationBackend> enumerator(backend);
+            std::atomic<bool> canceled = false;
+            HRESULT hr = enumerator.Run({ helper.GetFullPath(L"missing") }, { true }, canceled, [](const fs::path&, UINT, bool) { return S_OK; }, []() { return S_OK; });
+            Assert::IsTrue(FAILED(hr));
+        }
+
+        // Entries which can only be moved, like the ID lists of the shell backend
+        class CMoveOnlyEnumerationBackend
+        {
+        public:
+            using Entry = std::unique_ptr<fs::path>;
+
+            HRESULT InitializeThread() { return S_OK; }
+            void UninitializeThread() {}
+
+            HRESULT GetChildren(_In_ const Entry& folder, _Out_ std::vector<Entry>& children, _Out_ std::vector<char>& isFolder)
+            {
+                std::vector<fs::path> paths;
+                HRESULT hr = m_backend.GetChildren(*folder, paths, isFolder);
+                for (auto& path : paths)
+                {
+                    children.push_back(std::make_unique<fs::path>(std::move(path)));
+                }
+                return hr;
+            }
+
+        private:
+            CFileSystemEnumerationBackend m_backend;
+        };
+
+        TEST_METHOD(VerifyMoveOnlyEntries)
+        {
+            CTestFileHelper helper;
+            Assert::IsTrue(helper.AddFolder(L"root"));
+            AddTree(helper, L"root", 3, 3);
+
+            CMoveOnlyEnumerationBackend backend;
+            CParallelEnumerator<CMoveOnlyEnumerationBackend> enumerator(backend, 4);
+            std::vector<CMoveOnlyEnumerationBackend::Entry> roots;
+            roots.push_back(std::make_unique<fs::path>(helper.GetFullPath(L"root")));
+            UINT count = 0;
+            std::atomic<bool> canceled = false;
+            HRESULT hr = enumerator.Run(std::move(roots), { true }, canceled, [&](const CMoveOnlyEnumerationBackend::Entry& entry, UINT, bool) {
+                Assert::IsTrue(entry != nullptr);
+                count++;
+                return S_OK;
+            }, []() { return S_OK; });
+
+            Assert::IsTrue(hr == S_OK);
+            // root, 3 folders, 9 folders and 27 files
+            Assert::AreEqual(40u, count);
+        }
+
+        // Entries/s of a recursive walk on one thread against the parallel enumerator, and the time
+        // until the first entries can be published
+        BEGIN_TEST_METHOD_ATTRIBUTE(VerifyEnumerationBenchmark)
+            TEST_METHOD_ATTRIBUTE(L"TestCategory", L"Benchmark")
+            TEST_METHOD_ATTRIBUTE(L"Ignore", L"true")
+        END_TEST_METHOD_ATTRIBUTE()
+        TEST_METHOD(VerifyEnumerationBenchmark)
+        {
+            CTestFileHelper helper;
+            Assert::IsTrue(helper.AddFolder(L"root"));
+            AddTree(helper, L"root", 8, 5);
+
+            auto ms = [](std::chrono::steady_clock::time_point start) {
+                return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            };
+
+            CFileSystemEnumerationBackend backend;
+            auto startTime = std::chrono::steady_clock::now();
+            std::vector<EnumeratedEntry> expected;
+            RecursiveWalk(backend, helper.GetFullPath(L"root"), 1, expected);
+            const double recursiveMs = ms(startTime);
+            const size_t entryCount = expected.size() + 1;
+
+            std::wstring message = std::to_wstring(entryCount) + L" entries: recursive " + std::to_wstring(static_cast<size_t>(entryCount * 1000.0 / (std::max)(recursiveMs, 0.001))) + L" entries/s";
+            for (UINT threadCount : { 1u, 4u, 0u })
+            {
+                CParallelEnumerator<CFileSystemEnumerationBackend> enumerator(backend, threadCount);
+                std::atomic<bool> canceled = false;
+                size_t count = 0;
+                double firstFlushMs = -1;
+                startTime = std::chrono::steady_clock::now();
+                HRESULT hr = enumerator.Run({ helper.GetFullPath(L"root") }, { true }, canceled, [&](const fs::path&, UINT, bool) {
+                    count++;
+                    return S_OK;
+                }, [&]() {
+                    if (firstFlushMs < 0 && count > 0)
+                    {
+                        firstFlushMs = ms(startTime);
+                    }
+                    return S_OK;
+                });
+                const double parallelMs = ms(startTime);
+
+                Assert::IsTrue(hr == S_OK);
+                Assert::AreEqual(entryCount, count);
+                message += L", " + (threadCount ? std::to_wstring(threadCount) : std::wstring(L"default")) + L" threads " +
+                           std::to_wstring(static_cast<size_t>(entryCount * 1000.0 / (std::max)(parallelMs, 0.001))) + L" entries/s, first entries after " +
+                           std::to_wstring(firstFlushMs) + L" ms";
+            }
+            Logger::WriteMessage((message + L"\n").c_str());
+        }
+    };
+}
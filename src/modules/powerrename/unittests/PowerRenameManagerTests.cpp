@@ -7,6 +7,12 @@
 #include "MockPowerRenameManagerEvents.h"
 #include "TestFileHelper.h"
 #include "Helpers.h"
+#include "WorkerPool.h"
+#include "PowerRenameItemTable.h"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <set>
 
 #define DEFAULT_FLAGS MatchAllOccurences
 
@@ -133,6 +139,368 @@ namespace PowerRenameManagerTests
             Assert::IsTrue(mgr->Shutdown() == S_OK);
         }
 
+        TEST_METHOD(VerifyItemOrderAndVisibleIndex)
+        {
+            CComPtr<IPowerRenameManager> mgr;
+            Assert::IsTrue(CPowerRenameManager::s_CreateInstance(&mgr) == S_OK);
+
+            CComPtr<IPowerRenameItem> items[3];
+            for (auto& item : items)
+            {
+                CMockPowerRenameItem::CreateInstance(L"foo", L"foo", 0, false, SYSTEMTIME{ 0 }, &item);
+            }
+
+            // Items are ordered by id regardless of the order they are added in
+            Assert::IsTrue(mgr->AddItem(items[2]) == S_OK);
+            Assert::IsTrue(mgr->AddItem(items[0]) == S_OK);
+            Assert::IsTrue(mgr->AddItem(items[1]) == S_OK);
+            Assert::IsTrue(mgr->AddItem(items[1]) == E_FAIL);
+
+            UINT count = 0;
+            Assert::IsTrue(mgr->GetItemCount(&count) == S_OK);
+            Assert::AreEqual(3u, count);
+            for (UINT i = 0; i < count; i++)
+            {
+                CComPtr<IPowerRenameItem> item;
+                Assert::IsTrue(mgr->GetItemByIndex(i, &item) == S_OK);
+                Assert::IsTrue(item == items[i]);
+
+                int id = 0;
+                Assert::IsTrue(items[i]->GetId(&id) == S_OK);
+                CComPtr<IPowerRenameItem> itemById;
+                Assert::IsTrue(mgr->GetItemById(id, &itemById) == S_OK);
+                Assert::IsTrue(itemById == items[i]);
+            }
+
+            // Only show selected items
+            items[1]->PutSelected(false);
+            Assert::IsTrue(mgr->SwitchFilter(0) == S_OK);
+            Assert::IsTrue(mgr->GetVisibleItemCount(&count) == S_OK);
+            Assert::AreEqual(2u, count);
+
+            CComPtr<IPowerRenameItem> visibleItem;
+            Assert::IsTrue(mgr->GetVisibleItemByIndex(1, &visibleItem) == S_OK);
+            Assert::IsTrue(visibleItem == items[2]);
+            visibleItem.Release();
+            Assert::IsTrue(mgr->GetVisibleItemByIndex(2, &visibleItem) == E_FAIL);
+
+            Assert::IsTrue(mgr->Shutdown() == S_OK);
+        }
+
+        TEST_METHOD(VerifyAddItems)
+        {
+            CComPtr<IPowerRenameManager> mgr;
+            Assert::IsTrue(CPowerRenameManager::s_CreateInstance(&mgr) == S_OK);
+            CMockPowerRenameManagerEvents* mockMgrEvents = new CMockPowerRenameManagerEvents();
+            CComPtr<IPowerRenameManagerEvents> mgrEvents;
+            Assert::IsTrue(mockMgrEvents->QueryInterface(IID_PPV_ARGS(&mgrEvents)) == S_OK);
+            DWORD cookie = 0;
+            Assert::IsTrue(mgr->Advise(mgrEvents, &cookie) == S_OK);
+
+            CComPtr<IPowerRenameItem> items[3];
+            for (auto& item : items)
+            {
+                CMockPowerRenameItem::CreateInstance(L"foo", L"foo", 0, false, SYSTEMTIME{ 0 }, &item);
+            }
+
+            IPowerRenameItem* batch[] = { items[0], items[1], items[2] };
+            Assert::IsTrue(mgr->AddItems(batch, ARRAYSIZE(batch)) == S_OK);
+
+            // One event for the batch
+            Assert::IsTrue(mockMgrEvents->m_itemAdded == items[2]);
+
+            UINT count = 0;
+            Assert::IsTrue(mgr->GetItemCount(&count) == S_OK);
+            Assert::AreEqual(3u, count);
+            for (UINT i = 0; i < count; i++)
+            {
+                CComPtr<IPowerRenameItem> item;
+                Assert::IsTrue(mgr->GetItemByIndex(i, &item) == S_OK);
+                Assert::IsTrue(item == items[i]);
+            }
+
+            // Already added
+            Assert::IsTrue(mgr->AddItems(batch, 1) == E_FAIL);
+
+            Assert::IsTrue(mgr->UnAdvise(cookie) == S_OK);
+            Assert::IsTrue(mgr->Shutdown() == S_OK);
+            mockMgrEvents->Release();
+        }
+
+        TEST_METHOD(VerifyVisibleIndexAfterOutOfOrderAdd)
+        {
+            CComPtr<IPowerRenameManager> mgr;
+            Assert::IsTrue(CPowerRenameManager::s_CreateInstance(&mgr) == S_OK);
+
+            CComPtr<IPowerRenameItem> items[4];
+            for (auto& item : items)
+            {
+                CMockPowerRenameItem::CreateInstance(L"foo", L"foo", 0, false, SYSTEMTIME{ 0 }, &item);
+            }
+
+            Assert::IsTrue(mgr->AddItem(items[1]) == S_OK);
+            Assert::IsTrue(mgr->AddItem(items[3]) == S_OK);
+            items[3]->PutSelected(false);
+            Assert::IsTrue(mgr->SwitchFilter(0) == S_OK);
+            UINT count = 0;
+            Assert::IsTrue(mgr->GetVisibleItemCount(&count) == S_OK);
+            Assert::AreEqual(1u, count);
+
+            // Both go before items already added, the visibility of those must move with them
+            IPowerRenameItem* batch[] = { items[2], items[0] };
+            Assert::IsTrue(mgr->AddItems(batch, ARRAYSIZE(batch)) == S_OK);
+            for (UINT i = 0; i < 3; i++)
+            {
+                CComPtr<IPowerRenameItem> visibleItem;
+                Assert::IsTrue(mgr->GetVisibleItemByIndex(i, &visibleItem) == S_OK);
+                Assert::IsTrue(visibleItem == items[i]);
+            }
+            CComPtr<IPowerRenameItem> hiddenItem;
+            Assert::IsTrue(mgr->GetVisibleItemByIndex(3, &hiddenItem) == E_FAIL);
+
+            // A batch holding the same item twice stops at the second one
+            CComPtr<IPowerRenameItem> newItem;
+            CMockPowerRenameItem::CreateInstance(L"foo", L"foo", 0, false, SYSTEMTIME{ 0 }, &newItem);
+            IPowerRenameItem* duplicateBatch[] = { newItem, newItem };
+            Assert::IsTrue(mgr->AddItems(duplicateBatch, ARRAYSIZE(duplicateBatch)) == E_FAIL);
+            Assert::IsTrue(mgr->GetItemCount(&count) == S_OK);
+            Assert::AreEqual(5u, count);
+
+            Assert::IsTrue(mgr->Shutdown() == S_OK);
+        }
+
+        // 100k items added in reverse id order, then item access, filter switching and SetVisible
+        BEGIN_TEST_METHOD_ATTRIBUTE(VerifyItemStoreBenchmark)
+            TEST_METHOD_ATTRIBUTE(L"TestCategory", L"Benchmark")
+            TEST_METHOD_ATTRIBUTE(L"Ignore", L"true")
+        END_TEST_METHOD_ATTRIBUTE()
+        TEST_METHOD(VerifyItemStoreBenchmark)
+        {
+            const UINT itemCount = 100000;
+            std::vector<CComPtr<IPowerRenameItem>> items(itemCount);
+            for (UINT i = 0; i < itemCount; i++)
+            {
+                CMockPowerRenameItem::CreateInstance(L"foo", L"foo", i % 4, (i % 4) != 3, SYSTEMTIME{ 0 }, &items[i]);
+                if (i % 3 == 0)
+                {
+                    items[i]->PutSelected(false);
+                }
+            }
+
+            CComPtr<IPowerRenameManager> mgr;
+            Assert::IsTrue(CPowerRenameManager::s_CreateInstance(&mgr) == S_OK);
+
+            auto ms = [](std::chrono::steady_clock::time_point start) {
+                return std::to_wstring(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+            };
+
+            auto startTime = std::chrono::steady_clock::now();
+            for (UINT end = itemCount; end > 0;)
+            {
+                const UINT begin = end > DEFAULT_CHUNK_SIZE ? end - DEFAULT_CHUNK_SIZE : 0;
+                std::vector<IPowerRenameItem*> batch;
+                for (UINT i = end; i-- > begin;)
+                {
+                    batch.push_back(items[i]);
+                }
+                Assert::IsTrue(mgr->AddItems(batch.data(), static_cast<UINT>(batch.size())) == S_OK);
+                end = begin;
+            }
+            const std::wstring addMs = ms(startTime);
+
+            startTime = std::chrono::steady_clock::now();
+            for (UINT i = 0; i < itemCount; i++)
+            {
+                CComPtr<IPowerRenameItem> item;
+                Assert::IsTrue(mgr->GetItemByIndex(i, &item) == S_OK);
+                int id = 0;
+                item->GetId(&id);
+                CComPtr<IPowerRenameItem> itemById;
+                Assert::IsTrue(mgr->GetItemById(id, &itemById) == S_OK);
+                Assert::IsTrue(item == items[i] && itemById == items[i]);
+            }
+            const std::wstring accessMs = ms(startTime);
+
+            // Selected, FlagsApplicable and back to None, painting every visible row
+            startTime = std::chrono::steady_clock::now();
+            UINT visibleCounts[3] = {};
+            for (UINT filter = 0; filter < 3; filter++)
+            {
+                Assert::IsTrue(mgr->SwitchFilter(0) == S_OK);
+                Assert::IsTrue(mgr->GetVisibleItemCount(&visibleCounts[filter]) == S_OK);
+                for (UINT i = 0; i < visibleCounts[filter]; i++)
+                {
+                    CComPtr<IPowerRenameItem> item;
+                    Assert::IsTrue(mgr->GetVisibleItemByIndex(i, &item) == S_OK);
+                }
+            }
+            const std::wstring filterMs = ms(startTime);
+            Assert::IsTrue(visibleCounts[0] < itemCount);
+            Assert::AreEqual(itemCount, visibleCounts[2]);
+
+            startTime = std::chrono::steady_clock::now();
+            Assert::IsTrue(mgr->SwitchFilter(0) == S_OK);
+            for (int i = 0; i < 10; i++)
+            {
+                Assert::IsTrue(mgr->SetVisible() == S_OK);
+            }
+            const std::wstring setVisibleMs = ms(startTime);
+
+            Assert::IsTrue(mgr->Shutdown() == S_OK);
+            Logger::WriteMessage((std::to_wstring(itemCount) + L" items: added in reverse order in " + addMs + L" ms, access by index and id " + accessMs +
+                                  L" ms, 3 filter switches " + filterMs + L" ms, 10 SetVisible " + setVisibleMs + L" ms\n")
+                                     .c_str());
+        }
+
+        // Memory per item of the item table and time to compute the preview of all items,
+        // from setting the search term to the regex worker completing
+        BEGIN_TEST_METHOD_ATTRIBUTE(VerifyPreviewBenchmark)
+            TEST_METHOD_ATTRIBUTE(L"TestCategory", L"Benchmark")
+            TEST_METHOD_ATTRIBUTE(L"Ignore", L"true")
+        END_TEST_METHOD_ATTRIBUTE()
+        TEST_METHOD(VerifyPreviewBenchmark)
+        {
+            for (UINT itemCount : { 10000u, 100000u, 1000000u })
+            {
+                std::vector<CComPtr<IPowerRenameItem>> items(itemCount);
+                CPowerRenameItemTable itemTable;
+                for (UINT i = 0; i < itemCount; i++)
+                {
+                    CMockPowerRenameItem::CreateInstance(L"c:\\foo\\foo.txt", L"foo.txt", 0, false, SYSTEMTIME{ 0 }, &items[i]);
+                    Assert::IsTrue(itemTable.Insert(i, items[i]) == S_OK);
+                }
+                const size_t bytesPerItem = itemTable.GetMemoryUsage() / itemCount;
+
+                CComPtr<IPowerRenameManager> mgr;
+                Assert::IsTrue(CPowerRenameManager::s_CreateInstance(&mgr) == S_OK);
+                CMockPowerRenameManagerEvents* mockMgrEvents = new CMockPowerRenameManagerEvents();
+                CComPtr<IPowerRenameManagerEvents> mgrEvents;
+                Assert::IsTrue(mockMgrEvents->QueryInterface(IID_PPV_ARGS(&mgrEvents)) == S_OK);
+                DWORD cookie = 0;
+                Assert::IsTrue(mgr->Advise(mgrEvents, &cookie) == S_OK);
+
+                // Runs the message loop of the manager until the regex worker reports completion
+                auto waitForPreview = [&]() {
+                    while (!mockMgrEvents->m_regExCompleted)
+                    {
+                        MsgWaitForMultipleObjects(0, nullptr, FALSE, INFINITE, QS_ALLINPUT);
+                        MSG msg;
+                        while (PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE))
+                        {
+                            TranslateMessage(&msg);
+                            DispatchMessage(&msg);
+                        }
+                    }
+                    mockMgrEvents->m_regExCompleted = false;
+                };
+
+                CComPtr<IPowerRenameRegEx> renRegEx;
+                Assert::IsTrue(mgr->GetRenameRegEx(&renRegEx) == S_OK);
+                Assert::IsTrue(renRegEx->PutReplaceTerm(L"bar") == S_OK);
+                waitForPreview();
+
+                for (UINT begin = 0; begin < itemCount; begin += DEFAULT_CHUNK_SIZE)
+                {
+                    std::vector<IPowerRenameItem*> batch;
+                    for (UINT i = begin; i < (std::min)(begin + DEFAULT_CHUNK_SIZE, itemCount); i++)
+                    {
+                        batch.push_back(items[i]);
+                    }
+                    Assert::IsTrue(mgr->AddItems(batch.data(), static_cast<UINT>(batch.size())) == S_OK);
+                }
+
+                auto startTime = std::chrono::steady_clock::now();
+                Assert::IsTrue(renRegEx->PutSearchTerm(L"foo") == S_OK);
+                waitForPreview();
+                const double previewMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+
+                PWSTR newName = nullptr;
+                Assert::IsTrue(items[itemCount - 1]->GetNewName(&newName) == S_OK);
+                Assert::AreEqual(L"bar.txt", newName);
+                CoTaskMemFree(newName);
+
+                Assert::IsTrue(mgr->Shutdown() == S_OK);
+                mockMgrEvents->Release();
+
+                Logger::WriteMessage((std::to_wstring(itemCount) + L" items: " + std::to_wstring(bytesPerItem) + L" bytes per item in the item table, preview in " +
+                                      std::to_wstring(previewMs) + L" ms (" + std::to_wstring(static_cast<size_t>(itemCount * 1000.0 / (std::max)(previewMs, 0.001))) + L" items/s)\n")
+                                         .c_str());
+            }
+        }
+
+        TEST_METHOD(VerifyItemTable)
+        {
+            CComPtr<IPowerRenameItem> file;
+            CComPtr<IPowerRenameItem> folder;
+            CMockPowerRenameItem::CreateInstance(L"c:\\foo\\bar.txt", L"bar.txt", 1, false, SYSTEMTIME{ 2020, 7, 3, 22, 15, 6, 42, 453 }, &file);
+            CMockPowerRenameItem::CreateInstance(L"c:\\foo", L"foo", 0, true, SYSTEMTIME{ 0 }, &folder);
+
+            CPowerRenameItemTable itemTable;
+            Assert::IsTrue(itemTable.Insert(0, file) == S_OK);
+            Assert::IsTrue(itemTable.Insert(0, folder) == S_OK);
+            Assert::AreEqual(2u, itemTable.GetCount());
+
+            int id = 0;
+            folder->GetId(&id);
+            Assert::AreEqual(id, itemTable.GetId(0));
+            Assert::AreEqual(L"foo", itemTable.GetOriginalName(0));
+            Assert::IsTrue(itemTable.GetIsFolder(0));
+            Assert::IsFalse(itemTable.GetIsSubFolderContent(0));
+
+            Assert::AreEqual(L"bar.txt", itemTable.GetOriginalName(1));
+            Assert::IsFalse(itemTable.GetIsFolder(1));
+            Assert::AreEqual(1u, itemTable.GetDepth(1));
+
+            Assert::IsTrue(itemTable.ReadTime(1, file) == S_OK);
+            Assert::AreEqual(static_cast<WORD>(2020), itemTable.GetTime(1).wYear);
+
+            Assert::IsFalse(itemTable.UpdateNewName(1, nullptr));
+            Assert::IsTrue(itemTable.UpdateNewName(1, L"baz.txt"));
+            Assert::IsFalse(itemTable.UpdateNewName(1, L"baz.txt"));
+            Assert::IsTrue(itemTable.UpdateNewName(1, nullptr));
+
+            PCWSTR substitutedName = nullptr;
+            Assert::IsFalse(itemTable.GetSubstitutedName(1, 1, &substitutedName));
+            itemTable.PutSubstitutedName(1, 1, L"baz.txt");
+            Assert::IsTrue(itemTable.GetSubstitutedName(1, 1, &substitutedName));
+            Assert::AreEqual(L"baz.txt", substitutedName);
+            itemTable.PutSubstitutedName(0, 1, nullptr);
+            Assert::IsTrue(itemTable.GetSubstitutedName(0, 1, &substitutedName));
+            Assert::IsNull(substitutedName);
+            // Entries of an older generation are ignored
+            Assert::IsFalse(itemTable.GetSubstitutedName(1, 2, &substitutedName));
+
+            itemTable.Clear();
+            Assert::AreEqual(0u, itemTable.GetCount());
+        }
+
+        TEST_METHOD(VerifyItemTableFindRowAfterInsert)
+        {
+            CComPtr<IPowerRenameItem> items[3];
+            int ids[3] = {};
+            for (int i = 0; i < 3; i++)
+            {
+                CMockPowerRenameItem::CreateInstance(L"c:\\foo", L"foo", 0, false, SYSTEMTIME{ 0 }, &items[i]);
+                items[i]->GetId(&ids[i]);
+            }
+
+            CPowerRenameItemTable itemTable;
+            Assert::IsTrue(itemTable.Insert(0, items[1]) == S_OK);
+            Assert::IsTrue(itemTable.Insert(1, items[2]) == S_OK);
+
+            UINT row = 0;
+            Assert::IsTrue(itemTable.FindRow(ids[2], 1, &row));
+            Assert::AreEqual(1u, row);
+
+            // An insert in front moves the rows the item was last seen at
+            Assert::IsTrue(itemTable.Insert(0, items[0]) == S_OK);
+            Assert::IsTrue(itemTable.FindRow(ids[2], 1, &row));
+            Assert::AreEqual(2u, row);
+            Assert::IsTrue(itemTable.FindRow(ids[1], 5, &row));
+            Assert::AreEqual(1u, row);
+            Assert::IsFalse(itemTable.FindRow(ids[2] + 1, 0, &row));
+        }
+
         TEST_METHOD(VerifyRenameManagerEvents)
         {
             CComPtr<IPowerRenameManager> mgr;
@@ -291,6 +659,81 @@ namespace PowerRenameManagerTests
         }
 
 
+        TEST_METHOD (VerifyEnumerateItemsRename)
+        {
+            rename_pairs renamePairs[] = {
+                { L"foo1.txt", L"bar1 (1).txt", true, true, 0 },
+                { L"foo2.txt", L"bar2 (2).txt", true, true, 0 },
+                { L"baz.txt", L"baz.txt", true, false, 0 },
+                { L"foo3.txt", L"bar3 (3).txt", true, true, 0 },
+            };
+
+            RenameHelper(renamePairs, ARRAYSIZE(renamePairs), L"foo", L"bar", SYSTEMTIME{ 0 }, DEFAULT_FLAGS | EnumerateItems);
+        }
+
+        TEST_METHOD (VerifyParallelForEachChunkVisitsAllItems)
+        {
+            const UINT itemCount = 10 * DEFAULT_CHUNK_SIZE + 7;
+            std::vector<std::atomic<int>> visits(itemCount);
+            std::atomic<UINT> chunks = 0;
+            CWorkerPool workerPool;
+            Assert::IsTrue(workerPool.ParallelForEachChunk(itemCount, DEFAULT_CHUNK_SIZE, nullptr, [&](UINT chunk, UINT begin, UINT end) {
+                Assert::AreEqual(chunk * DEFAULT_CHUNK_SIZE, begin);
+                for (UINT u = begin; u < end; u++)
+                {
+                    visits[u]++;
+                }
+                chunks++;
+                return true;
+            }));
+
+            Assert::AreEqual(GetChunkCount(itemCount, DEFAULT_CHUNK_SIZE), chunks.load());
+            for (auto& visit : visits)
+            {
+                Assert::AreEqual(1, visit.load());
+            }
+        }
+
+        TEST_METHOD (VerifyParallelForEachChunkCancel)
+        {
+            HANDLE cancelEvent = CreateEvent(nullptr, TRUE, TRUE, nullptr);
+            std::atomic<UINT> chunks = 0;
+            CWorkerPool workerPool;
+            Assert::IsFalse(workerPool.ParallelForEachChunk(1000, 10, cancelEvent, [&](UINT, UINT, UINT) {
+                chunks++;
+                return true;
+            }));
+            Assert::AreEqual(0u, chunks.load());
+            CloseHandle(cancelEvent);
+        }
+
+        TEST_METHOD (VerifyWorkerPoolThreadsAreReusedAndInMTA)
+        {
+            CWorkerPool workerPool(4);
+            const DWORD callingThreadId = GetCurrentThreadId();
+            std::mutex lock;
+            std::set<DWORD> threadIds;
+            for (int run = 0; run < 2; run++)
+            {
+                Assert::IsTrue(workerPool.ParallelForEachChunk(1000, 1, nullptr, [&](UINT, UINT, UINT) {
+                    if (GetCurrentThreadId() != callingThreadId)
+                    {
+                        APTTYPE type = APTTYPE_CURRENT;
+                        APTTYPEQUALIFIER qualifier = APTTYPEQUALIFIER_NONE;
+                        Assert::IsTrue(CoGetApartmentType(&type, &qualifier) == S_OK);
+                        Assert::IsTrue(type == APTTYPE_MTA);
+                    }
+
+                    std::scoped_lock guard(lock);
+                    threadIds.insert(GetCurrentThreadId());
+                    return true;
+                }));
+            }
+
+            // The second run does not start new threads
+            Assert::IsTrue(threadIds.size() <= workerPool.GetThreadCount() + 1);
+        }
+
         TEST_METHOD (VerifyFileAttributesNoPadding)
         {
             rename_pairs renamePairs[] = {
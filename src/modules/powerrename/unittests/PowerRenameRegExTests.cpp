@@ -4,6 +4,8 @@
 #include <PowerRenameInterfaces.h>
 #include <PowerRenameRegEx.h>
 #include "MockPowerRenameRegExEvents.h"
+#include <chrono>
+#include <regex>
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 
@@ -466,6 +468,62 @@ TEST_METHOD (VerifyFileAttributesMonthandDayNames)
     }
 }
 
+TEST_METHOD(VerifyReplaceWithFileTime)
+{
+    CComPtr<IPowerRenameRegEx> renameRegEx;
+    Assert::IsTrue(CPowerRenameRegEx::s_CreateInstance(&renameRegEx) == S_OK);
+    Assert::IsTrue(renameRegEx->PutSearchTerm(L"foo") == S_OK);
+    Assert::IsTrue(renameRegEx->PutReplaceTerm(L"$YYYY-$MM") == S_OK);
+
+    PWSTR result = nullptr;
+    Assert::IsTrue(renameRegEx->ReplaceWithFileTime(L"foo", SYSTEMTIME{ 2020, 7, 3, 22, 15, 6, 42, 453 }, &result) == S_OK);
+    Assert::IsTrue(wcscmp(result, L"2020-07") == 0);
+    CoTaskMemFree(result);
+
+    Assert::IsTrue(renameRegEx->ReplaceWithFileTime(L"foo", SYSTEMTIME{ 2019, 12, 3, 22, 15, 6, 42, 453 }, &result) == S_OK);
+    Assert::IsTrue(wcscmp(result, L"2019-12") == 0);
+    CoTaskMemFree(result);
+}
+
+// The replace term is formatted once before the file time is expanded, which has to give the
+// same result as formatting the expanded term for every item
+TEST_METHOD(VerifyFileTimeWithCapturingGroups)
+{
+    PCWSTR replaceTerms[] = {
+        L"$1_$YYYY$2",
+        L"$$$Y$1",
+        L"$Y$0$1",
+        L"$$YYYY$2",
+        L"$MMM$10",
+        L"$D$$$1$$$0",
+        L"$0$YY$0$0",
+        L"$hh$1$$2$$$3",
+        L"$$$$fff$1$$$$$2",
+        L"$DDDD$$$DD$12",
+    };
+    const SYSTEMTIME fileTime = { 2020, 7, 3, 22, 15, 6, 42, 453 };
+
+    CComPtr<IPowerRenameRegEx> renameRegEx;
+    Assert::IsTrue(CPowerRenameRegEx::s_CreateInstance(&renameRegEx) == S_OK);
+    Assert::IsTrue(renameRegEx->PutFlags(UseRegularExpressions) == S_OK);
+    Assert::IsTrue(renameRegEx->PutSearchTerm(L"(foo)(bar)") == S_OK);
+
+    for (auto replaceTerm : replaceTerms)
+    {
+        std::wstring formatTerm;
+        CDateTimeTemplate(replaceTerm).Expand(fileTime, formatTerm);
+        formatTerm = std::regex_replace(formatTerm, std::wregex(L"(([^\\$]|^)(\\$\\$)*)\\$[0]"), L"$1$$$0");
+        formatTerm = std::regex_replace(formatTerm, std::wregex(L"(([^\\$]|^)(\\$\\$)*)\\$([1-9])"), L"$1$0$4");
+        std::wstring expected = std::regex_replace(std::wstring(L"foobar"), std::wregex(L"(foo)(bar)"), formatTerm);
+
+        PWSTR result = nullptr;
+        Assert::IsTrue(renameRegEx->PutReplaceTerm(replaceTerm) == S_OK);
+        Assert::IsTrue(renameRegEx->ReplaceWithFileTime(L"foobar", fileTime, &result) == S_OK);
+        Assert::AreEqual(expected, std::wstring(result), replaceTerm);
+        CoTaskMemFree(result);
+    }
+}
+
 TEST_METHOD(VerifyLookbehindFails)
 {
     // Standard Library Regex Engine does not support lookbehind, thus test should fail.
@@ -490,6 +548,203 @@ TEST_METHOD(VerifyLookbehindFails)
     }
 }
 
+TEST_METHOD(VerifyPatternUpdatedOnChange)
+{
+    CComPtr<IPowerRenameRegEx> renameRegEx;
+    Assert::IsTrue(CPowerRenameRegEx::s_CreateInstance(&renameRegEx) == S_OK);
+    Assert::IsTrue(renameRegEx->PutFlags(UseRegularExpressions | MatchAllOccurences) == S_OK);
+    Assert::IsTrue(renameRegEx->PutSearchTerm(L"^f") == S_OK);
+    Assert::IsTrue(renameRegEx->PutReplaceTerm(L"b") == S_OK);
+
+    PWSTR result = nullptr;
+    Assert::IsTrue(renameRegEx->Replace(L"foo", &result) == S_OK);
+    Assert::IsTrue(wcscmp(result, L"boo") == 0);
+    CoTaskMemFree(result);
+
+    // New search term
+    Assert::IsTrue(renameRegEx->PutSearchTerm(L"o$") == S_OK);
+    Assert::IsTrue(renameRegEx->Replace(L"foo", &result) == S_OK);
+    Assert::IsTrue(wcscmp(result, L"fob") == 0);
+    CoTaskMemFree(result);
+
+    // New replace term
+    Assert::IsTrue(renameRegEx->PutReplaceTerm(L"xy") == S_OK);
+    Assert::IsTrue(renameRegEx->Replace(L"foo", &result) == S_OK);
+    Assert::IsTrue(wcscmp(result, L"foxy") == 0);
+    CoTaskMemFree(result);
+
+    // Without regular expressions the search term is matched literally
+    Assert::IsTrue(renameRegEx->PutFlags(MatchAllOccurences) == S_OK);
+    Assert::IsTrue(renameRegEx->Replace(L"foo", &result) == S_OK);
+    Assert::IsTrue(wcscmp(result, L"foo") == 0);
+    CoTaskMemFree(result);
+}
+
+TEST_METHOD(VerifyReplaceTermChangeReusesMatches)
+{
+    CComPtr<IPowerRenameRegEx> renameRegEx;
+    Assert::IsTrue(CPowerRenameRegEx::s_CreateInstance(&renameRegEx) == S_OK);
+    Assert::IsTrue(renameRegEx->PutFlags(UseRegularExpressions | MatchAllOccurences) == S_OK);
+    Assert::IsTrue(renameRegEx->PutSearchTerm(L"(\\d+)-(\\w)") == S_OK);
+    Assert::IsTrue(renameRegEx->PutReplaceTerm(L"x") == S_OK);
+
+    PWSTR result = nullptr;
+    Assert::IsTrue(renameRegEx->Replace(L"a12-b 3-c", &result) == S_OK);
+    Assert::IsTrue(wcscmp(result, L"ax x") == 0);
+    CoTaskMemFree(result);
+
+    // The matches found above are substituted with the new replace term
+    Assert::IsTrue(renameRegEx->PutReplaceTerm(L"$2_$1") == S_OK);
+    Assert::IsTrue(renameRegEx->Replace(L"a12-b 3-c", &result) == S_OK);
+    Assert::IsTrue(wcscmp(result, L"ab_12 c_3") == 0);
+    CoTaskMemFree(result);
+
+    Assert::IsTrue(renameRegEx->PutReplaceTerm(L"[$1]") == S_OK);
+    Assert::IsTrue(renameRegEx->Replace(L"a12-b 3-c", &result) == S_OK);
+    Assert::IsTrue(wcscmp(result, L"a[12] [3]") == 0);
+    CoTaskMemFree(result);
+
+    // Only the first match once MatchAllOccurences is cleared
+    Assert::IsTrue(renameRegEx->PutFlags(UseRegularExpressions) == S_OK);
+    Assert::IsTrue(renameRegEx->Replace(L"a12-b 3-c", &result) == S_OK);
+    Assert::IsTrue(wcscmp(result, L"a[12] 3-c") == 0);
+    CoTaskMemFree(result);
+
+    // Simple search
+    Assert::IsTrue(renameRegEx->PutFlags(MatchAllOccurences) == S_OK);
+    Assert::IsTrue(renameRegEx->PutSearchTerm(L"Ab") == S_OK);
+    Assert::IsTrue(renameRegEx->PutReplaceTerm(L"ab") == S_OK);
+    Assert::IsTrue(renameRegEx->Replace(L"abcABab", &result) == S_OK);
+    Assert::IsTrue(wcscmp(result, L"abcabab") == 0);
+    CoTaskMemFree(result);
+
+    Assert::IsTrue(renameRegEx->PutReplaceTerm(L"") == S_OK);
+    Assert::IsTrue(renameRegEx->Replace(L"abcABab", &result) == S_OK);
+    Assert::IsTrue(wcscmp(result, L"c") == 0);
+    CoTaskMemFree(result);
+}
+
+TEST_METHOD(VerifyInvalidPatternRecovers)
+{
+    CComPtr<IPowerRenameRegEx> renameRegEx;
+    Assert::IsTrue(CPowerRenameRegEx::s_CreateInstance(&renameRegEx) == S_OK);
+    Assert::IsTrue(renameRegEx->PutFlags(UseRegularExpressions) == S_OK);
+    Assert::IsTrue(renameRegEx->PutReplaceTerm(L"bar") == S_OK);
+
+    PWSTR result = nullptr;
+    Assert::IsTrue(renameRegEx->PutSearchTerm(L"(fo") == S_OK);
+    Assert::IsTrue(renameRegEx->Replace(L"foo", &result) == E_FAIL);
+    Assert::IsTrue(result == nullptr);
+
+    Assert::IsTrue(renameRegEx->PutSearchTerm(L"(fo)") == S_OK);
+    Assert::IsTrue(renameRegEx->Replace(L"foo", &result) == S_OK);
+    Assert::IsTrue(wcscmp(result, L"baro") == 0);
+    CoTaskMemFree(result);
+}
+
+// Items/sec of Replace with the compiled pattern, against building the regex and escaping the
+// replace term for every item as Replace did before the pattern was cached
+BEGIN_TEST_METHOD_ATTRIBUTE(VerifyCompiledPatternBenchmark)
+    TEST_METHOD_ATTRIBUTE(L"TestCategory", L"Benchmark")
+    TEST_METHOD_ATTRIBUTE(L"Ignore", L"true")
+END_TEST_METHOD_ATTRIBUTE()
+TEST_METHOD(VerifyCompiledPatternBenchmark)
+{
+    const int count = 50000;
+    std::vector<std::wstring> sources;
+    for (int i = 0; i < count; i++)
+    {
+        // Distinct sources so the match cache does not answer for the repeated items
+        sources.push_back(L"IMG_" + std::to_wstring(i) + L"_holiday.jpg");
+    }
+    const std::wstring searchTerm = L"IMG_(\\d+)_(\\w+)";
+    const std::wstring replaceTerm = L"$2-$1";
+
+    auto startTime = std::chrono::steady_clock::now();
+    size_t uncachedLength = 0;
+    for (const auto& source : sources)
+    {
+        std::wregex pattern(searchTerm, std::regex_constants::icase | std::regex_constants::ECMAScript);
+        std::wstring formatTerm = std::regex_replace(replaceTerm, std::wregex(L"(([^\\$]|^)(\\$\\$)*)\\$[0]"), L"$1$$$0");
+        formatTerm = std::regex_replace(formatTerm, std::wregex(L"(([^\\$]|^)(\\$\\$)*)\\$([1-9])"), L"$1$0$4");
+        uncachedLength += std::regex_replace(source, pattern, formatTerm).length();
+    }
+    const double uncachedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+
+    CComPtr<IPowerRenameRegEx> renameRegEx;
+    Assert::IsTrue(CPowerRenameRegEx::s_CreateInstance(&renameRegEx) == S_OK);
+    Assert::IsTrue(renameRegEx->PutFlags(UseRegularExpressions | MatchAllOccurences) == S_OK);
+    Assert::IsTrue(renameRegEx->PutSearchTerm(searchTerm.c_str()) == S_OK);
+    Assert::IsTrue(renameRegEx->PutReplaceTerm(replaceTerm.c_str()) == S_OK);
+
+    startTime = std::chrono::steady_clock::now();
+    size_t cachedLength = 0;
+    for (const auto& source : sources)
+    {
+        PWSTR result = nullptr;
+        Assert::IsTrue(renameRegEx->Replace(source.c_str(), &result) == S_OK);
+        cachedLength += wcslen(result);
+        CoTaskMemFree(result);
+    }
+    const double cachedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+
+    Assert::AreEqual(uncachedLength, cachedLength);
+    auto itemsPerSecond = [count](double ms) { return std::to_wstring(static_cast<size_t>(count * 1000.0 / (std::max)(ms, 0.001))); };
+    Logger::WriteMessage((std::to_wstring(count) + L" items: " + itemsPerSecond(uncachedMs) + L" items/s compiling per item, " +
+                          itemsPerSecond(cachedMs) + L" items/s with the compiled pattern\n")
+                             .c_str());
+}
+
+// Preparing the dated replace term of an item: expanding and then escaping the group references
+// of every item, against expanding the template escaped once as Replace does
+BEGIN_TEST_METHOD_ATTRIBUTE(VerifyDatedReplaceTermBenchmark)
+    TEST_METHOD_ATTRIBUTE(L"TestCategory", L"Benchmark")
+    TEST_METHOD_ATTRIBUTE(L"Ignore", L"true")
+END_TEST_METHOD_ATTRIBUTE()
+TEST_METHOD(VerifyDatedReplaceTermBenchmark)
+{
+    const int count = 50000;
+    const std::wstring replaceTerm = L"$1_$YYYY-$MM-$DD_$hh$mm$ss_$2";
+    const std::wregex zeroGroupPattern(L"(([^\\$]|^)(\\$\\$)*)\\$[0]");
+    const std::wregex numberedGroupPattern(L"(([^\\$]|^)(\\$\\$)*)\\$([1-9])");
+    std::vector<SYSTEMTIME> fileTimes;
+    for (int i = 0; i < count; i++)
+    {
+        fileTimes.push_back({ static_cast<WORD>(1990 + i % 40), static_cast<WORD>(1 + i % 12), 0, static_cast<WORD>(1 + i % 28), static_cast<WORD>(i % 24), static_cast<WORD>(i % 60), 0, 0 });
+    }
+
+    const CDateTimeTemplate rawTemplate(replaceTerm.c_str());
+    auto startTime = std::chrono::steady_clock::now();
+    std::vector<std::wstring> perItemTerms;
+    for (const auto& fileTime : fileTimes)
+    {
+        std::wstring datedReplaceTerm;
+        rawTemplate.Expand(fileTime, datedReplaceTerm);
+        datedReplaceTerm = std::regex_replace(datedReplaceTerm, zeroGroupPattern, L"$1$$$0");
+        perItemTerms.push_back(std::regex_replace(datedReplaceTerm, numberedGroupPattern, L"$1$0$4"));
+    }
+    const double perItemMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+
+    std::wstring formatTerm = std::regex_replace(replaceTerm, zeroGroupPattern, L"$1$$$0");
+    formatTerm = std::regex_replace(formatTerm, numberedGroupPattern, L"$1$0$4");
+    const CDateTimeTemplate formattedTemplate(formatTerm.c_str());
+    startTime = std::chrono::steady_clock::now();
+    std::vector<std::wstring> preformattedTerms;
+    for (const auto& fileTime : fileTimes)
+    {
+        std::wstring datedReplaceTerm;
+        formattedTemplate.Expand(fileTime, datedReplaceTerm);
+        preformattedTerms.push_back(std::move(datedReplaceTerm));
+    }
+    const double preformattedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+
+    Assert::IsTrue(perItemTerms == preformattedTerms);
+    auto itemsPerSecond = [count](double ms) { return std::to_wstring(static_cast<size_t>(count * 1000.0 / (std::max)(ms, 0.001))); };
+    Logger::WriteMessage((std::to_wstring(count) + L" items: " + itemsPerSecond(perItemMs) + L" items/s escaping per item, " +
+                          itemsPerSecond(preformattedMs) + L" items/s with the term escaped once\n")
+                             .c_str());
+}
+
 TEST_METHOD(VerifyEventsFire)
 {
     CComPtr<IPowerRenameRegEx> renameRegEx;
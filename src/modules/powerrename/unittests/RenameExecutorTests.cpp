@@ -0,0 +1,241 @@
+#include "pch.h"
+#include "CppUnitTest.h"
+#include <RenameExecutor.h>
+#include "TestFileHelper.h"
+#include <atomic>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace RenameExecutorTests
+{
+    TEST_CLASS(RenameExecutorTests)
+    {
+    public:
+        // Folder a containing folder b containing file c.txt, plus d.txt next to a
+        void AddTestItems(CTestFileHelper& helper)
+        {
+            Assert::IsTrue(helper.AddFolder(L"a"));
+            Assert::IsTrue(helper.AddFolder(L"a\\b"));
+            Assert::IsTrue(helper.AddFile(L"a\\b\\c.txt"));
+            Assert::IsTrue(helper.AddFile(L"d.txt"));
+        }
+
+        // Listed parents first, the executor has to reorder them
+        std::vector<RenameRequest> GetTestRequests(CTestFileHelper& helper)
+        {
+            return {
+                { helper.GetFullPath(L"a").wstring(), L"x" },
+                { helper.GetFullPath(L"d.txt").wstring(), L"w.txt" },
+                { helper.GetFullPath(L"a\\b").wstring(), L"y" },
+                { helper.GetFullPath(L"a\\b\\c.txt").wstring(), L"z.txt" },
+            };
+        }
+
+        TEST_METHOD(VerifyChildrenRenamedFirst)
+        {
+            CTestFileHelper helper;
+            AddTestItems(helper);
+
+            std::atomic<UINT> lastProgress = 0;
+            CFileSystemRenameBackend backend;
+            CRenameExecutor executor(backend);
+            executor.SetProgressCallback([&](UINT processed, UINT total) {
+                Assert::AreEqual(4u, total);
+                lastProgress = std::max<UINT>(lastProgress, processed);
+            });
+
+            RenameStats stats;
+            Assert::IsTrue(executor.Execute(GetTestRequests(helper), nullptr, stats) == S_OK);
+            Assert::AreEqual(4u, stats.renamedCount);
+            Assert::AreEqual(0u, stats.failedCount);
+            Assert::AreEqual(4u, lastProgress.load());
+
+            Assert::IsTrue(helper.PathExists(L"x\\y\\z.txt"));
+            Assert::IsTrue(helper.PathExists(L"w.txt"));
+            Assert::IsFalse(helper.PathExists(L"a"));
+        }
+
+        TEST_METHOD(VerifyExistingItemNotOverwritten)
+        {
+            CTestFileHelper helper;
+            Assert::IsTrue(helper.AddFile(L"foo.txt"));
+            Assert::IsTrue(helper.AddFile(L"bar.txt"));
+
+            CFileSystemRenameBackend backend;
+            CRenameExecutor executor(backend);
+            RenameStats stats;
+            Assert::IsTrue(executor.Execute({ { helper.GetFullPath(L"foo.txt").wstring(), L"bar.txt" } }, nullptr, stats) == S_OK);
+            Assert::AreEqual(0u, stats.renamedCount);
+            Assert::AreEqual(1u, stats.failedCount);
+            Assert::IsTrue(helper.PathExists(L"foo.txt"));
+        }
+
+        TEST_METHOD(VerifyCaseOnlyRename)
+        {
+            CTestFileHelper helper;
+            Assert::IsTrue(helper.AddFile(L"foo.txt"));
+
+            CFileSystemRenameBackend backend;
+            CRenameExecutor executor(backend);
+            RenameStats stats;
+            Assert::IsTrue(executor.Execute({ { helper.GetFullPath(L"foo.txt").wstring(), L"FOO.txt" } }, nullptr, stats) == S_OK);
+            Assert::AreEqual(1u, stats.renamedCount);
+            Assert::AreEqual(0u, stats.failedCount);
+        }
+
+        // Queues the renames and on Commit renames only the first one
+        class CDeferredRenameBackend : public IRenameBackend
+        {
+        public:
+            HRESULT Rename(_In_ const std::wstring& path, _In_ const std::wstring& newName, _Out_ std::wstring& newPath) override
+            {
+                newPath.clear();
+                m_queued.push_back({ path, newName });
+                return S_OK;
+            }
+
+            bool SupportsConcurrentRename() const override { return false; }
+
+            HRESULT Commit() override
+            {
+                m_committed = true;
+                return m_queued.empty() ? S_OK : HRESULT_FROM_WIN32(ERROR_CANCELLED);
+            }
+
+            bool GetCommittedCounts(_Out_ UINT& renamedCount, _Out_ UINT& failedCount) const override
+            {
+                renamedCount = m_committed && !m_queued.empty() ? 1 : 0;
+                failedCount = m_committed && !m_queued.empty() ? static_cast<UINT>(m_queued.size()) - 1 : 0;
+                return true;
+            }
+
+        private:
+            std::vector<RenameRequest> m_queued;
+            bool m_committed = false;
+        };
+
+        TEST_METHOD(VerifyDeferredRenameCounts)
+        {
+            CTestFileHelper helper;
+            AddTestItems(helper);
+
+            // Queued items are not counted as renamed until Commit reports them
+            CDeferredRenameBackend backend;
+            CRenameExecutor executor(backend);
+            RenameStats stats;
+            Assert::IsTrue(executor.Execute(GetTestRequests(helper), nullptr, stats) == HRESULT_FROM_WIN32(ERROR_CANCELLED));
+            Assert::AreEqual(1u, stats.renamedCount);
+            Assert::AreEqual(3u, stats.failedCount);
+
+            CDeferredRenameBackend canceledBackend;
+            CRenameExecutor canceledExecutor(canceledBackend);
+            HANDLE cancelEvent = CreateEvent(nullptr, TRUE, TRUE, nullptr);
+            Assert::IsTrue(canceledExecutor.Execute(GetTestRequests(helper), cancelEvent, stats) == HRESULT_FROM_WIN32(ERROR_CANCELLED));
+            CloseHandle(cancelEvent);
+            Assert::AreEqual(0u, stats.renamedCount);
+        }
+
+        TEST_METHOD(VerifyJournalRollback)
+        {
+            CTestFileHelper helper;
+            AddTestItems(helper);
+            std::wstring journalPath = helper.GetFullPath(L"journal.bin").wstring();
+
+            CFileSystemRenameBackend backend;
+            CRenameJournal journal;
+            Assert::IsTrue(journal.Open(journalPath.c_str()) == S_OK);
+            CRenameExecutor executor(backend, &journal);
+            RenameStats stats;
+            Assert::IsTrue(executor.Execute(GetTestRequests(helper), nullptr, stats) == S_OK);
+            journal.Close();
+
+            std::vector<CRenameJournal::Entry> entries;
+            Assert::IsTrue(CRenameJournal::Load(journalPath.c_str(), entries) == S_OK);
+            Assert::AreEqual(static_cast<size_t>(4), entries.size());
+            Assert::AreEqual(helper.GetFullPath(L"a\\b\\c.txt").wstring(), entries[0].oldPath);
+            Assert::AreEqual(helper.GetFullPath(L"a\\b\\z.txt").wstring(), entries[0].newPath);
+
+            Assert::IsTrue(CRenameJournal::Rollback(entries, backend) == S_OK);
+            Assert::IsTrue(helper.PathExists(L"a\\b\\c.txt"));
+            Assert::IsTrue(helper.PathExists(L"d.txt"));
+            Assert::IsFalse(helper.PathExists(L"x"));
+        }
+
+        TEST_METHOD(VerifyJournalResume)
+        {
+            CTestFileHelper helper;
+            AddTestItems(helper);
+            std::wstring journalPath = helper.GetFullPath(L"journal.bin").wstring();
+            std::vector<RenameRequest> requests = GetTestRequests(helper);
+
+            // Interrupted batch which only got to the deepest item
+            CFileSystemRenameBackend backend;
+            {
+                CRenameJournal journal;
+                Assert::IsTrue(journal.Open(journalPath.c_str()) == S_OK);
+                CRenameExecutor executor(backend, &journal);
+                RenameStats stats;
+                Assert::IsTrue(executor.Execute({ requests[3] }, nullptr, stats) == S_OK);
+            }
+
+            std::vector<CRenameJournal::Entry> entries;
+            Assert::IsTrue(CRenameJournal::Load(journalPath.c_str(), entries) == S_OK);
+            Assert::AreEqual(static_cast<size_t>(1), entries.size());
+
+            CRenameExecutor executor(backend);
+            executor.SetCompleted(entries);
+            RenameStats stats;
+            Assert::IsTrue(executor.Execute(requests, nullptr, stats) == S_OK);
+            Assert::AreEqual(1u, stats.skippedCount);
+            Assert::AreEqual(3u, stats.renamedCount);
+            Assert::AreEqual(0u, stats.failedCount);
+            Assert::IsTrue(helper.PathExists(L"x\\y\\z.txt"));
+        }
+
+        TEST_METHOD(VerifyFileOperationJournal)
+        {
+            CTestFileHelper helper;
+            AddTestItems(helper);
+            std::wstring journalPath = helper.GetFullPath(L"journal.bin").wstring();
+
+            Assert::IsTrue(SUCCEEDED(CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED)));
+            {
+                CComPtr<IFileOperation> spFileOp;
+                Assert::IsTrue(SUCCEEDED(CoCreateInstance(CLSID_FileOperation, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&spFileOp))));
+
+                CRenameJournal journal;
+                Assert::IsTrue(journal.Open(journalPath.c_str()) == S_OK);
+                CFileOperationRenameBackend backend(spFileOp, FOF_NO_UI, nullptr, &journal);
+                CRenameExecutor executor(backend, &journal);
+                RenameStats stats;
+                Assert::IsTrue(executor.Execute(GetTestRequests(helper), nullptr, stats) == S_OK);
+                Assert::AreEqual(4u, stats.renamedCount);
+                journal.Close();
+            }
+            CoUninitialize();
+
+            // The file operation reports the renames in the order the executor queued them
+            std::vector<CRenameJournal::Entry> entries;
+            Assert::IsTrue(CRenameJournal::Load(journalPath.c_str(), entries) == S_OK);
+            Assert::AreEqual(static_cast<size_t>(4), entries.size());
+            Assert::AreEqual(helper.GetFullPath(L"a\\b\\c.txt").wstring(), entries[0].oldPath);
+            Assert::AreEqual(helper.GetFullPath(L"a\\b\\z.txt").wstring(), entries[0].newPath);
+            Assert::IsTrue(helper.PathExists(L"x\\y\\z.txt"));
+        }
+
+        TEST_METHOD(VerifyCancel)
+        {
+            CTestFileHelper helper;
+            AddTestItems(helper);
+
+            HANDLE cancelEvent = CreateEvent(nullptr, TRUE, TRUE, nullptr);
+            CFileSystemRenameBackend backend;
+            CRenameExecutor executor(backend);
+            RenameStats stats;
+            Assert::IsTrue(executor.Execute(GetTestRequests(helper), cancelEvent, stats) == HRESULT_FROM_WIN32(ERROR_CANCELLED));
+            Assert::AreEqual(0u, stats.renamedCount);
+            Assert::IsTrue(helper.PathExists(L"a\\b\\c.txt"));
+            CloseHandle(cancelEvent);
+        }
+    };
+}